@@ -10,6 +10,16 @@
 /* User includes */
 #include "arrays.h"
 
+#if ARRAY_LAYOUT > ARRAY_LAYOUT_MORTON
+#error "ARRAY_LAYOUT must be one of ARRAY_LAYOUT_* of config.h"
+#endif
+#if TILE_SIZE < 1
+#error "TILE_SIZE must be at least 1"
+#endif
+
+/* Layout of get_item_address() */
+static struct ArrayLayout array_layout = { ARRAY_LAYOUT, TILE_SIZE, ARRAY_PADDING, ROW_PADDING };
+
 /* a_equals_b_plus_c
  *
  * Simulate a[row, col] = b[row, col] + c[row, col]
@@ -31,6 +41,58 @@ void a_equals_b_plus_c(uint16_t row, uint16_t col)
     write_a(row, col);
 }
 
+/* for_each_item
+ *
+ * Visit every item in the order of the a = b + c kernel of main.c,
+ * columns outer, rows inner
+ *
+ * @param       visit
+ * @param       context     Passed to visit
+ *
+ * @return      0, or the first non-zero return of visit
+ */
+int for_each_item(item_visitor_t visit, void *context)
+{
+    /* Local Variables */
+    int status;
+
+    //Loop through columns
+    for (uint16_t j = 0; j < ARRAY_COLUMNS; j++) {
+        //Loop through rows
+        for (uint16_t i = 0; i < ARRAY_ROWS; i++) {
+            status = visit(i, j, context);
+            if (status != 0) {
+                return status;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* access_array
+ *
+ * Read or write one item of an array through the cache and count the
+ * result for that array as well
+ *
+ * @param       array_index
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ *
+ * @return      result_t
+ */
+result_t access_array(array_index_t array_index, uint32_t address, access_t access)
+{
+    /* Local Variables */
+    struct AccessCount *count = &get_cache_result()->array[array_index];
+    result_t result = access_cache(address, access);
+
+    count->hits += result == RESULT_HIT;
+    count->misses += result != RESULT_HIT;
+
+    return result;
+}
+
 /* write_a
  *
  * Simulate a write to array a
@@ -46,9 +108,13 @@ void write_a(uint16_t row, uint16_t col)
     uint32_t address = get_item_address(ARRAY_INDEX_A, row, col);
 
     /* Simulate cache access */
-    result_t result = access_cache(address);
+    result_t result = access_array(ARRAY_INDEX_A, address, WRITE_ACCESS);
 
+#if DISPLAY_RESULTS
     display_result(WRITE_ACCESS, address, result);
+#else
+    (void)result;
+#endif
 }
 
 /* read_b
@@ -66,9 +132,13 @@ void read_b(uint16_t row, uint16_t col)
     uint32_t address = get_item_address(ARRAY_INDEX_B, row, col);
 
     /* Simulate cache access */
-    result_t result = access_cache(address);
+    result_t result = access_array(ARRAY_INDEX_B, address, READ_ACCESS);
 
+#if DISPLAY_RESULTS
     display_result(READ_ACCESS, address, result);
+#else
+    (void)result;
+#endif
 }
 
 /* read_c
@@ -86,11 +156,16 @@ void read_c(uint16_t row, uint16_t col)
     uint32_t address = get_item_address(ARRAY_INDEX_C, row, col);
 
     /* Simulate cache access */
-    result_t result = access_cache(address);
+    result_t result = access_array(ARRAY_INDEX_C, address, READ_ACCESS);
 
+#if DISPLAY_RESULTS
     display_result(READ_ACCESS, address, result);
+#else
+    (void)result;
+#endif
 }
 
+#if DISPLAY_RESULTS
 /* display_result
  *
  * Get the corresponding address
@@ -130,7 +205,219 @@ void display_result(access_t access, uint32_t address, result_t result)
     debug_line_out(debug_level, str);
     delay();
 }
+#endif
 
+/* set_array_layout
+ *
+ * Select the layout used by get_item_address() and get_array_index()
+ *
+ * @param       layout
+ *
+ * @return      0 on success, -1 if the layout is invalid
+ */
+int set_array_layout(const struct ArrayLayout *layout)
+{
+    if (!array_layout_valid(layout)) {
+        return -1;
+    }
+    array_layout = *layout;
+
+    return 0;
+}
+
+/* get_array_layout
+ *
+ * Return the selected layout, initially the one of config.h
+ *
+ * @return      layout
+ */
+const struct ArrayLayout *get_array_layout(void)
+{
+    return &array_layout;
+}
+
+/* array_layout_valid
+ *
+ * Check a layout
+ *
+ * @param       layout
+ *
+ * @return      1 if valid, 0 otherwise
+ */
+uint8_t array_layout_valid(const struct ArrayLayout *layout)
+{
+    return layout->type <= ARRAY_LAYOUT_MORTON && layout->tile >= 1;
+}
+
+/* index_bits
+ *
+ * Bits needed to index count items
+ *
+ * @param       count
+ *
+ * @return      bits
+ */
+static uint32_t index_bits(uint32_t count)
+{
+    /* Local Variables */
+    uint32_t bits = 0;
+
+    while ((1u << bits) < count) {
+        bits++;
+    }
+
+    return bits;
+}
+
+/* morton_index
+ *
+ * Interleave the bits of row and column, column bit first. The bits of
+ * the longer dimension left over go on top.
+ *
+ * @param       row index
+ * @param       column index
+ *
+ * @return      item number on the Z-order curve
+ */
+static uint32_t morton_index(uint16_t row, uint16_t col)
+{
+    /* Local Variables */
+    uint32_t row_bits = index_bits(ARRAY_ROWS);
+    uint32_t col_bits = index_bits(ARRAY_COLUMNS);
+    uint32_t index = 0;
+    uint32_t bit = 0;
+    uint32_t k;
+
+    for (k = 0; k < row_bits || k < col_bits; k++) {
+        if (k < col_bits) {
+            index |= (uint32_t)((col >> k) & 1u) << bit++;
+        }
+        if (k < row_bits) {
+            index |= (uint32_t)((row >> k) & 1u) << bit++;
+        }
+    }
+
+    return index;
+}
+
+/* array_size
+ *
+ * Bytes of one array without the padding after it. Not used by the
+ * interleaved layout.
+ *
+ * @param       layout
+ *
+ * @return      size
+ */
+static uint32_t array_size(const struct ArrayLayout *layout)
+{
+    /* Local Variables */
+    uint32_t tile = layout->tile;
+
+    switch (layout->type) {
+        case ARRAY_LAYOUT_COLUMN_MAJOR:
+            return ARRAY_COLUMNS * (ARRAY_ROWS * ITEM_SIZE + layout->row_padding);
+        case ARRAY_LAYOUT_TILED:
+            return ((ARRAY_ROWS + tile - 1) / tile) * ((ARRAY_COLUMNS + tile - 1) / tile)
+                   * tile * tile * ITEM_SIZE;
+        case ARRAY_LAYOUT_MORTON:
+            return (1u << (index_bits(ARRAY_ROWS) + index_bits(ARRAY_COLUMNS))) * ITEM_SIZE;
+        default:
+            return ARRAY_ROWS * (ARRAY_COLUMNS * ITEM_SIZE + layout->row_padding);
+    }
+}
+
+/* layout_item_address
+ *
+ * Get the address of an item in a layout. row and col must be in
+ * bounds.
+ *
+ * @param       layout
+ * @param       array_index
+ * @param       row index
+ * @param       column index
+ *
+ * @return      item address
+ */
+uint32_t layout_item_address(const struct ArrayLayout *layout, array_index_t array_index,
+                             uint16_t row, uint16_t col)
+{
+    /* Local Variables */
+    uint32_t base = array_index * (array_size(layout) + layout->array_padding);
+    uint32_t tile = layout->tile;
+    uint32_t item;
+
+    switch (layout->type) {
+        case ARRAY_LAYOUT_COLUMN_MAJOR:
+            return base + col * (ARRAY_ROWS * ITEM_SIZE + layout->row_padding) + row * ITEM_SIZE;
+        case ARRAY_LAYOUT_INTERLEAVED:
+            item = ARRAY_COUNT * ITEM_SIZE + layout->array_padding;
+            return row * (ARRAY_COLUMNS * item + layout->row_padding) + col * item
+                   + array_index * ITEM_SIZE;
+        case ARRAY_LAYOUT_TILED:
+            item = ((row / tile) * ((ARRAY_COLUMNS + tile - 1) / tile) + col / tile) * tile * tile
+                   + (row % tile) * tile + col % tile;
+            return base + item * ITEM_SIZE;
+        case ARRAY_LAYOUT_MORTON:
+            return base + morton_index(row, col) * ITEM_SIZE;
+        default:
+            return base + row * (ARRAY_COLUMNS * ITEM_SIZE + layout->row_padding) + col * ITEM_SIZE;
+    }
+}
+
+/* layout_array_index
+ *
+ * Get the array an address belongs to in a layout
+ *
+ * @param       layout
+ * @param       address
+ *
+ * @return      array index, ARRAY_INDEX_OTHER outside of the arrays
+ *              and in padding
+ */
+array_index_t layout_array_index(const struct ArrayLayout *layout, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t size;
+    uint32_t stride;
+    uint32_t index;
+
+    if (layout->type == ARRAY_LAYOUT_INTERLEAVED) {
+        size = ARRAY_COUNT * ITEM_SIZE + layout->array_padding;
+        stride = ARRAY_COLUMNS * size + layout->row_padding;
+        if (address >= ARRAY_ROWS * stride || address % stride >= ARRAY_COLUMNS * size) {
+            return ARRAY_INDEX_OTHER;
+        }
+        index = address % stride % size / ITEM_SIZE;
+    } else {
+        size = array_size(layout);
+        stride = size + layout->array_padding;
+        index = address / stride;
+        if (address % stride >= size) {
+            return ARRAY_INDEX_OTHER;
+        }
+    }
+
+    return index < ARRAY_COUNT ? (array_index_t)index : ARRAY_INDEX_OTHER;
+}
+
+/* layout_size
+ *
+ * Get the bytes spanned by all arrays of a layout including padding
+ *
+ * @param       layout
+ *
+ * @return      size
+ */
+uint32_t layout_size(const struct ArrayLayout *layout)
+{
+    if (layout->type == ARRAY_LAYOUT_INTERLEAVED) {
+        return ARRAY_ROWS * (ARRAY_COLUMNS * (ARRAY_COUNT * ITEM_SIZE + layout->array_padding)
+                             + layout->row_padding);
+    }
+
+    return ARRAY_COUNT * (array_size(layout) + layout->array_padding);
+}
 
 /* get_item_address
  *
@@ -145,8 +432,6 @@ void display_result(access_t access, uint32_t address, result_t result)
 uint32_t get_item_address(array_index_t array_index, uint16_t row, uint16_t col)
 {
     char str[40];
-    uint32_t row_size = ITEM_SIZE * ARRAY_COLUMNS;
-    uint32_t array_total_size = ITEM_SIZE * ARRAY_ROWS * ARRAY_COLUMNS;
 
     if (row >= ARRAY_ROWS) {
         sprintf(str, "Row out of bound    row:%d", row);
@@ -160,5 +445,18 @@ uint32_t get_item_address(array_index_t array_index, uint16_t row, uint16_t col)
     }
 
     /* Calculate address */
-    return (array_index * array_total_size) + (row * row_size) + (col * ITEM_SIZE);
+    return layout_item_address(&array_layout, array_index, row, col);
+}
+
+/* get_array_index
+ *
+ * Get the array an address belongs to
+ *
+ * @param       address
+ *
+ * @return      array index, ARRAY_INDEX_OTHER outside of the arrays
+ */
+array_index_t get_array_index(uint32_t address)
+{
+    return layout_array_index(&array_layout, address);
 }
@@ -23,16 +23,50 @@
 typedef enum {
     ARRAY_INDEX_A = 0,
     ARRAY_INDEX_B = 1,
-    ARRAY_INDEX_C = 2
+    ARRAY_INDEX_C = 2,
+    ARRAY_INDEX_OTHER = 3
 } array_index_t;
 
-/* Typedefs */
-typedef enum {
-    WRITE_ACCESS,
-    READ_ACCESS
-} access_t;
+/* Number of arrays */
+#define ARRAY_COUNT 3
+
+/* HitMiss counts every array and ARRAY_INDEX_OTHER */
+#if ARRAY_COUNT + 1 != COUNTER_ARRAYS
+#error "COUNTER_ARRAYS of cache.h must be ARRAY_COUNT + 1"
+#endif
+
+/* ArrayLayout
+ *
+ * Placement of the arrays in memory, see the array params of config.h
+ */
+struct ArrayLayout {
+    uint8_t type;               /* ARRAY_LAYOUT_* of config.h */
+    uint8_t tile;               /* Tile edge in items */
+    uint32_t array_padding;     /* Bytes after every array or struct */
+    uint32_t row_padding;       /* Bytes after every row or column */
+};
+
+/* ItemVisitor
+ *
+ * Called by for_each_item() with the row, the column and the context,
+ * a non-zero return stops the loop
+ */
+typedef int (*item_visitor_t)(uint16_t row, uint16_t col, void *context);
 
 
+/* access_array
+ *
+ * Read or write one item of an array through the cache and count the
+ * result for that array as well
+ *
+ * @param       array_index
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ *
+ * @return      result_t
+ */
+result_t access_array(array_index_t array_index, uint32_t address, access_t access);
+
 /* write_a
  *
  * Simulate write to array a
@@ -77,6 +111,18 @@ void read_c(uint16_t row, uint16_t col);
  */
 void a_equals_b_plus_c(uint16_t row, uint16_t col);
 
+/* for_each_item
+ *
+ * Visit every item in the order of the a = b + c kernel of main.c,
+ * columns outer, rows inner
+ *
+ * @param       visit
+ * @param       context     Passed to visit
+ *
+ * @return      0, or the first non-zero return of visit
+ */
+int for_each_item(item_visitor_t visit, void *context);
+
 /* get_item_address
  *
  * Get the corresponding address
@@ -89,6 +135,81 @@ void a_equals_b_plus_c(uint16_t row, uint16_t col);
  */
 uint32_t get_item_address(array_index_t array_index, uint16_t row, uint16_t col);
 
+/* get_array_index
+ *
+ * Get the array an address belongs to
+ *
+ * @param       address
+ *
+ * @return      array index, ARRAY_INDEX_OTHER outside of the arrays
+ */
+array_index_t get_array_index(uint32_t address);
+
+/* set_array_layout
+ *
+ * Select the layout used by get_item_address() and get_array_index()
+ *
+ * @param       layout
+ *
+ * @return      0 on success, -1 if the layout is invalid
+ */
+int set_array_layout(const struct ArrayLayout *layout);
+
+/* get_array_layout
+ *
+ * Return the selected layout, initially the one of config.h
+ *
+ * @return      layout
+ */
+const struct ArrayLayout *get_array_layout(void);
+
+/* array_layout_valid
+ *
+ * Check a layout
+ *
+ * @param       layout
+ *
+ * @return      1 if valid, 0 otherwise
+ */
+uint8_t array_layout_valid(const struct ArrayLayout *layout);
+
+/* layout_item_address
+ *
+ * Get the address of an item in a layout. row and col must be in
+ * bounds.
+ *
+ * @param       layout
+ * @param       array_index
+ * @param       row index
+ * @param       column index
+ *
+ * @return      item address
+ */
+uint32_t layout_item_address(const struct ArrayLayout *layout, array_index_t array_index,
+                             uint16_t row, uint16_t col);
+
+/* layout_array_index
+ *
+ * Get the array an address belongs to in a layout
+ *
+ * @param       layout
+ * @param       address
+ *
+ * @return      array index, ARRAY_INDEX_OTHER outside of the arrays
+ *              and in padding
+ */
+array_index_t layout_array_index(const struct ArrayLayout *layout, uint32_t address);
+
+/* layout_size
+ *
+ * Get the bytes spanned by all arrays of a layout including padding
+ *
+ * @param       layout
+ *
+ * @return      size
+ */
+uint32_t layout_size(const struct ArrayLayout *layout);
+
 void display_result(access_t access, uint32_t address, result_t result);
 
 
@@ -7,68 +7,2465 @@
  * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
  * ------------------------------------------------------------------------- */
 
+#include <string.h>
+
+/* SIMD tag compare on x86. SSE2 is part of x86-64, AVX2 kernels are
+ * compiled for that target and only picked if the CPU supports it. */
+#if defined(__GNUC__) && defined(__SSE2__)
+#define KERNEL_HAVE_SSE2 1
+#define KERNEL_HAVE_AVX2 1
+#include <immintrin.h>
+#else
+#define KERNEL_HAVE_SSE2 0
+#define KERNEL_HAVE_AVX2 0
+#endif
+
 /* User includes */
 #include "cache.h"
 
-/* Struct to store the results */
-static struct HitMiss hit_miss;
+/* Checkpoint format of cache_serialize() */
+#define CHECKPOINT_MAGIC    0x4B484343u     /* "CCHK" */
+#define CHECKPOINT_VERSION  5u
+
+/* Counters of a checkpoint: hits, misses, writes, arrays, traffic */
+#define CHECKPOINT_COUNTERS (7 + 2 * COUNTER_ARRAYS)
+
+/* Counters of the victim cache in a checkpoint: hits, misses, writes */
+#define CHECKPOINT_VICTIM_COUNTERS 4
+
+/* The access path is inlined into the default cache and every kernel,
+ * each with its own constants. Without forcing, the compiler gives up
+ * inlining after a few copies. */
+#if defined(__GNUC__)
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+#define NEVER_INLINE static __attribute__((noinline))
+#elif defined(__CC_ARM)
+#define ALWAYS_INLINE static __forceinline
+#define NEVER_INLINE static __declspec(noinline)
+#else
+#define ALWAYS_INLINE static inline
+#define NEVER_INLINE static
+#endif
+
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address) ((void)0)
+#endif
+
+/* Largest associativity with a specialized scalar kernel */
+#define KERNEL_MAX_WAYS 8
+
+/* Accesses the SIMD kernels look ahead to prefetch a set */
+#define KERNEL_PREFETCH_AHEAD 8
+
+/* Golden ratio multiplier of the skewed index functions, way w uses
+ * (2w + 1) times it, so every way has its own odd multiplier */
+#define SKEW_MULTIPLIER 0x9E3779B1u
+
+/* Position of an absent line */
+#define LINE_NONE CACHE_LINE_NONE
+
+/* Storage of the cache configured by config.h */
+static line_t default_lines[LINE_COUNT];
+static uint8_t default_rank[LINE_COUNT];
+static uint32_t default_state[SET_COUNT];
+#if VICTIM_ENTRIES > 0
+static struct VictimCache default_victim;
+#endif
+#if TELEMETRY
+static struct Telemetry default_telemetry;
+static struct TelemetryCell default_cells[TELEMETRY_WINDOWS * SET_COUNT];
+static uint8_t default_occupancy[SET_COUNT];
+#endif
+
+/* Cache configured by config.h */
+static const struct CacheConfig default_config = {
+    OFFSET, INDEX, WAYS, REPLACEMENT, WRITE_POLICY, WRITE_MISS, INDEX_FUNCTION
+};
+static struct Cache default_cache;
+
+/* replacement_init
+ *
+ * Reset the replacement state of a set
+ *
+ * @param       rank        Ranks of the set
+ * @param       state       State of the set
+ * @param       ways
+ * @param       replacement
+ * @param       index       Set index, used to seed the random policy
+ *
+ * @return      void
+ */
+static void replacement_init(uint8_t *rank, uint32_t *state, uint32_t ways,
+                             uint8_t replacement, uint32_t index)
+{
+    /* Local Variables */
+    uint32_t way;
+
+    for (way = 0; way < ways; way++) {
+        /* LRU ranks must be a permutation of 0 .. ways-1 */
+        rank[way] = replacement == REPLACEMENT_SRRIP ? RRPV_MAX : (uint8_t)way;
+    }
+
+    /* Xorshift must not start at 0 */
+    *state = replacement == REPLACEMENT_RANDOM ? index + 1 : 0;
+}
+
+/* replacement_valid
+ *
+ * Check the replacement state of a set, e.g. one read from a checkpoint
+ *
+ * @param       rank        Ranks of the set
+ * @param       state       State of the set
+ * @param       ways
+ * @param       replacement
+ *
+ * @return      1 if the state could have been reached from
+ *              replacement_init(), 0 otherwise
+ */
+static uint8_t replacement_valid(const uint8_t *rank, uint32_t state, uint32_t ways,
+                                 uint8_t replacement)
+{
+    /* Local Variables */
+    uint64_t seen = 0;
+    uint32_t way;
+
+    switch (replacement) {
+    case REPLACEMENT_LRU:
+        /* The victim is the one line of rank ways-1 */
+        for (way = 0; way < ways; way++) {
+            if (rank[way] >= ways || ((seen >> rank[way]) & 1) != 0) {
+                return 0;
+            }
+            seen |= (uint64_t)1 << rank[way];
+        }
+        return 1;
+    case REPLACEMENT_FIFO:
+        return state < ways;
+    case REPLACEMENT_RANDOM:
+        /* Xorshift stays at 0 */
+        return state != 0;
+    case REPLACEMENT_SRRIP:
+        for (way = 0; way < ways; way++) {
+            if (rank[way] > RRPV_MAX) {
+                return 0;
+            }
+        }
+        return 1;
+    case REPLACEMENT_PLRU:
+    default:
+        /* Any tree bits lead to a way of the set */
+        return 1;
+    }
+}
+
+/* replacement_touch
+ *
+ * Update the replacement state after a hit on or a fill of a way
+ *
+ * @param       rank        Ranks of the set
+ * @param       state       State of the set
+ * @param       ways
+ * @param       replacement
+ * @param       way
+ * @param       fill        1 if the way was just filled, 0 on a hit
+ *
+ * @return      void
+ */
+ALWAYS_INLINE void replacement_touch(uint8_t *rank, uint32_t *state, uint32_t ways,
+                                   uint8_t replacement, uint32_t way, uint8_t fill)
+{
+    switch (replacement) {
+    case REPLACEMENT_LRU: {
+        uint8_t age = rank[way];
+        uint32_t i;
+
+        /* Age every line that was more recent than the touched one. The
+         * ranks are in random order, so add the compare, do not branch. */
+        for (i = 0; i < ways; i++) {
+            rank[i] += (uint8_t)(rank[i] < age);
+        }
+        rank[way] = 0;
+        break;
+    }
+    case REPLACEMENT_PLRU: {
+        uint32_t node = way + ways;
+
+        /* Walk up the tree and let every node point away from the way */
+        while (node > 1) {
+            if (node & 1) {
+                *state &= ~(1u << (node >> 1));
+            } else {
+                *state |= (1u << (node >> 1));
+            }
+            node >>= 1;
+        }
+        break;
+    }
+    case REPLACEMENT_FIFO:
+        /* Only insertion order counts */
+        if (fill && way == *state) {
+            *state = (*state + 1) % ways;
+        }
+        break;
+    case REPLACEMENT_SRRIP:
+        /* Hits predict a near re-reference, fills a distant one */
+        rank[way] = fill ? RRPV_INSERT : 0;
+        break;
+    default:
+        break;
+    }
+}
+
+/* replacement_victim
+ *
+ * Select the way to be replaced in a set. Invalid ways are used first.
+ *
+ * @param       lines       Lines of the set
+ * @param       rank        Ranks of the set
+ * @param       state       State of the set
+ * @param       ways
+ * @param       replacement
+ *
+ * @return      way
+ */
+ALWAYS_INLINE uint32_t replacement_victim(const line_t *lines, uint8_t *rank, uint32_t *state,
+                                         uint32_t ways, uint8_t replacement)
+{
+    /* Local Variables */
+    uint32_t way;
+
+    for (way = 0; way < ways; way++) {
+        if ((lines[way] & LINE_VALID) == 0) {
+            return way;
+        }
+    }
+
+    switch (replacement) {
+    case REPLACEMENT_LRU:
+    {
+        /* Least recently used line has the highest rank. Exactly one
+         * line has it, so OR the way numbers without a branch. */
+        uint32_t victim = 0;
+
+        for (way = 0; way < ways; way++) {
+            victim |= (0u - (uint32_t)(rank[way] == ways - 1)) & way;
+        }
+        return victim;
+    }
+    case REPLACEMENT_PLRU: {
+        uint32_t node = 1;
+
+        /* Follow the tree bits down to a leaf */
+        while (node < ways) {
+            node = (node << 1) | ((*state >> node) & 1);
+        }
+        return node - ways;
+    }
+    case REPLACEMENT_FIFO:
+        return *state;
+    case REPLACEMENT_RANDOM:
+        /* Xorshift32 */
+        *state ^= *state << 13;
+        *state ^= *state >> 17;
+        *state ^= *state << 5;
+        return *state % ways;
+    case REPLACEMENT_SRRIP:
+    default:
+        /* Age all lines until one is predicted for a distant re-reference */
+        while (1) {
+            for (way = 0; way < ways; way++) {
+                if (rank[way] >= RRPV_MAX) {
+                    return way;
+                }
+            }
+            for (way = 0; way < ways; way++) {
+                rank[way]++;
+            }
+        }
+    }
+}
+
+/* find_way
+ *
+ * Search a set for a valid line with matching tag
+ *
+ * @param       lines       Lines of the set
+ * @param       ways
+ * @param       tag
+ *
+ * @return      way, or ways if not present
+ */
+ALWAYS_INLINE uint32_t find_way(const line_t *lines, uint32_t ways, uint32_t tag)
+{
+    /* Local Variables */
+    line_t key = (tag << LINE_TAG_SHIFT) | LINE_VALID;
+    uint32_t way;
+
+    for (way = 0; way < ways; way++) {
+        if ((lines[way] & ~LINE_DIRTY) == key) {
+            break;
+        }
+    }
+
+    return way;
+}
+
+/* find_way_unrolled
+ *
+ * Same as find_way(), but compares every way without a branch. A tag
+ * is present at most once per set, so OR-ing the matching way numbers
+ * yields the way. Meant for a constant ways, so the loop is unrolled.
+ *
+ * @param       lines       Lines of the set
+ * @param       ways
+ * @param       tag
+ *
+ * @return      way, or ways if not present
+ */
+ALWAYS_INLINE uint32_t find_way_unrolled(const line_t *lines, uint32_t ways, uint32_t tag)
+{
+    /* Local Variables */
+    line_t key = (tag << LINE_TAG_SHIFT) | LINE_VALID;
+    uint32_t hit = 0;
+    uint32_t found = 0;
+    uint32_t way;
+
+    for (way = 0; way < ways; way++) {
+        uint32_t match = (lines[way] & ~LINE_DIRTY) == key;
+
+        hit |= match;
+        found |= (0u - match) & way;
+    }
+
+    /* A miss yields ways */
+    return found | ((hit - 1) & ways);
+}
+
+#if KERNEL_HAVE_SSE2
+/* find_way_sse2
+ *
+ * Same as find_way() for a multiple of 4 ways, comparing 4 ways at
+ * once
+ *
+ * @param       lines       Lines of the set
+ * @param       ways
+ * @param       tag
+ *
+ * @return      way, or ways if not present
+ */
+ALWAYS_INLINE uint32_t find_way_sse2(const line_t *lines, uint32_t ways, uint32_t tag)
+{
+    /* Local Variables */
+    __m128i key = _mm_set1_epi32((int)((tag << LINE_TAG_SHIFT) | LINE_VALID));
+    __m128i clear = _mm_set1_epi32((int)~LINE_DIRTY);
+    uint64_t hit = 0;
+    uint32_t way;
+
+    for (way = 0; way < ways; way += 4) {
+        __m128i words = _mm_loadu_si128((const __m128i *)&lines[way]);
+        __m128i match = _mm_cmpeq_epi32(_mm_and_si128(words, clear), key);
+
+        hit |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(match)) << way;
+    }
+
+    /* A miss yields ways */
+    return (uint32_t)__builtin_ctzll(hit | (1ull << ways));
+}
+#endif
+
+#if KERNEL_HAVE_AVX2
+/* find_way_avx2
+ *
+ * Same as find_way() for a multiple of 8 ways, comparing 8 ways at
+ * once. Only inlined into AVX2 kernels.
+ *
+ * @param       lines       Lines of the set
+ * @param       ways
+ * @param       tag
+ *
+ * @return      way, or ways if not present
+ */
+__attribute__((target("avx2")))
+static inline uint32_t find_way_avx2(const line_t *lines, uint32_t ways, uint32_t tag)
+{
+    /* Local Variables */
+    __m256i key = _mm256_set1_epi32((int)((tag << LINE_TAG_SHIFT) | LINE_VALID));
+    __m256i clear = _mm256_set1_epi32((int)~LINE_DIRTY);
+    uint64_t hit = 0;
+    uint32_t way;
+
+    for (way = 0; way < ways; way += 8) {
+        __m256i words = _mm256_loadu_si256((const __m256i *)&lines[way]);
+        __m256i match = _mm256_cmpeq_epi32(_mm256_and_si256(words, clear), key);
+
+        hit |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(match)) << way;
+    }
+
+    /* A miss yields ways */
+    return (uint32_t)__builtin_ctzll(hit | (1ull << ways));
+}
+#endif
+
+/* find_way_engine
+ *
+ * Tag compare of an engine. Meant for constant ways and engine, so
+ * only one compare is left.
+ *
+ * @param       lines       Lines of the set
+ * @param       ways
+ * @param       tag
+ * @param       engine
+ *
+ * @return      way, or ways if not present
+ */
+ALWAYS_INLINE uint32_t find_way_engine(const line_t *lines, uint32_t ways, uint32_t tag,
+                                       kernel_engine_t engine)
+{
+#if KERNEL_HAVE_AVX2
+    if (engine == KERNEL_AVX2) {
+        return find_way_avx2(lines, ways, tag);
+    }
+#endif
+#if KERNEL_HAVE_SSE2
+    if (engine == KERNEL_SSE2) {
+        return find_way_sse2(lines, ways, tag);
+    }
+#endif
+    (void)engine;
+
+    return ways <= KERNEL_MAX_WAYS ? find_way_unrolled(lines, ways, tag)
+                                   : find_way(lines, ways, tag);
+}
+
+/* index_hash
+ *
+ * Set of a block under a hashed index function. Inlined with a
+ * constant function, the set follows without a data dependent branch.
+ *
+ * @param       cache
+ * @param       function    INDEX_FUNCTION_* of config.h
+ * @param       block       Address >> offset
+ * @param       way         Way of the skewed index function
+ *
+ * @return      set
+ */
+ALWAYS_INLINE uint32_t index_hash(const struct Cache *cache, uint8_t function, uint32_t block,
+                                  uint32_t way)
+{
+    /* Local Variables */
+    uint32_t index = cache->config.index;
+    uint32_t mask = (1u << index) - 1;
+    uint32_t set = block;
+    uint32_t i;
+
+    switch (function) {
+    case INDEX_FUNCTION_XOR:
+        /* Fold every index wide slice of the tag onto the index bits */
+        for (i = 1; i <= cache->folds; i++) {
+            set ^= block >> (index * i);
+        }
+        return set & mask;
+    case INDEX_FUNCTION_PRIME:
+#if defined(__SIZEOF_INT128__)
+        /* Remainder by multiplication with the reciprocal, no division */
+        return (uint32_t)(((unsigned __int128)(cache->reciprocal * block) * cache->set_count) >> 64);
+#else
+        return block % cache->set_count;
+#endif
+    case INDEX_FUNCTION_SKEWED:
+        /* The top index bits of a multiplicative hash of the tag, with
+         * another multiplier per way */
+        return (block ^ (uint32_t)((uint64_t)((block >> index) * (SKEW_MULTIPLIER * (2 * way + 1)))
+                                   >> (32 - index))) & mask;
+    case INDEX_FUNCTION_BITS:
+    default:
+        return block & mask;
+    }
+}
+
+/* skewed_find
+ *
+ * Look up a block in a skewed cache
+ *
+ * @param       cache
+ * @param       block
+ * @param       position    Gets the line of every way the block may use
+ *
+ * @return      line holding the block, LINE_NONE if absent
+ */
+ALWAYS_INLINE uint32_t skewed_find(const struct Cache *cache, uint32_t block, uint32_t *position)
+{
+    /* Local Variables */
+    uint32_t ways = cache->config.ways;
+    line_t key = (block << LINE_TAG_SHIFT) | LINE_VALID;
+    uint32_t found = LINE_NONE;
+    uint32_t way;
+
+    for (way = 0; way < ways; way++) {
+        position[way] = index_hash(cache, INDEX_FUNCTION_SKEWED, block, way) * ways + way;
+        found = (cache->lines[position[way]] & ~LINE_DIRTY) == key ? position[way] : found;
+    }
+
+    return found;
+}
+
+/* skewed_touch
+ *
+ * Make a line the youngest of the lines a block may use, the others age
+ *
+ * @param       rank        Ages of all lines
+ * @param       position    Lines the block may use
+ * @param       ways
+ * @param       line
+ *
+ * @return      void
+ */
+ALWAYS_INLINE void skewed_touch(uint8_t *rank, const uint32_t *position, uint32_t ways,
+                                uint32_t line)
+{
+    /* Local Variables */
+    uint32_t way;
+
+    for (way = 0; way < ways; way++) {
+        rank[position[way]] += (uint8_t)(rank[position[way]] < UINT8_MAX);
+    }
+    rank[line] = 0;
+}
+
+/* skewed_victim
+ *
+ * Select the line to be replaced among the lines a block may use.
+ * Invalid lines are used first, then the oldest.
+ *
+ * @param       lines       All lines
+ * @param       rank        Ages of all lines
+ * @param       position    Lines the block may use
+ * @param       ways
+ *
+ * @return      line
+ */
+ALWAYS_INLINE uint32_t skewed_victim(const line_t *lines, const uint8_t *rank,
+                                     const uint32_t *position, uint32_t ways)
+{
+    /* Local Variables */
+    uint32_t victim = LINE_NONE;
+    uint32_t oldest = 0;
+    uint32_t way;
+
+    for (way = 0; way < ways; way++) {
+        if ((lines[position[way]] & LINE_VALID) == 0) {
+            return position[way];
+        }
+        if (victim == LINE_NONE || rank[position[way]] > oldest) {
+            victim = position[way];
+            oldest = rank[victim];
+        }
+    }
+
+    return victim;
+}
+
+/* access_set
+ *
+ * Read or write a tag in a set and fill it on a miss. Inlined with the
+ * constant config of config.h for the default cache and with a
+ * constant ways for every kernel, so those paths keep the speed of a
+ * compile time configuration.
+ *
+ * @param       config
+ * @param       ways        config->ways, passed apart so kernels fix it
+ * @param       engine      Tag compare to use
+ * @param       lines       Lines of the set
+ * @param       rank        Ranks of the set
+ * @param       state       State of the set
+ * @param       tag
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ * @param       counter
+ * @param       traffic
+ *
+ * @return      result_t
+ */
+ALWAYS_INLINE result_t access_set(const struct CacheConfig *config, uint32_t ways,
+                                  kernel_engine_t engine, line_t *lines, uint8_t *rank,
+                                  uint32_t *state, uint32_t tag, access_t access, uint8_t size,
+                                  struct HitMiss *counter, struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    uint32_t way = find_way_engine(lines, ways, tag, engine);
+    uint32_t write = access == WRITE_ACCESS;
+    result_t result = RESULT_HIT;
+
+    if (way < ways) {
+        /* Hit */
+        counter->hits++;
+        counter->write_hits += write;
+        replacement_touch(rank, state, ways, config->replacement, way, 0);
+    } else {
+        /* Miss */
+        counter->misses++;
+        counter->write_misses += write;
+        result = RESULT_MISS;
+
+        if (write && config->write_miss == WRITE_MISS_NO_ALLOCATE) {
+            /* Write around the cache */
+            traffic->write_through_bytes += size;
+            return RESULT_MISS;
+        }
+
+        /* Simulate Block read from RAM -> block is valid now, a dirty
+         * victim is written back first */
+        traffic->fill_bytes += 1u << config->offset;
+        way = replacement_victim(lines, rank, state, ways, config->replacement);
+        traffic->writeback_bytes += (lines[way] & (lines[way] >> 1) & LINE_VALID) << config->offset;
+        lines[way] = (tag << LINE_TAG_SHIFT) | LINE_VALID;
+        replacement_touch(rank, state, ways, config->replacement, way, 1);
+    }
+
+    /* Reads and writes are mixed at random, so no branch on the type */
+    if (config->write_policy == WRITE_POLICY_THROUGH) {
+        traffic->write_through_bytes += size & (0u - write);
+    } else {
+        lines[way] |= write << 1;
+    }
+
+    return result;
+}
+
+/* access_victim
+ *
+ * Read or write size bytes inside one block of a cache with a victim
+ * cache, see cache_attach_victim()
+ *
+ * @param       cache
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ * @param       counter
+ * @param       traffic
+ *
+ * @return      result_t of the lines of the cache
+ */
+static result_t access_victim(struct Cache *cache, uint32_t address, access_t access, uint8_t size,
+                              struct HitMiss *counter, struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    const struct CacheConfig *config = &cache->config;
+    struct VictimCache *victim = cache->victim;
+    uint32_t ways = config->ways;
+    uint32_t block = address >> config->offset;
+    uint32_t index = block & (cache->set_count - 1);
+    uint32_t tag = address >> (config->offset + config->index);
+    line_t *lines = &cache->lines[index * ways];
+    uint8_t *rank = &cache->rank[index * ways];
+    uint32_t *state = &cache->state[index];
+    uint32_t write = access == WRITE_ACCESS;
+    uint32_t way = find_way(lines, ways, tag);
+    uint32_t unused = 0;
+    result_t result = RESULT_HIT;
+    line_t dirty = 0;
+    line_t replaced;
+    uint32_t slot;
+
+    if (way < ways) {
+        counter->hits++;
+        counter->write_hits += write;
+        replacement_touch(rank, state, ways, config->replacement, way, 0);
+    } else {
+        counter->misses++;
+        counter->write_misses += write;
+        result = RESULT_MISS;
+        slot = find_way(victim->lines, victim->entries, block);
+        if (slot < victim->entries) {
+            /* The line moves back into its set, no memory traffic */
+            victim->hit_miss.hits++;
+            victim->hit_miss.write_hits += write;
+            dirty = victim->lines[slot] & LINE_DIRTY;
+            victim->lines[slot] = 0;
+        } else {
+            victim->hit_miss.misses++;
+            victim->hit_miss.write_misses += write;
+            if (write && config->write_miss == WRITE_MISS_NO_ALLOCATE) {
+                /* Write around both caches */
+                traffic->write_through_bytes += size;
+                return RESULT_MISS;
+            }
+
+            /* Read the block from RAM */
+            traffic->fill_bytes += 1u << config->offset;
+        }
+
+        /* A valid replaced line goes to the victim cache with its dirty
+         * bit. Only then, unless the hit freed a slot, the LRU victim
+         * line makes room. */
+        way = replacement_victim(lines, rank, state, ways, config->replacement);
+        replaced = lines[way];
+        if (replaced & LINE_VALID) {
+            if (slot >= victim->entries) {
+                slot = replacement_victim(victim->lines, victim->rank, &unused, victim->entries,
+                                          REPLACEMENT_LRU);
+                traffic->writeback_bytes += (victim->lines[slot] & (victim->lines[slot] >> 1) &
+                                             LINE_VALID) << config->offset;
+            }
+            block = ((replaced >> LINE_TAG_SHIFT) << config->index) | index;
+            victim->lines[slot] = (block << LINE_TAG_SHIFT) | (replaced & (LINE_DIRTY | LINE_VALID));
+            replacement_touch(victim->rank, &unused, victim->entries, REPLACEMENT_LRU, slot, 1);
+        }
+        lines[way] = (tag << LINE_TAG_SHIFT) | LINE_VALID | dirty;
+        replacement_touch(rank, state, ways, config->replacement, way, 1);
+    }
+
+    if (config->write_policy == WRITE_POLICY_THROUGH) {
+        traffic->write_through_bytes += size & (0u - write);
+    } else {
+        lines[way] |= write << 1;
+    }
+
+    return result;
+}
+
+/* access_hashed
+ *
+ * Read or write size bytes inside one block of a cache with a hashed
+ * index function. The XOR and prime functions only pick another set
+ * than the bit-slice, the lines hold the block number as tag.
+ *
+ * @param       cache
+ * @param       function    INDEX_FUNCTION_* of config.h
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ * @param       counter
+ * @param       traffic
+ *
+ * @return      result_t
+ */
+ALWAYS_INLINE result_t access_hashed(struct Cache *cache, uint8_t function, uint32_t address,
+                                     access_t access, uint8_t size, struct HitMiss *counter,
+                                     struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    const struct CacheConfig *config = &cache->config;
+    uint32_t ways = config->ways;
+    uint32_t block = address >> config->offset;
+    uint32_t write = access == WRITE_ACCESS;
+    uint32_t position[MAX_WAYS];
+    result_t result = RESULT_HIT;
+    uint32_t line;
+    uint32_t set;
+
+    if (function != INDEX_FUNCTION_SKEWED) {
+        set = index_hash(cache, function, block, 0);
+        return access_set(config, ways, KERNEL_SCALAR, &cache->lines[set * ways],
+                          &cache->rank[set * ways], &cache->state[set], block, access, size,
+                          counter, traffic);
+    }
+
+    line = skewed_find(cache, block, position);
+    if (line != LINE_NONE) {
+        counter->hits++;
+        counter->write_hits += write;
+    } else {
+        counter->misses++;
+        counter->write_misses += write;
+        result = RESULT_MISS;
+
+        if (write && config->write_miss == WRITE_MISS_NO_ALLOCATE) {
+            /* Write around the cache */
+            traffic->write_through_bytes += size;
+            return RESULT_MISS;
+        }
+
+        /* Read the block from RAM, a dirty victim is written back first */
+        traffic->fill_bytes += 1u << config->offset;
+        line = skewed_victim(cache->lines, cache->rank, position, ways);
+        traffic->writeback_bytes += (cache->lines[line] & (cache->lines[line] >> 1) & LINE_VALID)
+                                    << config->offset;
+        cache->lines[line] = (block << LINE_TAG_SHIFT) | LINE_VALID;
+    }
+    skewed_touch(cache->rank, position, ways, line);
+
+    if (config->write_policy == WRITE_POLICY_THROUGH) {
+        traffic->write_through_bytes += size & (0u - write);
+    } else {
+        cache->lines[line] |= write << 1;
+    }
+
+    return result;
+}
+
+#if TELEMETRY
+/* telemetry_reset
+ *
+ * Clear all cells and start over with the first window
+ *
+ * @param       telemetry
+ *
+ * @return      void
+ */
+static void telemetry_reset(struct Telemetry *telemetry)
+{
+    memset(telemetry->cells, 0,
+           (size_t)telemetry->capacity * telemetry->set_count * sizeof(*telemetry->cells));
+    telemetry->window = telemetry->first_window;
+    telemetry->current = 0;
+    telemetry->remaining = telemetry->window;
+    telemetry->row = telemetry->cells;
+}
+
+/* telemetry_recount
+ *
+ * Count the valid lines of every set, after the lines were replaced
+ * as a whole
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+static void telemetry_recount(const struct Cache *cache)
+{
+    /* Local Variables */
+    struct Telemetry *telemetry = cache->telemetry;
+    uint32_t ways = cache->config.ways;
+    uint32_t set;
+    uint32_t way;
+
+    telemetry->free_lines = 0;
+    for (set = 0; set < cache->set_count; set++) {
+        uint8_t valid = 0;
+
+        for (way = 0; way < ways; way++) {
+            valid += cache->lines[set * ways + way] & LINE_VALID;
+        }
+        telemetry->occupancy[set] = valid;
+        telemetry->free_lines += ways - valid;
+    }
+}
+
+/* telemetry_fill
+ *
+ * Take back the eviction of a fill that found an invalid line in its
+ * set. Kept out of line, it only runs until the cache is full.
+ *
+ * @param       cache
+ * @param       set
+ *
+ * @return      void
+ */
+NEVER_INLINE void telemetry_fill(const struct Cache *cache, uint32_t set)
+{
+    /* Local Variables */
+    struct Telemetry *telemetry = cache->telemetry;
+
+    /* A skewed block may use lines of other sets, it scans them */
+    if (cache->config.index_function == INDEX_FUNCTION_SKEWED ||
+        telemetry->occupancy[set] == cache->config.ways) {
+        return;
+    }
+    telemetry->row[set].evictions--;
+    telemetry->occupancy[set]++;
+    telemetry->free_lines--;
+}
+
+/* telemetry_advance
+ *
+ * Start the next window, merge neighbouring windows when all are used.
+ * Kept out of line, it runs once per window.
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+NEVER_INLINE void telemetry_advance(const struct Cache *cache)
+{
+    /* Local Variables */
+    struct Telemetry *telemetry = cache->telemetry;
+    uint32_t sets = telemetry->set_count;
+    uint32_t half = telemetry->capacity / 2;
+    struct TelemetryCell *cells = telemetry->cells;
+    uint32_t w;
+    uint32_t s;
+
+    telemetry->row += sets;
+    if (++telemetry->current < telemetry->capacity) {
+        telemetry->remaining = telemetry->window;
+        return;
+    }
+    for (w = 0; w < half; w++) {
+        for (s = 0; s < sets; s++) {
+            const struct TelemetryCell *even = &cells[(2 * w) * sets + s];
+            const struct TelemetryCell *odd = &cells[(2 * w + 1) * sets + s];
+
+            cells[w * sets + s].hits = even->hits + odd->hits;
+            cells[w * sets + s].misses = even->misses + odd->misses;
+            cells[w * sets + s].evictions = even->evictions + odd->evictions;
+        }
+    }
+    memset(&cells[(size_t)half * sets], 0, (size_t)half * sets * sizeof(*cells));
+    telemetry->current = half;
+    telemetry->row = &cells[(size_t)half * sets];
+    telemetry->window *= 2;
+    telemetry->remaining = telemetry->window;
+}
+
+/* telemetry_skewed
+ *
+ * Set of a block in a skewed cache and whether all lines it may
+ * replace are valid. The lines of a block lie in different sets, so the
+ * occupancy does not tell. Kept out of line, so the other index
+ * functions need no position array.
+ *
+ * @param       cache
+ * @param       block       Address >> offset
+ * @param       set         Gets the set of way 0
+ *
+ * @return      1 if a fill evicts a valid line, 0 otherwise
+ */
+NEVER_INLINE uint32_t telemetry_skewed(const struct Cache *cache, uint32_t block, uint32_t *set)
+{
+    /* Local Variables */
+    uint32_t ways = cache->config.ways;
+    uint32_t position[MAX_WAYS];
+    line_t valid = LINE_VALID;
+    uint32_t way;
+
+    skewed_find(cache, block, position);
+    *set = position[0] / ways;
+    for (way = 0; way < ways; way++) {
+        valid &= cache->lines[position[way]];
+    }
+
+    return valid;
+}
+
+/* telemetry_before
+ *
+ * Find the set of an access. A skewed cache also scans the lines the
+ * block may replace, before the access changes them.
+ *
+ * @param       cache
+ * @param       address
+ * @param       set         Gets the set
+ *
+ * @return      0 if a fill of a skewed cache uses an invalid line, 1
+ *              otherwise
+ */
+ALWAYS_INLINE uint32_t telemetry_before(const struct Cache *cache, uint32_t address, uint32_t *set)
+{
+    /* Local Variables */
+    uint32_t block = address >> cache->config.offset;
+
+    switch (cache->config.index_function) {
+    case INDEX_FUNCTION_SKEWED:
+        return telemetry_skewed(cache, block, set);
+    case INDEX_FUNCTION_XOR:
+        *set = index_hash(cache, INDEX_FUNCTION_XOR, block, 0);
+        break;
+    case INDEX_FUNCTION_PRIME:
+        *set = index_hash(cache, INDEX_FUNCTION_PRIME, block, 0);
+        break;
+    default:
+        *set = index_hash(cache, INDEX_FUNCTION_BITS, block, 0);
+        break;
+    }
+
+    return 1;
+}
+
+/* telemetry_after
+ *
+ * Count an access in the cell of its set and window
+ *
+ * @param       cache
+ * @param       set         From telemetry_before()
+ * @param       full        From telemetry_before()
+ * @param       access
+ * @param       result
+ *
+ * @return      void
+ */
+ALWAYS_INLINE void telemetry_after(const struct Cache *cache, uint32_t set, uint32_t full,
+                                   access_t access, result_t result)
+{
+    /* Local Variables */
+    struct Telemetry *telemetry = cache->telemetry;
+    struct TelemetryCell *cell = &telemetry->row[set];
+    uint32_t miss = result != RESULT_HIT;
+    uint32_t around = (access == WRITE_ACCESS) &
+                      (cache->config.write_miss == WRITE_MISS_NO_ALLOCATE);
+    uint32_t fill = miss & (1 - around);
+
+    cell->hits += 1 - miss;
+    cell->misses += miss;
+    cell->evictions += fill & full;
+    if (fill && telemetry->free_lines != 0) {
+        telemetry_fill(cache, set);
+    }
+    if (--telemetry->remaining == 0) {
+        telemetry_advance(cache);
+    }
+}
+#endif
+
+/* access_batch
+ *
+ * Run an array of accesses through a cache instance. Inlined into
+ * every kernel with its constant ways and engine.
+ *
+ * @param       cache
+ * @param       ways
+ * @param       engine
+ * @param       ahead       Accesses to look ahead for prefetching a set,
+ *                          0 for none
+ * @param       addresses
+ * @param       accesses    NULL for reads only
+ * @param       size
+ * @param       count
+ * @param       results     May be NULL
+ *
+ * @return      number of hits
+ */
+ALWAYS_INLINE size_t access_batch(struct Cache *cache, uint32_t ways, kernel_engine_t engine,
+                                  uint32_t ahead, const uint32_t *addresses,
+                                  const uint8_t *accesses, uint8_t size, size_t count,
+                                  uint8_t *results)
+{
+    /* Local Variables */
+    struct CacheConfig config = cache->config;
+    line_t *lines = cache->lines;
+    uint8_t *rank = cache->rank;
+    uint32_t *state = cache->state;
+    uint32_t shift = config.offset + config.index;
+    uint32_t mask = cache->set_count - 1;
+    struct HitMiss counter = cache->hit_miss;
+    struct MemoryTraffic traffic = cache->traffic;
+    size_t hits = 0;
+    size_t i;
+
+    /* State is kept in locals, stores to the uint8_t ranks would force
+     * reloading it from the instance after every access otherwise */
+    for (i = 0; i < count; i++) {
+        uint32_t index = (addresses[i] >> config.offset) & mask;
+        access_t access = accesses != NULL ? (access_t)accesses[i] : READ_ACCESS;
+        result_t result;
+
+        if (ahead && i + ahead < count) {
+            uint32_t next = (addresses[i + ahead] >> config.offset) & mask;
+
+            PREFETCH(&lines[next * ways]);
+            if (ways * sizeof(line_t) > 64) {
+                PREFETCH(&lines[next * ways + ways - 1]);
+            }
+            PREFETCH(&rank[next * ways]);
+        }
+
+        result = access_set(&config, ways, engine, &lines[index * ways], &rank[index * ways],
+                            &state[index], addresses[i] >> shift, access, size, &counter,
+                            &traffic);
+        hits += result == RESULT_HIT;
+        if (results != NULL) {
+            results[i] = (uint8_t)result;
+        }
+    }
+    cache->hit_miss = counter;
+    cache->traffic = traffic;
+
+    return hits;
+}
+
+/* Kernels specialized for one associativity and engine */
+#define CACHE_KERNEL(NAME, N, ENGINE, AHEAD)                                                    \
+static size_t NAME(struct Cache *cache, const uint32_t *addresses, const uint8_t *accesses,     \
+                   uint8_t size, size_t count, uint8_t *results)                                \
+{                                                                                               \
+    return access_batch(cache, N, ENGINE, AHEAD, addresses, accesses, size, count, results);    \
+}
+
+CACHE_KERNEL(cache_kernel_1way, 1, KERNEL_SCALAR, 0)
+CACHE_KERNEL(cache_kernel_2way, 2, KERNEL_SCALAR, 0)
+CACHE_KERNEL(cache_kernel_4way, 4, KERNEL_SCALAR, 0)
+CACHE_KERNEL(cache_kernel_8way, 8, KERNEL_SCALAR, 0)
+
+#if KERNEL_HAVE_SSE2
+CACHE_KERNEL(cache_kernel_8way_sse2, 8, KERNEL_SSE2, KERNEL_PREFETCH_AHEAD)
+CACHE_KERNEL(cache_kernel_16way_sse2, 16, KERNEL_SSE2, KERNEL_PREFETCH_AHEAD)
+CACHE_KERNEL(cache_kernel_32way_sse2, 32, KERNEL_SSE2, KERNEL_PREFETCH_AHEAD)
+#endif
+
+#if KERNEL_HAVE_AVX2
+__attribute__((target("avx2")))
+CACHE_KERNEL(cache_kernel_8way_avx2, 8, KERNEL_AVX2, KERNEL_PREFETCH_AHEAD)
+__attribute__((target("avx2")))
+CACHE_KERNEL(cache_kernel_16way_avx2, 16, KERNEL_AVX2, KERNEL_PREFETCH_AHEAD)
+__attribute__((target("avx2")))
+CACHE_KERNEL(cache_kernel_32way_avx2, 32, KERNEL_AVX2, KERNEL_PREFETCH_AHEAD)
+#endif
+
+/* Kernels of the hashed index functions, scalar only */
+#define HASHED_KERNEL(NAME, FUNCTION)                                                           \
+static size_t NAME(struct Cache *cache, const uint32_t *addresses, const uint8_t *accesses,     \
+                   uint8_t size, size_t count, uint8_t *results)                                \
+{                                                                                               \
+    struct HitMiss counter = cache->hit_miss;                                                   \
+    struct MemoryTraffic traffic = cache->traffic;                                              \
+    size_t hits = 0;                                                                            \
+    size_t i;                                                                                   \
+                                                                                                \
+    for (i = 0; i < count; i++) {                                                               \
+        access_t access = accesses != NULL ? (access_t)accesses[i] : READ_ACCESS;               \
+        result_t result = access_hashed(cache, FUNCTION, addresses[i], access, size, &counter,  \
+                                        &traffic);                                              \
+                                                                                                \
+        hits += result == RESULT_HIT;                                                           \
+        if (results != NULL) {                                                                  \
+            results[i] = (uint8_t)result;                                                       \
+        }                                                                                       \
+    }                                                                                           \
+    cache->hit_miss = counter;                                                                  \
+    cache->traffic = traffic;                                                                   \
+                                                                                                \
+    return hits;                                                                                \
+}
+
+HASHED_KERNEL(cache_kernel_xor, INDEX_FUNCTION_XOR)
+HASHED_KERNEL(cache_kernel_prime, INDEX_FUNCTION_PRIME)
+HASHED_KERNEL(cache_kernel_skewed, INDEX_FUNCTION_SKEWED)
+
+/* Kernels and names of the hashed index functions, by function */
+static const cache_kernel_t hashed_kernels[] = {
+    NULL, cache_kernel_xor, cache_kernel_prime, cache_kernel_skewed
+};
+static const char *hashed_kernel_names[] = { NULL, "xor", "prime", "skewed" };
+
+/* KernelEntry
+ *
+ * Specialized kernel of the dispatch table
+ */
+struct KernelEntry {
+    uint8_t ways;
+    uint8_t engine;
+    cache_kernel_t kernel;
+    const char *name;
+};
+
+/* Specialized kernels, the generic one covers every other config */
+static const struct KernelEntry kernel_table[] = {
+    { 1, KERNEL_SCALAR, cache_kernel_1way, "1-way" },
+    { 2, KERNEL_SCALAR, cache_kernel_2way, "2-way" },
+    { 4, KERNEL_SCALAR, cache_kernel_4way, "4-way" },
+    { 8, KERNEL_SCALAR, cache_kernel_8way, "8-way" },
+#if KERNEL_HAVE_SSE2
+    { 8, KERNEL_SSE2, cache_kernel_8way_sse2, "8-way sse2" },
+    { 16, KERNEL_SSE2, cache_kernel_16way_sse2, "16-way sse2" },
+    { 32, KERNEL_SSE2, cache_kernel_32way_sse2, "32-way sse2" },
+#endif
+#if KERNEL_HAVE_AVX2
+    { 8, KERNEL_AVX2, cache_kernel_8way_avx2, "8-way avx2" },
+    { 16, KERNEL_AVX2, cache_kernel_16way_avx2, "16-way avx2" },
+    { 32, KERNEL_AVX2, cache_kernel_32way_avx2, "32-way avx2" },
+#endif
+};
+
+/* cache_kernel_victim
+ *
+ * Batch kernel of a cache with a victim cache, see cache_access_batch()
+ *
+ * @return      number of hits in the lines of the cache
+ */
+static size_t cache_kernel_victim(struct Cache *cache, const uint32_t *addresses,
+                                  const uint8_t *accesses, uint8_t size, size_t count,
+                                  uint8_t *results)
+{
+    /* Local Variables */
+    size_t hits = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        access_t access = accesses != NULL ? (access_t)accesses[i] : READ_ACCESS;
+        result_t result = access_victim(cache, addresses[i], access, size, &cache->hit_miss,
+                                        &cache->traffic);
+
+        hits += result == RESULT_HIT;
+        if (results != NULL) {
+            results[i] = (uint8_t)result;
+        }
+    }
+
+    return hits;
+}
+
+/* cache_kernel_telemetry
+ *
+ * Batch kernel of a cache with telemetry, see cache_access_batch()
+ *
+ * @return      number of hits
+ */
+static size_t cache_kernel_telemetry(struct Cache *cache, const uint32_t *addresses,
+                                     const uint8_t *accesses, uint8_t size, size_t count,
+                                     uint8_t *results)
+{
+    /* Local Variables */
+    size_t hits = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        access_t access = accesses != NULL ? (access_t)accesses[i] : READ_ACCESS;
+        result_t result = cache_access(cache, addresses[i], access, size);
+
+        hits += result == RESULT_HIT;
+        if (results != NULL) {
+            results[i] = (uint8_t)result;
+        }
+    }
+
+    return hits;
+}
+
+/* kernel_update
+ *
+ * Pick the batch kernel after attaching or detaching a victim cache or
+ * telemetry
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+static void kernel_update(struct Cache *cache)
+{
+    if (cache->telemetry != NULL) {
+        cache->kernel = cache_kernel_telemetry;
+    } else if (cache->victim != NULL) {
+        cache->kernel = cache_kernel_victim;
+    } else {
+        cache->kernel = cache_kernel_select(&cache->config);
+    }
+}
+
+/* victim_reset
+ *
+ * Invalidate all lines of a victim cache and reset its counters
+ *
+ * @param       victim
+ *
+ * @return      void
+ */
+static void victim_reset(struct VictimCache *victim)
+{
+    /* Local Variables */
+    uint32_t unused = 0;
+
+    memset(victim->lines, 0, sizeof(victim->lines));
+    replacement_init(victim->rank, &unused, victim->entries, REPLACEMENT_LRU, 0);
+    memset(&victim->hit_miss, 0, sizeof(victim->hit_miss));
+}
+
+/* cache_config_valid
+ *
+ * Check a cache configuration
+ *
+ * @param       config
+ *
+ * @return      1 if valid, 0 otherwise
+ */
+uint8_t cache_config_valid(const struct CacheConfig *config)
+{
+    if (config->ways < 1 || config->ways > MAX_WAYS) {
+        return 0;
+    }
+    if (config->offset + config->index > 31 || config->offset + config->index < LINE_TAG_SHIFT) {
+        return 0;
+    }
+    if (config->replacement > REPLACEMENT_SRRIP) {
+        return 0;
+    }
+    if (config->replacement == REPLACEMENT_PLRU && (config->ways & (config->ways - 1)) != 0) {
+        return 0;
+    }
+    if (config->write_policy > WRITE_POLICY_THROUGH || config->write_miss > WRITE_MISS_NO_ALLOCATE) {
+        return 0;
+    }
+    if (config->index_function > INDEX_FUNCTION_SKEWED) {
+        return 0;
+    }
+    if (config->index_function != INDEX_FUNCTION_BITS && config->offset < LINE_TAG_SHIFT) {
+        return 0;
+    }
+    if (config->index_function == INDEX_FUNCTION_SKEWED && config->replacement != REPLACEMENT_LRU) {
+        return 0;
+    }
+
+    return 1;
+}
+
+/* largest_prime
+ *
+ * Largest prime up to a limit, by trial division
+ *
+ * @param       limit
+ *
+ * @return      prime, 1 for a limit of 1
+ */
+static uint32_t largest_prime(uint32_t limit)
+{
+    /* Local Variables */
+    uint32_t n;
+    uint32_t d;
+
+    for (n = limit; n > 2; n--) {
+        for (d = 2; d <= n / d && n % d != 0; d++) {
+        }
+        if (d > n / d) {
+            return n;
+        }
+    }
+
+    return limit;
+}
+
+/* cache_init
+ *
+ * Initialize a cache instance on caller provided storage of
+ * (1 << index) * ways lines and ranks and (1 << index) states
+ *
+ * @param       cache
+ * @param       config
+ * @param       lines
+ * @param       rank
+ * @param       state
+ *
+ * @return      void
+ */
+void cache_init(struct Cache *cache, const struct CacheConfig *config,
+                line_t *lines, uint8_t *rank, uint32_t *state)
+{
+    cache->config = *config;
+    cache->set_count = 1u << config->index;
+    cache->tag_shift = (uint8_t)(config->offset + config->index);
+    cache->folds = 0;
+    cache->reciprocal = 0;
+    if (config->index_function != INDEX_FUNCTION_BITS) {
+        cache->tag_shift = config->offset;
+    }
+    if (config->index_function == INDEX_FUNCTION_XOR && config->index > 0) {
+        /* Slices until the top bit of the block */
+        cache->folds = (uint8_t)((32 - config->offset - 1) / config->index);
+    }
+    if (config->index_function == INDEX_FUNCTION_PRIME) {
+        cache->set_count = largest_prime(cache->set_count);
+        cache->reciprocal = UINT64_MAX / cache->set_count + 1;
+    }
+    cache->kernel = cache_kernel_select(config);
+    cache->lines = lines;
+    cache->rank = rank;
+    cache->state = state;
+    cache->victim = NULL;
+    cache->telemetry = NULL;
+    cache_reset(cache);
+}
+
+/* cache_alloc
+ *
+ * Initialize a cache instance on heap storage
+ *
+ * @param       cache
+ * @param       config
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int cache_alloc(struct Cache *cache, const struct CacheConfig *config)
+{
+    /* Local Variables */
+    size_t sets = (size_t)1 << config->index;
+    line_t *lines;
+    uint8_t *rank;
+    uint32_t *state;
+
+    if (!cache_config_valid(config)) {
+        return -1;
+    }
+
+    lines = malloc(sets * config->ways * sizeof(*lines));
+    rank = malloc(sets * config->ways * sizeof(*rank));
+    state = malloc(sets * sizeof(*state));
+    if (lines == NULL || rank == NULL || state == NULL) {
+        free(lines);
+        free(rank);
+        free(state);
+        return -1;
+    }
+    cache_init(cache, config, lines, rank, state);
+
+    return 0;
+}
+
+/* cache_release
+ *
+ * Release the heap storage of a cache instance from cache_alloc()
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+void cache_release(struct Cache *cache)
+{
+    free(cache->lines);
+    free(cache->rank);
+    free(cache->state);
+    cache->lines = NULL;
+    cache->rank = NULL;
+    cache->state = NULL;
+}
+
+/* cache_create
+ *
+ * Create a cache instance and its storage in one heap block. Instances
+ * share no state, so each one may be driven by its own thread.
+ *
+ * @param       config
+ *
+ * @return      cache, NULL on an invalid config or no memory
+ */
+cache_t *cache_create(const cache_config_t *config)
+{
+    /* Local Variables */
+    size_t sets = (size_t)1 << config->index;
+    size_t lines = sets * config->ways;
+    struct Cache *cache;
+    uint8_t *storage;
+    size_t size;
+
+    if (!cache_config_valid(config)) {
+        return NULL;
+    }
+
+    /* Widest alignment first: lines, states, ranks */
+    size = sizeof(*cache) + lines * sizeof(line_t) + sets * sizeof(uint32_t) + lines;
+#if defined(HOST_BUILD)
+    /* Keeps the alignment of the counters */
+    cache = aligned_alloc(COUNTER_LINE, (size + COUNTER_LINE - 1) & ~(size_t)(COUNTER_LINE - 1));
+#else
+    cache = malloc(size);
+#endif
+    if (cache == NULL) {
+        return NULL;
+    }
+    storage = (uint8_t *)(cache + 1);
+    cache_init(cache, config, (line_t *)storage,
+               storage + lines * sizeof(line_t) + sets * sizeof(uint32_t),
+               (uint32_t *)(storage + lines * sizeof(line_t)));
+
+    return cache;
+}
+
+/* cache_destroy
+ *
+ * Release a cache instance from cache_create()
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+void cache_destroy(cache_t *cache)
+{
+    free(cache);
+}
+
+/* cache_reset
+ *
+ * Invalidate all lines and reset the replacement state and counters
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+void cache_reset(struct Cache *cache)
+{
+    /* Local Variables */
+    uint32_t i;
+    uint32_t lines = cache->set_count * cache->config.ways;
+
+    /* Init blocks where valid = 0 */
+    for (i = 0; i < lines; i++) {
+        cache->lines[i] = 0;
+    }
+    for (i = 0; i < cache->set_count; i++) {
+        replacement_init(&cache->rank[i * cache->config.ways], &cache->state[i],
+                         cache->config.ways, cache->config.replacement, i);
+    }
+
+    /* Init hit/miss counter to 0 */
+    memset(&cache->hit_miss, 0, sizeof(cache->hit_miss));
+    cache->traffic.fill_bytes = 0;
+    cache->traffic.writeback_bytes = 0;
+    cache->traffic.write_through_bytes = 0;
+
+    if (cache->victim != NULL) {
+        victim_reset(cache->victim);
+    }
+#if TELEMETRY
+    if (cache->telemetry != NULL) {
+        telemetry_reset(cache->telemetry);
+        telemetry_recount(cache);
+    }
+#endif
+}
+
+/* access_instance
+ *
+ * Read or write size bytes inside one block of any cache instance
+ *
+ * @param       cache
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ * @param       counter
+ * @param       traffic
+ *
+ * @return      result_t
+ */
+ALWAYS_INLINE result_t access_instance(struct Cache *cache, uint32_t address, access_t access,
+                                       uint8_t size, struct HitMiss *counter,
+                                       struct MemoryTraffic *traffic)
+{
+    /* Calculate tag and index */
+    uint32_t ways = cache->config.ways;
+    uint32_t index = (address >> cache->config.offset) & (cache->set_count - 1);
+    uint32_t tag = address >> (cache->config.offset + cache->config.index);
+
+    if (cache->victim != NULL) {
+        return access_victim(cache, address, access, size, counter, traffic);
+    }
+    switch (cache->config.index_function) {
+    case INDEX_FUNCTION_XOR:
+        return access_hashed(cache, INDEX_FUNCTION_XOR, address, access, size, counter, traffic);
+    case INDEX_FUNCTION_PRIME:
+        return access_hashed(cache, INDEX_FUNCTION_PRIME, address, access, size, counter, traffic);
+    case INDEX_FUNCTION_SKEWED:
+        return access_hashed(cache, INDEX_FUNCTION_SKEWED, address, access, size, counter, traffic);
+    default:
+        break;
+    }
+    return access_set(&cache->config, ways, KERNEL_SCALAR, &cache->lines[index * ways],
+                      &cache->rank[index * ways], &cache->state[index], tag, access, size, counter,
+                      traffic);
+}
+
+#if TELEMETRY
+/* access_telemetry
+ *
+ * access_instance() counted into the telemetry. The bit index function
+ * reuses the set of the access and always evicts on a fill of a full
+ * set, so it needs no telemetry_before().
+ *
+ * @param       cache
+ * @param       address
+ * @param       access
+ * @param       size
+ * @param       counter
+ * @param       traffic
+ *
+ * @return      result_t
+ */
+ALWAYS_INLINE result_t access_telemetry(struct Cache *cache, uint32_t address, access_t access,
+                                        uint8_t size, struct HitMiss *counter,
+                                        struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    uint32_t set;
+    uint32_t full;
+    result_t result;
+
+    if (cache->victim == NULL && cache->config.index_function == INDEX_FUNCTION_BITS) {
+        uint32_t ways = cache->config.ways;
+        uint32_t tag = address >> (cache->config.offset + cache->config.index);
+
+        set = (address >> cache->config.offset) & (cache->set_count - 1);
+        result = access_set(&cache->config, ways, KERNEL_SCALAR, &cache->lines[set * ways],
+                            &cache->rank[set * ways], &cache->state[set], tag, access, size,
+                            counter, traffic);
+        telemetry_after(cache, set, 1, access, result);
+        return result;
+    }
+    full = telemetry_before(cache, address, &set);
+    result = access_instance(cache, address, access, size, counter, traffic);
+    telemetry_after(cache, set, full, access, result);
+
+    return result;
+}
+#endif
+
+/* cache_access
+ *
+ * Read or write size bytes inside one block. A miss fills the line
+ * unless it is a write without write-allocate.
+ *
+ * @param       cache
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ *
+ * @return      result_t
+ */
+result_t cache_access(struct Cache *cache, uint32_t address, access_t access, uint8_t size)
+{
+    return cache_access_counted(cache, address, access, size, &cache->hit_miss, &cache->traffic);
+}
+
+/* cache_access_counted
+ *
+ * Same as cache_access(), but counts into the given counters
+ *
+ * @param       cache
+ * @param       address
+ * @param       access
+ * @param       size
+ * @param       counter
+ * @param       traffic
+ *
+ * @return      result_t
+ */
+result_t cache_access_counted(struct Cache *cache, uint32_t address, access_t access, uint8_t size,
+                              struct HitMiss *counter, struct MemoryTraffic *traffic)
+{
+#if TELEMETRY
+    if (cache->telemetry != NULL) {
+        return access_telemetry(cache, address, access, size, counter, traffic);
+    }
+#endif
+    return access_instance(cache, address, access, size, counter, traffic);
+}
+
+/* cache_kernel_select
+ *
+ * Pick the fastest batch kernel for a config, see cache_kernel_engine()
+ *
+ * @param       config
+ *
+ * @return      kernel
+ */
+cache_kernel_t cache_kernel_select(const cache_config_t *config)
+{
+    /* Local Variables */
+    cache_kernel_t kernel = cache_kernel_engine(config, KERNEL_AVX2);
+
+    if (kernel == NULL) {
+        kernel = cache_kernel_engine(config, KERNEL_SSE2);
+    }
+    if (kernel == NULL) {
+        kernel = cache_kernel_engine(config, KERNEL_SCALAR);
+    }
+
+    return kernel;
+}
+
+/* cache_kernel_engine
+ *
+ * Batch kernel of one engine for a config. The scalar engine has
+ * kernels specialized for 1, 2, 4 and 8 ways with an unrolled tag
+ * compare and falls back to cache_kernel_generic(). The SIMD engines
+ * have kernels for 8, 16 and 32 ways that compare all tags of a set at
+ * once and prefetch the sets of upcoming addresses. They exist on x86
+ * only, AVX2 if the CPU supports it. The hashed index functions have
+ * one scalar kernel each.
+ *
+ * @param       config
+ * @param       engine
+ *
+ * @return      kernel, NULL if the engine has none for the config
+ */
+cache_kernel_t cache_kernel_engine(const cache_config_t *config, kernel_engine_t engine)
+{
+    /* Local Variables */
+    size_t i;
+
+    if (config->index_function != INDEX_FUNCTION_BITS) {
+        return engine == KERNEL_SCALAR ? hashed_kernels[config->index_function] : NULL;
+    }
+#if KERNEL_HAVE_AVX2
+    if (engine == KERNEL_AVX2 && !__builtin_cpu_supports("avx2")) {
+        return NULL;
+    }
+#endif
+    for (i = 0; i < sizeof(kernel_table) / sizeof(kernel_table[0]); i++) {
+        if (kernel_table[i].ways == config->ways && kernel_table[i].engine == engine) {
+            return kernel_table[i].kernel;
+        }
+    }
+
+    return engine == KERNEL_SCALAR ? cache_kernel_generic : NULL;
+}
+
+/* cache_kernel_generic
+ *
+ * Batch kernel for any config, see cache_access_batch()
+ *
+ * @return      number of hits
+ */
+size_t cache_kernel_generic(cache_t *cache, const uint32_t *addresses, const uint8_t *accesses,
+                            uint8_t size, size_t count, uint8_t *results)
+{
+    if (cache->config.index_function != INDEX_FUNCTION_BITS) {
+        return hashed_kernels[cache->config.index_function](cache, addresses, accesses, size, count,
+                                                            results);
+    }
+    return access_batch(cache, cache->config.ways, KERNEL_SCALAR, 0, addresses, accesses, size, count,
+                        results);
+}
+
+/* cache_kernel_name
+ *
+ * Name of a kernel
+ *
+ * @param       kernel
+ *
+ * @return      name
+ */
+const char *cache_kernel_name(cache_kernel_t kernel)
+{
+    /* Local Variables */
+    size_t i;
+
+    for (i = 0; i < sizeof(kernel_table) / sizeof(kernel_table[0]); i++) {
+        if (kernel_table[i].kernel == kernel) {
+            return kernel_table[i].name;
+        }
+    }
+    for (i = 1; i < sizeof(hashed_kernels) / sizeof(hashed_kernels[0]); i++) {
+        if (hashed_kernels[i] == kernel) {
+            return hashed_kernel_names[i];
+        }
+    }
+
+    if (kernel == cache_kernel_telemetry) {
+        return "telemetry";
+    }
+    return kernel == cache_kernel_victim ? "victim" : "generic";
+}
+
+/* cache_access_batch
+ *
+ * Run an array of accesses through a cache instance in order, using
+ * the kernel picked for its config
+ *
+ * @param       cache
+ * @param       addresses
+ * @param       accesses    access_t of every address, NULL for reads only
+ * @param       size        Bytes of every access, used for write-through
+ * @param       count       Number of addresses
+ * @param       results     result_t of every access, may be NULL
+ *
+ * @return      number of hits
+ */
+size_t cache_access_batch(cache_t *cache, const uint32_t *addresses, const uint8_t *accesses,
+                          uint8_t size, size_t count, uint8_t *results)
+{
+    return cache->kernel(cache, addresses, accesses, size, count, results);
+}
+
+/* cache_flush
+ *
+ * Write back all dirty lines. The lines stay valid.
+ *
+ * @param       cache
+ * @param       traffic     Counts the written bytes
+ *
+ * @return      void
+ */
+void cache_flush(struct Cache *cache, struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    uint32_t lines = cache->set_count * cache->config.ways;
+    uint32_t i;
+
+    for (i = 0; i < lines; i++) {
+        if ((cache->lines[i] & (LINE_VALID | LINE_DIRTY)) == (LINE_VALID | LINE_DIRTY)) {
+            traffic->writeback_bytes += 1u << cache->config.offset;
+            cache->lines[i] &= ~LINE_DIRTY;
+        }
+    }
+    for (i = 0; cache->victim != NULL && i < cache->victim->entries; i++) {
+        if ((cache->victim->lines[i] & (LINE_VALID | LINE_DIRTY)) == (LINE_VALID | LINE_DIRTY)) {
+            traffic->writeback_bytes += 1u << cache->config.offset;
+            cache->victim->lines[i] &= ~LINE_DIRTY;
+        }
+    }
+}
+
+/* line_find
+ *
+ * Look up a block under any index function
+ *
+ * @param       cache
+ * @param       address
+ * @param       position    Gets the lines the block may use, ways of them
+ *                          for the skewed function, else the first of its set
+ *
+ * @return      line holding the block, LINE_NONE if absent
+ */
+static uint32_t line_find(const struct Cache *cache, uint32_t address, uint32_t *position)
+{
+    /* Local Variables */
+    uint32_t block = address >> cache->config.offset;
+    uint32_t ways = cache->config.ways;
+    uint32_t set;
+    uint32_t way;
+
+    switch (cache->config.index_function) {
+    case INDEX_FUNCTION_SKEWED:
+        return skewed_find(cache, block, position);
+    case INDEX_FUNCTION_XOR:
+        set = index_hash(cache, INDEX_FUNCTION_XOR, block, 0);
+        break;
+    case INDEX_FUNCTION_PRIME:
+        set = index_hash(cache, INDEX_FUNCTION_PRIME, block, 0);
+        break;
+    default:
+        set = index_hash(cache, INDEX_FUNCTION_BITS, block, 0);
+        break;
+    }
+    position[0] = set * ways;
+    way = find_way(&cache->lines[set * ways], ways, address >> cache->tag_shift);
 
-/* Struct to store the blocks */
-static struct BlockLine block_lines[LINE_COUNT];
+    return way < ways ? set * ways + way : LINE_NONE;
+}
 
-/* init_cache
+/* line_touch
  *
- * Function to initialize the cache simulation
+ * Update the replacement state after a hit on or a fill of a line
  *
- * @return void
+ * @param       cache
+ * @param       position    From line_find()
+ * @param       line
+ * @param       fill        1 if the line was just filled, 0 on a hit
  *
+ * @return      void
  */
-void init_cache(void)
+static void line_touch(struct Cache *cache, const uint32_t *position, uint32_t line, uint8_t fill)
 {
     /* Local Variables */
-    int i;
+    uint32_t ways = cache->config.ways;
 
-    /* Init blocks where valid = 0 */
-    for (i = 0; i < LINE_COUNT; i++) {
-        block_lines[i].valid = 0;
+    if (cache->config.index_function == INDEX_FUNCTION_SKEWED) {
+        skewed_touch(cache->rank, position, ways, line);
+        return;
+    }
+    replacement_touch(&cache->rank[position[0]], &cache->state[position[0] / ways], ways,
+                      cache->config.replacement, line - position[0], fill);
+}
+
+/* cache_lookup
+ *
+ * Look up an address without filling it. A hit updates the
+ * replacement state. Counters are not touched.
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 on a hit, 0 on a miss
+ */
+uint8_t cache_lookup(struct Cache *cache, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t position[MAX_WAYS];
+    uint32_t line = line_find(cache, address, position);
+
+    if (line == LINE_NONE) {
+        return 0;
     }
+    line_touch(cache, position, line, 0);
 
-    /* Init hit/miss counter to 0 */
-    hit_miss.hits = 0;
-    hit_miss.misses = 0;
+    return 1;
+}
+
+/* cache_probe
+ *
+ * Check whether the block of an address is present without changing
+ * any state
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 if present, 0 otherwise
+ */
+uint8_t cache_probe(const struct Cache *cache, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t position[MAX_WAYS];
+
+    return line_find(cache, address, position) != LINE_NONE;
+}
+
+/* cache_fill
+ *
+ * Place the block of an address into its set as a clean line. The hit
+ * and miss counters are not touched, the fill itself is not counted as
+ * traffic since its source depends on the caller.
+ *
+ * @param       cache
+ * @param       address
+ * @param       victim      Block address of the replaced line
+ * @param       traffic     Counts the write-back of a dirty victim, may
+ *                          be NULL
+ *
+ * @return      1 if a valid line was replaced, 0 otherwise
+ */
+uint8_t cache_fill(struct Cache *cache, uint32_t address, uint32_t *victim,
+                   struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    uint32_t ways = cache->config.ways;
+    uint32_t position[MAX_WAYS];
+    uint32_t line = line_find(cache, address, position);
+    uint32_t set = position[0] / ways;
+    uint8_t replaced = 0;
+
+    if (line != LINE_NONE) {
+        /* Already present */
+        line_touch(cache, position, line, 0);
+        return 0;
+    }
+
+    if (cache->config.index_function == INDEX_FUNCTION_SKEWED) {
+        line = skewed_victim(cache->lines, cache->rank, position, ways);
+    } else {
+        line = position[0] + replacement_victim(&cache->lines[position[0]], &cache->rank[position[0]],
+                                                &cache->state[set], ways, cache->config.replacement);
+    }
+    if (cache->lines[line] & LINE_VALID) {
+        /* Rebuild the block address from tag and set, hashed tags hold
+         * the whole block number */
+        *victim = (cache->lines[line] >> LINE_TAG_SHIFT) << cache->tag_shift;
+        if (cache->config.index_function == INDEX_FUNCTION_BITS) {
+            *victim |= set << cache->config.offset;
+        }
+        replaced = 1;
+        if ((cache->lines[line] & LINE_DIRTY) && traffic != NULL) {
+            traffic->writeback_bytes += 1u << cache->config.offset;
+        }
+    }
+#if TELEMETRY
+    if (cache->telemetry != NULL) {
+        cache->telemetry->occupancy[line / ways] += 1 - replaced;
+        cache->telemetry->free_lines -= 1 - replaced;
+    }
+#endif
+    cache->lines[line] = ((address >> cache->tag_shift) << LINE_TAG_SHIFT) | LINE_VALID;
+    line_touch(cache, position, line, 1);
+
+    return replaced;
+}
+
+/* cache_dirty
+ *
+ * Check whether the block of an address is present and dirty
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 if dirty, 0 if clean or absent
+ */
+uint8_t cache_dirty(const struct Cache *cache, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t position[MAX_WAYS];
+    uint32_t line = line_find(cache, address, position);
+
+    return line != LINE_NONE && (cache->lines[line] & LINE_DIRTY) != 0;
+}
+
+/* cache_mark_dirty
+ *
+ * Mark the block of an address dirty without changing the replacement
+ * state
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 if the block was present, 0 otherwise
+ */
+uint8_t cache_mark_dirty(struct Cache *cache, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t position[MAX_WAYS];
+    uint32_t line = line_find(cache, address, position);
+
+    if (line == LINE_NONE) {
+        return 0;
+    }
+    cache->lines[line] |= LINE_DIRTY;
+
+    return 1;
+}
+
+/* cache_line
+ *
+ * Find the line holding the block of an address without changing any
+ * state
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      line number, CACHE_LINE_NONE if absent
+ */
+uint32_t cache_line(const struct Cache *cache, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t position[MAX_WAYS];
+
+    return line_find(cache, address, position);
+}
+
+/* cache_set
+ *
+ * Set an address maps to under the index function of the cache, the
+ * set of way 0 for the skewed function
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      set
+ */
+uint32_t cache_set(const struct Cache *cache, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t block = address >> cache->config.offset;
+
+    switch (cache->config.index_function) {
+    case INDEX_FUNCTION_SKEWED:
+        return index_hash(cache, INDEX_FUNCTION_SKEWED, block, 0);
+    case INDEX_FUNCTION_XOR:
+        return index_hash(cache, INDEX_FUNCTION_XOR, block, 0);
+    case INDEX_FUNCTION_PRIME:
+        return index_hash(cache, INDEX_FUNCTION_PRIME, block, 0);
+    default:
+        return index_hash(cache, INDEX_FUNCTION_BITS, block, 0);
+    }
+}
+
+/* cache_invalidate
+ *
+ * Drop the block of an address
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 if the block was present, 0 otherwise
+ */
+uint8_t cache_invalidate(struct Cache *cache, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t position[MAX_WAYS];
+    uint32_t line = line_find(cache, address, position);
+
+    if (line == LINE_NONE) {
+        return 0;
+    }
+    cache->lines[line] = 0;
+#if TELEMETRY
+    if (cache->telemetry != NULL) {
+        cache->telemetry->occupancy[line / cache->config.ways]--;
+        cache->telemetry->free_lines++;
+    }
+#endif
+
+    return 1;
+}
+
+/* cache_attach_victim
+ *
+ * Put an empty victim cache behind the lines of a cache instance, see
+ * cache.h
+ *
+ * @param       cache
+ * @param       victim      Storage of the victim cache, NULL to detach
+ * @param       entries     1 .. VICTIM_MAX_ENTRIES
+ *
+ * @return      0 on success, -1 on invalid entries or an offset below 2
+ */
+int cache_attach_victim(struct Cache *cache, struct VictimCache *victim, uint8_t entries)
+{
+    if (victim == NULL) {
+        cache->victim = NULL;
+        kernel_update(cache);
+        return 0;
+    }
+    if (entries < 1 || entries > VICTIM_MAX_ENTRIES || cache->config.offset < LINE_TAG_SHIFT ||
+        cache->config.index_function != INDEX_FUNCTION_BITS) {
+        return -1;
+    }
+
+    victim->entries = entries;
+    victim_reset(victim);
+    cache->victim = victim;
+    kernel_update(cache);
+
+    return 0;
+}
+
+/* cache_attach_telemetry
+ *
+ * Count the hits, misses and evictions of every set per window of
+ * accesses into preallocated cells, see cache.h
+ *
+ * @param       cache
+ * @param       telemetry   Storage of the telemetry, NULL to detach
+ * @param       cells       capacity * set_count cells
+ * @param       occupancy   set_count bytes
+ * @param       capacity    Windows, even and at least 2
+ * @param       window      Accesses per window, at least 1
+ *
+ * @return      0 on success, -1 on invalid params or without TELEMETRY
+ */
+int cache_attach_telemetry(struct Cache *cache, struct Telemetry *telemetry,
+                           struct TelemetryCell *cells, uint8_t *occupancy, uint32_t capacity,
+                           uint32_t window)
+{
+#if TELEMETRY
+    if (telemetry == NULL) {
+        cache->telemetry = NULL;
+        kernel_update(cache);
+        return 0;
+    }
+    if (cells == NULL || occupancy == NULL || capacity < 2 || capacity % 2 != 0 || window < 1) {
+        return -1;
+    }
+
+    telemetry->set_count = cache->set_count;
+    telemetry->capacity = capacity;
+    telemetry->first_window = window;
+    telemetry->cells = cells;
+    telemetry->occupancy = occupancy;
+    telemetry_reset(telemetry);
+    cache->telemetry = telemetry;
+    telemetry_recount(cache);
+    kernel_update(cache);
+
+    return 0;
+#else
+    (void)cache;
+    (void)telemetry;
+    (void)cells;
+    (void)occupancy;
+    (void)capacity;
+    (void)window;
+
+    return -1;
+#endif
+}
+
+/* checkpoint_put
+ *
+ * Append bytes to a checkpoint
+ *
+ * @param       cursor      Write position, advanced
+ * @param       data
+ * @param       size
+ *
+ * @return      void
+ */
+static void checkpoint_put(uint8_t **cursor, const void *data, size_t size)
+{
+    memcpy(*cursor, data, size);
+    *cursor += size;
+}
+
+/* checkpoint_get
+ *
+ * Take bytes from a checkpoint
+ *
+ * @param       cursor      Read position, advanced
+ * @param       data
+ * @param       size
+ *
+ * @return      void
+ */
+static void checkpoint_get(const uint8_t **cursor, void *data, size_t size)
+{
+    memcpy(data, *cursor, size);
+    *cursor += size;
+}
+
+/* cache_serialized_size
+ *
+ * Bytes needed by cache_serialize()
+ *
+ * @param       cache
+ *
+ * @return      bytes
+ */
+size_t cache_serialized_size(const cache_t *cache)
+{
+    /* Local Variables */
+    size_t lines = (size_t)cache->set_count * cache->config.ways;
+    size_t entries = cache->victim != NULL ? cache->victim->entries : 0;
+
+    /* Header, word and rank per line, state per set, counters, victim
+     * entries and their words, ranks and counters */
+    return 4 * sizeof(uint32_t) + sizeof(struct CacheConfig) +
+           lines * (sizeof(line_t) + 1) + cache->set_count * sizeof(uint32_t) +
+           CHECKPOINT_COUNTERS * sizeof(uint64_t) +
+           (entries ? entries * (sizeof(line_t) + 1) +
+                      CHECKPOINT_VICTIM_COUNTERS * sizeof(uint64_t) : 0);
+}
+
+/* cache_serialize
+ *
+ * Write the full state of a cache instance, i.e. its config, lines,
+ * replacement state and counters and those of an attached victim
+ * cache, to a buffer. The format uses the byte order of the host.
+ *
+ * @param       cache
+ * @param       buffer
+ * @param       size        Size of the buffer
+ *
+ * @return      bytes written, 0 if the buffer is too small
+ */
+size_t cache_serialize(const cache_t *cache, void *buffer, size_t size)
+{
+    /* Local Variables */
+    uint32_t lines = cache->set_count * cache->config.ways;
+    uint32_t header[2] = { CHECKPOINT_MAGIC, CHECKPOINT_VERSION };
+    uint64_t counters[CHECKPOINT_COUNTERS];
+    uint8_t *cursor = buffer;
+    uint32_t entries;
+    uint32_t i;
+
+    if (size < cache_serialized_size(cache)) {
+        return 0;
+    }
+
+    checkpoint_put(&cursor, header, sizeof(header));
+    checkpoint_put(&cursor, &cache->config, sizeof(cache->config));
+    checkpoint_put(&cursor, &cache->set_count, sizeof(cache->set_count));
+    checkpoint_put(&cursor, cache->lines, lines * sizeof(line_t));
+    checkpoint_put(&cursor, cache->rank, lines);
+    checkpoint_put(&cursor, cache->state, cache->set_count * sizeof(uint32_t));
+
+    counters[0] = cache->hit_miss.hits;
+    counters[1] = cache->hit_miss.misses;
+    counters[2] = cache->hit_miss.write_hits;
+    counters[3] = cache->hit_miss.write_misses;
+    counters[4] = cache->traffic.fill_bytes;
+    counters[5] = cache->traffic.write_through_bytes;
+    counters[6] = cache->traffic.writeback_bytes;
+    for (i = 0; i < COUNTER_ARRAYS; i++) {
+        counters[7 + 2 * i] = cache->hit_miss.array[i].hits;
+        counters[8 + 2 * i] = cache->hit_miss.array[i].misses;
+    }
+    checkpoint_put(&cursor, counters, sizeof(counters));
+
+    entries = cache->victim != NULL ? cache->victim->entries : 0;
+    checkpoint_put(&cursor, &entries, sizeof(entries));
+    if (entries > 0) {
+        checkpoint_put(&cursor, cache->victim->lines, entries * sizeof(line_t));
+        checkpoint_put(&cursor, cache->victim->rank, entries);
+        counters[0] = cache->victim->hit_miss.hits;
+        counters[1] = cache->victim->hit_miss.misses;
+        counters[2] = cache->victim->hit_miss.write_hits;
+        counters[3] = cache->victim->hit_miss.write_misses;
+        checkpoint_put(&cursor, counters, CHECKPOINT_VICTIM_COUNTERS * sizeof(uint64_t));
+    }
+
+    return (size_t)(cursor - (uint8_t *)buffer);
+}
+
+/* cache_restore
+ *
+ * Load a state written by cache_serialize() into a cache instance of
+ * the same config and victim cache size
+ *
+ * @param       cache
+ * @param       buffer
+ * @param       size        Bytes in the buffer
+ *
+ * @return      0 on success, -1 on a malformed state, e.g. replacement
+ *              state no access could have left, or another config
+ */
+int cache_restore(cache_t *cache, const void *buffer, size_t size)
+{
+    /* Local Variables */
+    uint32_t lines = cache->set_count * cache->config.ways;
+    const uint8_t *cursor = buffer;
+    struct CacheConfig config;
+    uint32_t header[2];
+    uint32_t set_count;
+    uint64_t counters[CHECKPOINT_COUNTERS];
+    uint32_t entries = cache->victim != NULL ? cache->victim->entries : 0;
+    uint32_t saved_entries;
+    const uint8_t *rank;
+    const uint8_t *victim;
+    uint32_t state;
+    uint32_t i;
+
+    if (size != cache_serialized_size(cache)) {
+        return -1;
+    }
+    checkpoint_get(&cursor, header, sizeof(header));
+    checkpoint_get(&cursor, &config, sizeof(config));
+    checkpoint_get(&cursor, &set_count, sizeof(set_count));
+    if (header[0] != CHECKPOINT_MAGIC || header[1] != CHECKPOINT_VERSION ||
+        memcmp(&config, &cache->config, sizeof(config)) != 0 || set_count != cache->set_count) {
+        return -1;
+    }
+
+    /* The victim cache entries follow the counters, check before any
+     * state changes */
+    rank = cursor + lines * sizeof(line_t);
+    victim = rank + lines + set_count * sizeof(uint32_t) + sizeof(counters);
+    memcpy(&saved_entries, victim, sizeof(saved_entries));
+    if (saved_entries != entries) {
+        return -1;
+    }
+
+    /* So is the replacement state of every set. A skewed cache keeps
+     * saturating ages, any of them are valid. */
+    for (i = 0; i < set_count && config.index_function != INDEX_FUNCTION_SKEWED; i++) {
+        memcpy(&state, rank + lines + i * sizeof(uint32_t), sizeof(state));
+        if (!replacement_valid(&rank[i * config.ways], state, config.ways, config.replacement)) {
+            return -1;
+        }
+    }
+    if (entries > 0 && !replacement_valid(victim + sizeof(saved_entries) + entries * sizeof(line_t),
+                                          0, entries, REPLACEMENT_LRU)) {
+        return -1;
+    }
+
+    checkpoint_get(&cursor, cache->lines, lines * sizeof(line_t));
+    checkpoint_get(&cursor, cache->rank, lines);
+    checkpoint_get(&cursor, cache->state, cache->set_count * sizeof(uint32_t));
+
+    checkpoint_get(&cursor, counters, sizeof(counters));
+    cache->hit_miss.hits = counters[0];
+    cache->hit_miss.misses = counters[1];
+    cache->hit_miss.write_hits = counters[2];
+    cache->hit_miss.write_misses = counters[3];
+    cache->traffic.fill_bytes = counters[4];
+    cache->traffic.write_through_bytes = counters[5];
+    cache->traffic.writeback_bytes = counters[6];
+    for (i = 0; i < COUNTER_ARRAYS; i++) {
+        cache->hit_miss.array[i].hits = counters[7 + 2 * i];
+        cache->hit_miss.array[i].misses = counters[8 + 2 * i];
+    }
+
+    checkpoint_get(&cursor, &saved_entries, sizeof(saved_entries));
+    if (entries > 0) {
+        checkpoint_get(&cursor, cache->victim->lines, entries * sizeof(line_t));
+        checkpoint_get(&cursor, cache->victim->rank, entries);
+        checkpoint_get(&cursor, counters, CHECKPOINT_VICTIM_COUNTERS * sizeof(uint64_t));
+        memset(&cache->victim->hit_miss, 0, sizeof(cache->victim->hit_miss));
+        cache->victim->hit_miss.hits = counters[0];
+        cache->victim->hit_miss.misses = counters[1];
+        cache->victim->hit_miss.write_hits = counters[2];
+        cache->victim->hit_miss.write_misses = counters[3];
+    }
+#if TELEMETRY
+    if (cache->telemetry != NULL) {
+        telemetry_recount(cache);
+    }
+#endif
+
+    return 0;
+}
+
+/* init_cache
+ *
+ * Function to initialize the cache simulation
+ *
+ * @return void
+ *
+ */
+void init_cache(void)
+{
+    cache_init(&default_cache, &default_config, default_lines, default_rank, default_state);
+#if VICTIM_ENTRIES > 0
+    cache_attach_victim(&default_cache, &default_victim, VICTIM_ENTRIES);
+#endif
+#if TELEMETRY
+    cache_attach_telemetry(&default_cache, &default_telemetry, default_cells, default_occupancy,
+                           TELEMETRY_WINDOWS, TELEMETRY_WINDOW);
+#endif
 }
 
 /* access_cache
  *
- * Function that reads data from a cache. Returns 0 on failure
- * or 1 on success.
+ * Function that reads or writes one item through the cache.
+ * Returns 0 on failure or 1 on success.
  *
  * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
  *
  * @return      result_t
  */
-result_t access_cache(uint32_t address)
+result_t access_cache(uint32_t address, access_t access)
 {
-    /* Calculate tag and index*/
-    uint32_t tag = TAG_GET(address);
-    uint32_t index = INDEX_GET(address);
+    return access_cache_shard(address, access, ITEM_SIZE, &default_cache.hit_miss, &default_cache.traffic);
+}
 
-    /* Check if block is valid and if the tags matches */
-    if (block_lines[index].valid == 1 && block_lines[index].tag == tag) {
-        /* Hit*/
-        hit_miss.hits++;
+/* access_cache_sized
+ *
+ * Same as access_cache(), but for size bytes inside one block
+ *
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ *
+ * @return      result_t
+ */
+result_t access_cache_sized(uint32_t address, access_t access, uint8_t size)
+{
+    return access_cache_shard(address, access, size, &default_cache.hit_miss, &default_cache.traffic);
+}
 
-        return RESULT_HIT;
-    }else {
-        /* Miss */
-        hit_miss.misses++;
+/* access_cache_shard
+ *
+ * Same as access_cache(), but for size bytes inside one block and
+ * counting into the given counters. Accesses to different sets touch
+ * disjoint state, so threads that each own a distinct range of sets
+ * can call this concurrently. Not so with a victim cache or telemetry,
+ * which all sets share.
+ *
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ * @param       counter     Counters of the calling thread
+ * @param       traffic     Memory traffic of the calling thread
+ *
+ * @return      result_t
+ */
+result_t access_cache_shard(uint32_t address, access_t access, uint8_t size,
+                            struct HitMiss *counter, struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    result_t result;
+#if TELEMETRY
+    uint32_t set = 0;
+    uint32_t full = 0;
 
-        /* Simulate Block read from RAM -> block is valid now */
-        block_lines[index].valid = 1;
-        block_lines[index].tag = tag;
+    if (default_cache.telemetry != NULL) {
+        full = telemetry_before(&default_cache, address, &set);
+    }
+#endif
+#if VICTIM_ENTRIES > 0
+    result = access_victim(&default_cache, address, access, size, counter, traffic);
+#elif INDEX_FUNCTION != INDEX_FUNCTION_BITS
+    result = access_hashed(&default_cache, INDEX_FUNCTION, address, access, size, counter, traffic);
+#else
+    /* Calculate tag and index */
+    uint32_t index = INDEX_GET(address);
 
-        return RESULT_MISS;
+    result = access_set(&default_config, WAYS, KERNEL_SCALAR, &default_lines[index * WAYS],
+                        &default_rank[index * WAYS], &default_state[index], TAG_GET(address),
+                        access, size, counter, traffic);
+#endif
+#if TELEMETRY
+    if (default_cache.telemetry != NULL) {
+        telemetry_after(&default_cache, set, full, access, result);
     }
+#endif
+
+    return result;
 }
 
 /* get_cache_result
@@ -79,5 +2476,68 @@ result_t access_cache(uint32_t address)
  */
 struct HitMiss *get_cache_result(void)
 {
-    return &hit_miss;
+    return &default_cache.hit_miss;
+}
+
+/* get_cache_traffic
+ *
+ * Return a pointer to the memory traffic of the cache
+ *
+ * @return      MemoryTraffic
+ */
+struct MemoryTraffic *get_cache_traffic(void)
+{
+    return &default_cache.traffic;
+}
+
+/* get_cache
+ *
+ * Return the cache instance configured by config.h, which is used by
+ * init_cache() and access_cache()
+ *
+ * @return      Cache
+ */
+struct Cache *get_cache(void)
+{
+    return &default_cache;
+}
+
+/* get_victim_result
+ *
+ * Return a pointer to the results of the victim cache configured by
+ * config.h
+ *
+ * @return      HitMiss, NULL without a victim cache
+ */
+struct HitMiss *get_victim_result(void)
+{
+#if VICTIM_ENTRIES > 0
+    return &default_victim.hit_miss;
+#else
+    return NULL;
+#endif
+}
+
+/* hit_miss_add
+ *
+ * Add the counters of one instance or thread to a sum
+ *
+ * @param       sum
+ * @param       part
+ *
+ * @return      void
+ */
+void hit_miss_add(struct HitMiss *sum, const struct HitMiss *part)
+{
+    /* Local Variables */
+    uint32_t i;
+
+    sum->hits += part->hits;
+    sum->misses += part->misses;
+    sum->write_hits += part->write_hits;
+    sum->write_misses += part->write_misses;
+    for (i = 0; i < COUNTER_ARRAYS; i++) {
+        sum->array[i].hits += part->array[i].hits;
+        sum->array[i].misses += part->array[i].misses;
+    }
 }
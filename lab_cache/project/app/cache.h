@@ -16,6 +16,47 @@
 /* User includes */
 #include "config.h"
 
+/* Geometry checks */
+#if WAYS < 1 || WAYS > 32
+#error "WAYS must be between 1 and 32"
+#endif
+#if REPLACEMENT == REPLACEMENT_PLRU && (WAYS & (WAYS - 1)) != 0
+#error "Tree-PLRU needs a power of two WAYS"
+#endif
+#if OFFSET + INDEX < 2
+#error "OFFSET + INDEX must be at least 2, the tag shares a word with two flag bits"
+#endif
+#if VICTIM_ENTRIES < 0 || VICTIM_ENTRIES > 16
+#error "VICTIM_ENTRIES must be between 0 and 16"
+#endif
+#if VICTIM_ENTRIES > 0 && OFFSET < 2
+#error "A victim cache needs an OFFSET of at least 2, its lines hold the block number"
+#endif
+#if INDEX_FUNCTION < INDEX_FUNCTION_BITS || INDEX_FUNCTION > INDEX_FUNCTION_SKEWED
+#error "INDEX_FUNCTION must be one of INDEX_FUNCTION_*"
+#endif
+#if INDEX_FUNCTION != INDEX_FUNCTION_BITS && OFFSET < 2
+#error "A hashed INDEX_FUNCTION needs an OFFSET of at least 2, the lines hold the block number"
+#endif
+#if INDEX_FUNCTION == INDEX_FUNCTION_SKEWED && REPLACEMENT != REPLACEMENT_LRU
+#error "The skewed INDEX_FUNCTION needs LRU replacement"
+#endif
+#if INDEX_FUNCTION != INDEX_FUNCTION_BITS && VICTIM_ENTRIES > 0
+#error "A victim cache needs the bit-slice INDEX_FUNCTION"
+#endif
+#if TELEMETRY && (TELEMETRY_WINDOW < 1 || TELEMETRY_WINDOWS < 2 || TELEMETRY_WINDOWS % 2 != 0)
+#error "TELEMETRY needs a TELEMETRY_WINDOW of at least 1 and an even TELEMETRY_WINDOWS"
+#endif
+
+/* Largest associativity of a cache instance */
+#define MAX_WAYS 32
+
+/* Most entries of a victim cache */
+#define VICTIM_MAX_ENTRIES 16
+
+/* Line number of an absent block, see cache_line() */
+#define CACHE_LINE_NONE 0xFFFFFFFFu
+
 /* Masks */
 #define OFFSET_MASK ((1 << OFFSET) - 1)
 #define INDEX_MASK  (((1 << INDEX) - 1) << OFFSET)
@@ -28,30 +69,196 @@
 
 /* Block
  *
- * Holds an integer that states the validity of the bit (0 = invalid,
- * 1 = valid) and the tag being held.
+ * One line packed into a word:  / TAG / DIRTY / VALID /
+ * VALID states the validity of the line, DIRTY whether it was written
+ * since it was filled (write-back only). A tag lookup compares the
+ * whole word with (tag << LINE_TAG_SHIFT) | LINE_VALID, ignoring DIRTY.
+ */
+typedef uint32_t line_t;
+
+#define LINE_VALID      1u
+#define LINE_DIRTY      2u
+#define LINE_TAG_SHIFT  2
+
+/* Re-reference prediction values for SRRIP (2 bit) */
+#define RRPV_MAX    3
+#define RRPV_INSERT (RRPV_MAX - 1)
+
+/* Bytes of a cache line of the machine running the simulator */
+#define COUNTER_LINE 64
+
+/* Counters of different instances or threads never share a line. Only
+ * the host build runs threads. */
+#if defined(HOST_BUILD) && defined(__GNUC__)
+#define COUNTER_ALIGNED __attribute__((aligned(COUNTER_LINE)))
+#else
+#define COUNTER_ALIGNED
+#endif
+
+/* Arrays counted by HitMiss, the array_index_t values of arrays.h */
+#define COUNTER_ARRAYS 4
+
+/* AccessCount
+ *
+ * Hits and misses of one kind of access
  */
-struct BlockLine {
-    uint8_t valid;
-    uint32_t tag;
+struct AccessCount {
+    uint64_t hits;
+    uint64_t misses;
 };
 
 /* HitMiss
  *
- * Count of Hits and Misses
- *
+ * Count of Hits and Misses, in total, of the writes and per array.
+ * The reads are the total less the writes. Only accesses that know
+ * their array are counted per array, see access_array() of arrays.h.
+ * One per instance or thread, filling whole cache lines.
  */
 struct HitMiss {
-    uint16_t hits;
-    uint16_t misses;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t write_hits;
+    uint64_t write_misses;
+    struct AccessCount array[COUNTER_ARRAYS];   /* By array_index_t */
+} COUNTER_ALIGNED;
+
+/* MemoryTraffic
+ *
+ * Bytes moved between the cache and memory. fill_bytes and
+ * writeback_bytes both change on every miss and are kept apart, so the
+ * compiler does not merge them into one wide read-modify-write that
+ * serializes consecutive misses.
+ */
+struct MemoryTraffic {
+    uint64_t fill_bytes;            /* Lines read on a miss */
+    uint64_t write_through_bytes;   /* Writes passed on at once */
+    uint64_t writeback_bytes;       /* Dirty lines written on eviction */
+};
+
+/* CacheConfig
+ *
+ * Geometry, replacement and write policy of a cache instance
+ */
+struct CacheConfig {
+    uint8_t offset;         /* Offset size in bits */
+    uint8_t index;          /* Index size in bits */
+    uint8_t ways;           /* Lines per set, 1 .. MAX_WAYS */
+    uint8_t replacement;    /* REPLACEMENT_* of config.h */
+    uint8_t write_policy;   /* WRITE_POLICY_* of config.h */
+    uint8_t write_miss;     /* WRITE_MISS_* of config.h */
+    uint8_t index_function; /* INDEX_FUNCTION_* of config.h */
+};
+
+/* VictimCache
+ *
+ * Small fully associative LRU buffer behind the lines of a cache. It
+ * takes every valid line the cache replaces and swaps a line back into
+ * its set on a hit. Its lines hold the block number (address >> offset)
+ * in place of the tag.
+ */
+struct VictimCache {
+    uint8_t entries;                        /* 1 .. VICTIM_MAX_ENTRIES */
+    line_t lines[VICTIM_MAX_ENTRIES];
+    uint8_t rank[VICTIM_MAX_ENTRIES];       /* LRU age */
+    struct HitMiss hit_miss;                /* Lookups on misses of the cache */
+};
+
+/* TelemetryCell
+ *
+ * Counts of one set in one window
+ */
+struct TelemetryCell {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;         /* Valid lines replaced */
+};
+
+/* Telemetry
+ *
+ * Counts per set and window of a cache instance, see
+ * cache_attach_telemetry(). cells holds capacity rows of set_count
+ * cells, row w counts the accesses window * w .. window * (w + 1) - 1.
+ * Every fill counts as an eviction, only while free_lines is not 0 a
+ * fill looks at the occupancy of its set and takes the count back if it
+ * found an invalid line, so the access of a full cache does not scan
+ * its set.
+ */
+struct Telemetry {
+    uint32_t set_count;
+    uint32_t capacity;          /* Windows, even */
+    uint32_t first_window;      /* Accesses per window after a reset */
+    uint64_t window;            /* Accesses per window */
+    uint32_t current;           /* Window being counted */
+    uint64_t remaining;         /* Accesses left in it */
+    struct TelemetryCell *cells;
+    struct TelemetryCell *row;  /* Cells of the current window */
+    uint8_t *occupancy;         /* Valid lines per set */
+    uint32_t free_lines;        /* Invalid lines of the cache */
+};
+
+struct Cache;
+
+/* Engines of the batch kernels */
+typedef enum {
+    KERNEL_SCALAR,      /* Portable C */
+    KERNEL_SSE2,        /* x86 SSE2 tag compare, 4 ways at once */
+    KERNEL_AVX2,        /* x86 AVX2 tag compare, 8 ways at once */
+    KERNEL_ENGINES
+} kernel_engine_t;
+
+/* Kernel
+ *
+ * Batch access routine of a cache instance, see cache_access_batch()
+ */
+typedef size_t (*cache_kernel_t)(struct Cache *cache, const uint32_t *addresses,
+                                 const uint8_t *accesses, uint8_t size, size_t count,
+                                 uint8_t *results);
+
+/* Cache
+ *
+ * One cache instance. The lines of one set are stored next to each
+ * other, so a tag lookup only touches one contiguous block. rank holds
+ * the LRU age (0 = most recent) or the SRRIP RRPV of each line. state
+ * holds the PLRU tree bits, the FIFO pointer or the random seed of each
+ * set, so every set evolves independently.
+ *
+ * With the bit-slice index function a line holds the tag above the
+ * index bits, with the hashed ones the whole block number. The prime
+ * index function uses set_count sets of the 1 << index allocated. The
+ * skewed one keeps way w of set s in line s * ways + w as well, but
+ * every way of a block has its own set, and ranks the lines of these
+ * sets by a saturating age.
+ */
+struct Cache {
+    struct CacheConfig config;
+    uint32_t set_count;
+    uint8_t tag_shift;          /* Address bits below the tag of a line */
+    uint8_t folds;              /* Tag slices folded by the XOR index function */
+    uint64_t reciprocal;        /* 2^64 / set_count rounded up, prime index function */
+    cache_kernel_t kernel;      /* From cache_kernel_select() */
+    line_t *lines;
+    uint8_t *rank;
+    uint32_t *state;
+    struct HitMiss hit_miss;
+    struct MemoryTraffic traffic;
+    struct VictimCache *victim; /* NULL for none, see cache_attach_victim() */
+    struct Telemetry *telemetry;    /* NULL for none, see cache_attach_telemetry() */
 };
 
 /* Typedefs */
+typedef struct Cache cache_t;
+typedef struct CacheConfig cache_config_t;
+
 typedef enum {
     RESULT_HIT,
     RESULT_MISS
 } result_t;
 
+typedef enum {
+    WRITE_ACCESS,
+    READ_ACCESS
+} access_t;
+
 /* init_cache
  *
  * Function to initialize the cache simulation
@@ -63,14 +270,46 @@ void init_cache(void);
 
 /* access_cache
  *
- * Function that reads data from a cache. Returns 0 on failure
- * or 1 on success.
+ * Function that reads or writes one item through the cache.
+ * Returns 0 on failure or 1 on success.
+ *
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ *
+ * @return      result_t
+ */
+result_t access_cache(uint32_t address, access_t access);
+
+/* access_cache_sized
+ *
+ * Same as access_cache(), but for size bytes inside one block
  *
  * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
  *
  * @return      result_t
  */
-result_t access_cache(uint32_t address);
+result_t access_cache_sized(uint32_t address, access_t access, uint8_t size);
+
+/* access_cache_shard
+ *
+ * Same as access_cache(), but for size bytes inside one block and
+ * counting into the given counters. Accesses to different sets touch
+ * disjoint state, so threads that each own a distinct range of sets
+ * can call this concurrently. Not so with a victim cache or telemetry,
+ * which all sets share.
+ *
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ * @param       counter     Counters of the calling thread
+ * @param       traffic     Memory traffic of the calling thread
+ *
+ * @return      result_t
+ */
+result_t access_cache_shard(uint32_t address, access_t access, uint8_t size,
+                            struct HitMiss *counter, struct MemoryTraffic *traffic);
 
 /* get_cache_result
  *
@@ -80,5 +319,407 @@ result_t access_cache(uint32_t address);
  */
 struct HitMiss *get_cache_result(void);
 
+/* get_cache_traffic
+ *
+ * Return a pointer to the memory traffic of the cache
+ *
+ * @return      MemoryTraffic
+ */
+struct MemoryTraffic *get_cache_traffic(void);
+
+/* get_cache
+ *
+ * Return the cache instance configured by config.h, which is used by
+ * init_cache() and access_cache()
+ *
+ * @return      Cache
+ */
+struct Cache *get_cache(void);
+
+/* get_victim_result
+ *
+ * Return a pointer to the results of the victim cache configured by
+ * config.h
+ *
+ * @return      HitMiss, NULL without a victim cache
+ */
+struct HitMiss *get_victim_result(void);
+
+/* hit_miss_add
+ *
+ * Add the counters of one instance or thread to a sum
+ *
+ * @param       sum
+ * @param       part
+ *
+ * @return      void
+ */
+void hit_miss_add(struct HitMiss *sum, const struct HitMiss *part);
+
+/* cache_config_valid
+ *
+ * Check a cache configuration
+ *
+ * @param       config
+ *
+ * @return      1 if valid, 0 otherwise
+ */
+uint8_t cache_config_valid(const struct CacheConfig *config);
+
+/* cache_init
+ *
+ * Initialize a cache instance on caller provided storage of
+ * (1 << index) * ways lines and ranks and (1 << index) states
+ *
+ * @param       cache
+ * @param       config
+ * @param       lines
+ * @param       rank
+ * @param       state
+ *
+ * @return      void
+ */
+void cache_init(struct Cache *cache, const struct CacheConfig *config,
+                line_t *lines, uint8_t *rank, uint32_t *state);
+
+/* cache_alloc
+ *
+ * Initialize a cache instance on heap storage
+ *
+ * @param       cache
+ * @param       config
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int cache_alloc(struct Cache *cache, const struct CacheConfig *config);
+
+/* cache_release
+ *
+ * Release the heap storage of a cache instance from cache_alloc()
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+void cache_release(struct Cache *cache);
+
+/* cache_create
+ *
+ * Create a cache instance and its storage in one heap block. Instances
+ * share no state, so each one may be driven by its own thread.
+ *
+ * @param       config
+ *
+ * @return      cache, NULL on an invalid config or no memory
+ */
+cache_t *cache_create(const cache_config_t *config);
+
+/* cache_destroy
+ *
+ * Release a cache instance from cache_create()
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+void cache_destroy(cache_t *cache);
+
+/* cache_reset
+ *
+ * Invalidate all lines and reset the replacement state and counters
+ *
+ * @param       cache
+ *
+ * @return      void
+ */
+void cache_reset(struct Cache *cache);
+
+/* cache_access
+ *
+ * Read or write size bytes inside one block. A miss fills the line
+ * unless it is a write without write-allocate.
+ *
+ * @param       cache
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes written, used for write-through
+ *
+ * @return      result_t
+ */
+result_t cache_access(struct Cache *cache, uint32_t address, access_t access, uint8_t size);
+
+/* cache_access_counted
+ *
+ * Same as cache_access(), but counts into the given counters
+ *
+ * @param       cache
+ * @param       address
+ * @param       access
+ * @param       size
+ * @param       counter
+ * @param       traffic
+ *
+ * @return      result_t
+ */
+result_t cache_access_counted(struct Cache *cache, uint32_t address, access_t access, uint8_t size,
+                              struct HitMiss *counter, struct MemoryTraffic *traffic);
+
+/* cache_kernel_select
+ *
+ * Pick the fastest batch kernel for a config, see cache_kernel_engine()
+ *
+ * @param       config
+ *
+ * @return      kernel
+ */
+cache_kernel_t cache_kernel_select(const cache_config_t *config);
+
+/* cache_kernel_engine
+ *
+ * Batch kernel of one engine for a config. The scalar engine has
+ * kernels specialized for 1, 2, 4 and 8 ways with an unrolled tag
+ * compare and falls back to cache_kernel_generic(). The SIMD engines
+ * have kernels for 8, 16 and 32 ways that compare all tags of a set at
+ * once and prefetch the sets of upcoming addresses. They exist on x86
+ * only, AVX2 if the CPU supports it. The hashed index functions have
+ * one scalar kernel each.
+ *
+ * @param       config
+ * @param       engine
+ *
+ * @return      kernel, NULL if the engine has none for the config
+ */
+cache_kernel_t cache_kernel_engine(const cache_config_t *config, kernel_engine_t engine);
+
+/* cache_kernel_generic
+ *
+ * Batch kernel for any config, see cache_access_batch()
+ *
+ * @return      number of hits
+ */
+size_t cache_kernel_generic(cache_t *cache, const uint32_t *addresses, const uint8_t *accesses,
+                            uint8_t size, size_t count, uint8_t *results);
+
+/* cache_kernel_name
+ *
+ * Name of a kernel
+ *
+ * @param       kernel
+ *
+ * @return      name
+ */
+const char *cache_kernel_name(cache_kernel_t kernel);
+
+/* cache_access_batch
+ *
+ * Run an array of accesses through a cache instance in order, using
+ * the kernel picked for its config
+ *
+ * @param       cache
+ * @param       addresses
+ * @param       accesses    access_t of every address, NULL for reads only
+ * @param       size        Bytes of every access, used for write-through
+ * @param       count       Number of addresses
+ * @param       results     result_t of every access, may be NULL
+ *
+ * @return      number of hits
+ */
+size_t cache_access_batch(cache_t *cache, const uint32_t *addresses, const uint8_t *accesses,
+                          uint8_t size, size_t count, uint8_t *results);
+
+/* cache_flush
+ *
+ * Write back all dirty lines. The lines stay valid.
+ *
+ * @param       cache
+ * @param       traffic     Counts the written bytes
+ *
+ * @return      void
+ */
+void cache_flush(struct Cache *cache, struct MemoryTraffic *traffic);
+
+/* cache_lookup
+ *
+ * Look up an address without filling it. A hit updates the
+ * replacement state. Counters are not touched.
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 on a hit, 0 on a miss
+ */
+uint8_t cache_lookup(struct Cache *cache, uint32_t address);
+
+/* cache_probe
+ *
+ * Check whether the block of an address is present without changing
+ * any state
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 if present, 0 otherwise
+ */
+uint8_t cache_probe(const struct Cache *cache, uint32_t address);
+
+/* cache_fill
+ *
+ * Place the block of an address into its set as a clean line. The hit
+ * and miss counters are not touched, the fill itself is not counted as
+ * traffic since its source depends on the caller.
+ *
+ * @param       cache
+ * @param       address
+ * @param       victim      Block address of the replaced line
+ * @param       traffic     Counts the write-back of a dirty victim, may
+ *                          be NULL
+ *
+ * @return      1 if a valid line was replaced, 0 otherwise
+ */
+uint8_t cache_fill(struct Cache *cache, uint32_t address, uint32_t *victim,
+                   struct MemoryTraffic *traffic);
+
+/* cache_dirty
+ *
+ * Check whether the block of an address is present and dirty
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 if dirty, 0 if clean or absent
+ */
+uint8_t cache_dirty(const struct Cache *cache, uint32_t address);
+
+/* cache_mark_dirty
+ *
+ * Mark the block of an address dirty, as a write hit of a write-back
+ * cache would. The replacement state and the counters are not touched.
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 if the block was present, 0 otherwise
+ */
+uint8_t cache_mark_dirty(struct Cache *cache, uint32_t address);
+
+/* cache_line
+ *
+ * Find the line holding the block of an address without changing any
+ * state. Lines are numbered 0 .. sets * ways - 1 and keep their number
+ * while the block stays, so a caller can keep its own state per line.
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      line number, CACHE_LINE_NONE if absent
+ */
+uint32_t cache_line(const struct Cache *cache, uint32_t address);
+
+/* cache_set
+ *
+ * Set an address maps to under the index function of the cache. The
+ * skewed function gives each way its own set, this is the one of way 0.
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      set, 0 .. sets - 1
+ */
+uint32_t cache_set(const struct Cache *cache, uint32_t address);
+
+/* cache_invalidate
+ *
+ * Drop the block of an address
+ *
+ * @param       cache
+ * @param       address
+ *
+ * @return      1 if the block was present, 0 otherwise
+ */
+uint8_t cache_invalidate(struct Cache *cache, uint32_t address);
+
+/* cache_attach_victim
+ *
+ * Put an empty victim cache behind the lines of a cache instance. A
+ * miss of the cache then looks up the victim cache: a hit swaps its line
+ * with the one the set replaces, a miss fills from memory and moves the
+ * replaced line into the victim cache, whose LRU line is written back if
+ * dirty. Needs the bit-slice index function. The hit and miss counters
+ * of the cache count its own lines as without the victim cache, so do
+ * the results of the batch kernels, victim->hit_miss counts the
+ * lookups. cache_lookup(), cache_probe(),
+ * cache_fill() and cache_invalidate() only see the lines of the cache,
+ * a checkpoint holds the victim cache as well.
+ *
+ * @param       cache
+ * @param       victim      Storage of the victim cache, NULL to detach
+ * @param       entries     1 .. VICTIM_MAX_ENTRIES
+ *
+ * @return      0 on success, -1 on invalid entries, an offset below 2 or
+ *              a hashed index function
+ */
+int cache_attach_victim(struct Cache *cache, struct VictimCache *victim, uint8_t entries);
+
+/* cache_attach_telemetry
+ *
+ * Count the hits, misses and evictions of every set per window of
+ * accesses into preallocated cells. The cells are reset with the
+ * cache. When all windows are used, neighbouring windows are merged
+ * and the window doubles, so the whole run stays covered. A skewed
+ * cache counts a block in the set of its way 0. Only available with
+ * TELEMETRY, the parallel shards of access_cache_shard() must not
+ * share a cache with telemetry.
+ *
+ * @param       cache
+ * @param       telemetry   Storage of the telemetry, NULL to detach
+ * @param       cells       capacity * set_count cells
+ * @param       occupancy   set_count bytes
+ * @param       capacity    Windows, even and at least 2
+ * @param       window      Accesses per window, at least 1
+ *
+ * @return      0 on success, -1 on invalid params or without TELEMETRY
+ */
+int cache_attach_telemetry(struct Cache *cache, struct Telemetry *telemetry,
+                           struct TelemetryCell *cells, uint8_t *occupancy, uint32_t capacity,
+                           uint32_t window);
+
+/* cache_serialized_size
+ *
+ * Bytes needed by cache_serialize()
+ *
+ * @param       cache
+ *
+ * @return      bytes
+ */
+size_t cache_serialized_size(const cache_t *cache);
+
+/* cache_serialize
+ *
+ * Write the full state of a cache instance, i.e. its config, lines,
+ * replacement state and counters and those of an attached victim
+ * cache, to a buffer. The format uses the byte order of the host.
+ *
+ * @param       cache
+ * @param       buffer
+ * @param       size        Size of the buffer
+ *
+ * @return      bytes written, 0 if the buffer is too small
+ */
+size_t cache_serialize(const cache_t *cache, void *buffer, size_t size);
+
+/* cache_restore
+ *
+ * Load a state written by cache_serialize() into a cache instance of
+ * the same config and victim cache size
+ *
+ * @param       cache
+ * @param       buffer
+ * @param       size        Bytes in the buffer
+ *
+ * @return      0 on success, -1 on a malformed state, e.g. replacement
+ *              state no access could have left, or another config
+ */
+int cache_restore(cache_t *cache, const void *buffer, size_t size);
+
 #endif
 /* CACHE_H_ */
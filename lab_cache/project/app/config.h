@@ -12,22 +12,118 @@
 
 /* ------------------------------------------------------------------
  * Cache params
+ *
+ * The params can be overridden on the compiler command line, e.g.
+ * -DWAYS=4 for the host build.
  * --------------------------------------------------------------- */
 
 /* Size of the address in bits */
+#ifndef ADDRESS_SIZE
 #define ADDRESS_SIZE 11
+#endif
 
 /* Split Up Cache:  / TAG / INDEX / OFFSET /                       */
 /* Offset size in bits */
+#ifndef OFFSET
 #define OFFSET 2
+#endif
 /* Index size in bits */
+#ifndef INDEX
 #define INDEX  2
+#endif
+
+/* Associativity (lines per set), 1 = direct mapped */
+#ifndef WAYS
+#define WAYS   1
+#endif
 
 /* Tag size in bits */
 #define TAG    (ADDRESS_SIZE - INDEX - OFFSET)
 
+/* Set Count */
+#define SET_COUNT  (1 << INDEX)
+
+/* Available index functions, mapping a block to its set */
+#define INDEX_FUNCTION_BITS     0   /* INDEX bits above the offset */
+#define INDEX_FUNCTION_XOR      1   /* Tag bits folded onto the index bits */
+#define INDEX_FUNCTION_PRIME    2   /* Block modulo the largest prime set count */
+#define INDEX_FUNCTION_SKEWED   3   /* Like XOR, with another hash per way */
+
+/* Index function of the sets, all but BITS need an OFFSET of at least 2
+ * and SKEWED needs LRU replacement */
+#ifndef INDEX_FUNCTION
+#define INDEX_FUNCTION INDEX_FUNCTION_BITS
+#endif
+
 /* Line Count */
-#define LINE_COUNT (1 << INDEX)
+#define LINE_COUNT (SET_COUNT * WAYS)
+
+/* ------------------------------------------------------------------
+ * Replacement params
+ * --------------------------------------------------------------- */
+
+/* Available replacement policies */
+#define REPLACEMENT_LRU     0
+#define REPLACEMENT_PLRU    1
+#define REPLACEMENT_FIFO    2
+#define REPLACEMENT_RANDOM  3
+#define REPLACEMENT_SRRIP   4
+
+/* Policy used to pick the victim line of a full set */
+#ifndef REPLACEMENT
+#define REPLACEMENT REPLACEMENT_LRU
+#endif
+
+/* ------------------------------------------------------------------
+ * Write params
+ * --------------------------------------------------------------- */
+
+/* When a write reaches memory: on eviction of the dirty line or at once */
+#define WRITE_POLICY_BACK       0
+#define WRITE_POLICY_THROUGH    1
+
+#ifndef WRITE_POLICY
+#define WRITE_POLICY WRITE_POLICY_BACK
+#endif
+
+/* Whether a write miss fills the line or writes around the cache */
+#define WRITE_MISS_ALLOCATE     0
+#define WRITE_MISS_NO_ALLOCATE  1
+
+#ifndef WRITE_MISS
+#define WRITE_MISS WRITE_MISS_ALLOCATE
+#endif
+
+/* ------------------------------------------------------------------
+ * Victim cache params
+ * --------------------------------------------------------------- */
+
+/* Entries of the fully associative victim cache behind the lines,
+ * 0 = none, up to 16 */
+#ifndef VICTIM_ENTRIES
+#define VICTIM_ENTRIES 0
+#endif
+
+/* ------------------------------------------------------------------
+ * Telemetry params
+ * --------------------------------------------------------------- */
+
+/* Count hits, misses and evictions per set and per window of accesses,
+ * 0 = compiled out */
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+
+/* Accesses per window of the cache of config.h */
+#ifndef TELEMETRY_WINDOW
+#define TELEMETRY_WINDOW 1024
+#endif
+
+/* Windows kept, even. When they are used up, neighbours are merged and
+ * the window doubles. */
+#ifndef TELEMETRY_WINDOWS
+#define TELEMETRY_WINDOWS 64
+#endif
 
 /* ------------------------------------------------------------------
  * Array params
@@ -42,5 +138,46 @@
 /* Array item size in Bytes */
 #define ITEM_SIZE 1
 
+/* Available array layouts */
+#define ARRAY_LAYOUT_ROW_MAJOR      0
+#define ARRAY_LAYOUT_COLUMN_MAJOR   1
+#define ARRAY_LAYOUT_INTERLEAVED    2   /* Array of structs { a, b, c } */
+#define ARRAY_LAYOUT_TILED          3   /* Row-major tiles of TILE_SIZE^2 items */
+#define ARRAY_LAYOUT_MORTON         4   /* Z-order curve */
+
+/* Placement of the items of arrays A, B and C in memory */
+#ifndef ARRAY_LAYOUT
+#define ARRAY_LAYOUT ARRAY_LAYOUT_ROW_MAJOR
+#endif
+
+/* Padding in Bytes after every array, after every struct when
+ * interleaved */
+#ifndef ARRAY_PADDING
+#define ARRAY_PADDING 0
+#endif
+
+/* Padding in Bytes after every row, after every column when column
+ * major. Not used by the tiled and Morton layouts. */
+#ifndef ROW_PADDING
+#define ROW_PADDING 0
+#endif
+
+/* Tile edge in items of the tiled layout */
+#ifndef TILE_SIZE
+#define TILE_SIZE 4
+#endif
+
+/* ------------------------------------------------------------------
+ * Build params
+ * --------------------------------------------------------------- */
+
+/* Show every access on the LCD and wait for T0/T1. The host build
+ * (HOST_BUILD) runs headless. */
+#ifdef HOST_BUILD
+#define DISPLAY_RESULTS 0
+#else
+#define DISPLAY_RESULTS 1
+#endif
+
 #endif
 /* CONFIG_H_ */
@@ -16,6 +16,26 @@
 #include "config.h"
 
 
+/* simulate_item
+ *
+ * Simulate the kernel on one item, for_each_item() callback
+ *
+ * @param       row index
+ * @param       column index
+ * @param       context     Unused
+ *
+ * @return      0
+ */
+static int simulate_item(uint16_t row, uint16_t col, void *context)
+{
+    (void)context;
+
+    // Replaces a[x, y] = b[x, y] + c[x, y]
+    a_equals_b_plus_c(row, col);
+
+    return 0;
+}
+
 /* run_simulation
  *
  * Run the simulation
@@ -24,14 +44,7 @@
  */
 static void run_simulation(void)
 {
-    //Loop through columns
-    for (uint16_t j = 0; j < ARRAY_COLUMNS; j++) {
-        //Loop through rows
-        for (uint16_t i = 0; i < ARRAY_ROWS; i++) {
-            // Replaces a[x, y] = b[x, y] + c[x, y]
-            a_equals_b_plus_c(i, j);
-        }
-    }
+    for_each_item(simulate_item, NULL);
 }
 
 
@@ -50,6 +63,12 @@ int main(void)
 
     /* Print simulation results */
     print_results(get_cache_result());
+#if VICTIM_ENTRIES > 0
+    /* The victim cache on the next screen, after T0 or T1 */
+    while (button2_pressed()) {}
+    while (!button1_pressed() && !button2_pressed()) {}
+    print_victim_results(get_victim_result());
+#endif
 
     while (1) {}
 }
@@ -23,7 +23,30 @@ void print_results(struct HitMiss *hit_miss)
     /* Local Variables */
     char str[80];
 
-    sprintf(str, "HITS: %6d        MISSES: %4d", hit_miss->hits, hit_miss->misses);
+    /* One LCD line of 20 characters each */
+    sprintf(str, "HITS: %-14lluMISSES: %-12llu", (unsigned long long)hit_miss->hits,
+            (unsigned long long)hit_miss->misses);
+
+    /* Print line */
+    debug_line_out(DEBUG_LEVEL_INFO, str);
+}
+
+/* print_victim_results
+ *
+ * Print the hits and misses of the victim cache, labeled
+ *
+ * @param       hit_miss    Hits and misses
+ *
+ * @return      void
+ */
+void print_victim_results(struct HitMiss *hit_miss)
+{
+    /* Local Variables */
+    char str[80];
+
+    /* One LCD line of 20 characters each */
+    sprintf(str, "VICTIM HITS: %-7lluVICTIM MISS: %-7llu", (unsigned long long)hit_miss->hits,
+            (unsigned long long)hit_miss->misses);
 
     /* Print line */
     debug_line_out(DEBUG_LEVEL_INFO, str);
@@ -10,11 +10,13 @@
 #ifndef SIM_H_
 #define SIM_H_
 
+#ifndef HOST_BUILD
 /* CT board includes */
 #include "hal_ct_seg7.h"
 #include "reg_ctboard.h"
 #include "hal_ct_lcd.h"
 #include "hal_timer.h"
+#endif
 
 /* User includes */
 #include "arrays.h"
@@ -43,6 +45,16 @@ typedef enum {
  */
 void print_results(struct HitMiss *hit_miss);
 
+/* print_victim_results
+ *
+ * Print the hits and misses of the victim cache, labeled
+ *
+ * @param       hit_miss    Hits and misses
+ *
+ * @return      void
+ */
+void print_victim_results(struct HitMiss *hit_miss);
+
 /* debug_line_out
  *
  * Prints out to the LCD
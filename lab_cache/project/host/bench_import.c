@@ -0,0 +1,259 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, trace importer benchmark
+ * --
+ * -- Usage       : bench_import [records] [directory]
+ * --               Writes the same synthetic accesses (default 4M) as
+ * --               din, lackey and pin trace, with an instruction
+ * --               fetch every four accesses in din and lackey, and
+ * --               as native text trace. Reports lines per second of
+ * --               parsing alone and of parsing and replaying into
+ * --               the cache of config.h, the native trace through
+ * --               trace_stream() for comparison.
+ * --------------------------------------------------------------- */
+
+#include <sys/stat.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace_bin.h"
+#include "trace_import.h"
+
+/* Formats written, the native text trace last */
+#define BENCH_FORMATS   4
+
+/* Names of the written files and the rows */
+static const char *bench_names[BENCH_FORMATS] = { "din", "lackey", "pin", "native" };
+
+/* Checksum
+ *
+ * Context of the visitors
+ */
+struct Checksum {
+    uint64_t sum;
+    uint64_t accesses;
+};
+
+/* next_record
+ *
+ * Synthetic access stream: the a = b + c kernel on word arrays,
+ * interleaved with unaligned 8 byte accesses that cross lines
+ *
+ * @param       n           Record number
+ * @param       record
+ *
+ * @return      void
+ */
+static void next_record(uint64_t n, struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t element = (uint32_t)(n / 4);
+    uint32_t hash = (uint32_t)(n * 2654435761u);
+
+    switch (n % 4) {
+        case 0:
+            record->access = READ_ACCESS;
+            record->address = 0x10000000u + element * 4;
+            break;
+        case 1:
+            record->access = READ_ACCESS;
+            record->address = 0x20000000u + element * 4;
+            break;
+        case 2:
+            record->access = WRITE_ACCESS;
+            record->address = 0x30000000u + element * 4;
+            break;
+        default:
+            record->access = (hash & 1) ? WRITE_ACCESS : READ_ACCESS;
+            record->address = 0x40000000u + (hash >> 8) * 8 + 4;
+            break;
+    }
+    record->size = (n % 4 == 3) ? 8 : 4;
+}
+
+/* write_line
+ *
+ * Write one record in a format, with the instruction fetch before it
+ *
+ * @param       file
+ * @param       format      TRACE_FORMAT_*, BENCH_FORMATS - 1 for native
+ * @param       n           Record number
+ * @param       record
+ *
+ * @return      void
+ */
+static void write_line(FILE *file, int format, uint64_t n, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t ip = 0x00400000u + (uint32_t)(n % 4096) * 4;
+    int write = record->access == WRITE_ACCESS;
+
+    switch (format) {
+        case TRACE_FORMAT_DIN:
+            if (n % 4 == 0) {
+                fprintf(file, "2 %x\n", ip);
+            }
+            fprintf(file, "%d %x %u\n", write, record->address, record->size);
+            break;
+        case TRACE_FORMAT_LACKEY:
+            if (n % 4 == 0) {
+                fprintf(file, "I  %08x,4\n", ip);
+            }
+            fprintf(file, " %c %08x,%u\n", write ? 'S' : 'L', record->address, record->size);
+            break;
+        case TRACE_FORMAT_PIN:
+            fprintf(file, "0x%x: %c 0x%08x %u\n", ip, write ? 'W' : 'R', record->address,
+                    record->size);
+            break;
+        default:
+            fprintf(file, "%c 0x%08x %u\n", write ? 'W' : 'R', record->address, record->size);
+            break;
+    }
+}
+
+/* sum_visit
+ *
+ * Add a record to the checksum
+ *
+ * @param       context     struct Checksum
+ * @param       record
+ *
+ * @return      void
+ */
+static void sum_visit(void *context, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct Checksum *checksum = context;
+
+    checksum->sum += record->address + record->size + record->access;
+}
+
+/* replay_visit
+ *
+ * Run a record through the cache of config.h, one access per block
+ *
+ * @param       context     struct Checksum
+ * @param       record
+ *
+ * @return      void
+ */
+static void replay_visit(void *context, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct Checksum *checksum = context;
+
+    checksum->sum += record->address + record->size + record->access;
+    checksum->accesses += trace_access_record(record);
+}
+
+/* run
+ *
+ * Parse a file once through a visitor
+ *
+ * @param       path
+ * @param       format      TRACE_FORMAT_*, BENCH_FORMATS - 1 for native
+ * @param       visit
+ * @param       checksum    Reset, gets the sums
+ * @param       import      Gets the counters of an import
+ *
+ * @return      seconds, negative on error
+ */
+static double run(const char *path, int format,
+                  void (*visit)(void *context, const struct TraceRecord *record),
+                  struct Checksum *checksum, struct TraceImport *import)
+{
+    /* Local Variables */
+    double start;
+    int64_t records;
+
+    checksum->sum = 0;
+    checksum->accesses = 0;
+    init_cache();
+    start = host_time();
+    if (format == BENCH_FORMATS - 1) {
+        records = trace_stream(path, visit, checksum);
+    } else {
+        records = trace_import(path, format, visit, checksum, import);
+    }
+
+    return records < 0 ? -1.0 : host_time() - start;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    uint64_t records = 4000000ull;
+    const char *directory = "/tmp";
+    char paths[BENCH_FORMATS][256];
+    FILE *files[BENCH_FORMATS];
+    struct TraceRecord record;
+    struct TraceImport import;
+    struct Checksum checksum;
+    uint64_t reference = 0;
+    uint64_t n;
+    int status = 0;
+    int f;
+
+    if (argc > 1) {
+        records = strtoull(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        directory = argv[2];
+    }
+
+    for (f = 0; f < BENCH_FORMATS; f++) {
+        snprintf(paths[f], sizeof(paths[f]), "%s/bench_import.%s", directory, bench_names[f]);
+        files[f] = fopen(paths[f], "w");
+        if (files[f] == NULL) {
+            perror(paths[f]);
+            return 1;
+        }
+    }
+    for (n = 0; n < records; n++) {
+        next_record(n, &record);
+        reference += record.address + record.size + record.access;
+        for (f = 0; f < BENCH_FORMATS; f++) {
+            write_line(files[f], f, n, &record);
+        }
+    }
+    for (f = 0; f < BENCH_FORMATS; f++) {
+        fclose(files[f]);
+    }
+
+    printf("RECORDS: %llu, replayed into offset %d index %d ways %d\n",
+           (unsigned long long)records, OFFSET, INDEX, WAYS);
+    printf("%-7s %10s %9s %12s %9s %14s %12s\n", "FORMAT", "LINES", "MB", "PARSE Ml/s", "MB/s",
+           "REPLAY Ml/s", "ACCESSES");
+    for (f = 0; f < BENCH_FORMATS; f++) {
+        struct stat st;
+        double bytes = stat(paths[f], &st) == 0 ? (double)st.st_size : 0;
+        double parse = run(paths[f], f, sum_visit, &checksum, &import);
+        double replay;
+        uint64_t lines;
+
+        if (parse < 0 || checksum.sum != reference) {
+            fprintf(stderr, "%s: %s\n", bench_names[f], parse < 0 ? "parse error" : "records differ");
+            status = 1;
+            continue;
+        }
+        replay = run(paths[f], f, replay_visit, &checksum, &import);
+        lines = f == BENCH_FORMATS - 1 ? records : import.lines;
+        printf("%-7s %10llu %9.1f %12.2f %9.1f %14.2f %12llu\n", bench_names[f],
+               (unsigned long long)lines, bytes / 1e6, lines / parse / 1e6, bytes / parse / 1e6,
+               lines / replay / 1e6, (unsigned long long)checksum.accesses);
+    }
+
+    for (f = 0; f < BENCH_FORMATS; f++) {
+        remove(paths[f]);
+    }
+
+    return status;
+}
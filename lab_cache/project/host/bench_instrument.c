@@ -0,0 +1,246 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, instrumentation benchmark
+ * --
+ * -- Usage       : bench_instrument [elements] [directory]
+ * --               Runs the triad a = b + s * c on double arrays
+ * --               (default 4M elements) plain and instrumented with
+ * --               the events discarded, run through a cache of
+ * --               config.h geometry or written to a binary trace,
+ * --               on 1 and on up to 4 threads. Reports the cost per
+ * --               event over the plain loop.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "instrument.h"
+#include "config.h"
+
+/* Elements per parallel_for() item */
+#define BENCH_CHUNK     (1u << 16)
+
+/* Sweeps over the arrays per run */
+#define BENCH_SWEEPS    4
+
+/* Sinks */
+#define SINK_PLAIN      0
+#define SINK_NONE       1
+#define SINK_CACHE      2
+#define SINK_TRACE      3
+
+/* Names of the sinks */
+static const char *sink_names[] = { "plain", "discard", "cache", "trace" };
+
+/* Triad
+ *
+ * Arrays of the triad
+ */
+struct Triad {
+    double *a;
+    double *b;
+    double *c;
+    size_t length;
+};
+
+/* triad_plain
+ *
+ * a = b + s * c on one chunk
+ *
+ * @param       context     struct Triad
+ * @param       item        Chunk
+ * @param       worker      unused
+ *
+ * @return      void
+ */
+static void triad_plain(void *context, uint32_t item, uint32_t worker)
+{
+    /* Local Variables */
+    struct Triad *t = context;
+    size_t end = ((size_t)item + 1) * BENCH_CHUNK < t->length ? ((size_t)item + 1) * BENCH_CHUNK
+                                                              : t->length;
+    size_t i;
+
+    (void)worker;
+    for (i = (size_t)item * BENCH_CHUNK; i < end; i++) {
+        t->a[i] = t->b[i] + 3.0 * t->c[i];
+    }
+}
+
+/* triad_traced
+ *
+ * a = b + s * c on one chunk, instrumented
+ *
+ * @param       context     struct Triad
+ * @param       item        Chunk
+ * @param       worker      unused
+ *
+ * @return      void
+ */
+static void triad_traced(void *context, uint32_t item, uint32_t worker)
+{
+    /* Local Variables */
+    struct Triad *t = context;
+    size_t end = ((size_t)item + 1) * BENCH_CHUNK < t->length ? ((size_t)item + 1) * BENCH_CHUNK
+                                                              : t->length;
+    size_t i;
+
+    (void)worker;
+    for (i = (size_t)item * BENCH_CHUNK; i < end; i++) {
+        TRACE_LOAD(&t->b[i]);
+        TRACE_LOAD(&t->c[i]);
+        TRACE_STORE(&t->a[i]);
+        t->a[i] = t->b[i] + 3.0 * t->c[i];
+    }
+}
+
+/* run
+ *
+ * Time the sweeps with one sink
+ *
+ * @param       triad
+ * @param       sink        SINK_*
+ * @param       threads
+ * @param       path        Binary trace of SINK_TRACE
+ * @param       stats       Gets the counters of the session
+ *
+ * @return      seconds, negative on error
+ */
+static double run(struct Triad *triad, uint32_t sink, uint32_t threads, const char *path,
+                  struct InstrumentStats *stats)
+{
+    /* Local Variables */
+    struct TraceBinWriter writer;
+    struct CacheConfig config;
+    uint32_t chunks = (uint32_t)((triad->length + BENCH_CHUNK - 1) / BENCH_CHUNK);
+    cache_t *cache = NULL;
+    double start;
+    double seconds;
+    uint32_t sweep;
+    int status = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&config, 0, sizeof(config));
+    config.offset = OFFSET;
+    config.index = INDEX;
+    config.ways = WAYS;
+    config.replacement = REPLACEMENT;
+    config.write_policy = WRITE_POLICY;
+    config.write_miss = WRITE_MISS;
+    config.index_function = INDEX_FUNCTION;
+
+    if (sink == SINK_CACHE && (cache = cache_create(&config)) == NULL) {
+        return -1;
+    }
+    if (sink == SINK_TRACE && trace_bin_create(&writer, path, 0) != 0) {
+        return -1;
+    }
+
+    start = host_time();
+    if (sink != SINK_PLAIN &&
+        instrument_start(sink == SINK_TRACE ? &writer : NULL, cache) != 0) {
+        status = -1;
+    }
+    for (sweep = 0; sweep < BENCH_SWEEPS && status == 0; sweep++) {
+        parallel_for(chunks, threads, sink == SINK_PLAIN ? triad_plain : triad_traced, triad);
+    }
+    if (sink != SINK_PLAIN && status == 0 && instrument_stop(stats) != 0) {
+        status = -1;
+    }
+    seconds = host_time() - start;
+
+    if (sink == SINK_TRACE && (trace_bin_finish(&writer) != 0 || status != 0)) {
+        status = -1;
+    }
+    cache_destroy(cache);
+
+    return status == 0 ? seconds : -1;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static const uint32_t thread_counts[] = { 1, 4 };
+    struct Triad triad;
+    struct InstrumentStats stats;
+    const char *directory = "/tmp";
+    char path[256];
+    uint64_t expected;
+    uint32_t cpus = parallel_cpus();
+    uint32_t k;
+    uint32_t sink;
+    size_t i;
+    int status = 0;
+
+    triad.length = 4u << 20;
+    if (argc > 1) {
+        triad.length = (size_t)strtoull(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        directory = argv[2];
+    }
+    snprintf(path, sizeof(path), "%s/bench_instrument.ctt", directory);
+
+    triad.a = malloc(triad.length * sizeof(double));
+    triad.b = malloc(triad.length * sizeof(double));
+    triad.c = malloc(triad.length * sizeof(double));
+    if (triad.a == NULL || triad.b == NULL || triad.c == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < triad.length; i++) {
+        triad.a[i] = 0;
+        triad.b[i] = (double)i;
+        triad.c[i] = 1.0;
+    }
+    expected = (uint64_t)triad.length * 3 * BENCH_SWEEPS;
+
+    printf("TRIAD: %zu doubles x %d sweeps, %llu events per run\n", triad.length, BENCH_SWEEPS,
+           (unsigned long long)expected);
+    printf("%-7s %-8s %10s %12s %12s %10s\n", "THREADS", "SINK", "SECONDS", "M events/s",
+           "ns/event", "STALLS");
+    for (k = 0; k < sizeof(thread_counts) / sizeof(thread_counts[0]); k++) {
+        uint32_t threads = thread_counts[k] < cpus ? thread_counts[k] : cpus;
+        double plain = 0;
+
+        if (k > 0 && threads == thread_counts[k - 1]) {
+            break;
+        }
+        for (sink = SINK_PLAIN; sink <= SINK_TRACE; sink++) {
+            double seconds = run(&triad, sink, threads, path, &stats);
+
+            if (seconds < 0 || (sink != SINK_PLAIN && stats.events != expected)) {
+                fprintf(stderr, "%s: %s\n", sink_names[sink], seconds < 0 ? "failed" : "events lost");
+                status = 1;
+                continue;
+            }
+            if (sink == SINK_PLAIN) {
+                plain = seconds;
+                printf("%-7u %-8s %10.3f\n", threads, sink_names[sink], seconds);
+                continue;
+            }
+
+            /* Cost over the plain loop, per event of one thread */
+            printf("%-7u %-8s %10.3f %12.1f %12.2f %10llu\n", threads, sink_names[sink], seconds,
+                   expected / seconds / 1e6, (seconds - plain) * 1e9 * threads / expected,
+                   (unsigned long long)stats.stalls);
+        }
+    }
+    remove(path);
+
+    free(triad.a);
+    free(triad.b);
+    free(triad.c);
+
+    return status;
+}
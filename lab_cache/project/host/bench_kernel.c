@@ -0,0 +1,257 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, kernel benchmark
+ * --
+ * -- Usage       : bench_kernel [accesses]
+ * --               Runs random reads and writes (default 16M) through
+ * --               the kernel of every engine and through the generic
+ * --               kernel for several associativities, on a small and
+ * --               on a large cache. Reports ns/access of each and
+ * --               checks that they all count the same. Then times
+ * --               the selected kernel of every index function.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "sim_host.h"
+
+/* Geometry of the benchmarked caches: the lines of the small one fit
+ * into L1, those of the large one not */
+#define BENCH_OFFSET        6
+#define BENCH_INDEX_SMALL   6
+#define BENCH_INDEX_LARGE   13
+
+/* Runs per kernel, the fastest counts */
+#define BENCH_RUNS      3
+
+/* run_kernel
+ *
+ * Time a kernel on an empty cache
+ *
+ * @param       cache
+ * @param       kernel
+ * @param       addresses
+ * @param       accesses
+ * @param       count
+ *
+ * @return      fastest run in ns per access
+ */
+static double run_kernel(cache_t *cache, cache_kernel_t kernel, const uint32_t *addresses,
+                         const uint8_t *accesses, size_t count)
+{
+    /* Local Variables */
+    double best = 0;
+    uint32_t run;
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        double start;
+        double seconds;
+
+        cache_reset(cache);
+        start = host_time();
+        kernel(cache, addresses, accesses, 4, count, NULL);
+        seconds = host_time() - start;
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+
+    return best * 1e9 / count;
+}
+
+/* run_geometry
+ *
+ * Benchmark all engines on caches with a number of sets
+ *
+ * @param       index       Index size in bits
+ * @param       addresses   Storage for count addresses
+ * @param       accesses    Storage for count access types
+ * @param       count
+ *
+ * @return      0 if all kernels agree, 1 otherwise
+ */
+static int run_geometry(uint8_t index, uint32_t *addresses, uint8_t *accesses, size_t count)
+{
+    /* Local Variables */
+    static const uint8_t ways[] = { 1, 2, 4, 8, 16, 32 };
+    static const char *engine_names[] = { "SCALAR ns", "SSE2 ns", "AVX2 ns" };
+    struct CacheConfig config;
+    uint32_t seed = 1;
+    uint32_t engine;
+    size_t i;
+    uint32_t w;
+    int status = 0;
+
+    memset(&config, 0, sizeof(config));
+    config.offset = BENCH_OFFSET;
+    config.index = index;
+    config.replacement = REPLACEMENT_LRU;
+    config.write_policy = WRITE_POLICY_BACK;
+    config.write_miss = WRITE_MISS_ALLOCATE;
+
+    printf("CACHE: offset %d index %u LRU write-back, %zu random accesses\n", BENCH_OFFSET, index,
+           count);
+    printf("%-5s", "WAYS");
+    for (engine = 0; engine < KERNEL_ENGINES; engine++) {
+        printf(" %12s", engine_names[engine]);
+    }
+    printf(" %12s  %s\n", "GENERIC ns", "SELECTED");
+
+    for (w = 0; w < sizeof(ways); w++) {
+        struct HitMiss counted;
+        struct MemoryTraffic traffic;
+        cache_t *cache;
+        double generic;
+        uint32_t range;
+
+        config.ways = ways[w];
+        cache = cache_create(&config);
+        if (cache == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+
+        /* Twice the capacity, so about half of the accesses hit */
+        range = (2u << (BENCH_OFFSET + index)) * ways[w];
+        for (i = 0; i < count; i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            addresses[i] = seed % range & ~3u;
+            accesses[i] = (seed & 0x80000000u) ? WRITE_ACCESS : READ_ACCESS;
+        }
+
+        /* The generic kernel is the reference */
+        generic = run_kernel(cache, cache_kernel_generic, addresses, accesses, count);
+        counted = cache->hit_miss;
+        traffic = cache->traffic;
+
+        printf("%-5u", ways[w]);
+        for (engine = 0; engine < KERNEL_ENGINES; engine++) {
+            cache_kernel_t kernel = cache_kernel_engine(&config, (kernel_engine_t)engine);
+
+            if (kernel == NULL || kernel == cache_kernel_generic) {
+                printf(" %12s", "-");
+                continue;
+            }
+            printf(" %12.2f", run_kernel(cache, kernel, addresses, accesses, count));
+            if (counted.hits != cache->hit_miss.hits || counted.misses != cache->hit_miss.misses ||
+                counted.write_hits != cache->hit_miss.write_hits ||
+                counted.write_misses != cache->hit_miss.write_misses ||
+                memcmp(&traffic, &cache->traffic, sizeof(traffic)) != 0) {
+                fprintf(stderr, "%u ways: %s kernel and generic engine disagree\n", ways[w],
+                        cache_kernel_name(kernel));
+                status = 1;
+            }
+        }
+        printf(" %12.2f", generic);
+        printf("  %s\n", cache_kernel_name(cache_kernel_select(&config)));
+        cache_destroy(cache);
+    }
+
+    return status;
+}
+
+/* run_functions
+ *
+ * Benchmark the selected kernel of every index function
+ *
+ * @param       index       Index size in bits
+ * @param       addresses   Storage for count addresses
+ * @param       accesses    Storage for count access types
+ * @param       count
+ *
+ * @return      void
+ */
+static void run_functions(uint8_t index, uint32_t *addresses, uint8_t *accesses, size_t count)
+{
+    /* Local Variables */
+    static const uint8_t ways[] = { 1, 4, 8 };
+    static const char *function_names[] = { "BITS ns", "XOR ns", "PRIME ns", "SKEWED ns" };
+    struct CacheConfig config;
+    uint32_t seed = 1;
+    uint32_t function;
+    size_t i;
+    uint32_t w;
+
+    memset(&config, 0, sizeof(config));
+    config.offset = BENCH_OFFSET;
+    config.index = index;
+    config.replacement = REPLACEMENT_LRU;
+    config.write_policy = WRITE_POLICY_BACK;
+    config.write_miss = WRITE_MISS_ALLOCATE;
+
+    printf("INDEX FUNCTIONS: offset %d index %u LRU write-back, %zu random accesses\n",
+           BENCH_OFFSET, index, count);
+    printf("%-5s", "WAYS");
+    for (function = 0; function <= INDEX_FUNCTION_SKEWED; function++) {
+        printf(" %12s", function_names[function]);
+    }
+    printf("\n");
+
+    for (w = 0; w < sizeof(ways); w++) {
+        uint32_t range = (2u << (BENCH_OFFSET + index)) * ways[w];
+
+        for (i = 0; i < count; i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            addresses[i] = seed % range & ~3u;
+            accesses[i] = (seed & 0x80000000u) ? WRITE_ACCESS : READ_ACCESS;
+        }
+
+        printf("%-5u", ways[w]);
+        config.ways = ways[w];
+        for (function = 0; function <= INDEX_FUNCTION_SKEWED; function++) {
+            cache_t *cache;
+
+            config.index_function = (uint8_t)function;
+            cache = cache_create(&config);
+            if (cache == NULL) {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+            printf(" %12.2f", run_kernel(cache, cache->kernel, addresses, accesses, count));
+            cache_destroy(cache);
+        }
+        printf("\n");
+    }
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    uint32_t *addresses;
+    uint8_t *accesses;
+    size_t count = 16u << 20;
+    int status;
+
+    if (argc > 1) {
+        count = (size_t)strtoull(argv[1], NULL, 0);
+    }
+    addresses = malloc(count * sizeof(*addresses));
+    accesses = malloc(count * sizeof(*accesses));
+    if (addresses == NULL || accesses == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    status = run_geometry(BENCH_INDEX_SMALL, addresses, accesses, count);
+    status |= run_geometry(BENCH_INDEX_LARGE, addresses, accesses, count);
+    run_functions(BENCH_INDEX_LARGE, addresses, accesses, count);
+
+    free(addresses);
+    free(accesses);
+
+    return status;
+}
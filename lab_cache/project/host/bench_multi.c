@@ -0,0 +1,168 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, multi-config benchmark
+ * --
+ * -- Usage       : bench_multi [accesses]
+ * --               Runs random reads and writes (default 4M) through
+ * --               1 to 64 LRU configs that differ in ways and write
+ * --               policy, once on the shared LRU stack of multi.h and
+ * --               once with a cache instance per config. Reports ns
+ * --               per access and per config of both and checks that
+ * --               they count the same.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "multi.h"
+
+/* Geometry of the benchmarked configs */
+#define BENCH_OFFSET    6
+#define BENCH_INDEX     8
+
+/* Accesses per batch, the chunk a trace reader would decode */
+#define BENCH_CHUNK     4096
+
+/* Runs per engine, the fastest counts */
+#define BENCH_RUNS      3
+
+/* run_multi
+ *
+ * Time an engine on empty caches, the results are left in multi
+ *
+ * @param       multi
+ * @param       configs
+ * @param       count       Configs
+ * @param       stacks      Passed to multi_init()
+ * @param       addresses
+ * @param       accesses
+ * @param       length      Accesses
+ *
+ * @return      fastest run in ns per access
+ */
+static double run_multi(struct Multi *multi, const struct CacheConfig *configs, uint32_t count,
+                        int stacks, const uint32_t *addresses, const uint8_t *accesses,
+                        size_t length)
+{
+    /* Local Variables */
+    double best = 0;
+    uint32_t run;
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        double start;
+        double seconds;
+        size_t i;
+
+        if (run > 0) {
+            multi_free(multi);
+        }
+        if (multi_init(multi, configs, count, stacks) != 0) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        start = host_time();
+        for (i = 0; i < length; i += BENCH_CHUNK) {
+            size_t chunk = length - i < BENCH_CHUNK ? length - i : BENCH_CHUNK;
+
+            multi_access_batch(multi, &addresses[i], &accesses[i], 4, chunk);
+        }
+        seconds = host_time() - start;
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    multi_flush(multi);
+
+    return best * 1e9 / length;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static const uint32_t counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    static struct Multi stacked;
+    static struct Multi instances;
+    struct CacheConfig configs[MULTI_MAX_CONFIGS];
+    uint32_t *addresses;
+    uint8_t *accesses;
+    size_t length = 4u << 20;
+    uint32_t seed = 1;
+    uint32_t k;
+    uint32_t c;
+    size_t i;
+    int status = 0;
+
+    if (argc > 1) {
+        length = (size_t)strtoull(argv[1], NULL, 0);
+    }
+    addresses = malloc(length * sizeof(*addresses));
+    accesses = malloc(length * sizeof(*accesses));
+    if (addresses == NULL || accesses == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    /* Ways 1 .. 32 write-back, then again write-through */
+    for (c = 0; c < MULTI_MAX_CONFIGS; c++) {
+        configs[c].offset = BENCH_OFFSET;
+        configs[c].index = BENCH_INDEX;
+        configs[c].ways = (uint8_t)(c % MAX_WAYS + 1);
+        configs[c].replacement = REPLACEMENT_LRU;
+        configs[c].write_policy = c < MAX_WAYS ? WRITE_POLICY_BACK : WRITE_POLICY_THROUGH;
+        configs[c].write_miss = WRITE_MISS_ALLOCATE;
+        configs[c].index_function = INDEX_FUNCTION_BITS;
+    }
+
+    /* Up to the capacity of 32 ways, so the hit ratio grows with the ways */
+    for (i = 0; i < length; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        addresses[i] = seed % (MAX_WAYS << (BENCH_OFFSET + BENCH_INDEX)) & ~3u;
+        accesses[i] = (seed & 0x80000000u) ? WRITE_ACCESS : READ_ACCESS;
+    }
+
+    printf("CONFIGS: offset %d index %d LRU, ways 1..32 write-back then write-through, "
+           "%zu random accesses\n", BENCH_OFFSET, BENCH_INDEX, length);
+    printf("%-7s %12s %14s %12s %14s %9s\n", "CONFIGS", "STACK ns", "STACK ns/cfg", "INSTANCE ns",
+           "INSTANCE ns/cfg", "SPEEDUP");
+
+    for (k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+        uint32_t count = counts[k];
+        double stack_ns = run_multi(&stacked, configs, count, 1, addresses, accesses, length);
+        double instance_ns = run_multi(&instances, configs, count, 0, addresses, accesses, length);
+
+        printf("%-7u %12.2f %14.3f %12.2f %14.3f %8.1fx\n", count, stack_ns, stack_ns / count,
+               instance_ns, instance_ns / count, instance_ns / stack_ns);
+
+        /* The instances are the reference */
+        for (c = 0; c < count; c++) {
+            struct MultiResult expected;
+            struct MultiResult result;
+
+            multi_result(&instances, c, &expected);
+            multi_result(&stacked, c, &result);
+            if (memcmp(&expected, &result, sizeof(result)) != 0) {
+                fprintf(stderr, "config %u of %u: stack and instance disagree\n", c, count);
+                status = 1;
+            }
+        }
+        multi_free(&stacked);
+        multi_free(&instances);
+    }
+
+    free(addresses);
+    free(accesses);
+
+    return status;
+}
@@ -0,0 +1,112 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, parallel scaling benchmark
+ * --
+ * -- Usage       : bench_parallel [records] [max workers]
+ * --               Replays a random read/write trace (default 20M records)
+ * --               sequentially and with 1 .. max workers (default:
+ * --               online cores) and checks that the counters and the
+ * --               memory traffic match.
+ * --               Sharding needs sets, e.g.
+ * --               make CONFIG="-DINDEX=10 -DWAYS=8" bench
+ * --------------------------------------------------------------- */
+
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "parallel.h"
+
+/* Address range of the random pattern */
+#define RANDOM_RANGE (1u << 24)
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    struct Trace trace;
+    struct HitMiss sequential;
+    struct HitMiss result;
+    struct MemoryTraffic sequential_traffic;
+    struct MemoryTraffic traffic;
+    uint64_t records = 20000000ull;
+    uint32_t max_workers = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t seed = 1;
+    uint32_t workers;
+    int64_t accesses;
+    uint64_t n;
+    double start;
+    double base_seconds;
+    double seconds;
+    int mismatch = 0;
+    int match;
+
+    if (argc > 1) {
+        records = strtoull(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        max_workers = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+    max_workers = parallel_workers(max_workers);
+
+    /* Random word reads and writes */
+    trace_init(&trace);
+    for (n = 0; n < records; n++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        if (trace_append(&trace, (seed & 0x80000000u) ? WRITE_ACCESS : READ_ACCESS,
+                         seed % RANDOM_RANGE & ~3u, 4) != 0) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    printf("CACHE: offset %d index %d ways %d\n", OFFSET, INDEX, WAYS);
+
+    /* Sequential reference */
+    init_cache();
+    start = host_time();
+    accesses = (int64_t)trace_replay(&trace);
+    base_seconds = host_time() - start;
+    sequential = *get_cache_result();
+    sequential_traffic = *get_cache_traffic();
+    printf("sequential  ");
+    print_throughput((uint64_t)accesses, base_seconds);
+
+    for (workers = 1; workers <= max_workers; workers++) {
+        init_cache();
+        start = host_time();
+        accesses = parallel_replay(&trace, workers, &result, &traffic);
+        seconds = host_time() - start;
+        if (accesses < 0) {
+            fprintf(stderr, "cannot start %u workers\n", workers);
+            trace_free(&trace);
+            return 1;
+        }
+        match = result.hits == sequential.hits && result.misses == sequential.misses
+                && result.write_hits == sequential.write_hits
+                && result.write_misses == sequential.write_misses
+                && memcmp(&traffic, &sequential_traffic, sizeof(traffic)) == 0;
+
+        printf("workers %2u  speedup %5.2f  %s  ", workers, base_seconds / seconds,
+               match ? "match " : "DIFFER");
+        print_throughput((uint64_t)accesses, seconds);
+
+        if (!match) {
+            mismatch = 1;
+        }
+    }
+
+    trace_free(&trace);
+
+    return mismatch;
+}
@@ -0,0 +1,188 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, replay benchmark
+ * --
+ * -- Usage       : bench_replay [accesses]
+ * --               Replays a synthetic trace (default 100M accesses)
+ * --               in chunks and reports the accesses per second,
+ * --               once through access_cache() and once through
+ * --               cache_access_batch() of a cache_create() instance.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace.h"
+
+/* Records generated and replayed at once */
+#define CHUNK_SIZE (1u << 20)
+
+/* Address range of the random pattern */
+#define RANDOM_RANGE (1u << 20)
+
+/* fill_kernel
+ *
+ * Fill a chunk with the a = b + c pattern of main.c. Every sweep over
+ * the arrays is moved to fresh addresses.
+ *
+ * @param       trace
+ * @param       sweep       Running sweep counter
+ *
+ * @return      void
+ */
+static void fill_kernel(struct Trace *trace, uint32_t *sweep)
+{
+    uint32_t base = 0;
+    uint16_t i = 0;
+    uint16_t j = 0;
+
+    trace->count = 0;
+    while (trace->count + 3 <= CHUNK_SIZE) {
+        if (i == 0 && j == 0) {
+            base = (*sweep)++ * 3 * ARRAY_ROWS * ARRAY_COLUMNS * ITEM_SIZE;
+        }
+        trace_append(trace, READ_ACCESS, base + get_item_address(ARRAY_INDEX_B, i, j), ITEM_SIZE);
+        trace_append(trace, READ_ACCESS, base + get_item_address(ARRAY_INDEX_C, i, j), ITEM_SIZE);
+        trace_append(trace, WRITE_ACCESS, base + get_item_address(ARRAY_INDEX_A, i, j), ITEM_SIZE);
+        if (++i == ARRAY_ROWS) {
+            i = 0;
+            if (++j == ARRAY_COLUMNS) {
+                j = 0;
+            }
+        }
+    }
+}
+
+/* fill_random
+ *
+ * Fill a chunk with uniformly distributed word accesses
+ *
+ * @param       trace
+ * @param       seed        Xorshift state
+ *
+ * @return      void
+ */
+static void fill_random(struct Trace *trace, uint32_t *seed)
+{
+    trace->count = 0;
+    while (trace->count < CHUNK_SIZE) {
+        *seed ^= *seed << 13;
+        *seed ^= *seed >> 17;
+        *seed ^= *seed << 5;
+        trace_append(trace, (*seed & 0x80000000u) ? WRITE_ACCESS : READ_ACCESS,
+                     *seed % RANDOM_RANGE & ~3u, 4);
+    }
+}
+
+/* run_pattern
+ *
+ * Replay a pattern chunk by chunk, only the replay is timed
+ *
+ * @param       name
+ * @param       total       Number of records
+ * @param       random      1 for the random pattern, 0 for the kernel
+ * @param       cache       Instance for cache_access_batch(), NULL for
+ *                          access_cache()
+ *
+ * @return      void
+ */
+static void run_pattern(const char *name, uint64_t total, int random, cache_t *cache)
+{
+    /* Local Variables */
+    struct Trace trace;
+    uint32_t *addresses = NULL;
+    uint8_t *accesses_of = NULL;
+    uint64_t done = 0;
+    uint64_t accesses = 0;
+    uint32_t state = 1;
+    double seconds = 0;
+
+    trace_init(&trace);
+    init_cache();
+    if (cache != NULL) {
+        cache_reset(cache);
+        addresses = malloc(CHUNK_SIZE * sizeof(*addresses));
+        accesses_of = malloc(CHUNK_SIZE * sizeof(*accesses_of));
+        if (addresses == NULL || accesses_of == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+
+    while (done < total) {
+        double start;
+        size_t i;
+
+        if (random) {
+            fill_random(&trace, &state);
+        } else {
+            fill_kernel(&trace, &state);
+        }
+        if (trace.count > total - done) {
+            trace.count = (size_t)(total - done);
+        }
+
+        /* The batch takes plain arrays, split before timing */
+        for (i = 0; cache != NULL && i < trace.count; i++) {
+            addresses[i] = trace.records[i].address;
+            accesses_of[i] = trace.records[i].access;
+        }
+
+        start = host_time();
+        if (cache != NULL) {
+            /* Neither pattern crosses a block */
+            cache_access_batch(cache, addresses, accesses_of, trace.records[0].size, trace.count,
+                               NULL);
+            accesses += trace.count;
+        } else {
+            accesses += trace_replay(&trace);
+        }
+        seconds += host_time() - start;
+
+        done += trace.count;
+    }
+
+    printf("%-8s %-6s ", name, cache != NULL ? "batch" : "single");
+    print_throughput(accesses, seconds);
+
+    free(addresses);
+    free(accesses_of);
+    trace_free(&trace);
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    uint64_t total = 100000000ull;
+    cache_t *cache;
+
+    if (argc > 1) {
+        total = strtoull(argv[1], NULL, 0);
+    }
+
+    init_cache();
+    cache = cache_create(&get_cache()->config);
+    if (cache == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("CACHE: offset %d index %d ways %d\n", OFFSET, INDEX, WAYS);
+    run_pattern("kernel", total, 0, NULL);
+    run_pattern("kernel", total, 0, cache);
+    run_pattern("random", total, 1, NULL);
+    run_pattern("random", total, 1, cache);
+
+    cache_destroy(cache);
+
+    return 0;
+}
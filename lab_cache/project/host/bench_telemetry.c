@@ -0,0 +1,175 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, telemetry benchmark
+ * --
+ * -- Usage       : bench_telemetry [accesses]
+ * --               Built with TELEMETRY. Runs random reads and writes
+ * --               (default 4M) through cache instances of 1 to 16
+ * --               ways with and without telemetry attached. Reports
+ * --               ns per access of both, the overhead, and checks
+ * --               that the cells add up to the hit and miss counters
+ * --               and the evictions to the misses after the warm-up.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "telemetry.h"
+
+/* Geometry of the benchmarked configs */
+#define BENCH_OFFSET    6
+#define BENCH_INDEX     8
+
+/* Windows of the telemetry */
+#define BENCH_WINDOWS   256
+
+/* Accesses per window, the run fills the windows several times over */
+#define BENCH_WINDOW    1024
+
+/* Runs per mode, the fastest counts */
+#define BENCH_RUNS      5
+
+/* run
+ *
+ * Time cache_access() over all accesses on an empty cache
+ *
+ * @param       cache
+ * @param       addresses
+ * @param       accesses
+ * @param       length      Accesses
+ *
+ * @return      ns per access
+ */
+static double run(cache_t *cache, const uint32_t *addresses, const uint8_t *accesses,
+                  size_t length)
+{
+    /* Local Variables */
+    double start;
+    size_t i;
+
+    cache_reset(cache);
+    start = host_time();
+    for (i = 0; i < length; i++) {
+        cache_access(cache, addresses[i], (access_t)accesses[i], 4);
+    }
+
+    return (host_time() - start) * 1e9 / length;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static const uint8_t ways[] = { 1, 2, 4, 8, 16 };
+    struct CacheConfig config;
+    uint32_t *addresses;
+    uint8_t *accesses;
+    size_t length = 4u << 20;
+    uint32_t seed = 1;
+    uint32_t k;
+    size_t i;
+    int status = 0;
+
+    if (argc > 1) {
+        length = (size_t)strtoull(argv[1], NULL, 0);
+    }
+    addresses = malloc(length * sizeof(*addresses));
+    accesses = malloc(length * sizeof(*accesses));
+    if (addresses == NULL || accesses == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    /* Twice the capacity of 16 ways, hits and evictions mixed */
+    for (i = 0; i < length; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        addresses[i] = seed % (32u << (BENCH_OFFSET + BENCH_INDEX)) & ~3u;
+        accesses[i] = (seed & 0x80000000u) ? WRITE_ACCESS : READ_ACCESS;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.offset = BENCH_OFFSET;
+    config.index = BENCH_INDEX;
+    config.replacement = REPLACEMENT_LRU;
+    config.write_policy = WRITE_POLICY_BACK;
+    config.write_miss = WRITE_MISS_ALLOCATE;
+    config.index_function = INDEX_FUNCTION_BITS;
+
+    printf("CONFIGS: offset %d index %d LRU write-back, %zu random accesses, "
+           "%d windows of %d accesses\n", BENCH_OFFSET, BENCH_INDEX, length, BENCH_WINDOWS,
+           BENCH_WINDOW);
+    printf("%-5s %10s %14s %10s %11s\n", "WAYS", "OFF ns", "TELEMETRY ns", "OVERHEAD",
+           "EVICTIONS");
+    for (k = 0; k < sizeof(ways) / sizeof(ways[0]); k++) {
+        struct Telemetry *telemetry;
+        cache_t *cache;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint32_t cells;
+        uint32_t r;
+        double off_ns = 0;
+        double on_ns = 0;
+
+        config.ways = ways[k];
+        cache = cache_create(&config);
+        if (cache == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        telemetry = telemetry_create(cache, BENCH_WINDOWS, BENCH_WINDOW);
+        if (telemetry == NULL) {
+            fprintf(stderr, "cannot attach telemetry, build with -DTELEMETRY=1\n");
+            cache_destroy(cache);
+            return 1;
+        }
+
+        /* Alternate the modes, so both see the same load of the machine */
+        for (r = 0; r < BENCH_RUNS; r++) {
+            double ns;
+
+            cache_attach_telemetry(cache, NULL, NULL, NULL, 0, 0);
+            ns = run(cache, addresses, accesses, length);
+            off_ns = r == 0 || ns < off_ns ? ns : off_ns;
+            cache_attach_telemetry(cache, telemetry, telemetry->cells, telemetry->occupancy,
+                                   BENCH_WINDOWS, BENCH_WINDOW);
+            ns = run(cache, addresses, accesses, length);
+            on_ns = r == 0 || ns < on_ns ? ns : on_ns;
+        }
+
+        /* Every miss fills, only the first fill of each line evicts nothing */
+        cells = telemetry_windows(telemetry) * telemetry->set_count;
+        for (i = 0; i < cells; i++) {
+            hits += telemetry->cells[i].hits;
+            misses += telemetry->cells[i].misses;
+            evictions += telemetry->cells[i].evictions;
+        }
+        if (hits + misses != length || hits != cache->hit_miss.hits ||
+            misses != cache->hit_miss.misses ||
+            evictions != misses - ((uint64_t)ways[k] << BENCH_INDEX)) {
+            fprintf(stderr, "%u ways: the cells do not add up\n", ways[k]);
+            status = 1;
+        }
+        printf("%-5u %10.2f %14.2f %9.1f%% %11llu\n", ways[k], off_ns, on_ns,
+               100.0 * (on_ns - off_ns) / off_ns, (unsigned long long)evictions);
+
+        telemetry_destroy(cache, telemetry);
+        cache_destroy(cache);
+    }
+
+    free(addresses);
+    free(accesses);
+
+    return status;
+}
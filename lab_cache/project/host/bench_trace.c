@@ -0,0 +1,174 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, trace format benchmark
+ * --
+ * -- Usage       : bench_trace [records] [directory]
+ * --               Writes the same synthetic trace (default 10M
+ * --               records) as text and as binary trace and compares
+ * --               file size and decode speed.
+ * --------------------------------------------------------------- */
+
+#include <sys/stat.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace_bin.h"
+
+/* next_record
+ *
+ * Synthetic access stream: the a = b + c kernel on word arrays,
+ * interleaved with a few random accesses
+ *
+ * @param       n           Record number
+ * @param       record
+ *
+ * @return      void
+ */
+static void next_record(uint64_t n, struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t element = (uint32_t)(n / 4);
+    uint32_t hash = (uint32_t)(n * 2654435761u);
+
+    switch (n % 4) {
+        case 0:
+            record->access = READ_ACCESS;
+            record->address = 0x10000000u + element * 4;
+            break;
+        case 1:
+            record->access = READ_ACCESS;
+            record->address = 0x20000000u + element * 4;
+            break;
+        case 2:
+            record->access = WRITE_ACCESS;
+            record->address = 0x30000000u + element * 4;
+            break;
+        default:
+            record->access = (hash & 1) ? WRITE_ACCESS : READ_ACCESS;
+            record->address = 0x40000000u + (hash >> 8) * 8;
+            break;
+    }
+    record->size = (n % 4 == 3) ? 8 : 4;
+}
+
+/* file_size
+ *
+ * Size of a file in bytes
+ *
+ * @param       path
+ *
+ * @return      size
+ */
+static double file_size(const char *path)
+{
+    /* Local Variables */
+    struct stat st;
+
+    return stat(path, &st) == 0 ? (double)st.st_size : 0;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    uint64_t records = 10000000ull;
+    const char *directory = "/tmp";
+    char text_path[256];
+    char binary_path[256];
+    struct TraceRecord record;
+    struct TraceBinWriter writer;
+    struct TraceBinReader reader;
+    struct TraceBinCursor cursor;
+    char line[128];
+    uint64_t checksum_text = 0;
+    uint64_t checksum_binary = 0;
+    uint64_t n;
+    uint32_t chunk;
+    int decoded = 0;
+    double start;
+    double text_seconds;
+    double binary_seconds;
+    double text_bytes;
+    double binary_bytes;
+    FILE *file;
+
+    if (argc > 1) {
+        records = strtoull(argv[1], NULL, 0);
+    }
+    if (argc > 2) {
+        directory = argv[2];
+    }
+    snprintf(text_path, sizeof(text_path), "%s/bench_trace.txt", directory);
+    snprintf(binary_path, sizeof(binary_path), "%s/bench_trace.ctt", directory);
+
+    /* Write both formats */
+    file = fopen(text_path, "w");
+    if (file == NULL || trace_bin_create(&writer, binary_path, 0) != 0) {
+        perror(directory);
+        return 1;
+    }
+    for (n = 0; n < records; n++) {
+        next_record(n, &record);
+        fprintf(file, "%c 0x%08x %u\n", record.access == WRITE_ACCESS ? 'W' : 'R',
+                record.address, record.size);
+        trace_bin_write(&writer, &record);
+    }
+    fclose(file);
+    if (trace_bin_finish(&writer) != 0) {
+        fprintf(stderr, "%s: write failed\n", binary_path);
+        return 1;
+    }
+
+    /* Decode text */
+    start = host_time();
+    file = fopen(text_path, "r");
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (trace_parse_line(line, &record) > 0) {
+            checksum_text += record.address + record.size + record.access;
+        }
+    }
+    fclose(file);
+    text_seconds = host_time() - start;
+
+    /* Decode binary */
+    start = host_time();
+    if (trace_bin_open(&reader, binary_path) != 0) {
+        return 1;
+    }
+    for (chunk = 0; chunk < reader.chunk_count && decoded >= 0; chunk++) {
+        trace_bin_cursor(&reader, chunk, &cursor);
+        while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+            checksum_binary += record.address + record.size + record.access;
+        }
+    }
+    trace_bin_close(&reader);
+    binary_seconds = host_time() - start;
+    if (decoded < 0) {
+        fprintf(stderr, "%s: corrupt chunk\n", binary_path);
+        return 1;
+    }
+
+    text_bytes = file_size(text_path);
+    binary_bytes = file_size(binary_path);
+
+    printf("RECORDS: %llu\n", (unsigned long long)records);
+    printf("text     %8.1f MB  %5.2f B/record  %7.1f MB/s  %6.1f M records/s\n",
+           text_bytes / 1e6, text_bytes / records, text_bytes / text_seconds / 1e6,
+           records / text_seconds / 1e6);
+    printf("binary   %8.1f MB  %5.2f B/record  %7.1f MB/s  %6.1f M records/s\n",
+           binary_bytes / 1e6, binary_bytes / records, binary_bytes / binary_seconds / 1e6,
+           records / binary_seconds / 1e6);
+    printf("records decoded %s\n", checksum_text == checksum_binary ? "match" : "DIFFER");
+
+    remove(text_path);
+    remove(binary_path);
+
+    return checksum_text == checksum_binary ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+
+/* User includes */
+#include "block_map.h"
+
+/* map_slot
+ *
+ * Home slot of a block
+ *
+ * @param       block
+ * @param       capacity    Power of two
+ *
+ * @return      slot
+ */
+static uint32_t map_slot(uint32_t block, uint32_t capacity)
+{
+    return (block * 0x9E3779B1u) & (capacity - 1);
+}
+
+/* map_grow
+ *
+ * Double the number of slots
+ *
+ * @param       map
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int map_grow(struct BlockMap *map)
+{
+    /* Local Variables */
+    uint32_t capacity = map->capacity * 2;
+    uint32_t *keys = malloc(capacity * sizeof(*keys));
+    uint32_t *values = calloc(capacity, sizeof(*values));
+    uint32_t i;
+
+    if (keys == NULL || values == NULL || capacity == 0) {
+        free(keys);
+        free(values);
+        return -1;
+    }
+
+    for (i = 0; i < map->capacity; i++) {
+        if (map->values[i] != 0) {
+            uint32_t slot = map_slot(map->keys[i], capacity);
+
+            while (values[slot] != 0) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            keys[slot] = map->keys[i];
+            values[slot] = map->values[i];
+        }
+    }
+
+    free(map->keys);
+    free(map->values);
+    map->keys = keys;
+    map->values = values;
+    map->capacity = capacity;
+
+    return 0;
+}
+
+/* block_map_init
+ *
+ * Initialize an empty map
+ *
+ * @param       map
+ * @param       capacity    Initial slots, power of two
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int block_map_init(struct BlockMap *map, uint32_t capacity)
+{
+    map->capacity = capacity < 16 ? 16 : capacity;
+    map->count = 0;
+    map->keys = malloc(map->capacity * sizeof(*map->keys));
+    map->values = calloc(map->capacity, sizeof(*map->values));
+    if (map->keys == NULL || map->values == NULL) {
+        block_map_free(map);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* block_map_free
+ *
+ * Release a map
+ *
+ * @param       map
+ *
+ * @return      void
+ */
+void block_map_free(struct BlockMap *map)
+{
+    free(map->keys);
+    free(map->values);
+    map->keys = NULL;
+    map->values = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
+
+/* block_map_find
+ *
+ * Find the value of a block. An absent block is inserted with value 0
+ * and the caller must store a non-zero value. The pointer is valid
+ * until the next call.
+ *
+ * @param       map
+ * @param       block
+ *
+ * @return      pointer to the value, NULL if out of memory
+ */
+uint32_t *block_map_find(struct BlockMap *map, uint32_t block)
+{
+    /* Local Variables */
+    uint32_t slot;
+
+    /* Keep the load below one half */
+    if (map->count * 2 >= map->capacity && map_grow(map) != 0) {
+        return NULL;
+    }
+
+    slot = map_slot(block, map->capacity);
+    while (map->values[slot] != 0) {
+        if (map->keys[slot] == block) {
+            return &map->values[slot];
+        }
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+
+    map->keys[slot] = block;
+    map->count++;
+
+    return &map->values[slot];
+}
+
+/* block_map_get
+ *
+ * Look up a block without inserting it
+ *
+ * @param       map
+ * @param       block
+ *
+ * @return      value, 0 if absent
+ */
+uint32_t block_map_get(const struct BlockMap *map, uint32_t block)
+{
+    /* Local Variables */
+    uint32_t slot = map_slot(block, map->capacity);
+
+    while (map->values[slot] != 0) {
+        if (map->keys[slot] == block) {
+            return map->values[slot];
+        }
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+
+    return 0;
+}
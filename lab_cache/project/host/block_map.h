@@ -0,0 +1,73 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#ifndef BLOCK_MAP_H_
+#define BLOCK_MAP_H_
+
+#include <stdint.h>
+
+/* BlockMap
+ *
+ * Open addressing hash map from a block number to a non-zero 32 bit
+ * value. A value of 0 marks an empty slot.
+ */
+struct BlockMap {
+    uint32_t *keys;
+    uint32_t *values;
+    uint32_t capacity;
+    uint32_t count;
+};
+
+/* block_map_init
+ *
+ * Initialize an empty map
+ *
+ * @param       map
+ * @param       capacity    Initial slots, power of two
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int block_map_init(struct BlockMap *map, uint32_t capacity);
+
+/* block_map_free
+ *
+ * Release a map
+ *
+ * @param       map
+ *
+ * @return      void
+ */
+void block_map_free(struct BlockMap *map);
+
+/* block_map_find
+ *
+ * Find the value of a block. An absent block is inserted with value 0
+ * and the caller must store a non-zero value. The pointer is valid
+ * until the next call.
+ *
+ * @param       map
+ * @param       block
+ *
+ * @return      pointer to the value, NULL if out of memory
+ */
+uint32_t *block_map_find(struct BlockMap *map, uint32_t block);
+
+/* block_map_get
+ *
+ * Look up a block without inserting it
+ *
+ * @param       map
+ * @param       block
+ *
+ * @return      value, 0 if absent
+ */
+uint32_t block_map_get(const struct BlockMap *map, uint32_t block);
+
+#endif
+/* BLOCK_MAP_H_ */
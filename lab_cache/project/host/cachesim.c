@@ -0,0 +1,405 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, headless host simulator
+ * --
+ * -- Usage       : cachesim [-c] [-j workers] [-R file] [-S file]
+ * --                        [-f format] [-U unit] [-P period]
+ * --                        [-W warmup] [-V] [-H file] [trace]
+ * --               The trace is a text or binary trace (see
+ * --               trace_bin.h). Without a trace the a = b + c kernel
+ * --               of main.c is simulated and counted per array, -j
+ * --               is off.
+ * --               -f  import a din, lackey or pin trace (see
+ * --                   trace_import.h)
+ * --               -c  classify misses (compulsory/capacity/conflict)
+ * --               -j  replay on set-sharded worker threads
+ * --               -R  restore the cache from a checkpoint before the
+ * --                   replay, e.g. to skip a warm-up phase
+ * --               -S  save the cache to a checkpoint after the replay
+ * --               -U, -P, -W  sampled simulation: measure windows of
+ * --                   unit records every period records after warmup
+ * --                   warmed records (see sample.h), any of them
+ * --                   turns it on, the others keep their defaults
+ * --               -V  also run the full simulation through the same
+ * --                   counting and compare it with the estimate
+ * --               -H  write the per set and window counts to a CSV
+ * --                   (*.csv) or binary file (see telemetry.h),
+ * --                   needs TELEMETRY
+ * --               With VICTIM_ENTRIES set, the victim cache results
+ * --               are printed too. It is shared by all sets, so -j
+ * --               is off.
+ * --               With TELEMETRY the hottest sets and the peak window
+ * --               are printed, -j is off.
+ * --               With a hashed INDEX_FUNCTION -j is off.
+ * --------------------------------------------------------------- */
+
+#include <math.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "parallel.h"
+#include "classify.h"
+#include "trace_import.h"
+#include "sample.h"
+#include "telemetry.h"
+#include "cache.h"
+#include "config.h"
+
+/* Sets listed by the telemetry summary */
+#define TELEMETRY_TOP 8
+
+/* Names of the replacement and write policies */
+static const char *replacement_names[] = { "LRU", "PLRU", "FIFO", "RANDOM", "SRRIP" };
+static const char *write_policy_names[] = { "write-back", "write-through" };
+static const char *write_miss_names[] = { "write-allocate", "no-write-allocate" };
+
+/* ImportTarget
+ *
+ * Context of import_visit()
+ */
+struct ImportTarget {
+    struct Trace *trace;
+    int failed;
+};
+
+/* import_visit
+ *
+ * Append an imported record to the trace
+ *
+ * @param       context     struct ImportTarget
+ * @param       record
+ *
+ * @return      void
+ */
+static void import_visit(void *context, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct ImportTarget *target = context;
+
+    if (!target->failed &&
+        trace_append(target->trace, (access_t)record->access, record->address, record->size) != 0) {
+        target->failed = 1;
+    }
+}
+
+/* usage
+ *
+ * Print the command line help
+ *
+ * @param       name        Program name
+ *
+ * @return      exit code
+ */
+static int usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-c] [-j workers] [-R file] [-S file] [-f din|lackey|pin] "
+            "[-U unit] [-P period] [-W warmup] [-V] [-H file] [trace]\n", name);
+
+    return 2;
+}
+
+/* run_sampled
+ *
+ * Sample the trace and, to validate, simulate all of it with the same
+ * counting, each from the same start state
+ *
+ * @param       config
+ * @param       trace       In-memory trace, used if reader is NULL
+ * @param       reader      Binary trace or NULL
+ * @param       restore     Checkpoint to start from or NULL
+ * @param       validate
+ *
+ * @return      0 on success, -1 on error
+ */
+static int run_sampled(const struct SampleConfig *config, const struct Trace *trace,
+                       const struct TraceBinReader *reader, const char *restore, int validate)
+{
+    /* Local Variables */
+    uint64_t records = reader != NULL ? reader->record_count : trace->count;
+    struct SampleConfig full = { records, records, 0 };
+    struct SampleResult estimate;
+    struct SampleResult reference;
+    double start;
+    double seconds;
+    double reference_seconds;
+    double error;
+
+    start = host_time();
+    if (reader != NULL ? sample_bin(config, get_cache(), reader, &estimate) != 0
+                       : (sample_trace(config, get_cache(), trace, &estimate), 0)) {
+        return -1;
+    }
+    seconds = host_time() - start;
+
+    printf("SAMPLING: unit %llu period %llu warmup %llu\n", (unsigned long long)config->unit,
+           (unsigned long long)config->period, (unsigned long long)config->warmup);
+    sample_print(&estimate, stdout);
+    print_traffic(&estimate.traffic);
+    print_throughput((uint64_t)estimate.est_accesses, seconds);
+    if (!validate || records == 0) {
+        return 0;
+    }
+
+    /* Reference: one window over the whole trace */
+    init_cache();
+    if (restore != NULL && checkpoint_load(restore, get_cache()) != 0) {
+        return -1;
+    }
+    start = host_time();
+    if (reader != NULL ? sample_bin(&full, get_cache(), reader, &reference) != 0
+                       : (sample_trace(&full, get_cache(), trace, &reference), 0)) {
+        return -1;
+    }
+    reference_seconds = host_time() - start;
+
+    error = estimate.miss_rate - reference.miss_rate;
+    printf("FULL: MISS RATE: %.4f %%  MISSES: %llu  ACCESSES: %llu  TIME: %.3f s\n",
+           100.0 * reference.miss_rate, (unsigned long long)reference.misses,
+           (unsigned long long)reference.accesses, reference_seconds);
+    printf("ERROR: %+.4f %% (%+.2f %% relative), %s the interval, speedup %.1fx\n", 100.0 * error,
+           reference.miss_rate > 0 ? 100.0 * error / reference.miss_rate : 0.0,
+           fabs(error) <= estimate.half_width ? "inside" : "outside",
+           seconds > 0 ? reference_seconds / seconds : 0.0);
+
+    return 0;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static struct Classifier classifier;
+    struct Trace trace;
+    struct TraceBinReader reader;
+    struct HitMiss result;
+    struct MemoryTraffic traffic;
+    struct SampleConfig sample = { SAMPLE_UNIT, SAMPLE_PERIOD, SAMPLE_WARMUP };
+    const char *path = NULL;
+    const char *restore = NULL;
+    const char *save = NULL;
+    const char *heatmap = NULL;
+    uint32_t workers = 0;
+    int format = -1;
+    int classify = 0;
+    int sampled = 0;
+    int validate = 0;
+    int binary;
+    int64_t accesses;
+    double start;
+    double seconds;
+    int option;
+
+    while ((option = getopt(argc, argv, "cj:R:S:f:U:P:W:VH:")) != -1) {
+        switch (option) {
+            case 'c':
+                classify = 1;
+                break;
+            case 'j':
+                workers = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'R':
+                restore = optarg;
+                break;
+            case 'S':
+                save = optarg;
+                break;
+            case 'f':
+                format = trace_format_parse(optarg);
+                if (format < 0) {
+                    return usage(argv[0]);
+                }
+                break;
+            case 'U':
+                sample.unit = strtoull(optarg, NULL, 0);
+                sampled = 1;
+                break;
+            case 'P':
+                sample.period = strtoull(optarg, NULL, 0);
+                sampled = 1;
+                break;
+            case 'W':
+                sample.warmup = strtoull(optarg, NULL, 0);
+                sampled = 1;
+                break;
+            case 'V':
+                validate = 1;
+                break;
+            case 'H':
+                heatmap = optarg;
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind++];
+    }
+    if (optind < argc || (format >= 0 && path == NULL)) {
+        return usage(argv[0]);
+    }
+
+    /* The shadow caches of the classifier are not part of a checkpoint */
+    if (classify && restore != NULL) {
+        return usage(argv[0]);
+    }
+
+    /* Sampling runs in trace order and leaves the cache partly warmed */
+    if (sampled && (classify || workers || save != NULL || !sample_config_valid(&sample))) {
+        return usage(argv[0]);
+    }
+    if (validate && !sampled) {
+        return usage(argv[0]);
+    }
+    if (heatmap != NULL && (!TELEMETRY || sampled)) {
+        fprintf(stderr, "-H needs a build with TELEMETRY and no sampling\n");
+        return usage(argv[0]);
+    }
+
+    /* The shadow cache runs in trace order, all sets share the victim
+     * cache and the telemetry windows, the workers own bit-slice sets,
+     * not the ones of a hashed index function, and only the sequential
+     * replay of the kernel counts per array */
+    if (classify || VICTIM_ENTRIES > 0 || TELEMETRY || INDEX_FUNCTION != INDEX_FUNCTION_BITS
+        || path == NULL) {
+        workers = 0;
+    }
+
+    printf("CACHE: offset %d index %d ways %d replacement %s %s %s\n",
+           OFFSET, INDEX, WAYS, replacement_names[REPLACEMENT],
+           write_policy_names[WRITE_POLICY], write_miss_names[WRITE_MISS]);
+    if (VICTIM_ENTRIES > 0) {
+        printf("VICTIM: %d entries\n", VICTIM_ENTRIES);
+    }
+    if (workers) {
+        printf("WORKERS: %u\n", parallel_workers(workers));
+    }
+
+    /* Load before timing, the replay does no I/O */
+    trace_init(&trace);
+    binary = format < 0 && path != NULL && trace_bin_is_binary(path);
+    if (format >= 0) {
+        struct ImportTarget target = { &trace, 0 };
+        struct TraceImport import;
+
+        if (trace_import(path, format, import_visit, &target, &import) < 0 || target.failed) {
+            fprintf(stderr, "%s\n", target.failed ? "out of memory" : "import failed");
+            trace_free(&trace);
+            return 1;
+        }
+        printf("TRACE: %s, %llu lines, %llu records, %llu skipped\n", trace_format_name(format),
+               (unsigned long long)import.lines, (unsigned long long)import.records,
+               (unsigned long long)import.skipped);
+    } else if (binary) {
+        /* Binary traces are decoded straight from the mapping */
+        if (trace_bin_open(&reader, path) != 0) {
+            return 1;
+        }
+    } else if ((path != NULL ? trace_load_text(path, &trace) : trace_kernel(&trace)) != 0) {
+        trace_free(&trace);
+        return 1;
+    }
+
+    /* Create the cache */
+    init_cache();
+    if (restore != NULL && checkpoint_load(restore, get_cache()) != 0) {
+        trace_free(&trace);
+        return 1;
+    }
+    if (classify && classify_init(&classifier) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    if (sampled) {
+        int status = run_sampled(&sample, &trace, binary ? &reader : NULL, restore, validate);
+
+        if (binary) {
+            trace_bin_close(&reader);
+        }
+        trace_free(&trace);
+
+        return status != 0;
+    }
+
+    start = host_time();
+    if (classify) {
+        accesses = binary ? classify_replay_bin(&classifier, &reader)
+                          : classify_replay(&classifier, &trace);
+    } else if (workers) {
+        accesses = binary ? parallel_replay_bin(&reader, workers, &result, &traffic)
+                          : parallel_replay(&trace, workers, &result, &traffic);
+    } else if (path == NULL) {
+        accesses = (int64_t)trace_replay_arrays(&trace);
+    } else {
+        accesses = binary ? trace_bin_replay(&reader) : (int64_t)trace_replay(&trace);
+    }
+    seconds = host_time() - start;
+    if (accesses < 0) {
+        if (classify && accesses == -1) {
+            fprintf(stderr, "classify: out of memory\n");
+        } else if (workers && accesses == -1) {
+            fprintf(stderr, "cannot start %u workers\n", workers);
+        } else {
+            fprintf(stderr, "%s: corrupt chunk\n", path);
+        }
+        if (classify) {
+            classify_free(&classifier);
+        }
+        if (binary) {
+            trace_bin_close(&reader);
+        }
+        trace_free(&trace);
+        return 1;
+    }
+
+    if (workers) {
+        /* The workers count from zero, on top of restored counters */
+        hit_miss_add(get_cache_result(), &result);
+        get_cache_traffic()->fill_bytes += traffic.fill_bytes;
+        get_cache_traffic()->write_through_bytes += traffic.write_through_bytes;
+        get_cache_traffic()->writeback_bytes += traffic.writeback_bytes;
+    }
+    result = *get_cache_result();
+    traffic = *get_cache_traffic();
+    if (save != NULL && checkpoint_save(save, get_cache()) != 0) {
+        trace_free(&trace);
+        return 1;
+    }
+
+    /* Dirty lines left at the end still cost a write-back */
+    cache_flush(get_cache(), &traffic);
+
+    /* Print simulation results */
+    print_results(&result);
+    if (get_victim_result() != NULL) {
+        print_victim_results(get_victim_result());
+    }
+    print_traffic(&traffic);
+    print_throughput((uint64_t)accesses, seconds);
+    if (get_cache()->telemetry != NULL) {
+        telemetry_print(get_cache()->telemetry, stdout, TELEMETRY_TOP);
+        if (heatmap != NULL && telemetry_save(get_cache()->telemetry, heatmap) != 0) {
+            trace_free(&trace);
+            return 1;
+        }
+    }
+    if (classify) {
+        classify_print(&classifier, stdout);
+        classify_free(&classifier);
+    }
+
+    if (binary) {
+        trace_bin_close(&reader);
+    }
+    trace_free(&trace);
+
+    return 0;
+}
@@ -0,0 +1,373 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* User includes */
+#include "classify.h"
+
+/* Initial number of seen blocks, power of two */
+#define CLASSIFY_INITIAL_BLOCKS (1u << 12)
+
+/* Names of the arrays in the report */
+static const char *array_names[ARRAY_COUNT + 1] = { "A", "B", "C", "other" };
+
+/* shadow_unlink
+ *
+ * Remove an entry from the shadow LRU list
+ *
+ * @param       classifier
+ * @param       e           Entry number
+ *
+ * @return      void
+ */
+static void shadow_unlink(struct Classifier *classifier, uint32_t e)
+{
+    /* Local Variables */
+    struct ShadowEntry *entries = classifier->entries;
+
+    if (entries[e].prev) {
+        entries[entries[e].prev].next = entries[e].next;
+    } else {
+        classifier->head = entries[e].next;
+    }
+    if (entries[e].next) {
+        entries[entries[e].next].prev = entries[e].prev;
+    } else {
+        classifier->tail = entries[e].prev;
+    }
+}
+
+/* shadow_push
+ *
+ * Insert an entry as most recently used
+ *
+ * @param       classifier
+ * @param       e           Entry number
+ *
+ * @return      void
+ */
+static void shadow_push(struct Classifier *classifier, uint32_t e)
+{
+    /* Local Variables */
+    struct ShadowEntry *entries = classifier->entries;
+
+    entries[e].prev = 0;
+    entries[e].next = classifier->head;
+    if (classifier->head) {
+        entries[classifier->head].prev = e;
+    } else {
+        classifier->tail = e;
+    }
+    classifier->head = e;
+}
+
+/* block_array
+ *
+ * Get the array all bytes of a block belong to
+ *
+ * @param       address     Any address inside the block
+ *
+ * @return      array index, CLASSIFY_ARRAY_MIXED if the block holds
+ *              items of several arrays
+ */
+static uint8_t block_array(uint32_t address)
+{
+    /* Local Variables */
+    const struct ArrayLayout *layout = get_array_layout();
+    uint32_t first = address >> OFFSET << OFFSET;
+    array_index_t array = get_array_index(first);
+
+    /* Interleaved items change the array inside a block, the other
+     * layouts only at the end of an array */
+    if (layout->type == ARRAY_LAYOUT_INTERLEAVED && first < layout_size(layout)) {
+        return CLASSIFY_ARRAY_MIXED;
+    }
+
+    return get_array_index(first + (1u << OFFSET) - 1) == array ? array : CLASSIFY_ARRAY_MIXED;
+}
+
+/* classify_init
+ *
+ * Initialize a classifier. The cache itself is initialized with
+ * init_cache().
+ *
+ * @param       classifier
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int classify_init(struct Classifier *classifier)
+{
+    memset(classifier, 0, sizeof(*classifier));
+
+    /* Entry 0 is the list end */
+    classifier->entry_count = 1;
+    classifier->entry_capacity = CLASSIFY_INITIAL_BLOCKS;
+    classifier->entries = malloc(classifier->entry_capacity * sizeof(*classifier->entries));
+    if (classifier->entries == NULL
+        || block_map_init(&classifier->map, 2 * CLASSIFY_INITIAL_BLOCKS) != 0) {
+        classify_free(classifier);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* classify_free
+ *
+ * Release a classifier
+ *
+ * @param       classifier
+ *
+ * @return      void
+ */
+void classify_free(struct Classifier *classifier)
+{
+    free(classifier->entries);
+    block_map_free(&classifier->map);
+    classifier->entries = NULL;
+}
+
+/* classify_access
+ *
+ * Run one block access through the cache of config.h and the shadow
+ * cache and classify it
+ *
+ * @param       classifier
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes inside the block
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int classify_access(struct Classifier *classifier, uint32_t address, access_t access,
+                    uint8_t size)
+{
+    /* Local Variables */
+    uint32_t *entry = block_map_find(&classifier->map, address >> OFFSET);
+    struct ShadowEntry *shadow;
+    struct MissClass *array;
+    struct MissClass *set;
+    uint8_t seen = 1;
+    uint8_t shadow_hit = 0;
+    result_t result;
+    uint32_t e;
+
+    if (entry == NULL) {
+        return -1;
+    }
+
+    if (*entry == 0) {
+        /* First access to the block */
+        if (classifier->entry_count == classifier->entry_capacity) {
+            uint32_t capacity = classifier->entry_capacity * 2;
+            struct ShadowEntry *entries = realloc(classifier->entries, capacity * sizeof(*entries));
+
+            if (entries == NULL) {
+                return -1;
+            }
+            classifier->entries = entries;
+            classifier->entry_capacity = capacity;
+        }
+        *entry = classifier->entry_count++;
+        classifier->entries[*entry].resident = 0;
+        classifier->entries[*entry].set = cache_set(get_cache(), address);
+        classifier->entries[*entry].array = block_array(address);
+        seen = 0;
+    }
+    e = *entry;
+    shadow = &classifier->entries[e];
+    array = &classifier->array[shadow->array != CLASSIFY_ARRAY_MIXED ? shadow->array
+                                                                      : get_array_index(address)];
+    set = &classifier->set[shadow->set];
+    result = access_cache_sized(address, access, size);
+
+    /* Shadow cache: fully associative LRU of the same capacity, it
+     * allocates on the same misses as the cache */
+    if (classifier->entries[e].resident) {
+        shadow_hit = 1;
+        shadow_unlink(classifier, e);
+        shadow_push(classifier, e);
+    } else if (access != WRITE_ACCESS
+               || get_cache()->config.write_miss != WRITE_MISS_NO_ALLOCATE) {
+        if (classifier->resident == LINE_COUNT) {
+            uint32_t victim = classifier->tail;
+
+            shadow_unlink(classifier, victim);
+            classifier->entries[victim].resident = 0;
+            classifier->resident--;
+        }
+        classifier->entries[e].resident = 1;
+        classifier->resident++;
+        shadow_push(classifier, e);
+    }
+
+    if (result == RESULT_HIT) {
+        classifier->total.hits++;
+        array->hits++;
+        set->hits++;
+    } else if (!seen) {
+        classifier->total.compulsory++;
+        array->compulsory++;
+        set->compulsory++;
+    } else if (!shadow_hit) {
+        classifier->total.capacity++;
+        array->capacity++;
+        set->capacity++;
+    } else {
+        classifier->total.conflict++;
+        array->conflict++;
+        set->conflict++;
+    }
+
+    return 0;
+}
+
+/* classify_record
+ *
+ * Classify every block access of a record
+ *
+ * @param       classifier
+ * @param       record
+ *
+ * @return      number of cache accesses, -1 if out of memory
+ */
+int classify_record(struct Classifier *classifier, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t block = record->address >> OFFSET;
+    uint32_t last = (record->address + record->size - 1) >> OFFSET;
+    int accesses = 1;
+
+    if (classify_access(classifier, record->address, (access_t)record->access,
+                        trace_block_bytes(record, record->address, OFFSET)) != 0) {
+        return -1;
+    }
+
+    /* Remaining blocks of an access crossing a block boundary */
+    while (block != last) {
+        block++;
+        if (classify_access(classifier, block << OFFSET, (access_t)record->access,
+                            trace_block_bytes(record, block << OFFSET, OFFSET)) != 0) {
+            return -1;
+        }
+        accesses++;
+    }
+
+    return accesses;
+}
+
+/* classify_replay
+ *
+ * Classify all records of an in-memory trace
+ *
+ * @param       classifier
+ * @param       trace
+ *
+ * @return      number of cache accesses, -1 if out of memory
+ */
+int64_t classify_replay(struct Classifier *classifier, const struct Trace *trace)
+{
+    /* Local Variables */
+    int64_t accesses = 0;
+    int counted;
+    size_t i;
+
+    for (i = 0; i < trace->count; i++) {
+        counted = classify_record(classifier, &trace->records[i]);
+        if (counted < 0) {
+            return -1;
+        }
+        accesses += counted;
+    }
+
+    return accesses;
+}
+
+/* classify_replay_bin
+ *
+ * Classify all records of a binary trace
+ *
+ * @param       classifier
+ * @param       reader
+ *
+ * @return      number of cache accesses, -1 if out of memory, -2 if a chunk
+ *              is corrupt
+ */
+int64_t classify_replay_bin(struct Classifier *classifier, const struct TraceBinReader *reader)
+{
+    /* Local Variables */
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    int64_t accesses = 0;
+    int counted;
+    uint32_t chunk;
+    int decoded = 0;
+
+    for (chunk = 0; chunk < reader->chunk_count && decoded >= 0; chunk++) {
+        trace_bin_cursor(reader, chunk, &cursor);
+        while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+            counted = classify_record(classifier, &record);
+            if (counted < 0) {
+                return -1;
+            }
+            accesses += counted;
+        }
+    }
+
+    return decoded < 0 ? -2 : accesses;
+}
+
+/* print_class
+ *
+ * Print one line of the report
+ *
+ * @param       file
+ * @param       name
+ * @param       counts
+ *
+ * @return      void
+ */
+static void print_class(FILE *file, const char *name, const struct MissClass *counts)
+{
+    fprintf(file, "%-12s %12llu %12llu %12llu %12llu\n", name,
+            (unsigned long long)counts->hits, (unsigned long long)counts->compulsory,
+            (unsigned long long)counts->capacity, (unsigned long long)counts->conflict);
+}
+
+/* classify_print
+ *
+ * Print the totals, the breakdown per array and per used set
+ *
+ * @param       classifier
+ * @param       file
+ *
+ * @return      void
+ */
+void classify_print(const struct Classifier *classifier, FILE *file)
+{
+    /* Local Variables */
+    char name[16];
+    uint32_t i;
+
+    fprintf(file, "%-12s %12s %12s %12s %12s\n", "", "HITS", "COMPULSORY", "CAPACITY", "CONFLICT");
+    print_class(file, "total", &classifier->total);
+
+    for (i = 0; i <= ARRAY_COUNT; i++) {
+        snprintf(name, sizeof(name), "array %s", array_names[i]);
+        print_class(file, name, &classifier->array[i]);
+    }
+
+    for (i = 0; i < SET_COUNT; i++) {
+        const struct MissClass *set = &classifier->set[i];
+
+        if (set->hits + set->compulsory + set->capacity + set->conflict != 0) {
+            snprintf(name, sizeof(name), "set %u", i);
+            print_class(file, name, set);
+        }
+    }
+}
@@ -0,0 +1,160 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* 3C miss classification
+ *
+ * Every access also runs through a fully associative LRU shadow cache
+ * with LINE_COUNT lines. A miss is
+ *
+ *   compulsory   on the first access to the block
+ *   capacity     if the shadow cache misses as well
+ *   conflict     if the shadow cache hits
+ *
+ * Like the cache, the shadow cache does not allocate on a write miss
+ * without write-allocate.
+ *
+ * One hash map entry per block serves as seen set and as shadow cache
+ * lookup, the shadow LRU order is a doubly linked list, so the shadow
+ * costs O(1) per access.
+ */
+
+#ifndef CLASSIFY_H_
+#define CLASSIFY_H_
+
+/* User includes */
+#include "trace_bin.h"
+#include "block_map.h"
+
+/* MissClass
+ *
+ * Hits and classified misses
+ */
+struct MissClass {
+    uint64_t hits;
+    uint64_t compulsory;
+    uint64_t capacity;
+    uint64_t conflict;
+};
+
+/* Array of a block holding items of several arrays, looked up per access */
+#define CLASSIFY_ARRAY_MIXED (ARRAY_COUNT + 1)
+
+/* ShadowEntry
+ *
+ * Seen block, linked into the shadow LRU list while resident. Its set
+ * and array are looked up once, when the block is first seen.
+ */
+struct ShadowEntry {
+    uint32_t prev;
+    uint32_t next;
+    uint32_t set;               /* Set in the cache of config.h */
+    uint8_t resident;
+    uint8_t array;              /* array_index_t or CLASSIFY_ARRAY_MIXED */
+};
+
+/* Classifier
+ *
+ * Shadow cache and the counters per array and per set
+ */
+struct Classifier {
+    struct BlockMap map;
+    struct ShadowEntry *entries;
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t resident;
+    struct MissClass total;
+    struct MissClass array[ARRAY_COUNT + 1];
+    struct MissClass set[SET_COUNT];
+};
+
+/* classify_init
+ *
+ * Initialize a classifier. The cache itself is initialized with
+ * init_cache().
+ *
+ * @param       classifier
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int classify_init(struct Classifier *classifier);
+
+/* classify_free
+ *
+ * Release a classifier
+ *
+ * @param       classifier
+ *
+ * @return      void
+ */
+void classify_free(struct Classifier *classifier);
+
+/* classify_access
+ *
+ * Run one block access through the cache of config.h and the shadow
+ * cache and classify it
+ *
+ * @param       classifier
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes inside the block
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int classify_access(struct Classifier *classifier, uint32_t address, access_t access,
+                    uint8_t size);
+
+/* classify_record
+ *
+ * Classify every block access of a record
+ *
+ * @param       classifier
+ * @param       record
+ *
+ * @return      number of cache accesses, -1 if out of memory
+ */
+int classify_record(struct Classifier *classifier, const struct TraceRecord *record);
+
+/* classify_replay
+ *
+ * Classify all records of an in-memory trace
+ *
+ * @param       classifier
+ * @param       trace
+ *
+ * @return      number of cache accesses, -1 if out of memory
+ */
+int64_t classify_replay(struct Classifier *classifier, const struct Trace *trace);
+
+/* classify_replay_bin
+ *
+ * Classify all records of a binary trace
+ *
+ * @param       classifier
+ * @param       reader
+ *
+ * @return      number of cache accesses, -1 if out of memory, -2 if a chunk
+ *              is corrupt
+ */
+int64_t classify_replay_bin(struct Classifier *classifier, const struct TraceBinReader *reader);
+
+/* classify_print
+ *
+ * Print the totals, the breakdown per array and per used set
+ *
+ * @param       classifier
+ * @param       file
+ *
+ * @return      void
+ */
+void classify_print(const struct Classifier *classifier, FILE *file);
+
+#endif
+/* CLASSIFY_H_ */
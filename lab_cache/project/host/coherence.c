@@ -0,0 +1,472 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "coherence.h"
+#include "config.h"
+
+/* Marks a block in the lost map, whose values must not be 0 */
+#define LOST_PRESENT (1u << 31)
+
+/* Initial slots of the block maps */
+#define COHERENCE_MAP_SLOTS 4096
+
+/* coherence_init
+ *
+ * Initialize a simulator with empty caches
+ *
+ * @param       coherence
+ * @param       config
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int coherence_init(struct Coherence *coherence, const struct CoherenceConfig *config)
+{
+    /* Local Variables */
+    struct CacheConfig cache = config->cache;
+    uint32_t c;
+
+    memset(coherence, 0, sizeof(*coherence));
+    cache.write_policy = WRITE_POLICY_BACK;
+    cache.write_miss = WRITE_MISS_ALLOCATE;
+    if (config->cores < 1 || config->cores > COHERENCE_MAX_CORES ||
+        config->protocol > PROTOCOL_MOESI || config->interconnect > INTERCONNECT_DIRECTORY ||
+        !cache_config_valid(&cache)) {
+        return -1;
+    }
+    coherence->config = *config;
+    coherence->config.cache = cache;
+    coherence->mask_shift = cache.offset > 6 ? cache.offset - 6u : 0;
+
+    for (c = 0; c < config->cores; c++) {
+        struct CoherenceCore *core = &coherence->core[c];
+
+        core->cache = cache_create(&cache);
+        if (core->cache == NULL) {
+            coherence_free(coherence);
+            return -1;
+        }
+        core->state = calloc((size_t)core->cache->set_count * cache.ways, sizeof(*core->state));
+        if (core->state == NULL) {
+            coherence_free(coherence);
+            return -1;
+        }
+    }
+    if (block_map_init(&coherence->lost, COHERENCE_MAP_SLOTS) != 0 ||
+        block_map_init(&coherence->shared, COHERENCE_MAP_SLOTS) != 0) {
+        coherence_free(coherence);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* coherence_free
+ *
+ * Release a simulator
+ *
+ * @param       coherence
+ *
+ * @return      void
+ */
+void coherence_free(struct Coherence *coherence)
+{
+    /* Local Variables */
+    uint32_t c;
+
+    for (c = 0; c < COHERENCE_MAX_CORES; c++) {
+        cache_destroy(coherence->core[c].cache);
+        free(coherence->core[c].state);
+    }
+    block_map_free(&coherence->lost);
+    block_map_free(&coherence->shared);
+    free(coherence->lines);
+    free(coherence->masks);
+    memset(coherence, 0, sizeof(*coherence));
+}
+
+/* line_state
+ *
+ * Find the state of a block in the cache of a core
+ *
+ * @param       core
+ * @param       address
+ *
+ * @return      state of its line, NULL if absent
+ */
+static uint8_t *line_state(struct CoherenceCore *core, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t line = cache_line(core->cache, address);
+
+    return line != CACHE_LINE_NONE ? &core->state[line] : NULL;
+}
+
+/* record_write
+ *
+ * Add the bytes a core writes to the sharing record of their line
+ *
+ * @param       coherence
+ * @param       core
+ * @param       address
+ * @param       size
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int record_write(struct Coherence *coherence, uint32_t core, uint32_t address, uint8_t size)
+{
+    /* Local Variables */
+    const uint32_t cores = coherence->config.cores;
+    const uint32_t offset = coherence->config.cache.offset;
+    uint32_t block = address >> offset;
+    uint32_t first = (address & ((1u << offset) - 1)) >> coherence->mask_shift;
+    uint32_t last = ((address & ((1u << offset) - 1)) + (size ? size : 1) - 1) >> coherence->mask_shift;
+    uint64_t bits;
+    uint32_t *slot;
+    struct SharedLine *line;
+    uint64_t *masks;
+
+    slot = block_map_find(&coherence->shared, block);
+    if (slot == NULL) {
+        return -1;
+    }
+    if (*slot == 0) {
+        if (coherence->line_count == coherence->line_capacity) {
+            uint32_t capacity = coherence->line_capacity ? 2 * coherence->line_capacity : 1024;
+            struct SharedLine *lines = realloc(coherence->lines, capacity * sizeof(*lines));
+            uint64_t *grown;
+
+            if (lines == NULL) {
+                return -1;
+            }
+            coherence->lines = lines;
+            grown = realloc(coherence->masks, (size_t)capacity * cores * sizeof(*grown));
+            if (grown == NULL) {
+                return -1;
+            }
+            coherence->masks = grown;
+            coherence->line_capacity = capacity;
+        }
+        line = &coherence->lines[coherence->line_count];
+        memset(line, 0, sizeof(*line));
+        line->block = block;
+        memset(&coherence->masks[(size_t)coherence->line_count * cores], 0,
+               cores * sizeof(*coherence->masks));
+        *slot = ++coherence->line_count;
+    }
+    line = &coherence->lines[*slot - 1];
+    masks = &coherence->masks[(size_t)(*slot - 1) * cores];
+
+    /* One bit per byte, per 2^mask_shift bytes for lines over 64 bytes */
+    bits = last - first == 63 ? ~0ull : ((1ull << (last - first + 1)) - 1) << first;
+    if (bits & line->written & ~masks[core]) {
+        line->overlap = 1;
+    }
+    masks[core] |= bits;
+    line->written |= bits;
+    line->writers |= 1u << core;
+
+    return 0;
+}
+
+/* invalidate_others
+ *
+ * Drop the copies of a block in all caches but the one of a core
+ *
+ * @param       coherence
+ * @param       core
+ * @param       address
+ * @param       owner       Set to 1 if a copy was E, M or O
+ * @param       dirty       Set to 1 if a copy was M or O
+ *
+ * @return      number of copies dropped, -1 if out of memory
+ */
+static int invalidate_others(struct Coherence *coherence, uint32_t core, uint32_t address,
+                             uint8_t *owner, uint8_t *dirty)
+{
+    /* Local Variables */
+    uint32_t block = address >> coherence->config.cache.offset;
+    uint32_t mask = 0;
+    uint32_t *lost;
+    uint32_t shared;
+    uint32_t c;
+    int copies = 0;
+
+    for (c = 0; c < coherence->config.cores; c++) {
+        struct CoherenceCore *other = &coherence->core[c];
+        uint8_t *state;
+
+        if (c == core || (state = line_state(other, address)) == NULL || *state == STATE_INVALID) {
+            continue;
+        }
+        *owner |= *state >= STATE_EXCLUSIVE;
+        *dirty |= *state >= STATE_OWNED;
+        *state = STATE_INVALID;
+        cache_invalidate(other->cache, address);
+        other->invalidated++;
+        mask |= 1u << c;
+        copies++;
+    }
+    if (copies == 0) {
+        return 0;
+    }
+
+    lost = block_map_find(&coherence->lost, block);
+    if (lost == NULL) {
+        return -1;
+    }
+    *lost |= LOST_PRESENT | mask;
+    shared = block_map_get(&coherence->shared, block);
+    if (shared != 0) {
+        coherence->lines[shared - 1].invalidations += copies;
+    }
+    coherence->traffic.invalidations += copies;
+
+    return copies;
+}
+
+/* snoop_read
+ *
+ * Let the other caches see a read miss of a core. E copies become S; an
+ * M copy is written back and becomes S under MESI, becomes O under MOESI.
+ *
+ * @param       coherence
+ * @param       core
+ * @param       address
+ * @param       owner       Set to 1 if a copy was E, M or O
+ * @param       dirty       Set to 1 if a copy was M or O
+ *
+ * @return      number of other copies
+ */
+static int snoop_read(struct Coherence *coherence, uint32_t core, uint32_t address, uint8_t *owner,
+                      uint8_t *dirty)
+{
+    /* Local Variables */
+    uint32_t c;
+    int copies = 0;
+
+    for (c = 0; c < coherence->config.cores; c++) {
+        uint8_t *state;
+
+        if (c == core || (state = line_state(&coherence->core[c], address)) == NULL ||
+            *state == STATE_INVALID) {
+            continue;
+        }
+        *owner |= *state >= STATE_EXCLUSIVE;
+        *dirty |= *state >= STATE_OWNED;
+        copies++;
+
+        switch (*state) {
+        case STATE_EXCLUSIVE:
+            *state = STATE_SHARED;
+            break;
+        case STATE_MODIFIED:
+            if (coherence->config.protocol == PROTOCOL_MOESI) {
+                *state = STATE_OWNED;
+            } else {
+                /* Sharing write-back, a message to the home directory */
+                *state = STATE_SHARED;
+                coherence->traffic.memory_writes++;
+                coherence->traffic.messages += coherence->config.interconnect ==
+                                               INTERCONNECT_DIRECTORY;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return copies;
+}
+
+/* fill_line
+ *
+ * Place a block into the cache of a core, writing back a dirty victim
+ *
+ * @param       coherence
+ * @param       core
+ * @param       address
+ * @param       state       State of the new line
+ *
+ * @return      void
+ */
+static void fill_line(struct Coherence *coherence, struct CoherenceCore *core, uint32_t address,
+                      uint8_t state)
+{
+    /* Local Variables */
+    struct CoherenceTraffic *traffic = &coherence->traffic;
+    uint8_t directory = coherence->config.interconnect == INTERCONNECT_DIRECTORY;
+    uint32_t victim;
+    uint8_t replaced = cache_fill(core->cache, address, &victim, NULL);
+    uint8_t *line = line_state(core, address);
+
+    /* The new block took the line of the victim, so its state is the
+     * one of the victim */
+    if (replaced && *line >= STATE_OWNED) {
+        core->writebacks++;
+        traffic->bus_writebacks++;
+        traffic->memory_writes++;
+        traffic->messages += directory;
+    } else if (replaced) {
+        /* Replacement hint, a bus drops clean lines silently */
+        traffic->messages += directory;
+    }
+    *line = state;
+}
+
+/* coherence_access
+ *
+ * Run one access of a core within one line
+ *
+ * @param       coherence
+ * @param       core
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes, must not cross the line
+ *
+ * @return      RESULT_HIT or RESULT_MISS, -1 if out of memory
+ */
+int coherence_access(struct Coherence *coherence, uint32_t core, uint32_t address, access_t access,
+                     uint8_t size)
+{
+    /* Local Variables */
+    struct CoherenceCore *self = &coherence->core[core];
+    struct CoherenceTraffic *traffic = &coherence->traffic;
+    uint32_t block = address >> coherence->config.cache.offset;
+    uint8_t directory = coherence->config.interconnect == INTERCONNECT_DIRECTORY;
+    uint32_t snooped = coherence->config.cores - 1;
+    uint8_t *state = line_state(self, address);
+    uint8_t owner = 0;
+    uint8_t dirty = 0;
+    uint32_t lost;
+    int copies;
+
+    if (access == WRITE_ACCESS) {
+        self->writes++;
+        if (record_write(coherence, core, address, size) != 0) {
+            return -1;
+        }
+    } else {
+        self->reads++;
+    }
+
+    if (state != NULL && *state != STATE_INVALID) {
+        self->hits++;
+        cache_lookup(self->cache, address);
+        if (access != WRITE_ACCESS || *state == STATE_MODIFIED || *state == STATE_EXCLUSIVE) {
+            *state = access == WRITE_ACCESS ? STATE_MODIFIED : *state;
+            return RESULT_HIT;
+        }
+
+        /* Write on S or O: invalidate the other copies, no data moves */
+        self->upgrades++;
+        copies = invalidate_others(coherence, core, address, &owner, &dirty);
+        if (copies < 0) {
+            return -1;
+        }
+        if (directory) {
+            traffic->messages += 2 + 2 * (uint32_t)copies;
+        } else {
+            traffic->bus_upgrades++;
+            traffic->snoops += snooped;
+        }
+        *state = STATE_MODIFIED;
+        return RESULT_HIT;
+    }
+
+    self->misses++;
+    lost = block_map_get(&coherence->lost, block);
+    if (lost & (1u << core)) {
+        uint32_t shared = block_map_get(&coherence->shared, block);
+
+        self->coherence_misses++;
+        if (shared != 0) {
+            coherence->lines[shared - 1].coherence_misses++;
+        }
+        *block_map_find(&coherence->lost, block) = lost & ~(1u << core);
+    }
+
+    if (access == WRITE_ACCESS) {
+        copies = invalidate_others(coherence, core, address, &owner, &dirty);
+        if (copies < 0) {
+            return -1;
+        }
+        if (directory) {
+            traffic->messages += 2 + 2 * (uint32_t)copies + owner;
+        } else {
+            traffic->bus_read_exclusive++;
+            traffic->snoops += snooped;
+        }
+        fill_line(coherence, self, address, STATE_MODIFIED);
+    } else {
+        copies = snoop_read(coherence, core, address, &owner, &dirty);
+        if (directory) {
+            traffic->messages += 2 + owner;
+        } else {
+            traffic->bus_reads++;
+            traffic->snoops += snooped;
+        }
+        fill_line(coherence, self, address, copies ? STATE_SHARED : STATE_EXCLUSIVE);
+    }
+    if (dirty) {
+        traffic->cache_to_cache++;
+    } else {
+        traffic->memory_reads++;
+    }
+
+    return RESULT_MISS;
+}
+
+/* coherence_flush
+ *
+ * Write back the dirty lines of every core. The lines stay valid and
+ * clean.
+ *
+ * @param       coherence
+ *
+ * @return      void
+ */
+void coherence_flush(struct Coherence *coherence)
+{
+    /* Local Variables */
+    uint32_t c;
+    size_t line;
+
+    for (c = 0; c < coherence->config.cores; c++) {
+        struct CoherenceCore *core = &coherence->core[c];
+        size_t lines = (size_t)core->cache->set_count * coherence->config.cache.ways;
+
+        for (line = 0; line < lines; line++) {
+            if (core->state[line] < STATE_OWNED) {
+                continue;
+            }
+            core->state[line] = core->state[line] == STATE_OWNED ? STATE_SHARED : STATE_EXCLUSIVE;
+            coherence->traffic.bus_writebacks++;
+            coherence->traffic.memory_writes++;
+            coherence->traffic.messages += coherence->config.interconnect ==
+                                           INTERCONNECT_DIRECTORY;
+        }
+    }
+}
+
+/* coherence_false_sharing
+ *
+ * Check whether a written line is falsely shared
+ *
+ * @param       line
+ *
+ * @return      1 if written by several cores at disjoint offsets
+ */
+int coherence_false_sharing(const struct SharedLine *line)
+{
+    return (line->writers & (line->writers - 1)) != 0 && !line->overlap;
+}
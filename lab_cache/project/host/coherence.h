@@ -0,0 +1,193 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Multi-core coherence
+ *
+ * N cores with a private write-back cache each, built from the cache
+ * model plus a MESI or MOESI state per line, kept coherent by write
+ * invalidation. The states and transitions are the same on both
+ * interconnects, they differ in what is counted:
+ *
+ *   bus        BusRd, BusRdX, BusUpgr and write-back transactions, each
+ *              request is snooped by the N - 1 other caches
+ *   directory  Point to point messages: request and reply, an
+ *              invalidation and an ack per other copy, a forward to the
+ *              owner of an E, M or O line, write-backs and replacement
+ *              hints, so the sharer vector stays exact
+ *
+ * A dirty owner (M, or O under MOESI) supplies the data cache to cache.
+ * Under MESI a read of an M line also writes it back and both end in S,
+ * under MOESI the owner moves to O and memory stays stale.
+ *
+ * A miss on a block the core lost to an invalidation is a coherence
+ * miss. Every written line records which bytes each core wrote; a line
+ * written by several cores at disjoint offsets is falsely shared, any
+ * byte written by two cores makes it truly shared.
+ */
+
+#ifndef COHERENCE_H_
+#define COHERENCE_H_
+
+/* User includes */
+#include "cache.h"
+#include "block_map.h"
+
+/* Most cores, one bit each in a sharer or writer mask */
+#define COHERENCE_MAX_CORES 16
+
+/* Protocols */
+#define PROTOCOL_MESI       0
+#define PROTOCOL_MOESI      1
+
+/* Interconnects */
+#define INTERCONNECT_BUS        0
+#define INTERCONNECT_DIRECTORY  1
+
+/* States of a line */
+#define STATE_INVALID       0
+#define STATE_SHARED        1
+#define STATE_EXCLUSIVE     2
+#define STATE_OWNED         3
+#define STATE_MODIFIED      4
+
+/* CoherenceConfig
+ *
+ * Cores, protocol, interconnect and the geometry of every private cache
+ */
+struct CoherenceConfig {
+    uint32_t cores;
+    uint8_t protocol;
+    uint8_t interconnect;
+    struct CacheConfig cache;           /* Write policy and write miss are forced */
+};
+
+/* CoherenceCore
+ *
+ * One core with its private cache and counters
+ */
+struct CoherenceCore {
+    cache_t *cache;
+    uint8_t *state;                     /* Per line of the cache */
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t coherence_misses;          /* Misses on blocks lost to an invalidation */
+    uint64_t upgrades;                  /* Write hits on S or O lines */
+    uint64_t invalidated;               /* Copies dropped for another core */
+    uint64_t writebacks;                /* Dirty lines replaced */
+};
+
+/* SharedLine
+ *
+ * Sharing record of a written line, its written bytes per core follow
+ * in Coherence.masks
+ */
+struct SharedLine {
+    uint32_t block;
+    uint32_t writers;                   /* Bit per core */
+    uint32_t invalidations;
+    uint32_t coherence_misses;
+    uint64_t written;                   /* Union of the byte masks */
+    uint8_t overlap;                    /* A byte written by two cores */
+};
+
+/* CoherenceTraffic
+ *
+ * Interconnect counters
+ */
+struct CoherenceTraffic {
+    uint64_t bus_reads;                 /* BusRd */
+    uint64_t bus_read_exclusive;        /* BusRdX */
+    uint64_t bus_upgrades;              /* BusUpgr */
+    uint64_t bus_writebacks;            /* Dirty lines replaced or flushed */
+    uint64_t snoops;                    /* Lookups in other caches, bus only */
+    uint64_t messages;                  /* Directory only */
+    uint64_t invalidations;
+    uint64_t cache_to_cache;            /* Fills supplied by a dirty owner */
+    uint64_t memory_reads;              /* Fills supplied by memory */
+    uint64_t memory_writes;             /* Lines written back, MESI sharing too */
+};
+
+/* Coherence
+ *
+ * Simulator state
+ */
+struct Coherence {
+    struct CoherenceConfig config;
+    struct CoherenceCore core[COHERENCE_MAX_CORES];
+    struct CoherenceTraffic traffic;
+    struct BlockMap lost;               /* Block to the cores it was invalidated in */
+    struct BlockMap shared;             /* Block to 1 + its SharedLine */
+    struct SharedLine *lines;
+    uint64_t *masks;                    /* cores per SharedLine */
+    uint32_t line_count;
+    uint32_t line_capacity;
+    uint32_t mask_shift;                /* Line bytes per mask bit, log2 */
+};
+
+/* coherence_init
+ *
+ * Initialize a simulator with empty caches
+ *
+ * @param       coherence
+ * @param       config
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int coherence_init(struct Coherence *coherence, const struct CoherenceConfig *config);
+
+/* coherence_free
+ *
+ * Release a simulator
+ *
+ * @param       coherence
+ *
+ * @return      void
+ */
+void coherence_free(struct Coherence *coherence);
+
+/* coherence_access
+ *
+ * Run one access of a core within one line
+ *
+ * @param       coherence
+ * @param       core
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes, must not cross the line
+ *
+ * @return      RESULT_HIT or RESULT_MISS, -1 if out of memory
+ */
+int coherence_access(struct Coherence *coherence, uint32_t core, uint32_t address, access_t access,
+                     uint8_t size);
+
+/* coherence_flush
+ *
+ * Write back the dirty lines of every core. The lines stay valid and
+ * clean.
+ *
+ * @param       coherence
+ *
+ * @return      void
+ */
+void coherence_flush(struct Coherence *coherence);
+
+/* coherence_false_sharing
+ *
+ * Check whether a written line is falsely shared
+ *
+ * @param       line
+ *
+ * @return      1 if written by several cores at disjoint offsets
+ */
+int coherence_false_sharing(const struct SharedLine *line);
+
+#endif
+/* COHERENCE_H_ */
@@ -0,0 +1,403 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, multi-core coherence simulator
+ * --
+ * -- Usage       : cohsim [-M] [-D] [-q quantum] [-n lines]
+ * --                      [-o offset] [-s index] [-w ways]
+ * --                      [-r replacement] [-t threads] [-p]
+ * --                      [trace ...]
+ * --               Every trace is the text or binary trace of one
+ * --               thread, run on its own core with a private cache
+ * --               of the given geometry (default config.h). The
+ * --               threads are interleaved round-robin, quantum
+ * --               records at a time (default 1).
+ * --               -M  MOESI instead of MESI
+ * --               -D  directory instead of a snoopy bus
+ * --               -n  falsely shared lines listed (default 10)
+ * --               Without traces -t threads (default 4) each sum
+ * --               their own part of an array into their own counter,
+ * --               the counters packed into one line, or with -p
+ * --               padded to a line each.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace_bin.h"
+#include "coherence.h"
+#include "config.h"
+
+/* Elements each thread of the built-in workload sums */
+#define WORKLOAD_ELEMENTS   4096
+
+/* Base addresses of the built-in workload */
+#define WORKLOAD_ARRAY      0x10000u
+#define WORKLOAD_COUNTERS   0x80000u
+
+/* Names of the protocols and interconnects */
+static const char *protocol_names[] = { "MESI", "MOESI" };
+static const char *interconnect_names[] = { "bus", "directory" };
+
+/* load_thread
+ *
+ * Load the trace of one thread into memory
+ *
+ * @param       path        Text or binary trace
+ * @param       trace       Initialized, gets the records
+ *
+ * @return      0 on success, -1 on error
+ */
+static int load_thread(const char *path, struct Trace *trace)
+{
+    /* Local Variables */
+    struct TraceBinReader reader;
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    uint32_t chunk;
+    int status = 0;
+    int next;
+
+    if (!trace_bin_is_binary(path)) {
+        return trace_load_text(path, trace);
+    }
+    if (trace_bin_open(&reader, path) != 0) {
+        return -1;
+    }
+    for (chunk = 0; chunk < reader.chunk_count && status == 0; chunk++) {
+        trace_bin_cursor(&reader, chunk, &cursor);
+        while ((next = trace_bin_next(&cursor, &record)) > 0) {
+            if (trace_append(trace, (access_t)record.access, record.address, record.size) != 0) {
+                status = -1;
+                break;
+            }
+        }
+        if (next < 0) {
+            status = -1;
+        }
+    }
+    trace_bin_close(&reader);
+
+    return status;
+}
+
+/* workload
+ *
+ * Build the traces of the built-in workload: thread t sums its quarter
+ * of an array into counter t
+ *
+ * @param       traces
+ * @param       threads
+ * @param       stride      Bytes between the counters
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int workload(struct Trace *traces, uint32_t threads, uint32_t stride)
+{
+    /* Local Variables */
+    uint32_t t;
+    uint32_t i;
+
+    for (t = 0; t < threads; t++) {
+        uint32_t counter = WORKLOAD_COUNTERS + t * stride;
+
+        for (i = 0; i < WORKLOAD_ELEMENTS; i++) {
+            uint32_t element = WORKLOAD_ARRAY + (t * WORKLOAD_ELEMENTS + i) * 4;
+
+            if (trace_append(&traces[t], READ_ACCESS, element, 4) != 0 ||
+                trace_append(&traces[t], READ_ACCESS, counter, 4) != 0 ||
+                trace_append(&traces[t], WRITE_ACCESS, counter, 4) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* run_record
+ *
+ * Run a record of a thread line by line
+ *
+ * @param       coherence
+ * @param       core
+ * @param       record
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int run_record(struct Coherence *coherence, uint32_t core, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t offset = coherence->config.cache.offset;
+    uint32_t address = record->address;
+    uint32_t last = (record->address + (record->size ? record->size : 1) - 1) >> offset;
+
+    while (1) {
+        if (coherence_access(coherence, core, address, (access_t)record->access,
+                             trace_block_bytes(record, address, offset)) < 0) {
+            return -1;
+        }
+        if ((address >> offset) == last) {
+            return 0;
+        }
+        address = ((address >> offset) + 1) << offset;
+    }
+}
+
+/* compare_invalidations
+ *
+ * qsort() order of shared lines, most invalidations first
+ *
+ * @param       a
+ * @param       b
+ *
+ * @return      <0, 0 or >0
+ */
+static int compare_invalidations(const void *a, const void *b)
+{
+    /* Local Variables */
+    const struct SharedLine *x = *(const struct SharedLine *const *)a;
+    const struct SharedLine *y = *(const struct SharedLine *const *)b;
+
+    if (x->invalidations != y->invalidations) {
+        return x->invalidations > y->invalidations ? -1 : 1;
+    }
+    return x->block < y->block ? -1 : x->block > y->block;
+}
+
+/* print_coherence
+ *
+ * Print the counters per core, of the interconnect and the falsely
+ * shared lines
+ *
+ * @param       coherence
+ * @param       top         Falsely shared lines listed
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int print_coherence(const struct Coherence *coherence, uint32_t top)
+{
+    /* Local Variables */
+    const struct CoherenceConfig *config = &coherence->config;
+    const struct CoherenceTraffic *traffic = &coherence->traffic;
+    const struct SharedLine **false_shared;
+    uint64_t false_invalidations = 0;
+    uint64_t false_misses = 0;
+    uint32_t multi_writer = 0;
+    uint32_t count = 0;
+    uint32_t c;
+    uint32_t i;
+
+    printf("CORES: %u %s %s  CACHE: offset %u index %u ways %u\n", config->cores,
+           protocol_names[config->protocol], interconnect_names[config->interconnect],
+           config->cache.offset, config->cache.index, config->cache.ways);
+    printf("%-5s %10s %10s %10s %10s %10s %10s %11s %10s\n", "CORE", "READS", "WRITES", "HITS",
+           "MISSES", "COHERENCE", "UPGRADES", "INVALIDATED", "WRITEBACKS");
+    for (c = 0; c < config->cores; c++) {
+        const struct CoherenceCore *core = &coherence->core[c];
+
+        printf("%-5u %10llu %10llu %10llu %10llu %10llu %10llu %11llu %10llu\n", c,
+               (unsigned long long)core->reads, (unsigned long long)core->writes,
+               (unsigned long long)core->hits, (unsigned long long)core->misses,
+               (unsigned long long)core->coherence_misses, (unsigned long long)core->upgrades,
+               (unsigned long long)core->invalidated, (unsigned long long)core->writebacks);
+    }
+
+    if (config->interconnect == INTERCONNECT_BUS) {
+        printf("BUS: BusRd %llu  BusRdX %llu  BusUpgr %llu  write-back %llu  total %llu  "
+               "snoops %llu\n",
+               (unsigned long long)traffic->bus_reads,
+               (unsigned long long)traffic->bus_read_exclusive,
+               (unsigned long long)traffic->bus_upgrades,
+               (unsigned long long)traffic->bus_writebacks,
+               (unsigned long long)(traffic->bus_reads + traffic->bus_read_exclusive +
+                                    traffic->bus_upgrades + traffic->bus_writebacks),
+               (unsigned long long)traffic->snoops);
+    } else {
+        printf("DIRECTORY: messages %llu\n", (unsigned long long)traffic->messages);
+    }
+    printf("INVALIDATIONS: %llu  CACHE TO CACHE: %llu  MEMORY READS: %llu  MEMORY WRITES: %llu\n",
+           (unsigned long long)traffic->invalidations, (unsigned long long)traffic->cache_to_cache,
+           (unsigned long long)traffic->memory_reads, (unsigned long long)traffic->memory_writes);
+
+    false_shared = malloc((coherence->line_count + 1) * sizeof(*false_shared));
+    if (false_shared == NULL) {
+        return -1;
+    }
+    for (i = 0; i < coherence->line_count; i++) {
+        const struct SharedLine *line = &coherence->lines[i];
+
+        multi_writer += (line->writers & (line->writers - 1)) != 0;
+        if (coherence_false_sharing(line)) {
+            false_shared[count++] = line;
+            false_invalidations += line->invalidations;
+            false_misses += line->coherence_misses;
+        }
+    }
+    qsort(false_shared, count, sizeof(*false_shared), compare_invalidations);
+
+    printf("WRITTEN LINES: %u  BY SEVERAL CORES: %u  FALSELY SHARED: %u  "
+           "their invalidations %llu, coherence misses %llu\n",
+           coherence->line_count, multi_writer, count, (unsigned long long)false_invalidations,
+           (unsigned long long)false_misses);
+    if (count > 0 && top > 0) {
+        printf("%-10s %-8s %13s %16s  %s\n", "LINE", "WRITERS", "INVALIDATIONS", "COHERENCE MISSES",
+               "OFFSETS PER WRITER");
+    }
+    for (i = 0; i < count && i < top; i++) {
+        const struct SharedLine *line = false_shared[i];
+        const uint64_t *masks = &coherence->masks[(size_t)(line - coherence->lines) * config->cores];
+
+        printf("0x%08x 0x%06x %13u %16u ", line->block << config->cache.offset, line->writers,
+               line->invalidations, line->coherence_misses);
+        for (c = 0; c < config->cores; c++) {
+            if (masks[c]) {
+                /* Bytes of the line, in units of 2^mask_shift */
+                printf(" %u:%u-%u", c, __builtin_ctzll(masks[c]) << coherence->mask_shift,
+                       ((64 - __builtin_clzll(masks[c])) << coherence->mask_shift) - 1);
+            }
+        }
+        printf("\n");
+    }
+    free(false_shared);
+
+    return 0;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static struct Coherence coherence;
+    static struct Trace traces[COHERENCE_MAX_CORES];
+    static size_t next[COHERENCE_MAX_CORES];
+    struct CoherenceConfig config;
+    uint32_t threads = 4;
+    uint32_t quantum = 1;
+    uint32_t top = 10;
+    uint32_t pad = 0;
+    uint32_t running;
+    uint32_t t;
+    size_t i;
+    int status = 0;
+    int option;
+
+    memset(&config, 0, sizeof(config));
+    config.protocol = PROTOCOL_MESI;
+    config.interconnect = INTERCONNECT_BUS;
+    config.cache.offset = OFFSET;
+    config.cache.index = INDEX;
+    config.cache.ways = WAYS;
+    config.cache.replacement = REPLACEMENT;
+    config.cache.index_function = INDEX_FUNCTION;
+
+    while ((option = getopt(argc, argv, "MDq:n:o:s:w:r:t:p")) != -1) {
+        switch (option) {
+            case 'M':
+                config.protocol = PROTOCOL_MOESI;
+                break;
+            case 'D':
+                config.interconnect = INTERCONNECT_DIRECTORY;
+                break;
+            case 'q':
+                quantum = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                top = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                config.cache.offset = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                config.cache.index = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                config.cache.ways = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                config.cache.replacement = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                threads = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                pad = 1;
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind > argc || quantum == 0) {
+        fprintf(stderr, "usage: %s [-M] [-D] [-q quantum] [-n lines] [-o offset] [-s index] "
+                "[-w ways] [-r replacement] [-t threads] [-p] [trace ...]\n", argv[0]);
+        return 2;
+    }
+    if (optind < argc) {
+        threads = (uint32_t)(argc - optind);
+    }
+    if (threads < 1 || threads > COHERENCE_MAX_CORES) {
+        fprintf(stderr, "1 to %d threads\n", COHERENCE_MAX_CORES);
+        return 2;
+    }
+    config.cores = threads;
+    if (coherence_init(&coherence, &config) != 0) {
+        fprintf(stderr, "invalid cache config or out of memory\n");
+        return 1;
+    }
+
+    for (t = 0; t < threads; t++) {
+        trace_init(&traces[t]);
+    }
+    if (optind < argc) {
+        for (t = 0; t < threads && status == 0; t++) {
+            if (load_thread(argv[optind + t], &traces[t]) != 0) {
+                fprintf(stderr, "%s: trace error\n", argv[optind + t]);
+                status = 1;
+            }
+        }
+    } else if (workload(traces, threads, pad ? 1u << config.cache.offset : 4) != 0) {
+        fprintf(stderr, "out of memory\n");
+        status = 1;
+    }
+
+    /* Round-robin, quantum records per turn, until every thread is done */
+    for (running = threads; status == 0 && running > 0;) {
+        running = 0;
+        for (t = 0; t < threads && status == 0; t++) {
+            for (i = 0; i < quantum && next[t] < traces[t].count; i++) {
+                if (run_record(&coherence, t, &traces[t].records[next[t]++]) != 0) {
+                    fprintf(stderr, "out of memory\n");
+                    status = 1;
+                    break;
+                }
+            }
+            running += next[t] < traces[t].count;
+        }
+    }
+
+    if (status == 0) {
+        /* Dirty lines left at the end still cost a write-back */
+        coherence_flush(&coherence);
+        if (print_coherence(&coherence, top) != 0) {
+            fprintf(stderr, "out of memory\n");
+            status = 1;
+        }
+    }
+
+    for (t = 0; t < threads; t++) {
+        trace_free(&traces[t]);
+    }
+    coherence_free(&coherence);
+
+    return status;
+}
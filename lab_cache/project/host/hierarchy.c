@@ -0,0 +1,420 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <string.h>
+
+/* User includes */
+#include "hierarchy.h"
+
+/* Names of the inclusion policies */
+static const char *inclusion_names[] = { "NINE", "INCLUSIVE", "EXCLUSIVE" };
+
+/* block_bytes
+ *
+ * Block size of a level
+ *
+ * @param       level
+ *
+ * @return      bytes
+ */
+static uint32_t block_bytes(const struct HierarchyLevel *level)
+{
+    return 1u << level->cache.config.offset;
+}
+
+/* write_back
+ *
+ * Write a dirty block that leaves a level into the next level holding
+ * it, or into memory
+ *
+ * @param       hierarchy
+ * @param       from        Level the block leaves
+ * @param       address     Address of the block
+ *
+ * @return      void
+ */
+static void write_back(struct Hierarchy *hierarchy, uint32_t from, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t i;
+
+    for (i = from; i < hierarchy->levels; i++) {
+        hierarchy->level[i].writeback_bytes += block_bytes(&hierarchy->level[i]);
+        if (i + 1 < hierarchy->levels && cache_mark_dirty(&hierarchy->level[i + 1].cache, address)) {
+            return;
+        }
+    }
+}
+
+/* back_invalidate
+ *
+ * Drop every block of the upper levels that lies inside a block
+ * evicted from a lower level
+ *
+ * @param       hierarchy
+ * @param       lower       Level that evicted the block
+ * @param       victim      Address of the evicted block
+ *
+ * @return      1 if a dropped block was dirty, 0 otherwise
+ */
+static uint8_t back_invalidate(struct Hierarchy *hierarchy, uint32_t lower, uint32_t victim)
+{
+    /* Local Variables */
+    uint32_t size = block_bytes(&hierarchy->level[lower]);
+    uint8_t dirty = 0;
+    uint32_t k;
+
+    for (k = 0; k < lower; k++) {
+        struct HierarchyLevel *upper = &hierarchy->level[k];
+        uint32_t step = block_bytes(upper);
+        uint32_t offset;
+
+        for (offset = 0; offset < size; offset += step) {
+            dirty |= cache_dirty(&upper->cache, victim + offset);
+            if (cache_invalidate(&upper->cache, victim + offset)) {
+                upper->back_invalidations++;
+            }
+        }
+    }
+
+    return dirty;
+}
+
+/* fill_exclusive
+ *
+ * Place a block in L1 and push the victims down level by level. The
+ * victims keep their dirty state, the victim of the last level is
+ * written back to memory if dirty and dropped otherwise.
+ *
+ * @param       hierarchy
+ * @param       address
+ * @param       dirty       State of the block placed in L1
+ *
+ * @return      void
+ */
+static void fill_exclusive(struct Hierarchy *hierarchy, uint32_t address, uint8_t dirty)
+{
+    /* Local Variables */
+    struct MemoryTraffic traffic;
+    uint32_t victim;
+    uint32_t i;
+
+    for (i = 0; i < hierarchy->levels; i++) {
+        struct HierarchyLevel *level = &hierarchy->level[i];
+        uint8_t replaced;
+
+        memset(&traffic, 0, sizeof(traffic));
+        replaced = cache_fill(&level->cache, address, &victim, &traffic);
+        if (dirty) {
+            cache_mark_dirty(&level->cache, address);
+        }
+        if (!replaced) {
+            return;
+        }
+        if (i + 1 < hierarchy->levels) {
+            level->victim_bytes += block_bytes(level);
+        } else {
+            /* The memory link */
+            level->writeback_bytes += traffic.writeback_bytes;
+        }
+        address = victim;
+        dirty = traffic.writeback_bytes != 0;
+    }
+}
+
+/* hierarchy_init
+ *
+ * Create the caches of a hierarchy. Every level must be write-back
+ * with write-allocate. Inclusive hierarchies need block sizes that do
+ * not shrink towards memory, exclusive ones the same block size in
+ * every level.
+ *
+ * @param       hierarchy
+ * @param       config
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int hierarchy_init(struct Hierarchy *hierarchy, const struct HierarchyConfig *config)
+{
+    /* Local Variables */
+    uint32_t i;
+
+    memset(hierarchy, 0, sizeof(*hierarchy));
+    if (config->levels < 1 || config->levels > HIERARCHY_MAX_LEVELS ||
+        config->inclusion > INCLUSION_EXCLUSIVE) {
+        return -1;
+    }
+    for (i = 0; i < config->levels; i++) {
+        /* The model only knows write-back with write-allocate */
+        if (config->cache[i].write_policy != WRITE_POLICY_BACK ||
+            config->cache[i].write_miss != WRITE_MISS_ALLOCATE) {
+            return -1;
+        }
+    }
+    for (i = 1; i < config->levels; i++) {
+        uint8_t upper = config->cache[i - 1].offset;
+        uint8_t lower = config->cache[i].offset;
+
+        if (config->inclusion == INCLUSION_INCLUSIVE && lower < upper) {
+            return -1;
+        }
+        if (config->inclusion == INCLUSION_EXCLUSIVE && lower != upper) {
+            return -1;
+        }
+    }
+
+    hierarchy->inclusion = config->inclusion;
+    hierarchy->memory_latency = config->memory_latency;
+    for (i = 0; i < config->levels; i++) {
+        if (cache_alloc(&hierarchy->level[i].cache, &config->cache[i]) != 0) {
+            hierarchy_free(hierarchy);
+            return -1;
+        }
+        hierarchy->level[i].latency = config->latency[i];
+        hierarchy->levels++;
+    }
+
+    return 0;
+}
+
+/* hierarchy_free
+ *
+ * Release the caches of a hierarchy
+ *
+ * @param       hierarchy
+ *
+ * @return      void
+ */
+void hierarchy_free(struct Hierarchy *hierarchy)
+{
+    /* Local Variables */
+    uint32_t i;
+
+    for (i = 0; i < hierarchy->levels; i++) {
+        cache_release(&hierarchy->level[i].cache);
+    }
+    hierarchy->levels = 0;
+}
+
+/* hierarchy_access
+ *
+ * Run one access to an L1 block through the hierarchy
+ *
+ * @param       hierarchy
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ *
+ * @return      level that hit, levels if served by memory
+ */
+uint32_t hierarchy_access(struct Hierarchy *hierarchy, uint32_t address, access_t access)
+{
+    /* Local Variables */
+    struct MemoryTraffic traffic;
+    uint32_t source;
+    uint32_t victim;
+    uint8_t dirty = access == WRITE_ACCESS;
+    uint32_t i;
+
+    hierarchy->accesses++;
+
+    /* Walk down until a level holds the block */
+    for (source = 0; source < hierarchy->levels; source++) {
+        struct HierarchyLevel *level = &hierarchy->level[source];
+
+        level->accesses++;
+        if (cache_lookup(&level->cache, address)) {
+            level->hits++;
+            break;
+        }
+        level->misses++;
+    }
+    if (source == hierarchy->levels) {
+        hierarchy->memory_accesses++;
+    }
+    if (source == 0) {
+        if (dirty) {
+            cache_mark_dirty(&hierarchy->level[0].cache, address);
+        }
+        return 0;
+    }
+
+    /* The block crosses every link between the source and L1 */
+    for (i = 0; i < source; i++) {
+        hierarchy->level[i].fill_bytes += block_bytes(&hierarchy->level[i]);
+    }
+
+    if (hierarchy->inclusion == INCLUSION_EXCLUSIVE) {
+        /* Move the block up, it only lives in L1 afterwards */
+        if (source < hierarchy->levels) {
+            dirty |= cache_dirty(&hierarchy->level[source].cache, address);
+            cache_invalidate(&hierarchy->level[source].cache, address);
+        }
+        fill_exclusive(hierarchy, address, dirty);
+        return source;
+    }
+
+    /* Fill the missing levels from the bottom up */
+    for (i = source; i-- > 0;) {
+        memset(&traffic, 0, sizeof(traffic));
+        if (cache_fill(&hierarchy->level[i].cache, address, &victim, &traffic)) {
+            uint8_t upper_dirty = 0;
+
+            if (hierarchy->inclusion == INCLUSION_INCLUSIVE) {
+                upper_dirty = back_invalidate(hierarchy, i, victim);
+            }
+            if (traffic.writeback_bytes != 0 || upper_dirty) {
+                write_back(hierarchy, i, victim);
+            }
+        }
+    }
+    if (dirty) {
+        cache_mark_dirty(&hierarchy->level[0].cache, address);
+    }
+
+    return source;
+}
+
+/* hierarchy_record
+ *
+ * Run every L1 block access of a record through the hierarchy
+ *
+ * @param       hierarchy
+ * @param       record
+ *
+ * @return      number of L1 accesses
+ */
+uint32_t hierarchy_record(struct Hierarchy *hierarchy, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t offset = hierarchy->level[0].cache.config.offset;
+    uint32_t block = record->address >> offset;
+    uint32_t last = (record->address + record->size - 1) >> offset;
+    uint32_t accesses = 1;
+
+    hierarchy_access(hierarchy, record->address, (access_t)record->access);
+
+    /* Remaining blocks of an access crossing a block boundary */
+    while (block != last) {
+        block++;
+        hierarchy_access(hierarchy, block << offset, (access_t)record->access);
+        accesses++;
+    }
+
+    return accesses;
+}
+
+/* hierarchy_replay
+ *
+ * Run all records of an in-memory trace through the hierarchy
+ *
+ * @param       hierarchy
+ * @param       trace
+ *
+ * @return      number of L1 accesses
+ */
+uint64_t hierarchy_replay(struct Hierarchy *hierarchy, const struct Trace *trace)
+{
+    /* Local Variables */
+    uint64_t accesses = 0;
+    size_t i;
+
+    for (i = 0; i < trace->count; i++) {
+        accesses += hierarchy_record(hierarchy, &trace->records[i]);
+    }
+
+    return accesses;
+}
+
+/* hierarchy_replay_bin
+ *
+ * Run all records of a binary trace through the hierarchy
+ *
+ * @param       hierarchy
+ * @param       reader
+ *
+ * @return      number of L1 accesses, -1 if a chunk is corrupt
+ */
+int64_t hierarchy_replay_bin(struct Hierarchy *hierarchy, const struct TraceBinReader *reader)
+{
+    /* Local Variables */
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    uint64_t accesses = 0;
+    uint32_t chunk;
+    int decoded = 0;
+
+    for (chunk = 0; chunk < reader->chunk_count && decoded >= 0; chunk++) {
+        trace_bin_cursor(reader, chunk, &cursor);
+        while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+            accesses += hierarchy_record(hierarchy, &record);
+        }
+    }
+
+    return decoded < 0 ? -1 : (int64_t)accesses;
+}
+
+/* hierarchy_amat
+ *
+ * Average memory access time in cycles: every access pays the latency
+ * of each level it reaches, plus the memory latency if all levels miss
+ *
+ * @param       hierarchy
+ *
+ * @return      cycles per access
+ */
+double hierarchy_amat(const struct Hierarchy *hierarchy)
+{
+    /* Local Variables */
+    double cycles;
+    uint32_t i;
+
+    if (hierarchy->accesses == 0) {
+        return 0.0;
+    }
+    cycles = (double)hierarchy->memory_accesses * hierarchy->memory_latency;
+    for (i = 0; i < hierarchy->levels; i++) {
+        cycles += (double)hierarchy->level[i].accesses * hierarchy->level[i].latency;
+    }
+
+    return cycles / hierarchy->accesses;
+}
+
+/* hierarchy_print
+ *
+ * Print per level hit rates, the traffic on every link and the AMAT
+ *
+ * @param       hierarchy
+ * @param       file
+ *
+ * @return      void
+ */
+void hierarchy_print(const struct Hierarchy *hierarchy, FILE *file)
+{
+    /* Local Variables */
+    uint32_t i;
+
+    fprintf(file, "INCLUSION: %s\n", inclusion_names[hierarchy->inclusion]);
+    fprintf(file, "%-6s %12s %12s %12s %8s %14s %14s %14s %12s\n", "", "ACCESSES", "HITS",
+            "MISSES", "HIT %", "FILL BYTES", "VICTIM BYTES", "WRITEBACK B", "BACK-INV");
+    for (i = 0; i < hierarchy->levels; i++) {
+        const struct HierarchyLevel *level = &hierarchy->level[i];
+        char name[16];
+
+        snprintf(name, sizeof(name), "L%u", i + 1);
+        fprintf(file, "%-6s %12llu %12llu %12llu %8.2f %14llu %14llu %14llu %12llu\n", name,
+                (unsigned long long)level->accesses, (unsigned long long)level->hits,
+                (unsigned long long)level->misses,
+                level->accesses ? 100.0 * level->hits / level->accesses : 0.0,
+                (unsigned long long)level->fill_bytes, (unsigned long long)level->victim_bytes,
+                (unsigned long long)level->writeback_bytes,
+                (unsigned long long)level->back_invalidations);
+    }
+    fprintf(file, "%-6s %12llu\n", "MEMORY", (unsigned long long)hierarchy->memory_accesses);
+    fprintf(file, "AMAT: %.3f cycles\n", hierarchy_amat(hierarchy));
+}
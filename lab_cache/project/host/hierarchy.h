@@ -0,0 +1,186 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Multi-level cache hierarchy
+ *
+ * An access walks down from L1 until a level hits or memory is reached.
+ * How the block is placed afterwards depends on the inclusion policy:
+ *
+ *   NINE        every level that missed is filled, evictions of a
+ *               lower level leave the upper levels alone
+ *   inclusive   as NINE, but a block evicted from a lower level is
+ *               back-invalidated in all upper levels, so every upper
+ *               level is a subset of the lower ones
+ *   exclusive   only L1 is filled, a block that hits in a lower level
+ *               moves up and is removed there. L1 victims are placed in
+ *               L2, L2 victims in L3 and so on, so a block lives in at
+ *               most one level.
+ *
+ * Every level is write-back with write-allocate: a store dirties the L1
+ * line, a dirty block that leaves a level is written into the next
+ * level that holds it, or into memory. Exclusive victims carry their
+ * dirty state down, a dirty victim of the last level is written back.
+ *
+ * Traffic is counted per link below a level: bytes moving up to fill a
+ * level, bytes moving down as exclusive victims and dirty bytes written
+ * back. The link below the last level is the memory bus.
+ */
+
+#ifndef HIERARCHY_H_
+#define HIERARCHY_H_
+
+#include <stdio.h>
+
+/* User includes */
+#include "trace_bin.h"
+
+/* Largest number of levels */
+#define HIERARCHY_MAX_LEVELS 4
+
+/* Typedefs */
+typedef enum {
+    INCLUSION_NINE,
+    INCLUSION_INCLUSIVE,
+    INCLUSION_EXCLUSIVE
+} inclusion_t;
+
+/* HierarchyConfig
+ *
+ * Geometry and latency in cycles of every level, L1 first
+ */
+struct HierarchyConfig {
+    uint32_t levels;
+    inclusion_t inclusion;
+    struct CacheConfig cache[HIERARCHY_MAX_LEVELS];
+    uint32_t latency[HIERARCHY_MAX_LEVELS];
+    uint32_t memory_latency;
+};
+
+/* HierarchyLevel
+ *
+ * One level and the counters of the link below it
+ */
+struct HierarchyLevel {
+    struct Cache cache;
+    uint32_t latency;
+    uint64_t accesses;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t fill_bytes;            /* Moved up from the next level or memory */
+    uint64_t victim_bytes;          /* Moved down to the next level */
+    uint64_t writeback_bytes;       /* Dirty blocks written down */
+    uint64_t back_invalidations;    /* Upper blocks dropped for an eviction */
+};
+
+/* Hierarchy
+ *
+ * Levels plus the accesses that reached memory
+ */
+struct Hierarchy {
+    uint32_t levels;
+    inclusion_t inclusion;
+    uint32_t memory_latency;
+    uint64_t accesses;
+    uint64_t memory_accesses;
+    struct HierarchyLevel level[HIERARCHY_MAX_LEVELS];
+};
+
+/* hierarchy_init
+ *
+ * Create the caches of a hierarchy. Every level must be write-back
+ * with write-allocate. Inclusive hierarchies need block sizes that do
+ * not shrink towards memory, exclusive ones the same block size in
+ * every level.
+ *
+ * @param       hierarchy
+ * @param       config
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int hierarchy_init(struct Hierarchy *hierarchy, const struct HierarchyConfig *config);
+
+/* hierarchy_free
+ *
+ * Release the caches of a hierarchy
+ *
+ * @param       hierarchy
+ *
+ * @return      void
+ */
+void hierarchy_free(struct Hierarchy *hierarchy);
+
+/* hierarchy_access
+ *
+ * Run one access to an L1 block through the hierarchy
+ *
+ * @param       hierarchy
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ *
+ * @return      level that hit, levels if served by memory
+ */
+uint32_t hierarchy_access(struct Hierarchy *hierarchy, uint32_t address, access_t access);
+
+/* hierarchy_record
+ *
+ * Run every L1 block access of a record through the hierarchy
+ *
+ * @param       hierarchy
+ * @param       record
+ *
+ * @return      number of L1 accesses
+ */
+uint32_t hierarchy_record(struct Hierarchy *hierarchy, const struct TraceRecord *record);
+
+/* hierarchy_replay
+ *
+ * Run all records of an in-memory trace through the hierarchy
+ *
+ * @param       hierarchy
+ * @param       trace
+ *
+ * @return      number of L1 accesses
+ */
+uint64_t hierarchy_replay(struct Hierarchy *hierarchy, const struct Trace *trace);
+
+/* hierarchy_replay_bin
+ *
+ * Run all records of a binary trace through the hierarchy
+ *
+ * @param       hierarchy
+ * @param       reader
+ *
+ * @return      number of L1 accesses, -1 if a chunk is corrupt
+ */
+int64_t hierarchy_replay_bin(struct Hierarchy *hierarchy, const struct TraceBinReader *reader);
+
+/* hierarchy_amat
+ *
+ * Average memory access time in cycles: every access pays the latency
+ * of each level it reaches, plus the memory latency if all levels miss
+ *
+ * @param       hierarchy
+ *
+ * @return      cycles per access
+ */
+double hierarchy_amat(const struct Hierarchy *hierarchy);
+
+/* hierarchy_print
+ *
+ * Print per level hit rates, the traffic on every link and the AMAT
+ *
+ * @param       hierarchy
+ * @param       file
+ *
+ * @return      void
+ */
+void hierarchy_print(const struct Hierarchy *hierarchy, FILE *file);
+
+#endif
+/* HIERARCHY_H_ */
@@ -0,0 +1,258 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, multi-level hierarchy simulator
+ * --
+ * -- Usage       : hiersim [-l level]... [-i inclusion] [-m cycles]
+ * --                       [trace]
+ * --               -l  offset:index:ways:policy:latency of the next
+ * --                   level, L1 first. policy is lru, plru, fifo,
+ * --                   random or srrip. Without -l, L1 is the cache
+ * --                   of config.h and L2 has four times its size.
+ * --               -i  nine (default), inclusive or exclusive
+ * --               -m  memory latency in cycles (default 100)
+ * --               Every level is write-back with write-allocate,
+ * --               whatever config.h selects.
+ * --               Without a trace the a = b + c kernel of main.c is
+ * --               simulated.
+ * --------------------------------------------------------------- */
+
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "hierarchy.h"
+#include "config.h"
+
+/* Names of the replacement policies */
+static const char *replacement_names[] = { "lru", "plru", "fifo", "random", "srrip" };
+
+/* usage
+ *
+ * Print the command line help
+ *
+ * @param       name        Program name
+ *
+ * @return      exit code
+ */
+static int usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-l offset:index:ways:policy:latency]... "
+            "[-i nine|inclusive|exclusive] [-m cycles] [trace]\n", name);
+
+    return 2;
+}
+
+/* parse_cycles
+ *
+ * Parse a latency
+ *
+ * @param       text        Decimal, hex or octal number
+ * @param       cycles
+ *
+ * @return      0 on success, -1 on a syntax error or overflow
+ */
+static int parse_cycles(const char *text, uint32_t *cycles)
+{
+    /* Local Variables */
+    unsigned long value;
+    char *end;
+
+    /* strtoul would accept a sign and blanks */
+    if (*text < '0' || *text > '9') {
+        return -1;
+    }
+    value = strtoul(text, &end, 0);
+    if (*end != '\0' || value > UINT32_MAX) {
+        return -1;
+    }
+    *cycles = (uint32_t)value;
+
+    return 0;
+}
+
+/* parse_level
+ *
+ * Parse the geometry, policy and latency of one level
+ *
+ * @param       text        offset:index:ways:policy:latency
+ * @param       cache
+ * @param       latency
+ *
+ * @return      0 on success, -1 on a syntax error
+ */
+static int parse_level(const char *text, struct CacheConfig *cache, uint32_t *latency)
+{
+    /* Local Variables */
+    unsigned long value[3];
+    char policy[16];
+    char *end;
+    size_t length;
+    uint32_t i;
+
+    for (i = 0; i < 3; i++) {
+        value[i] = strtoul(text, &end, 0);
+        if (end == text || *end != ':' || value[i] > UINT8_MAX) {
+            return -1;
+        }
+        text = end + 1;
+    }
+
+    length = strcspn(text, ":");
+    if (text[length] != ':' || length >= sizeof(policy)) {
+        return -1;
+    }
+    memcpy(policy, text, length);
+    policy[length] = '\0';
+    for (i = 0; i <= REPLACEMENT_SRRIP; i++) {
+        if (strcasecmp(policy, replacement_names[i]) == 0) {
+            break;
+        }
+    }
+    if (i > REPLACEMENT_SRRIP) {
+        return -1;
+    }
+
+    if (parse_cycles(text + length + 1, latency) != 0) {
+        return -1;
+    }
+
+    cache->offset = (uint8_t)value[0];
+    cache->index = (uint8_t)value[1];
+    cache->ways = (uint8_t)value[2];
+    cache->replacement = (uint8_t)i;
+
+    return cache_config_valid(cache) ? 0 : -1;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    struct HierarchyConfig config;
+    struct Hierarchy hierarchy;
+    struct Trace trace;
+    struct TraceBinReader reader;
+    const char *path = NULL;
+    int binary;
+    int64_t accesses;
+    double start;
+    double seconds;
+    uint32_t i;
+    int option;
+
+    memset(&config, 0, sizeof(config));
+    config.inclusion = INCLUSION_NINE;
+    config.memory_latency = 100;
+
+    while ((option = getopt(argc, argv, "l:i:m:")) != -1) {
+        switch (option) {
+            case 'l':
+                if (config.levels == HIERARCHY_MAX_LEVELS ||
+                    parse_level(optarg, &config.cache[config.levels],
+                                &config.latency[config.levels]) != 0) {
+                    fprintf(stderr, "invalid level: %s\n", optarg);
+                    return usage(argv[0]);
+                }
+                config.levels++;
+                break;
+            case 'i':
+                if (strcmp(optarg, "nine") == 0) {
+                    config.inclusion = INCLUSION_NINE;
+                } else if (strcmp(optarg, "inclusive") == 0) {
+                    config.inclusion = INCLUSION_INCLUSIVE;
+                } else if (strcmp(optarg, "exclusive") == 0) {
+                    config.inclusion = INCLUSION_EXCLUSIVE;
+                } else {
+                    fprintf(stderr, "invalid inclusion: %s\n", optarg);
+                    return usage(argv[0]);
+                }
+                break;
+            case 'm':
+                if (parse_cycles(optarg, &config.memory_latency) != 0) {
+                    fprintf(stderr, "invalid memory latency: %s\n", optarg);
+                    return usage(argv[0]);
+                }
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind++];
+    }
+    if (optind < argc) {
+        return usage(argv[0]);
+    }
+
+    /* Default: the config.h cache backed by an L2 of four times its size */
+    if (config.levels == 0) {
+        config.levels = 2;
+        config.cache[0].offset = OFFSET;
+        config.cache[0].index = INDEX;
+        config.cache[0].ways = WAYS;
+        config.cache[0].replacement = REPLACEMENT;
+        config.latency[0] = 1;
+        config.cache[1] = config.cache[0];
+        config.cache[1].index = INDEX + 2;
+        config.latency[1] = 10;
+    }
+
+    if (hierarchy_init(&hierarchy, &config) != 0) {
+        fprintf(stderr, "invalid hierarchy\n");
+        return 1;
+    }
+    for (i = 0; i < hierarchy.levels; i++) {
+        const struct CacheConfig *cache = &hierarchy.level[i].cache.config;
+
+        printf("L%u: offset %u index %u ways %u replacement %s latency %u\n", i + 1,
+               cache->offset, cache->index, cache->ways, replacement_names[cache->replacement],
+               hierarchy.level[i].latency);
+    }
+    printf("MEMORY: latency %u\n", config.memory_latency);
+
+    /* Load before timing, the replay does no I/O */
+    trace_init(&trace);
+    binary = path != NULL && trace_bin_is_binary(path);
+    if (binary) {
+        if (trace_bin_open(&reader, path) != 0) {
+            hierarchy_free(&hierarchy);
+            return 1;
+        }
+    } else if ((path != NULL ? trace_load_text(path, &trace) : trace_kernel(&trace)) != 0) {
+        trace_free(&trace);
+        hierarchy_free(&hierarchy);
+        return 1;
+    }
+
+    start = host_time();
+    accesses = binary ? hierarchy_replay_bin(&hierarchy, &reader)
+                      : (int64_t)hierarchy_replay(&hierarchy, &trace);
+    seconds = host_time() - start;
+    if (accesses < 0) {
+        fprintf(stderr, "%s: corrupt chunk\n", path);
+        trace_bin_close(&reader);
+        hierarchy_free(&hierarchy);
+        return 1;
+    }
+
+    /* Print simulation results */
+    hierarchy_print(&hierarchy, stdout);
+    print_throughput((uint64_t)accesses, seconds);
+
+    if (binary) {
+        trace_bin_close(&reader);
+    }
+    trace_free(&trace);
+    hierarchy_free(&hierarchy);
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, index function comparison
+ * --
+ * -- Usage       : indexsim [-o offset] [-s index] [-w ways]
+ * --                        [-r replacement] [trace]
+ * --               Streams the trace once through a cache of every
+ * --               index function and splits its misses into
+ * --               compulsory, capacity and conflict misses against a
+ * --               fully associative LRU cache of as many lines: the
+ * --               capacity misses are the ones of that cache, the
+ * --               conflict misses all others, negative if the index
+ * --               function does better than it. The conflict misses
+ * --               are compared to the bit-slice. The
+ * --               geometry defaults to config.h, skewed always uses
+ * --               LRU. Without a trace the a = b + c kernel of
+ * --               main.c is simulated, kernelsim -T writes others.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace_bin.h"
+#include "stack_distance.h"
+#include "config.h"
+
+/* Names of the index functions */
+static const char *function_names[] = { "bit-slice", "xor", "prime", "skewed" };
+
+/* Index functions compared */
+#define FUNCTION_COUNT (INDEX_FUNCTION_SKEWED + 1)
+
+/* Misses of one index function and of the fully associative cache
+ * of as many lines */
+struct FunctionCount {
+    uint64_t misses;
+    uint64_t capacity;          /* Of the fully associative cache, not cold */
+};
+
+/* Context of the trace callback */
+struct Comparison {
+    struct StackDistance sd;
+    cache_t *cache[FUNCTION_COUNT];
+    struct FunctionCount count[FUNCTION_COUNT];
+    uint64_t compulsory;
+    uint64_t accesses;
+    int failed;
+};
+
+/* compare_block
+ *
+ * Run one block access through every cache and the fully associative
+ * cache of each
+ *
+ * @param       comparison
+ * @param       address
+ * @param       access
+ * @param       size
+ *
+ * @return      void
+ */
+static void compare_block(struct Comparison *comparison, uint32_t address, access_t access,
+                          uint8_t size)
+{
+    /* Local Variables */
+    uint32_t distance;
+    uint32_t f;
+
+    if (stack_distance_access(&comparison->sd, address) != 0) {
+        comparison->failed = 1;
+        return;
+    }
+    distance = comparison->sd.distance;
+    comparison->accesses++;
+    comparison->compulsory += distance == STACK_DISTANCE_COLD;
+
+    for (f = 0; f < FUNCTION_COUNT; f++) {
+        cache_t *cache = comparison->cache[f];
+        struct FunctionCount *count = &comparison->count[f];
+
+        count->misses += cache_access(cache, address, access, size) != RESULT_HIT;
+        count->capacity += distance != STACK_DISTANCE_COLD &&
+                           distance >= cache->set_count * cache->config.ways;
+    }
+}
+
+/* compare_visit
+ *
+ * Run a record through every cache, block by block
+ *
+ * @param       context     struct Comparison
+ * @param       record
+ *
+ * @return      void
+ */
+static void compare_visit(void *context, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct Comparison *comparison = context;
+    uint32_t offset = comparison->sd.offset;
+    uint32_t address = record->address;
+    uint32_t last = (record->address + (record->size ? record->size : 1) - 1) >> offset;
+
+    while (!comparison->failed) {
+        compare_block(comparison, address, (access_t)record->access,
+                      trace_block_bytes(record, address, offset));
+        if ((address >> offset) == last) {
+            break;
+        }
+        address = ((address >> offset) + 1) << offset;
+    }
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static struct Comparison comparison;
+    struct CacheConfig base;
+    struct Trace trace;
+    const char *path = NULL;
+    int64_t records = 0;
+    int64_t reference;
+    uint32_t f;
+    size_t i;
+    int status = 0;
+    int option;
+
+    memset(&base, 0, sizeof(base));
+    base.offset = OFFSET;
+    base.index = INDEX;
+    base.ways = WAYS;
+    base.replacement = REPLACEMENT;
+    base.write_policy = WRITE_POLICY;
+    base.write_miss = WRITE_MISS;
+
+    while ((option = getopt(argc, argv, "o:s:w:r:")) != -1) {
+        switch (option) {
+            case 'o':
+                base.offset = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                base.index = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                base.ways = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                base.replacement = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind++];
+    }
+    if (optind < argc) {
+        fprintf(stderr, "usage: %s [-o offset] [-s index] [-w ways] [-r replacement] [trace]\n",
+                argv[0]);
+        return 2;
+    }
+
+    if (stack_distance_init(&comparison.sd, base.offset, 0) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (f = 0; f < FUNCTION_COUNT; f++) {
+        struct CacheConfig config = base;
+
+        config.index_function = (uint8_t)f;
+        if (f == INDEX_FUNCTION_SKEWED) {
+            config.replacement = REPLACEMENT_LRU;
+        }
+        comparison.cache[f] = cache_create(&config);
+        if (comparison.cache[f] == NULL) {
+            fprintf(stderr, "%s: invalid cache config or out of memory\n", function_names[f]);
+            status = 1;
+            break;
+        }
+    }
+
+    if (status == 0 && path != NULL) {
+        records = trace_stream(path, compare_visit, &comparison);
+    } else if (status == 0) {
+        trace_init(&trace);
+        records = trace_kernel(&trace) != 0 ? -1 : (int64_t)trace.count;
+        for (i = 0; records >= 0 && i < trace.count; i++) {
+            compare_visit(&comparison, &trace.records[i]);
+        }
+        trace_free(&trace);
+    }
+    if (status == 0 && (records < 0 || comparison.failed)) {
+        fprintf(stderr, "%s\n", records < 0 ? "trace error" : "out of memory");
+        status = 1;
+    }
+
+    if (status == 0) {
+        printf("CACHE: offset %u index %u ways %u  ACCESSES: %llu\n", base.offset, base.index,
+               base.ways, (unsigned long long)comparison.accesses);
+        printf("%-10s %6s %12s %12s %12s %12s %10s\n", "FUNCTION", "SETS", "MISSES", "COMPULSORY",
+               "CAPACITY", "CONFLICT", "CONFLICT %");
+        reference = (int64_t)(comparison.count[INDEX_FUNCTION_BITS].misses - comparison.compulsory
+                              - comparison.count[INDEX_FUNCTION_BITS].capacity);
+        for (f = 0; f < FUNCTION_COUNT; f++) {
+            const struct FunctionCount *count = &comparison.count[f];
+            int64_t conflict = (int64_t)(count->misses - comparison.compulsory - count->capacity);
+
+            /* Change of the conflict misses against the bit-slice */
+            printf("%-10s %6u %12llu %12llu %12llu %12lld %+10.2f\n", function_names[f],
+                   comparison.cache[f]->set_count, (unsigned long long)count->misses,
+                   (unsigned long long)comparison.compulsory,
+                   (unsigned long long)count->capacity, (long long)conflict,
+                   reference ? 100.0 * (double)(conflict - reference) / llabs(reference) : 0.0);
+        }
+    }
+
+    for (f = 0; f < FUNCTION_COUNT; f++) {
+        cache_destroy(comparison.cache[f]);
+    }
+    stack_distance_free(&comparison.sd);
+
+    return status;
+}
@@ -0,0 +1,355 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, instrumented kernel simulator
+ * --
+ * -- Usage       : instrsim [-k matmul|tiled|stencil] [-n size]
+ * --                        [-t tile] [-i iterations] [-j threads]
+ * --                        [-o offset] [-s index] [-w ways]
+ * --                        [-r replacement] [-T file]
+ * --               Runs real C code on n x n doubles (default 256),
+ * --               instrumented with TRACE_LOAD / TRACE_STORE of
+ * --               instrument.h, on worker threads (default 1) and
+ * --               simulates its accesses on a cache of config.h
+ * --               geometry while it runs. -T also writes them to a
+ * --               binary trace.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "instrument.h"
+#include "config.h"
+
+/* Kernels */
+#define KERNEL_MATMUL   0
+#define KERNEL_TILED    1
+#define KERNEL_STENCIL  2
+#define KERNELS         3
+
+/* Names of the kernels */
+static const char *kernel_names[] = { "matmul", "tiled", "stencil" };
+
+/* Problem
+ *
+ * Arrays and size of a kernel run
+ */
+struct Problem {
+    double *a;
+    double *b;
+    double *c;
+    uint32_t n;
+    uint32_t tile;
+};
+
+/* matmul_row
+ *
+ * c = a * b, row i, dot product inner loop
+ *
+ * @param       context     struct Problem
+ * @param       i           Row
+ * @param       worker      unused
+ *
+ * @return      void
+ */
+static void matmul_row(void *context, uint32_t i, uint32_t worker)
+{
+    /* Local Variables */
+    struct Problem *p = context;
+    const uint32_t n = p->n;
+    uint32_t j;
+    uint32_t k;
+
+    (void)worker;
+    for (j = 0; j < n; j++) {
+        double sum = 0;
+
+        for (k = 0; k < n; k++) {
+            TRACE_LOAD(&p->a[i * n + k]);
+            TRACE_LOAD(&p->b[k * n + j]);
+            sum += p->a[i * n + k] * p->b[k * n + j];
+        }
+        TRACE_STORE(&p->c[i * n + j]);
+        p->c[i * n + j] = sum;
+    }
+}
+
+/* tiled_rows
+ *
+ * c += a * b on the rows of one tile, ikj on tile x tile blocks
+ *
+ * @param       context     struct Problem
+ * @param       item        Tile row
+ * @param       worker      unused
+ *
+ * @return      void
+ */
+static void tiled_rows(void *context, uint32_t item, uint32_t worker)
+{
+    /* Local Variables */
+    struct Problem *p = context;
+    const uint32_t n = p->n;
+    const uint32_t tile = p->tile;
+    uint32_t i_end = (item + 1) * tile < n ? (item + 1) * tile : n;
+    uint32_t kk;
+    uint32_t jj;
+    uint32_t i;
+    uint32_t k;
+    uint32_t j;
+
+    (void)worker;
+    for (kk = 0; kk < n; kk += tile) {
+        uint32_t k_end = kk + tile < n ? kk + tile : n;
+
+        for (jj = 0; jj < n; jj += tile) {
+            uint32_t j_end = jj + tile < n ? jj + tile : n;
+
+            for (i = item * tile; i < i_end; i++) {
+                for (k = kk; k < k_end; k++) {
+                    double a_ik;
+
+                    TRACE_LOAD(&p->a[i * n + k]);
+                    a_ik = p->a[i * n + k];
+                    for (j = jj; j < j_end; j++) {
+                        TRACE_LOAD(&p->b[k * n + j]);
+                        TRACE_LOAD(&p->c[i * n + j]);
+                        TRACE_STORE(&p->c[i * n + j]);
+                        p->c[i * n + j] += a_ik * p->b[k * n + j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* stencil_row
+ *
+ * c = 5 point average of b, interior row i + 1
+ *
+ * @param       context     struct Problem
+ * @param       item        Row - 1
+ * @param       worker      unused
+ *
+ * @return      void
+ */
+static void stencil_row(void *context, uint32_t item, uint32_t worker)
+{
+    /* Local Variables */
+    struct Problem *p = context;
+    const uint32_t n = p->n;
+    uint32_t i = item + 1;
+    uint32_t j;
+
+    (void)worker;
+    for (j = 1; j + 1 < n; j++) {
+        TRACE_LOAD(&p->b[i * n + j]);
+        TRACE_LOAD(&p->b[(i - 1) * n + j]);
+        TRACE_LOAD(&p->b[(i + 1) * n + j]);
+        TRACE_LOAD(&p->b[i * n + j - 1]);
+        TRACE_LOAD(&p->b[i * n + j + 1]);
+        TRACE_STORE(&p->c[i * n + j]);
+        p->c[i * n + j] = 0.2 * (p->b[i * n + j] + p->b[(i - 1) * n + j] + p->b[(i + 1) * n + j] +
+                                 p->b[i * n + j - 1] + p->b[i * n + j + 1]);
+    }
+}
+
+/* run_kernel
+ *
+ * Run a kernel on worker threads
+ *
+ * @param       kernel
+ * @param       problem
+ * @param       iterations  Stencil sweeps
+ * @param       threads
+ *
+ * @return      void
+ */
+static void run_kernel(uint32_t kernel, struct Problem *problem, uint32_t iterations,
+                       uint32_t threads)
+{
+    /* Local Variables */
+    const uint32_t n = problem->n;
+    uint32_t iteration;
+
+    switch (kernel) {
+    case KERNEL_MATMUL:
+        parallel_for(n, threads, matmul_row, problem);
+        break;
+    case KERNEL_TILED:
+        parallel_for((n + problem->tile - 1) / problem->tile, threads, tiled_rows, problem);
+        break;
+    default:
+        for (iteration = 0; iteration < iterations && n > 2; iteration++) {
+            double *swap;
+
+            parallel_for(n - 2, threads, stencil_row, problem);
+            swap = problem->b;
+            problem->b = problem->c;
+            problem->c = swap;
+        }
+        break;
+    }
+}
+
+/* usage
+ *
+ * Print the command line help
+ *
+ * @param       name        Program name
+ *
+ * @return      exit code
+ */
+static int usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-k matmul|tiled|stencil] [-n size] [-t tile] [-i iterations] "
+            "[-j threads] [-o offset] [-s index] [-w ways] [-r replacement] [-T file]\n", name);
+
+    return 2;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    struct CacheConfig config;
+    struct Problem problem;
+    struct TraceBinWriter writer;
+    struct InstrumentStats stats;
+    const char *path = NULL;
+    uint32_t kernel = KERNEL_MATMUL;
+    uint32_t iterations = 10;
+    uint32_t threads = 1;
+    double checksum = 0;
+    double start;
+    double seconds;
+    cache_t *cache;
+    size_t cells;
+    size_t i;
+    int status = 0;
+    int option;
+
+    memset(&config, 0, sizeof(config));
+    config.offset = OFFSET;
+    config.index = INDEX;
+    config.ways = WAYS;
+    config.replacement = REPLACEMENT;
+    config.write_policy = WRITE_POLICY;
+    config.write_miss = WRITE_MISS;
+    config.index_function = INDEX_FUNCTION;
+    problem.n = 256;
+    problem.tile = 32;
+
+    while ((option = getopt(argc, argv, "k:n:t:i:j:o:s:w:r:T:")) != -1) {
+        switch (option) {
+            case 'k':
+                for (kernel = 0; kernel < KERNELS; kernel++) {
+                    if (strcmp(optarg, kernel_names[kernel]) == 0) {
+                        break;
+                    }
+                }
+                if (kernel == KERNELS) {
+                    return usage(argv[0]);
+                }
+                break;
+            case 'n':
+                problem.n = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                problem.tile = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                iterations = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'j':
+                threads = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                config.offset = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                config.index = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                config.ways = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                config.replacement = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'T':
+                path = optarg;
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if (optind < argc || problem.n == 0 || problem.tile == 0 || threads == 0 ||
+        threads > INSTRUMENT_MAX_THREADS) {
+        return usage(argv[0]);
+    }
+
+    cells = (size_t)problem.n * problem.n;
+    problem.a = malloc(cells * sizeof(double));
+    problem.b = malloc(cells * sizeof(double));
+    problem.c = calloc(cells, sizeof(double));
+    cache = cache_create(&config);
+    if (problem.a == NULL || problem.b == NULL || problem.c == NULL || cache == NULL) {
+        fprintf(stderr, "invalid cache config or out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < cells; i++) {
+        problem.a[i] = (double)(i % 7) - 3;
+        problem.b[i] = (double)(i % 5) - 2;
+    }
+    if (path != NULL && trace_bin_create(&writer, path, 0) != 0) {
+        return 1;
+    }
+
+    if (instrument_start(path != NULL ? &writer : NULL, cache) != 0) {
+        fprintf(stderr, "cannot start the instrumentation\n");
+        return 1;
+    }
+    start = host_time();
+    run_kernel(kernel, &problem, iterations, threads);
+    if (instrument_stop(&stats) != 0) {
+        fprintf(stderr, "%s: write failed\n", path);
+        status = 1;
+    }
+    seconds = host_time() - start;
+    if (path != NULL && trace_bin_finish(&writer) != 0) {
+        status = 1;
+    }
+
+    for (i = 0; i < cells; i++) {
+        checksum += problem.c[i];
+    }
+    printf("KERNEL: %s n %u threads %u  CACHE: offset %u index %u ways %u\n",
+           kernel_names[kernel], problem.n, threads, config.offset, config.index, config.ways);
+    printf("EVENTS: %llu from %u threads on %u rings, %llu stalls, %.1f M events/s  "
+           "CHECKSUM: %g\n", (unsigned long long)stats.events, stats.threads, stats.rings,
+           (unsigned long long)stats.stalls,
+           seconds > 0 ? stats.events / seconds / 1e6 : 0.0, checksum);
+    printf("ACCESSES: %llu  HITS: %llu  MISSES: %llu  HIT RATE: %.2f %%\n",
+           (unsigned long long)stats.accesses, (unsigned long long)stats.hits,
+           (unsigned long long)(stats.accesses - stats.hits),
+           stats.accesses ? 100.0 * stats.hits / stats.accesses : 0.0);
+
+    /* Dirty lines left at the end still cost a write-back */
+    cache_flush(cache, &cache->traffic);
+    print_traffic(&cache->traffic);
+
+    cache_destroy(cache);
+    free(problem.a);
+    free(problem.b);
+    free(problem.c);
+
+    return status;
+}
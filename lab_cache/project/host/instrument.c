@@ -0,0 +1,361 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* User includes */
+#include "instrument.h"
+
+/* Ring index mask */
+#define RING_MASK (INSTRUMENT_RING_SIZE - 1)
+
+/* Idle wait of the flusher, ns */
+#define FLUSHER_IDLE_NS 20000
+
+/* Session
+ *
+ * State of the running session, the rings are added under lock
+ */
+struct Session {
+    pthread_mutex_t lock;
+    pthread_key_t key;
+    pthread_t flusher;
+    atomic_int running;
+    atomic_int stopping;
+    atomic_uint count;
+    struct InstrumentRing *rings[INSTRUMENT_MAX_THREADS];
+    struct TraceBinWriter *writer;
+    cache_t *cache;
+    uint64_t events;
+    uint64_t accesses;
+    uint64_t hits;
+    uint32_t threads;
+    int failed;
+};
+
+/* Ring of the calling thread */
+_Thread_local struct InstrumentRing *instrument_ring;
+
+/* The one session */
+static struct Session session = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static pthread_once_t session_once = PTHREAD_ONCE_INIT;
+
+/* ring_publish
+ *
+ * Make the written events of a ring visible to the flusher
+ *
+ * @param       ring
+ *
+ * @return      void
+ */
+static void ring_publish(struct InstrumentRing *ring)
+{
+    atomic_store_explicit(&ring->tail, ring->write, memory_order_release);
+}
+
+/* ring_release
+ *
+ * Publish the events of an ending thread and free its ring for reuse
+ *
+ * @param       ring
+ *
+ * @return      void
+ */
+static void ring_release(struct InstrumentRing *ring)
+{
+    ring_publish(ring);
+    atomic_store_explicit(&ring->ended, 1, memory_order_release);
+}
+
+/* thread_exit
+ *
+ * Release the ring of an ending thread
+ *
+ * @param       arg         struct InstrumentRing
+ *
+ * @return      void
+ */
+static void thread_exit(void *arg)
+{
+    ring_release(arg);
+}
+
+/* session_key
+ *
+ * Create the key whose destructor publishes at thread exit
+ *
+ * @return      void
+ */
+static void session_key(void)
+{
+    pthread_key_create(&session.key, thread_exit);
+}
+
+/* flush_record
+ *
+ * Hand one event to the sinks
+ *
+ * @param       record
+ *
+ * @return      void
+ */
+static void flush_record(const struct TraceRecord *record)
+{
+    /* Local Variables */
+    cache_t *cache = session.cache;
+
+    if (session.writer != NULL && !session.failed && trace_bin_write(session.writer, record) != 0) {
+        session.failed = 1;
+    }
+    if (cache != NULL) {
+        uint32_t offset = cache->config.offset;
+        uint32_t address = record->address;
+        uint32_t last = (record->address + record->size - 1) >> offset;
+
+        /* One access per block */
+        while (1) {
+            session.hits += cache_access(cache, address, (access_t)record->access,
+                                         trace_block_bytes(record, address, offset)) == RESULT_HIT;
+            session.accesses++;
+            if ((address >> offset) == last) {
+                break;
+            }
+            address = ((address >> offset) + 1) << offset;
+        }
+    }
+    session.events++;
+}
+
+/* flusher_main
+ *
+ * Drain the rings by turns of up to INSTRUMENT_BATCH events each until
+ * the session stops
+ *
+ * @param       arg         unused
+ *
+ * @return      NULL
+ */
+static void *flusher_main(void *arg)
+{
+    /* Local Variables */
+    const struct timespec idle = { 0, FLUSHER_IDLE_NS };
+
+    (void)arg;
+    while (1) {
+        /* The threads publish everything before the session stops */
+        int stopping = atomic_load_explicit(&session.stopping, memory_order_acquire);
+        uint32_t count = atomic_load_explicit(&session.count, memory_order_acquire);
+        size_t drained = 0;
+        uint32_t r;
+
+        for (r = 0; r < count; r++) {
+            struct InstrumentRing *ring = session.rings[r];
+            size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            size_t end = tail - head > INSTRUMENT_BATCH ? head + INSTRUMENT_BATCH : tail;
+
+            drained += end - head;
+            for (; head != end; head++) {
+                flush_record(&ring->records[head & RING_MASK]);
+            }
+            atomic_store_explicit(&ring->head, head, memory_order_release);
+        }
+
+        if (drained == 0) {
+            if (stopping) {
+                break;
+            }
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+/* instrument_start
+ *
+ * Start a session and its flusher thread
+ *
+ * @param       writer      Created binary trace, NULL for none
+ * @param       cache       Cache the events run through, NULL for none
+ *
+ * @return      0 on success, -1 if running or out of resources
+ */
+int instrument_start(struct TraceBinWriter *writer, cache_t *cache)
+{
+    /* Local Variables */
+    int status = 0;
+
+    pthread_once(&session_once, session_key);
+    pthread_mutex_lock(&session.lock);
+    if (atomic_load_explicit(&session.running, memory_order_relaxed)) {
+        pthread_mutex_unlock(&session.lock);
+        return -1;
+    }
+    session.writer = writer;
+    session.cache = cache;
+    session.events = 0;
+    session.accesses = 0;
+    session.hits = 0;
+    session.threads = 0;
+    session.failed = 0;
+    atomic_store_explicit(&session.count, 0, memory_order_relaxed);
+    atomic_store_explicit(&session.stopping, 0, memory_order_relaxed);
+    if (pthread_create(&session.flusher, NULL, flusher_main, NULL) != 0) {
+        status = -1;
+    } else {
+        atomic_store_explicit(&session.running, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&session.lock);
+
+    return status;
+}
+
+/* instrument_stop
+ *
+ * Drain all rings, stop the flusher and free the rings. The writer is
+ * left open for the caller to finish.
+ *
+ * @param       stats       Gets the counters, may be NULL
+ *
+ * @return      0 on success, -1 if not running or the writer failed
+ */
+int instrument_stop(struct InstrumentStats *stats)
+{
+    /* Local Variables */
+    uint32_t count;
+    uint32_t r;
+
+    pthread_mutex_lock(&session.lock);
+    if (!atomic_load_explicit(&session.running, memory_order_relaxed)) {
+        pthread_mutex_unlock(&session.lock);
+        return -1;
+    }
+    atomic_store_explicit(&session.running, 0, memory_order_relaxed);
+    pthread_mutex_unlock(&session.lock);
+
+    instrument_thread_end();
+    atomic_store_explicit(&session.stopping, 1, memory_order_release);
+    pthread_join(session.flusher, NULL);
+
+    count = atomic_load_explicit(&session.count, memory_order_acquire);
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+        stats->events = session.events;
+        stats->accesses = session.accesses;
+        stats->hits = session.hits;
+        stats->threads = session.threads;
+        stats->rings = count;
+        for (r = 0; r < count; r++) {
+            stats->stalls += session.rings[r]->stalls;
+        }
+    }
+    for (r = 0; r < count; r++) {
+        free(session.rings[r]);
+        session.rings[r] = NULL;
+    }
+    atomic_store_explicit(&session.count, 0, memory_order_relaxed);
+
+    return session.failed ? -1 : 0;
+}
+
+/* instrument_thread_end
+ *
+ * Publish the events of the calling thread and detach it from its ring
+ *
+ * @return      void
+ */
+void instrument_thread_end(void)
+{
+    if (instrument_ring != NULL) {
+        ring_release(instrument_ring);
+        pthread_setspecific(session.key, NULL);
+        instrument_ring = NULL;
+    }
+}
+
+/* instrument_attach
+ *
+ * Give the calling thread the ring of an ended thread or a new one
+ *
+ * @return      ring, NULL without a session or with
+ *              INSTRUMENT_MAX_THREADS threads recording
+ */
+struct InstrumentRing *instrument_attach(void)
+{
+    /* Local Variables */
+    struct InstrumentRing *ring = NULL;
+    uint32_t count;
+    uint32_t r;
+
+    /* Untraced code runs the instrumentation without taking the lock */
+    if (!atomic_load_explicit(&session.running, memory_order_relaxed)) {
+        return NULL;
+    }
+    pthread_mutex_lock(&session.lock);
+    if (!atomic_load_explicit(&session.running, memory_order_relaxed)) {
+        pthread_mutex_unlock(&session.lock);
+        return NULL;
+    }
+    count = atomic_load_explicit(&session.count, memory_order_relaxed);
+
+    /* The events of the ended thread stay ahead of the new ones */
+    for (r = 0; r < count && ring == NULL; r++) {
+        if (atomic_load_explicit(&session.rings[r]->ended, memory_order_acquire)) {
+            ring = session.rings[r];
+            atomic_store_explicit(&ring->ended, 0, memory_order_relaxed);
+        }
+    }
+    if (ring == NULL && count < INSTRUMENT_MAX_THREADS &&
+        (ring = aligned_alloc(HOST_CACHE_LINE, sizeof(*ring))) != NULL) {
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        atomic_init(&ring->ended, 0);
+        ring->write = 0;
+        ring->cached_head = 0;
+        ring->stalls = 0;
+        session.rings[count] = ring;
+        atomic_store_explicit(&session.count, count + 1, memory_order_release);
+    }
+    if (ring != NULL) {
+        session.threads++;
+        pthread_setspecific(session.key, ring);
+        instrument_ring = ring;
+    }
+    pthread_mutex_unlock(&session.lock);
+
+    return ring;
+}
+
+/* instrument_wait
+ *
+ * Wait until a full ring has room
+ *
+ * @param       ring
+ *
+ * @return      void
+ */
+void instrument_wait(struct InstrumentRing *ring)
+{
+    ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (ring->write - ring->cached_head < INSTRUMENT_RING_SIZE) {
+        return;
+    }
+
+    /* The flusher is behind */
+    ring->stalls++;
+    ring_publish(ring);
+    do {
+        sched_yield();
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    } while (ring->write - ring->cached_head == INSTRUMENT_RING_SIZE);
+}
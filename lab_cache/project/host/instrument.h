@@ -0,0 +1,183 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Address trace instrumentation
+ *
+ * Real C code compiled on the host marks its memory accesses:
+ *
+ *   TRACE_LOAD(&b[i]);
+ *   TRACE_LOAD(&c[i]);
+ *   TRACE_STORE(&a[i]);
+ *   a[i] = b[i] + c[i];
+ *
+ * Every thread writes its events into its own single producer / single
+ * consumer ring, created on its first event. A flusher thread started
+ * by instrument_start() drains the rings into a binary trace writer
+ * and/or a cache instance. The events of one thread keep their order,
+ * the threads interleave by INSTRUMENT_BATCH events. A full ring makes
+ * its thread wait, no event is lost.
+ *
+ * The address is the low 32 bits of the pointer, accesses are up to
+ * 255 bytes. A thread must end or call instrument_thread_end() before
+ * instrument_stop(); its ring is then handed to the next new thread,
+ * so up to INSTRUMENT_MAX_THREADS threads may record at once. With
+ * INSTRUMENT 0 the macros compile to nothing.
+ */
+
+#ifndef INSTRUMENT_H_
+#define INSTRUMENT_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* User includes */
+#include "parallel.h"
+
+/* Compile the instrumentation in, 0 to drop it */
+#ifndef INSTRUMENT
+#define INSTRUMENT 1
+#endif
+
+/* Most threads with a ring per session */
+#define INSTRUMENT_MAX_THREADS 64
+
+/* Events per ring, power of two */
+#define INSTRUMENT_RING_SIZE (1u << 16)
+
+/* Events a thread writes before publishing them */
+#define INSTRUMENT_BATCH 256
+
+/* InstrumentRing
+ *
+ * Single producer / single consumer ring of one thread. head is
+ * written by the flusher, tail by the thread, each on its own cache
+ * line.
+ */
+struct InstrumentRing {
+    _Alignas(HOST_CACHE_LINE) atomic_size_t head;
+    _Alignas(HOST_CACHE_LINE) atomic_size_t tail;
+    _Alignas(HOST_CACHE_LINE) size_t write;
+    size_t cached_head;
+    uint64_t stalls;                    /* Waits on a full ring */
+    atomic_int ended;                   /* Thread gone, ring free to reuse */
+    struct TraceRecord records[INSTRUMENT_RING_SIZE];
+};
+
+/* InstrumentStats
+ *
+ * Counters of a session
+ */
+struct InstrumentStats {
+    uint64_t events;
+    uint64_t accesses;                  /* Block accesses of the cache */
+    uint64_t hits;
+    uint64_t stalls;
+    uint32_t threads;                   /* Threads that recorded events */
+    uint32_t rings;
+};
+
+/* Ring of the calling thread, NULL before its first event */
+extern _Thread_local struct InstrumentRing *instrument_ring;
+
+/* instrument_start
+ *
+ * Start a session and its flusher thread
+ *
+ * @param       writer      Created binary trace, NULL for none
+ * @param       cache       Cache the events run through, NULL for none
+ *
+ * @return      0 on success, -1 if running or out of resources
+ */
+int instrument_start(struct TraceBinWriter *writer, cache_t *cache);
+
+/* instrument_stop
+ *
+ * Drain all rings, stop the flusher and free the rings. The writer is
+ * left open for the caller to finish.
+ *
+ * @param       stats       Gets the counters, may be NULL
+ *
+ * @return      0 on success, -1 if not running or the writer failed
+ */
+int instrument_stop(struct InstrumentStats *stats);
+
+/* instrument_thread_end
+ *
+ * Publish the events of the calling thread and detach it from its ring
+ *
+ * @return      void
+ */
+void instrument_thread_end(void);
+
+/* instrument_attach
+ *
+ * Create the ring of the calling thread
+ *
+ * @return      ring, NULL without a session or with
+ *              INSTRUMENT_MAX_THREADS threads recording
+ */
+struct InstrumentRing *instrument_attach(void);
+
+/* instrument_wait
+ *
+ * Wait until a full ring has room
+ *
+ * @param       ring
+ *
+ * @return      void
+ */
+void instrument_wait(struct InstrumentRing *ring);
+
+/* instrument_event
+ *
+ * Record one access of the calling thread
+ *
+ * @param       address
+ * @param       size        Bytes, at most 255
+ * @param       access
+ *
+ * @return      void
+ */
+static inline void instrument_event(const volatile void *address, uint32_t size, access_t access)
+{
+    /* Local Variables */
+    struct InstrumentRing *ring = instrument_ring;
+    struct TraceRecord *slot;
+
+    if (__builtin_expect(ring == NULL, 0)) {
+        ring = instrument_attach();
+        if (ring == NULL) {
+            return;
+        }
+    }
+    if (__builtin_expect(ring->write - ring->cached_head == INSTRUMENT_RING_SIZE, 0)) {
+        instrument_wait(ring);
+    }
+
+    slot = &ring->records[ring->write & (INSTRUMENT_RING_SIZE - 1)];
+    slot->address = (uint32_t)(uintptr_t)address;
+    slot->access = (uint8_t)access;
+    slot->size = (uint8_t)size;
+    if (++ring->write % INSTRUMENT_BATCH == 0) {
+        atomic_store_explicit(&ring->tail, ring->write, memory_order_release);
+    }
+}
+
+/* Instrumentation macros */
+#if INSTRUMENT
+#define TRACE_SIZE(ptr)  (sizeof(*(ptr)) < 255 ? (uint32_t)sizeof(*(ptr)) : 255u)
+#define TRACE_LOAD(ptr)  instrument_event((ptr), TRACE_SIZE(ptr), READ_ACCESS)
+#define TRACE_STORE(ptr) instrument_event((ptr), TRACE_SIZE(ptr), WRITE_ACCESS)
+#else
+#define TRACE_LOAD(ptr)  ((void)0)
+#define TRACE_STORE(ptr) ((void)0)
+#endif
+
+#endif
+/* INSTRUMENT_H_ */
@@ -0,0 +1,464 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "kernels.h"
+#include "config.h"
+
+static const char *kernel_names[KERNEL_COUNT] = {
+    "abc-columns", "abc-rows", "abc-tiled", "transpose", "transpose-tiled",
+    "matmul-ijk", "matmul-ikj", "matmul-blocked", "stencil", "list"
+};
+
+/* Arrays
+ *
+ * Address computation of a kernel run
+ */
+struct Arrays {
+    uint32_t stride;            /* Bytes from one array to the next */
+    uint32_t item_size;
+    uint32_t rows;
+    uint32_t columns;
+    uint32_t tile;
+};
+
+/* kernel_params_default
+ *
+ * Fill the params with the array params of config.h
+ *
+ * @param       params
+ *
+ * @return      void
+ */
+void kernel_params_default(struct KernelParams *params)
+{
+    params->rows = ARRAY_ROWS;
+    params->columns = ARRAY_COLUMNS;
+    params->item_size = ITEM_SIZE;
+    params->tile = TILE_SIZE;
+    params->array_padding = ARRAY_PADDING;
+    params->seed = 1;
+}
+
+/* kernel_name
+ *
+ * Name of a kernel
+ *
+ * @param       kernel
+ *
+ * @return      name
+ */
+const char *kernel_name(kernel_t kernel)
+{
+    return kernel < KERNEL_COUNT ? kernel_names[kernel] : "unknown";
+}
+
+/* kernel_find
+ *
+ * Look up a kernel by name
+ *
+ * @param       name
+ *
+ * @return      kernel, KERNEL_COUNT if unknown
+ */
+kernel_t kernel_find(const char *name)
+{
+    /* Local Variables */
+    uint32_t kernel;
+
+    for (kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+        if (strcmp(name, kernel_names[kernel]) == 0) {
+            break;
+        }
+    }
+
+    return (kernel_t)kernel;
+}
+
+/* kernel_sink_init
+ *
+ * Initialize a sink
+ *
+ * @param       sink
+ * @param       cache       Cache to simulate on, or NULL
+ * @param       trace       Trace to append to, or NULL
+ * @param       size        Bytes of every access
+ *
+ * @return      void
+ */
+void kernel_sink_init(struct KernelSink *sink, cache_t *cache, struct Trace *trace, uint8_t size)
+{
+    sink->cache = cache;
+    sink->trace = trace;
+    sink->accesses = 0;
+    sink->hits = 0;
+    sink->failed = 0;
+    sink->size = size;
+    sink->count = 0;
+}
+
+/* kernel_sink_flush
+ *
+ * Simulate the collected accesses
+ *
+ * @param       sink
+ *
+ * @return      void
+ */
+void kernel_sink_flush(struct KernelSink *sink)
+{
+    /* Local Variables */
+    uint32_t i;
+
+    if (sink->cache != NULL) {
+        sink->hits += cache_access_batch(sink->cache, sink->addresses, sink->types, sink->size,
+                                         sink->count, NULL);
+    }
+    if (sink->trace != NULL) {
+        for (i = 0; i < sink->count; i++) {
+            if (trace_append(sink->trace, (access_t)sink->types[i], sink->addresses[i], sink->size) != 0) {
+                sink->failed = 1;
+            }
+        }
+    }
+    sink->accesses += sink->count;
+    sink->count = 0;
+}
+
+/* emit
+ *
+ * Collect one access, simulate the batch once it is full
+ *
+ * @param       sink
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       address
+ *
+ * @return      void
+ */
+static inline void emit(struct KernelSink *sink, access_t access, uint32_t address)
+{
+    sink->addresses[sink->count] = address;
+    sink->types[sink->count] = (uint8_t)access;
+    if (++sink->count == KERNEL_BATCH) {
+        kernel_sink_flush(sink);
+    }
+}
+
+/* at
+ *
+ * Address of an item of a row-major array
+ *
+ * @param       arrays
+ * @param       array       ARRAY_INDEX_A, _B or _C
+ * @param       row
+ * @param       col
+ * @param       width       Items per row
+ *
+ * @return      address
+ */
+static inline uint32_t at(const struct Arrays *arrays, array_index_t array, uint32_t row, uint32_t col,
+                          uint32_t width)
+{
+    return array * arrays->stride + (row * width + col) * arrays->item_size;
+}
+
+/* abc
+ *
+ * a[i, j] = b[i, j] + c[i, j] in the order of a_equals_b_plus_c()
+ *
+ * @param       arrays
+ * @param       sink
+ * @param       i
+ * @param       j
+ *
+ * @return      void
+ */
+static inline void abc(const struct Arrays *arrays, struct KernelSink *sink, uint32_t i, uint32_t j)
+{
+    emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i, j, arrays->columns));
+    emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_C, i, j, arrays->columns));
+    emit(sink, WRITE_ACCESS, at(arrays, ARRAY_INDEX_A, i, j, arrays->columns));
+}
+
+/* run_abc
+ *
+ * a = b + c in column, row or tile order
+ *
+ * @param       arrays
+ * @param       sink
+ * @param       kernel
+ *
+ * @return      void
+ */
+static void run_abc(const struct Arrays *arrays, struct KernelSink *sink, kernel_t kernel)
+{
+    /* Local Variables */
+    uint32_t rows = arrays->rows;
+    uint32_t columns = arrays->columns;
+    uint32_t tile = arrays->tile;
+    uint32_t ii;
+    uint32_t jj;
+    uint32_t i;
+    uint32_t j;
+
+    switch (kernel) {
+        case KERNEL_ABC_COLUMNS:
+            for (j = 0; j < columns; j++) {
+                for (i = 0; i < rows; i++) {
+                    abc(arrays, sink, i, j);
+                }
+            }
+            break;
+        case KERNEL_ABC_ROWS:
+            for (i = 0; i < rows; i++) {
+                for (j = 0; j < columns; j++) {
+                    abc(arrays, sink, i, j);
+                }
+            }
+            break;
+        default:
+            for (ii = 0; ii < rows; ii += tile) {
+                for (jj = 0; jj < columns; jj += tile) {
+                    for (i = ii; i < ii + tile && i < rows; i++) {
+                        for (j = jj; j < jj + tile && j < columns; j++) {
+                            abc(arrays, sink, i, j);
+                        }
+                    }
+                }
+            }
+            break;
+    }
+}
+
+/* run_transpose
+ *
+ * a[j, i] = b[i, j], a has columns rows of rows items
+ *
+ * @param       arrays
+ * @param       sink
+ * @param       tiled       Walk tile x tile blocks
+ *
+ * @return      void
+ */
+static void run_transpose(const struct Arrays *arrays, struct KernelSink *sink, int tiled)
+{
+    /* Local Variables */
+    uint32_t rows = arrays->rows;
+    uint32_t columns = arrays->columns;
+    uint32_t tile = tiled ? arrays->tile : (rows > columns ? rows : columns);
+    uint32_t ii;
+    uint32_t jj;
+    uint32_t i;
+    uint32_t j;
+
+    for (ii = 0; ii < rows; ii += tile) {
+        for (jj = 0; jj < columns; jj += tile) {
+            for (i = ii; i < ii + tile && i < rows; i++) {
+                for (j = jj; j < jj + tile && j < columns; j++) {
+                    emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i, j, columns));
+                    emit(sink, WRITE_ACCESS, at(arrays, ARRAY_INDEX_A, j, i, rows));
+                }
+            }
+        }
+    }
+}
+
+/* run_matmul
+ *
+ * a = b * c with b rows x n, c n x n and a rows x n, n = columns. The
+ * ijk order keeps the sum in a register, ikj and blocked keep b[i, k].
+ *
+ * @param       arrays
+ * @param       sink
+ * @param       kernel
+ *
+ * @return      void
+ */
+static void run_matmul(const struct Arrays *arrays, struct KernelSink *sink, kernel_t kernel)
+{
+    /* Local Variables */
+    uint32_t rows = arrays->rows;
+    uint32_t n = arrays->columns;
+    uint32_t tile = kernel == KERNEL_MATMUL_BLOCKED ? arrays->tile : (rows > n ? rows : n);
+    uint32_t ii;
+    uint32_t jj;
+    uint32_t kk;
+    uint32_t i;
+    uint32_t j;
+    uint32_t k;
+
+    if (kernel == KERNEL_MATMUL_IJK) {
+        for (i = 0; i < rows; i++) {
+            for (j = 0; j < n; j++) {
+                for (k = 0; k < n; k++) {
+                    emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i, k, n));
+                    emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_C, k, j, n));
+                }
+                emit(sink, WRITE_ACCESS, at(arrays, ARRAY_INDEX_A, i, j, n));
+            }
+        }
+        return;
+    }
+
+    /* ikj, the unblocked one is a single tile */
+    for (ii = 0; ii < rows; ii += tile) {
+        for (kk = 0; kk < n; kk += tile) {
+            for (jj = 0; jj < n; jj += tile) {
+                for (i = ii; i < ii + tile && i < rows; i++) {
+                    for (k = kk; k < kk + tile && k < n; k++) {
+                        emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i, k, n));
+                        for (j = jj; j < jj + tile && j < n; j++) {
+                            emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_A, i, j, n));
+                            emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_C, k, j, n));
+                            emit(sink, WRITE_ACCESS, at(arrays, ARRAY_INDEX_A, i, j, n));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* run_stencil
+ *
+ * a[i, j] = b[i - 1, j] + b[i, j - 1] + b[i, j] + b[i, j + 1]
+ * + b[i + 1, j] for the interior items
+ *
+ * @param       arrays
+ * @param       sink
+ *
+ * @return      void
+ */
+static void run_stencil(const struct Arrays *arrays, struct KernelSink *sink)
+{
+    /* Local Variables */
+    uint32_t columns = arrays->columns;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 1; i + 1 < arrays->rows; i++) {
+        for (j = 1; j + 1 < columns; j++) {
+            emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i - 1, j, columns));
+            emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i, j - 1, columns));
+            emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i, j, columns));
+            emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i, j + 1, columns));
+            emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, i + 1, j, columns));
+            emit(sink, WRITE_ACCESS, at(arrays, ARRAY_INDEX_A, i, j, columns));
+        }
+    }
+}
+
+/* run_list
+ *
+ * Visit every item of b once as a node of a linked list. The nodes are
+ * linked in a random order drawn from the seed, seed 0 links them in
+ * address order.
+ *
+ * @param       arrays
+ * @param       sink
+ * @param       seed
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int run_list(const struct Arrays *arrays, struct KernelSink *sink, uint32_t seed)
+{
+    /* Local Variables */
+    uint32_t nodes = arrays->rows * arrays->columns;
+    uint32_t *order = malloc(nodes * sizeof(*order));
+    uint32_t i;
+
+    if (order == NULL) {
+        return -1;
+    }
+    for (i = 0; i < nodes; i++) {
+        order[i] = i;
+    }
+
+    /* Fisher-Yates shuffle with an xorshift generator */
+    for (i = nodes; seed != 0 && i > 1; i--) {
+        uint32_t j;
+        uint32_t node;
+
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        j = seed % i;
+        node = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = node;
+    }
+
+    for (i = 0; i < nodes; i++) {
+        emit(sink, READ_ACCESS, at(arrays, ARRAY_INDEX_B, 0, order[i], 0));
+    }
+    free(order);
+
+    return 0;
+}
+
+/* kernel_run
+ *
+ * Emit all accesses of a kernel into a sink and flush it
+ *
+ * @param       kernel
+ * @param       params
+ * @param       sink
+ *
+ * @return      0 on success, -1 on invalid params or if the trace
+ *              is out of memory
+ */
+int kernel_run(kernel_t kernel, const struct KernelParams *params, struct KernelSink *sink)
+{
+    /* Local Variables */
+    struct Arrays arrays;
+    uint64_t stride;
+    uint32_t longer = params->rows > params->columns ? params->rows : params->columns;
+    int status = 0;
+
+    /* Room for the larger of rows x columns and columns x columns */
+    stride = (uint64_t)longer * params->columns * params->item_size + params->array_padding;
+    if (kernel >= KERNEL_COUNT || params->rows == 0 || params->columns == 0
+        || params->item_size == 0 || params->tile == 0 || ARRAY_COUNT * stride > UINT32_MAX) {
+        return -1;
+    }
+    arrays.stride = (uint32_t)stride;
+    arrays.item_size = params->item_size;
+    arrays.rows = params->rows;
+    arrays.columns = params->columns;
+    arrays.tile = params->tile;
+
+    switch (kernel) {
+        case KERNEL_ABC_COLUMNS:
+        case KERNEL_ABC_ROWS:
+        case KERNEL_ABC_TILED:
+            run_abc(&arrays, sink, kernel);
+            break;
+        case KERNEL_TRANSPOSE:
+        case KERNEL_TRANSPOSE_TILED:
+            run_transpose(&arrays, sink, kernel == KERNEL_TRANSPOSE_TILED);
+            break;
+        case KERNEL_MATMUL_IJK:
+        case KERNEL_MATMUL_IKJ:
+        case KERNEL_MATMUL_BLOCKED:
+            run_matmul(&arrays, sink, kernel);
+            break;
+        case KERNEL_STENCIL:
+            run_stencil(&arrays, sink);
+            break;
+        default:
+            status = run_list(&arrays, sink, params->seed);
+            break;
+    }
+    kernel_sink_flush(sink);
+
+    return status != 0 || sink->failed ? -1 : 0;
+}
@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Trace generating kernels
+ *
+ * Loop nests beyond the a = b + c kernel of main.c. Arrays A, B and C
+ * are row-major with rows x columns items, placed back to back like
+ * get_item_address() does with the config.h defaults, optionally with
+ * padding after every array. The C operand of matrix multiply is
+ * columns x columns, every array gets room for the larger of the two.
+ *
+ * The kernels emit their accesses into a KernelSink, which collects
+ * them and hands them to cache_access_batch() and/or appends them to a
+ * trace.
+ */
+
+#ifndef KERNELS_H_
+#define KERNELS_H_
+
+/* User includes */
+#include "trace.h"
+
+/* Accesses a sink collects before simulating them */
+#define KERNEL_BATCH 4096
+
+/* Kernels */
+typedef enum {
+    KERNEL_ABC_COLUMNS = 0,     /* a = b + c, columns outer as in main.c */
+    KERNEL_ABC_ROWS,            /* a = b + c, rows outer */
+    KERNEL_ABC_TILED,           /* a = b + c, tile x tile blocks */
+    KERNEL_TRANSPOSE,           /* a = transpose(b) */
+    KERNEL_TRANSPOSE_TILED,     /* a = transpose(b), tile x tile blocks */
+    KERNEL_MATMUL_IJK,          /* a = b * c, dot product inner loop */
+    KERNEL_MATMUL_IKJ,          /* a = b * c, row update inner loop */
+    KERNEL_MATMUL_BLOCKED,      /* a = b * c, ikj on tile x tile blocks */
+    KERNEL_STENCIL,             /* a = 5 point stencil of b, interior */
+    KERNEL_LIST,                /* Walk of a randomly linked list in b */
+    KERNEL_COUNT
+} kernel_t;
+
+/* KernelParams
+ *
+ * Problem size of a kernel
+ */
+struct KernelParams {
+    uint16_t rows;              /* ARRAY_ROWS */
+    uint16_t columns;           /* ARRAY_COLUMNS */
+    uint8_t item_size;          /* ITEM_SIZE */
+    uint16_t tile;              /* Tile edge in items */
+    uint32_t array_padding;     /* Bytes after every array */
+    uint32_t seed;              /* Order of the linked list */
+};
+
+/* KernelSink
+ *
+ * Receiver of the accesses of a kernel
+ */
+struct KernelSink {
+    cache_t *cache;             /* Simulated in batches, or NULL */
+    struct Trace *trace;        /* Appended to, or NULL */
+    uint64_t accesses;
+    uint64_t hits;
+    int failed;                 /* Appending to the trace failed */
+    uint8_t size;
+    uint32_t count;
+    uint32_t addresses[KERNEL_BATCH];
+    uint8_t types[KERNEL_BATCH];
+};
+
+/* kernel_params_default
+ *
+ * Fill the params with the array params of config.h
+ *
+ * @param       params
+ *
+ * @return      void
+ */
+void kernel_params_default(struct KernelParams *params);
+
+/* kernel_name
+ *
+ * Name of a kernel
+ *
+ * @param       kernel
+ *
+ * @return      name
+ */
+const char *kernel_name(kernel_t kernel);
+
+/* kernel_find
+ *
+ * Look up a kernel by name
+ *
+ * @param       name
+ *
+ * @return      kernel, KERNEL_COUNT if unknown
+ */
+kernel_t kernel_find(const char *name);
+
+/* kernel_sink_init
+ *
+ * Initialize a sink
+ *
+ * @param       sink
+ * @param       cache       Cache to simulate on, or NULL
+ * @param       trace       Trace to append to, or NULL
+ * @param       size        Bytes of every access
+ *
+ * @return      void
+ */
+void kernel_sink_init(struct KernelSink *sink, cache_t *cache, struct Trace *trace, uint8_t size);
+
+/* kernel_sink_flush
+ *
+ * Simulate the collected accesses
+ *
+ * @param       sink
+ *
+ * @return      void
+ */
+void kernel_sink_flush(struct KernelSink *sink);
+
+/* kernel_run
+ *
+ * Emit all accesses of a kernel into a sink and flush it
+ *
+ * @param       kernel
+ * @param       params
+ * @param       sink
+ *
+ * @return      0 on success, -1 on invalid params or if the trace
+ *              is out of memory
+ */
+int kernel_run(kernel_t kernel, const struct KernelParams *params, struct KernelSink *sink);
+
+#endif
+/* KERNELS_H_ */
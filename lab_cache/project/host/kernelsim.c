@@ -0,0 +1,211 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, kernel library simulator
+ * --
+ * -- Usage       : kernelsim [-k kernel|all] [-m rows] [-n columns]
+ * --                         [-i item size] [-t tile] [-p padding]
+ * --                         [-l seed] [-o offset] [-s index]
+ * --                         [-w ways] [-r replacement] [-T file]
+ * --               Runs the kernels of kernels.h on an empty cache
+ * --               through the batch path and prints their misses.
+ * --               The problem size defaults to the array params and
+ * --               the cache to config.h. -T writes the accesses of a
+ * --               single kernel to a binary trace.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace_bin.h"
+#include "kernels.h"
+#include "config.h"
+
+/* usage
+ *
+ * Print the command line help
+ *
+ * @param       name        Program name
+ *
+ * @return      exit code
+ */
+static int usage(const char *name)
+{
+    /* Local Variables */
+    uint32_t kernel;
+
+    fprintf(stderr, "usage: %s [-k kernel|all] [-m rows] [-n columns] [-i item size] [-t tile] "
+            "[-p padding] [-l seed] [-o offset] [-s index] [-w ways] [-r replacement] [-T file]\n"
+            "kernels:", name);
+    for (kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+        fprintf(stderr, " %s", kernel_name((kernel_t)kernel));
+    }
+    fprintf(stderr, "\n");
+
+    return 2;
+}
+
+/* write_trace
+ *
+ * Write a trace to a binary file
+ *
+ * @param       path
+ * @param       trace
+ *
+ * @return      0 on success, -1 on error
+ */
+static int write_trace(const char *path, const struct Trace *trace)
+{
+    /* Local Variables */
+    struct TraceBinWriter writer;
+    size_t i;
+
+    if (trace_bin_create(&writer, path, 0) != 0) {
+        return -1;
+    }
+    for (i = 0; i < trace->count; i++) {
+        if (trace_bin_write(&writer, &trace->records[i]) != 0) {
+            trace_bin_finish(&writer);
+            return -1;
+        }
+    }
+
+    return trace_bin_finish(&writer);
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static struct KernelSink sink;
+    struct KernelParams params;
+    struct CacheConfig config;
+    struct Trace trace;
+    cache_t *cache;
+    const char *path = NULL;
+    uint32_t selected = KERNEL_COUNT;
+    uint32_t kernel;
+    uint64_t accesses = 0;
+    double start;
+    double seconds = 0.0;
+    int option;
+
+    kernel_params_default(&params);
+    config.offset = OFFSET;
+    config.index = INDEX;
+    config.ways = WAYS;
+    config.replacement = REPLACEMENT;
+    config.write_policy = WRITE_POLICY;
+    config.write_miss = WRITE_MISS;
+    config.index_function = INDEX_FUNCTION;
+
+    while ((option = getopt(argc, argv, "k:m:n:i:t:p:l:o:s:w:r:T:")) != -1) {
+        switch (option) {
+            case 'k':
+                selected = strcmp(optarg, "all") == 0 ? KERNEL_COUNT : kernel_find(optarg);
+                if (strcmp(optarg, "all") != 0 && selected == KERNEL_COUNT) {
+                    return usage(argv[0]);
+                }
+                break;
+            case 'm':
+                params.rows = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                params.columns = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                params.item_size = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                params.tile = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                params.array_padding = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                params.seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                config.offset = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                config.index = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                config.ways = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                config.replacement = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'T':
+                path = optarg;
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if (optind != argc || (path != NULL && selected == KERNEL_COUNT)) {
+        return usage(argv[0]);
+    }
+
+    cache = cache_create(&config);
+    if (cache == NULL) {
+        fprintf(stderr, "invalid cache config or out of memory\n");
+        return 1;
+    }
+    trace_init(&trace);
+
+    printf("CACHE: offset %u index %u ways %u replacement %u  ARRAYS: %u x %u items of %u B "
+           "tile %u padding %u\n", config.offset, config.index, config.ways, config.replacement,
+           params.rows, params.columns, params.item_size, params.tile, params.array_padding);
+    printf("%-16s %12s %12s %9s %14s\n", "KERNEL", "ACCESSES", "MISSES", "MISS %", "TRAFFIC B");
+
+    for (kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+        struct MemoryTraffic *traffic = &cache->traffic;
+
+        if (selected != KERNEL_COUNT && kernel != selected) {
+            continue;
+        }
+
+        cache_reset(cache);
+        kernel_sink_init(&sink, cache, path != NULL ? &trace : NULL, params.item_size);
+        start = host_time();
+        if (kernel_run((kernel_t)kernel, &params, &sink) != 0) {
+            fprintf(stderr, "%s: invalid params or out of memory\n", kernel_name((kernel_t)kernel));
+            trace_free(&trace);
+            cache_destroy(cache);
+            return 1;
+        }
+        seconds += host_time() - start;
+        accesses += sink.accesses;
+
+        /* Dirty lines left at the end still cost a write-back */
+        cache_flush(cache, traffic);
+        printf("%-16s %12llu %12llu %9.4f %14llu\n", kernel_name((kernel_t)kernel),
+               (unsigned long long)sink.accesses, (unsigned long long)(sink.accesses - sink.hits),
+               sink.accesses ? 100.0 * (sink.accesses - sink.hits) / sink.accesses : 0.0,
+               (unsigned long long)(traffic->fill_bytes + traffic->write_through_bytes
+                                    + traffic->writeback_bytes));
+    }
+    print_throughput(accesses, seconds);
+
+    if (path != NULL && write_trace(path, &trace) != 0) {
+        fprintf(stderr, "%s: write error\n", path);
+        trace_free(&trace);
+        cache_destroy(cache);
+        return 1;
+    }
+    trace_free(&trace);
+    cache_destroy(cache);
+
+    return 0;
+}
@@ -0,0 +1,372 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, array layout explorer
+ * --
+ * -- Usage       : layoutsim [-o offset] [-s index] [-w ways]
+ * --                         [-r replacement] [-j workers] [-n rows]
+ * --               Runs the a = b + c kernel of main.c with every
+ * --               array layout and a range of paddings on an empty
+ * --               cache, on all cores. Prints the layouts with the
+ * --               fewest misses and the CONFIG of the best one.
+ * --               The geometry and replacement (0 LRU .. 4 SRRIP)
+ * --               default to config.h, -n sets the printed rows
+ * --               (default 10).
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "parallel.h"
+#include "config.h"
+
+/* Accesses of the kernel, b and c read, a written per item */
+#define SWEEP_ACCESSES (ARRAY_COUNT * ARRAY_ROWS * ARRAY_COLUMNS)
+
+/* Most array paddings tried per layout */
+#define SWEEP_MAX_PADDINGS 64
+
+static const char *layout_names[] = { "row-major", "column-major", "interleaved", "tiled", "morton" };
+
+/* Candidate
+ *
+ * One layout and its result
+ */
+struct Candidate {
+    struct ArrayLayout layout;
+    uint64_t misses;
+    uint64_t traffic;           /* Memory bytes including the final flush */
+};
+
+/* SweepWorker
+ *
+ * Cache and kernel buffers owned by one thread
+ */
+struct SweepWorker {
+    cache_t *cache;
+    uint32_t *addresses;
+    uint8_t *accesses;
+    int failed;
+};
+
+/* Sweep
+ *
+ * All candidates and the per-thread state
+ */
+struct Sweep {
+    struct CacheConfig config;
+    struct Candidate *candidates;
+    uint32_t count;
+    uint32_t capacity;
+    struct SweepWorker worker[PARALLEL_MAX_WORKERS];
+};
+
+/* sweep_add
+ *
+ * Append a candidate
+ *
+ * @param       sweep
+ * @param       type        ARRAY_LAYOUT_*
+ * @param       tile
+ * @param       array_padding
+ * @param       row_padding
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int sweep_add(struct Sweep *sweep, uint8_t type, uint8_t tile, uint32_t array_padding,
+                     uint32_t row_padding)
+{
+    /* Local Variables */
+    struct Candidate *candidate;
+
+    if (sweep->count == sweep->capacity) {
+        uint32_t capacity = sweep->capacity ? 2 * sweep->capacity : 256;
+        struct Candidate *candidates = realloc(sweep->candidates, capacity * sizeof(*candidates));
+
+        if (candidates == NULL) {
+            return -1;
+        }
+        sweep->candidates = candidates;
+        sweep->capacity = capacity;
+    }
+
+    candidate = &sweep->candidates[sweep->count++];
+    memset(candidate, 0, sizeof(*candidate));
+    candidate->layout.type = type;
+    candidate->layout.tile = tile;
+    candidate->layout.array_padding = array_padding;
+    candidate->layout.row_padding = row_padding;
+
+    return 0;
+}
+
+/* sweep_build
+ *
+ * Enumerate the candidates. Array paddings run in whole lines up to one
+ * way, after which the set mapping repeats, struct paddings of the
+ * interleaved layout in items up to one line. Row paddings are 0 and
+ * powers of two items up to one way, tiles powers of two up to the
+ * longer array edge.
+ *
+ * @param       sweep
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int sweep_build(struct Sweep *sweep)
+{
+    /* Local Variables */
+    uint32_t line = 1u << sweep->config.offset;
+    uint32_t way = line << sweep->config.index;
+    uint32_t step = line;
+    uint32_t edge = ARRAY_ROWS > ARRAY_COLUMNS ? ARRAY_ROWS : ARRAY_COLUMNS;
+    uint32_t type;
+    uint32_t pad;
+    uint32_t row;
+    uint32_t tile;
+    int status = 0;
+
+    while (way / step > SWEEP_MAX_PADDINGS) {
+        step *= 2;
+    }
+
+    for (type = 0; type <= ARRAY_LAYOUT_MORTON; type++) {
+        uint32_t pad_step = type == ARRAY_LAYOUT_INTERLEAVED ? ITEM_SIZE : step;
+        uint32_t pad_end = type == ARRAY_LAYOUT_INTERLEAVED ? line : way;
+
+        for (pad = 0; pad <= pad_end; pad += pad_step) {
+            switch (type) {
+                case ARRAY_LAYOUT_TILED:
+                    for (tile = 2; tile <= edge && tile <= 128; tile *= 2) {
+                        status |= sweep_add(sweep, (uint8_t)type, (uint8_t)tile, pad, 0);
+                    }
+                    break;
+                case ARRAY_LAYOUT_MORTON:
+                    status |= sweep_add(sweep, (uint8_t)type, 1, pad, 0);
+                    break;
+                default:
+                    status |= sweep_add(sweep, (uint8_t)type, 1, pad, 0);
+                    for (row = ITEM_SIZE; row <= way; row *= 2) {
+                        status |= sweep_add(sweep, (uint8_t)type, 1, pad, row);
+                    }
+                    break;
+            }
+        }
+    }
+
+    return status;
+}
+
+/* sweep_run
+ *
+ * Simulate one candidate, parallel_for() callback
+ *
+ * @param       context     struct Sweep
+ * @param       item        Candidate
+ * @param       worker
+ *
+ * @return      void
+ */
+static void sweep_run(void *context, uint32_t item, uint32_t worker)
+{
+    /* Local Variables */
+    struct Sweep *sweep = context;
+    struct SweepWorker *state = &sweep->worker[worker];
+    struct Candidate *candidate = &sweep->candidates[item];
+    struct MemoryTraffic *traffic;
+    size_t count = 0;
+    uint16_t i;
+    uint16_t j;
+
+    if (state->cache == NULL) {
+        state->cache = cache_create(&sweep->config);
+        state->addresses = malloc(SWEEP_ACCESSES * sizeof(*state->addresses));
+        state->accesses = malloc(SWEEP_ACCESSES * sizeof(*state->accesses));
+        if (state->cache == NULL || state->addresses == NULL || state->accesses == NULL) {
+            state->failed = 1;
+            return;
+        }
+    }
+    if (state->failed) {
+        return;
+    }
+
+    /* Same order as run_simulation() and a_equals_b_plus_c() */
+    for (j = 0; j < ARRAY_COLUMNS; j++) {
+        for (i = 0; i < ARRAY_ROWS; i++) {
+            state->addresses[count] = layout_item_address(&candidate->layout, ARRAY_INDEX_B, i, j);
+            state->accesses[count++] = READ_ACCESS;
+            state->addresses[count] = layout_item_address(&candidate->layout, ARRAY_INDEX_C, i, j);
+            state->accesses[count++] = READ_ACCESS;
+            state->addresses[count] = layout_item_address(&candidate->layout, ARRAY_INDEX_A, i, j);
+            state->accesses[count++] = WRITE_ACCESS;
+        }
+    }
+
+    cache_reset(state->cache);
+    candidate->misses = count - cache_access_batch(state->cache, state->addresses, state->accesses,
+                                                   ITEM_SIZE, count, NULL);
+    traffic = &state->cache->traffic;
+    cache_flush(state->cache, traffic);
+    candidate->traffic = traffic->fill_bytes + traffic->write_through_bytes + traffic->writeback_bytes;
+}
+
+/* compare_candidates
+ *
+ * Order by misses, then traffic, then memory footprint
+ *
+ * @param       a
+ * @param       b
+ *
+ * @return      qsort order
+ */
+static int compare_candidates(const void *a, const void *b)
+{
+    /* Local Variables */
+    const struct Candidate *x = a;
+    const struct Candidate *y = b;
+    uint32_t x_size = layout_size(&x->layout);
+    uint32_t y_size = layout_size(&y->layout);
+
+    if (x->misses != y->misses) {
+        return x->misses < y->misses ? -1 : 1;
+    }
+    if (x->traffic != y->traffic) {
+        return x->traffic < y->traffic ? -1 : 1;
+    }
+    if (x_size != y_size) {
+        return x_size < y_size ? -1 : 1;
+    }
+
+    return x < y ? -1 : x > y;
+}
+
+/* print_candidate
+ *
+ * Print one result row
+ *
+ * @param       name        Rank or label
+ * @param       candidate
+ *
+ * @return      void
+ */
+static void print_candidate(const char *name, const struct Candidate *candidate)
+{
+    /* Local Variables */
+    const struct ArrayLayout *layout = &candidate->layout;
+
+    printf("%-9s %-13s %5u %10u %10u %10u %10llu %8.2f %12llu\n", name, layout_names[layout->type],
+           layout->tile, layout->array_padding, layout->row_padding, layout_size(layout),
+           (unsigned long long)candidate->misses, 100.0 * candidate->misses / SWEEP_ACCESSES,
+           (unsigned long long)candidate->traffic);
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static struct Sweep sweep;
+    struct Candidate baseline;
+    uint32_t workers = 0;
+    uint32_t rows = 10;
+    uint32_t used;
+    uint32_t i;
+    double start;
+    double seconds;
+    char rank[16];
+    int option;
+
+    sweep.config.offset = OFFSET;
+    sweep.config.index = INDEX;
+    sweep.config.ways = WAYS;
+    sweep.config.replacement = REPLACEMENT;
+    sweep.config.write_policy = WRITE_POLICY;
+    sweep.config.write_miss = WRITE_MISS;
+    sweep.config.index_function = INDEX_FUNCTION;
+
+    while ((option = getopt(argc, argv, "o:s:w:r:j:n:")) != -1) {
+        switch (option) {
+            case 'o':
+                sweep.config.offset = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                sweep.config.index = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                sweep.config.ways = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                sweep.config.replacement = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'j':
+                workers = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                rows = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind != argc) {
+        fprintf(stderr, "usage: %s [-o offset] [-s index] [-w ways] [-r replacement] "
+                "[-j workers] [-n rows]\n", argv[0]);
+        return 2;
+    }
+    if (!cache_config_valid(&sweep.config)) {
+        fprintf(stderr, "invalid cache config\n");
+        return 1;
+    }
+
+    /* The config.h layout goes first, so it is the baseline */
+    if (sweep_add(&sweep, ARRAY_LAYOUT, TILE_SIZE, ARRAY_PADDING, ROW_PADDING) != 0
+        || sweep_build(&sweep) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    start = host_time();
+    used = parallel_for(sweep.count, workers, sweep_run, &sweep);
+    seconds = host_time() - start;
+
+    for (i = 0; i < PARALLEL_MAX_WORKERS; i++) {
+        if (sweep.worker[i].failed) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        cache_destroy(sweep.worker[i].cache);
+        free(sweep.worker[i].addresses);
+        free(sweep.worker[i].accesses);
+    }
+
+    baseline = sweep.candidates[0];
+    qsort(sweep.candidates, sweep.count, sizeof(*sweep.candidates), compare_candidates);
+
+    printf("CACHE: offset %u index %u ways %u replacement %u  ARRAYS: %d x %d items of %d B\n",
+           sweep.config.offset, sweep.config.index, sweep.config.ways, sweep.config.replacement,
+           ARRAY_ROWS, ARRAY_COLUMNS, ITEM_SIZE);
+    printf("LAYOUTS: %u  WORKERS: %u  TIME: %.3f s\n", sweep.count, used, seconds);
+    printf("%-9s %-13s %5s %10s %10s %10s %10s %8s %12s\n", "RANK", "LAYOUT", "TILE", "ARRAY PAD",
+           "ROW PAD", "BYTES", "MISSES", "MISS %", "TRAFFIC B");
+    print_candidate("config.h", &baseline);
+    for (i = 0; i < rows && i < sweep.count; i++) {
+        snprintf(rank, sizeof(rank), "%u", i + 1);
+        print_candidate(rank, &sweep.candidates[i]);
+    }
+    printf("CONFIG=\"-DARRAY_LAYOUT=%u -DTILE_SIZE=%u -DARRAY_PADDING=%u -DROW_PADDING=%u\"\n",
+           sweep.candidates[0].layout.type, sweep.candidates[0].layout.tile,
+           sweep.candidates[0].layout.array_padding, sweep.candidates[0].layout.row_padding);
+
+    free(sweep.candidates);
+
+    return 0;
+}
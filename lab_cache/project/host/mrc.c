@@ -0,0 +1,111 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, miss ratio curves
+ * --
+ * -- Usage       : mrc [-o offset] [-s max index] trace > curve.csv
+ * --               One pass over the trace gives the LRU miss ratio
+ * --               of every geometry with 2^0 .. 2^max index sets
+ * --               (default 10) and power of two ways. offset
+ * --               defaults to OFFSET of config.h.
+ * --------------------------------------------------------------- */
+
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace_bin.h"
+#include "stack_distance.h"
+
+/* Default largest index size */
+#define MRC_MAX_INDEX 10
+
+/* Context of the trace callback */
+struct Profile {
+    struct StackDistance sd;
+    int failed;
+};
+
+/* profile_record
+ *
+ * Feed every block of a record to the profiler
+ *
+ * @param       context     struct Profile
+ * @param       record
+ *
+ * @return      void
+ */
+static void profile_record(void *context, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct Profile *profile = context;
+    uint32_t offset = profile->sd.offset;
+    uint32_t block = record->address >> offset;
+    uint32_t last = (record->address + record->size - 1) >> offset;
+
+    while (1) {
+        if (stack_distance_access(&profile->sd, block << offset) != 0) {
+            profile->failed = 1;
+        }
+        if (block == last) {
+            break;
+        }
+        block++;
+    }
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static struct Profile profile;
+    uint32_t offset = OFFSET;
+    uint32_t max_index = MRC_MAX_INDEX;
+    int64_t records;
+    double start;
+    int option;
+
+    while ((option = getopt(argc, argv, "o:s:")) != -1) {
+        switch (option) {
+            case 'o':
+                offset = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                max_index = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "usage: %s [-o offset] [-s max index] trace\n", argv[0]);
+        return 2;
+    }
+
+    if (stack_distance_init(&profile.sd, offset, max_index) != 0) {
+        fprintf(stderr, "invalid geometry or out of memory\n");
+        return 1;
+    }
+
+    start = host_time();
+    records = trace_stream(argv[optind], profile_record, &profile);
+    if (records < 0 || profile.failed) {
+        fprintf(stderr, "%s\n", records < 0 ? "trace error" : "out of memory");
+        stack_distance_free(&profile.sd);
+        return 1;
+    }
+    fprintf(stderr, "RECORDS: %lld  BLOCKS: %u  TIME: %.3f s\n",
+            (long long)records, profile.sd.blocks, host_time() - start);
+
+    stack_distance_write_csv(&profile.sd, stdout);
+    stack_distance_free(&profile.sd);
+
+    return 0;
+}
@@ -0,0 +1,370 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "multi.h"
+#include "config.h"
+
+/* stackable
+ *
+ * Check if a config can share an LRU stack. A write miss that does not
+ * allocate leaves the stack order of the other configs, so only write
+ * allocate configs qualify, and only with the bit-slice index function.
+ *
+ * @param       config
+ *
+ * @return      1 if it can, 0 otherwise
+ */
+static int stackable(const struct CacheConfig *config)
+{
+    return config->replacement == REPLACEMENT_LRU && config->write_miss == WRITE_MISS_ALLOCATE &&
+           config->index_function == INDEX_FUNCTION_BITS;
+}
+
+/* stack_init
+ *
+ * Allocate a stack for the members of a config mask
+ *
+ * @param       stack
+ * @param       configs
+ * @param       members     Bit per config
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int stack_init(struct MultiStack *stack, const struct CacheConfig *configs, uint64_t members)
+{
+    /* Local Variables */
+    size_t sets;
+    uint64_t rest;
+
+    memset(stack, 0, sizeof(*stack));
+    for (rest = members; rest; rest &= rest - 1) {
+        const struct CacheConfig *config = &configs[__builtin_ctzll(rest)];
+
+        stack->offset = config->offset;
+        stack->set_mask = (1u << config->index) - 1;
+        if (config->ways > stack->depth) {
+            stack->depth = config->ways;
+        }
+        stack->evict[config->ways] |= rest & -rest;
+        if (config->write_policy == WRITE_POLICY_BACK) {
+            stack->write_back |= rest & -rest;
+        }
+    }
+
+    sets = (size_t)stack->set_mask + 1;
+    stack->blocks = malloc(sets * stack->depth * sizeof(*stack->blocks));
+    stack->dirty = calloc(sets * stack->depth, sizeof(*stack->dirty));
+    stack->fill = calloc(sets, sizeof(*stack->fill));
+    if (stack->blocks == NULL || stack->dirty == NULL || stack->fill == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* stack_release
+ *
+ * Free the arrays of a stack
+ *
+ * @param       stack
+ *
+ * @return      void
+ */
+static void stack_release(struct MultiStack *stack)
+{
+    free(stack->blocks);
+    free(stack->dirty);
+    free(stack->fill);
+    memset(stack, 0, sizeof(*stack));
+}
+
+/* stack_leave
+ *
+ * Write back a block for the configs it leaves dirty
+ *
+ * @param       writebacks  Bytes per config
+ * @param       leave       Configs the block is dirty in
+ * @param       line        Bytes per line
+ *
+ * @return      void
+ */
+static inline void stack_leave(uint64_t *writebacks, uint64_t leave, uint32_t line)
+{
+    for (; leave; leave &= leave - 1) {
+        writebacks[__builtin_ctzll(leave)] += line;
+    }
+}
+
+/* stack_batch
+ *
+ * Run an array of accesses through a stack
+ *
+ * @param       stack
+ * @param       writebacks  Bytes per config
+ * @param       addresses
+ * @param       accesses    NULL for reads
+ * @param       size
+ * @param       count
+ *
+ * @return      void
+ */
+static void stack_batch(struct MultiStack *stack, uint64_t *writebacks, const uint32_t *addresses,
+                        const uint8_t *accesses, uint8_t size, size_t count)
+{
+    /* Local Variables */
+    const uint32_t depth = stack->depth;
+    const uint32_t line = 1u << stack->offset;
+    uint64_t write_bytes = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        uint32_t block = addresses[i] >> stack->offset;
+        size_t set = block & stack->set_mask;
+        uint32_t *blocks = &stack->blocks[set * depth];
+        uint64_t *dirty = &stack->dirty[set * depth];
+        uint32_t fill = stack->fill[set];
+        uint32_t write = accesses != NULL && accesses[i] == WRITE_ACCESS;
+        uint64_t mask = 0;
+        uint32_t p;
+
+        for (p = 0; p < fill && blocks[p] != block; p++) {
+        }
+
+        if (p < fill) {
+            stack->histogram[p]++;
+            mask = dirty[p];
+        } else {
+            stack->histogram[depth]++;
+            if (fill < depth) {
+                stack->fill[set] = (uint8_t)(fill + 1);
+            } else {
+                /* The bottom block leaves the configs with all ways */
+                p = depth - 1;
+                stack_leave(writebacks, dirty[p], line);
+            }
+        }
+
+        /* Sinking from q - 1 to q leaves the configs with q ways */
+        for (; p > 0; p--) {
+            uint64_t moved = dirty[p - 1];
+            uint64_t leave = moved & stack->evict[p];
+
+            if (leave) {
+                stack_leave(writebacks, leave, line);
+            }
+            blocks[p] = blocks[p - 1];
+            dirty[p] = moved & ~leave;
+        }
+        blocks[0] = block;
+        dirty[0] = mask | (write ? stack->write_back : 0);
+        write_bytes += write ? size : 0;
+    }
+
+    stack->accesses += count;
+    stack->write_bytes += write_bytes;
+}
+
+/* multi_init
+ *
+ * Initialize an engine for a set of configs
+ *
+ * @param       multi
+ * @param       configs
+ * @param       count       At most MULTI_MAX_CONFIGS
+ * @param       stacks      0 to run every config as an instance
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int multi_init(struct Multi *multi, const struct CacheConfig *configs, uint32_t count, int stacks)
+{
+    /* Local Variables */
+    uint32_t c;
+    uint32_t d;
+
+    memset(multi, 0, sizeof(*multi));
+    if (count > MULTI_MAX_CONFIGS) {
+        return -1;
+    }
+    for (c = 0; c < count; c++) {
+        if (!cache_config_valid(&configs[c])) {
+            return -1;
+        }
+        multi->config[c] = configs[c];
+        multi->stack_of[c] = -1;
+    }
+    multi->count = count;
+
+    for (c = 0; c < count && stacks; c++) {
+        const struct CacheConfig *config = &configs[c];
+        uint64_t members = 1ull << c;
+
+        if (multi->stack_of[c] >= 0 || !stackable(config)) {
+            continue;
+        }
+        for (d = c + 1; d < count; d++) {
+            if (multi->stack_of[d] < 0 && stackable(&configs[d]) &&
+                configs[d].offset == config->offset && configs[d].index == config->index) {
+                members |= 1ull << d;
+            }
+        }
+
+        /* A single config runs faster on its own kernel */
+        if ((members & (members - 1)) == 0) {
+            continue;
+        }
+        if (stack_init(&multi->stack[multi->stack_count], configs, members) != 0) {
+            multi->stack_count++;
+            multi_free(multi);
+            return -1;
+        }
+        for (d = c; d < count; d++) {
+            if (members & (1ull << d)) {
+                multi->stack_of[d] = (int8_t)multi->stack_count;
+            }
+        }
+        multi->stack_count++;
+    }
+
+    for (c = 0; c < count; c++) {
+        if (multi->stack_of[c] < 0) {
+            multi->cache[c] = cache_create(&configs[c]);
+            if (multi->cache[c] == NULL) {
+                multi_free(multi);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* multi_free
+ *
+ * Release an engine
+ *
+ * @param       multi
+ *
+ * @return      void
+ */
+void multi_free(struct Multi *multi)
+{
+    /* Local Variables */
+    uint32_t c;
+
+    for (c = 0; c < multi->count; c++) {
+        cache_destroy(multi->cache[c]);
+    }
+    for (c = 0; c < multi->stack_count; c++) {
+        stack_release(&multi->stack[c]);
+    }
+    memset(multi, 0, sizeof(*multi));
+}
+
+/* multi_access_batch
+ *
+ * Run an array of accesses through every config
+ *
+ * @param       multi
+ * @param       addresses
+ * @param       accesses    READ_ACCESS or WRITE_ACCESS each, NULL for reads
+ * @param       size        Bytes of every access
+ * @param       count
+ *
+ * @return      void
+ */
+void multi_access_batch(struct Multi *multi, const uint32_t *addresses, const uint8_t *accesses,
+                        uint8_t size, size_t count)
+{
+    /* Local Variables */
+    uint32_t c;
+
+    for (c = 0; c < multi->stack_count; c++) {
+        stack_batch(&multi->stack[c], multi->writebacks, addresses, accesses, size, count);
+    }
+    for (c = 0; c < multi->count; c++) {
+        if (multi->cache[c] != NULL) {
+            multi->hits[c] += cache_access_batch(multi->cache[c], addresses, accesses, size, count,
+                                                 NULL);
+        }
+    }
+    multi->accesses += count;
+}
+
+/* multi_flush
+ *
+ * Write back the dirty lines of every config. The lines stay valid.
+ *
+ * @param       multi
+ *
+ * @return      void
+ */
+void multi_flush(struct Multi *multi)
+{
+    /* Local Variables */
+    uint32_t c;
+    size_t entry;
+
+    for (c = 0; c < multi->stack_count; c++) {
+        struct MultiStack *stack = &multi->stack[c];
+        size_t entries = ((size_t)stack->set_mask + 1) * stack->depth;
+
+        for (entry = 0; entry < entries; entry++) {
+            stack_leave(multi->writebacks, stack->dirty[entry], 1u << stack->offset);
+            stack->dirty[entry] = 0;
+        }
+    }
+    for (c = 0; c < multi->count; c++) {
+        if (multi->cache[c] != NULL) {
+            cache_flush(multi->cache[c], &multi->cache[c]->traffic);
+        }
+    }
+}
+
+/* multi_result
+ *
+ * Get the counters of one config
+ *
+ * @param       multi
+ * @param       config      Position in the configs of multi_init()
+ * @param       result
+ *
+ * @return      void
+ */
+void multi_result(const struct Multi *multi, uint32_t config, struct MultiResult *result)
+{
+    /* Local Variables */
+    const struct CacheConfig *c = &multi->config[config];
+    const struct MultiStack *stack;
+    uint32_t p;
+
+    memset(result, 0, sizeof(*result));
+    result->accesses = multi->accesses;
+    if (multi->stack_of[config] < 0) {
+        result->hits = multi->hits[config];
+        result->misses = multi->accesses - result->hits;
+        result->traffic = multi->cache[config]->traffic;
+        return;
+    }
+
+    /* A W way config hits on the top W positions */
+    stack = &multi->stack[multi->stack_of[config]];
+    for (p = 0; p < c->ways; p++) {
+        result->hits += stack->histogram[p];
+    }
+    result->misses = multi->accesses - result->hits;
+    result->traffic.fill_bytes = result->misses << c->offset;
+    if (c->write_policy == WRITE_POLICY_THROUGH) {
+        result->traffic.write_through_bytes = stack->write_bytes;
+    }
+    result->traffic.writeback_bytes = multi->writebacks[config];
+}
@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Multi-config engine
+ *
+ * Simulates up to 64 cache configs in one pass over the accesses.
+ *
+ * LRU write-allocate configs with the same offset and index share one
+ * LRU stack per set, as deep as the most ways among them. A W way
+ * cache holds exactly the top W blocks of the stack, so the position
+ * an access hits at decides hit or miss for all of them at once and
+ * only a histogram of positions is counted. Every stack entry carries
+ * a dirty mask with one bit per config; a block that sinks below the
+ * ways of a write-back config is written back for that config. The cost
+ * per access is the one of the deepest LRU set, whatever the number of
+ * configs on the stack.
+ *
+ * All other configs are cache instances. Each runs the batch through
+ * its own kernel while the accesses are hot in the host cache.
+ */
+
+#ifndef MULTI_H_
+#define MULTI_H_
+
+/* User includes */
+#include "cache.h"
+
+/* Most configs of an engine, one bit each in a dirty mask */
+#define MULTI_MAX_CONFIGS 64
+
+/* MultiStack
+ *
+ * Shared LRU stack of configs that differ in ways and write policy
+ */
+struct MultiStack {
+    uint8_t offset;
+    uint8_t depth;                          /* Most ways of the members */
+    uint32_t set_mask;
+    uint32_t *blocks;                       /* depth per set, MRU first */
+    uint64_t *dirty;                        /* Dirty mask of every entry */
+    uint8_t *fill;                          /* Valid entries per set */
+    uint64_t evict[MAX_WAYS + 1];           /* Members with ways == q */
+    uint64_t write_back;                    /* Write-back members */
+    uint64_t histogram[MAX_WAYS + 1];       /* Hits per position, misses last */
+    uint64_t accesses;
+    uint64_t write_bytes;
+};
+
+/* MultiResult
+ *
+ * Counters of one config
+ */
+struct MultiResult {
+    uint64_t accesses;
+    uint64_t hits;
+    uint64_t misses;
+    struct MemoryTraffic traffic;
+};
+
+/* Multi
+ *
+ * Engine state
+ */
+struct Multi {
+    uint32_t count;
+    struct CacheConfig config[MULTI_MAX_CONFIGS];
+    int8_t stack_of[MULTI_MAX_CONFIGS];     /* Stack of a config, -1 for an instance */
+    cache_t *cache[MULTI_MAX_CONFIGS];
+    uint64_t hits[MULTI_MAX_CONFIGS];       /* Of the instances */
+    uint64_t accesses;
+    uint64_t writebacks[MULTI_MAX_CONFIGS]; /* Bytes, of the stack members */
+    struct MultiStack stack[MULTI_MAX_CONFIGS];
+    uint32_t stack_count;
+};
+
+/* multi_init
+ *
+ * Initialize an engine for a set of configs
+ *
+ * @param       multi
+ * @param       configs
+ * @param       count       At most MULTI_MAX_CONFIGS
+ * @param       stacks      0 to run every config as an instance
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int multi_init(struct Multi *multi, const struct CacheConfig *configs, uint32_t count, int stacks);
+
+/* multi_free
+ *
+ * Release an engine
+ *
+ * @param       multi
+ *
+ * @return      void
+ */
+void multi_free(struct Multi *multi);
+
+/* multi_access_batch
+ *
+ * Run an array of accesses through every config
+ *
+ * @param       multi
+ * @param       addresses
+ * @param       accesses    READ_ACCESS or WRITE_ACCESS each, NULL for reads
+ * @param       size        Bytes of every access
+ * @param       count
+ *
+ * @return      void
+ */
+void multi_access_batch(struct Multi *multi, const uint32_t *addresses, const uint8_t *accesses,
+                        uint8_t size, size_t count);
+
+/* multi_flush
+ *
+ * Write back the dirty lines of every config. The lines stay valid.
+ *
+ * @param       multi
+ *
+ * @return      void
+ */
+void multi_flush(struct Multi *multi);
+
+/* multi_result
+ *
+ * Get the counters of one config
+ *
+ * @param       multi
+ * @param       config      Position in the configs of multi_init()
+ * @param       result
+ *
+ * @return      void
+ */
+void multi_result(const struct Multi *multi, uint32_t config, struct MultiResult *result);
+
+#endif
+/* MULTI_H_ */
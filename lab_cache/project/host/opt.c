@@ -0,0 +1,385 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "opt.h"
+
+/* Largest window, so positions in the buffer fit 32 bits */
+#define OPT_MAX_WINDOW (1u << 30)
+
+static const char *policy_names[] = { "LRU", "PLRU", "FIFO", "RANDOM", "SRRIP" };
+
+/* opt_init
+ *
+ * Initialize an OPT simulator
+ *
+ * @param       opt
+ * @param       config      Geometry, the replacement is ignored
+ * @param       window      Block accesses per window, 0 for the default
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int opt_init(struct Opt *opt, const struct CacheConfig *config, uint32_t window)
+{
+    /* Local Variables */
+    struct CacheConfig policy;
+    size_t lines;
+    uint32_t r;
+
+    memset(opt, 0, sizeof(*opt));
+    policy = *config;
+    policy.replacement = REPLACEMENT_LRU;
+    if (!cache_config_valid(&policy) || policy.index_function != INDEX_FUNCTION_BITS) {
+        return -1;
+    }
+    opt->config = policy;
+    opt->set_count = 1u << config->index;
+    opt->window = window == 0 ? OPT_WINDOW : window > OPT_MAX_WINDOW ? OPT_MAX_WINDOW : window;
+    lines = (size_t)opt->set_count * config->ways;
+
+    opt->addresses = malloc(2 * (size_t)opt->window * sizeof(*opt->addresses));
+    opt->next = malloc(2 * (size_t)opt->window * sizeof(*opt->next));
+    opt->blocks = malloc(lines * sizeof(*opt->blocks));
+    opt->next_use = malloc(lines * sizeof(*opt->next_use));
+    opt->heap = malloc(lines * sizeof(*opt->heap));
+    opt->slot = malloc(lines * sizeof(*opt->slot));
+    opt->fill = calloc(opt->set_count, sizeof(*opt->fill));
+    if (opt->addresses == NULL || opt->next == NULL || opt->blocks == NULL ||
+        opt->next_use == NULL || opt->heap == NULL || opt->slot == NULL || opt->fill == NULL ||
+        block_map_init(&opt->map, 1024) != 0 || block_map_init(&opt->seen, 1024) != 0) {
+        opt_free(opt);
+        return -1;
+    }
+
+    /* Every policy that accepts the geometry runs alongside */
+    for (r = 0; r <= REPLACEMENT_SRRIP; r++) {
+        policy.replacement = (uint8_t)r;
+        if (!cache_config_valid(&policy)) {
+            continue;
+        }
+        opt->policy[r] = cache_create(&policy);
+        if (opt->policy[r] == NULL) {
+            opt_free(opt);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* opt_free
+ *
+ * Release an OPT simulator
+ *
+ * @param       opt
+ *
+ * @return      void
+ */
+void opt_free(struct Opt *opt)
+{
+    /* Local Variables */
+    uint32_t r;
+
+    free(opt->addresses);
+    free(opt->next);
+    free(opt->blocks);
+    free(opt->next_use);
+    free(opt->heap);
+    free(opt->slot);
+    free(opt->fill);
+    block_map_free(&opt->map);
+    block_map_free(&opt->seen);
+    for (r = 0; r <= REPLACEMENT_SRRIP; r++) {
+        cache_destroy(opt->policy[r]);
+    }
+    memset(opt, 0, sizeof(*opt));
+}
+
+/* scan
+ *
+ * Find the next use of every buffered access. Entries before
+ * opt->scanned already know their next use inside the front part, so
+ * only the new entries are scanned backward and the last use of every
+ * block in the front part is linked to its first use in the new part.
+ *
+ * @param       opt
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int scan(struct Opt *opt)
+{
+    /* Local Variables */
+    struct BlockMap *map = &opt->map;
+    uint32_t offset = opt->config.offset;
+    uint32_t i;
+
+    memset(map->values, 0, map->capacity * sizeof(*map->values));
+    map->count = 0;
+
+    for (i = opt->count; i-- > opt->scanned;) {
+        uint32_t *first = block_map_find(map, opt->addresses[i] >> offset);
+
+        if (first == NULL) {
+            return -1;
+        }
+        opt->next[i] = *first != 0 ? *first - 1 : OPT_NEVER;
+        *first = i + 1;
+    }
+
+    for (i = 0; i < opt->scanned; i++) {
+        if (opt->next[i] == OPT_NEVER) {
+            uint32_t first = block_map_get(map, opt->addresses[i] >> offset);
+
+            if (first != 0) {
+                opt->next[i] = first - 1;
+            }
+        }
+    }
+    opt->scanned = opt->count;
+
+    return 0;
+}
+
+/* heap_update
+ *
+ * Restore the max-heap of a set after the next use of the way at a
+ * heap position changed
+ *
+ * @param       opt
+ * @param       first       First line of the set
+ * @param       k           Heap position
+ * @param       count       Ways in the heap
+ *
+ * @return      void
+ */
+static void heap_update(struct Opt *opt, size_t first, uint32_t k, uint32_t count)
+{
+    /* Local Variables */
+    uint8_t *heap = &opt->heap[first];
+    uint8_t *slot = &opt->slot[first];
+    const uint64_t *key = &opt->next_use[first];
+    uint8_t way = heap[k];
+
+    /* Up while larger than the parent */
+    while (k > 0 && key[heap[(k - 1) / 2]] < key[way]) {
+        heap[k] = heap[(k - 1) / 2];
+        slot[heap[k]] = (uint8_t)k;
+        k = (k - 1) / 2;
+    }
+
+    /* Down while smaller than a child */
+    while (2 * k + 1 < count) {
+        uint32_t child = 2 * k + 1;
+
+        if (child + 1 < count && key[heap[child + 1]] > key[heap[child]]) {
+            child++;
+        }
+        if (key[heap[child]] <= key[way]) {
+            break;
+        }
+        heap[k] = heap[child];
+        slot[heap[k]] = (uint8_t)k;
+        k = child;
+    }
+
+    heap[k] = way;
+    slot[way] = (uint8_t)k;
+}
+
+/* simulate
+ *
+ * Run the first accesses of the buffer through OPT and the online
+ * policies
+ *
+ * @param       opt
+ * @param       count       Accesses to simulate
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int simulate(struct Opt *opt, uint32_t count)
+{
+    /* Local Variables */
+    uint32_t offset = opt->config.offset;
+    uint32_t ways = opt->config.ways;
+    uint32_t i;
+    uint32_t r;
+
+    for (i = 0; i < count; i++) {
+        uint32_t block = opt->addresses[i] >> offset;
+        uint32_t set = block & (opt->set_count - 1);
+        size_t first = (size_t)set * ways;
+        uint64_t next_use = opt->next[i] == OPT_NEVER ? UINT64_MAX : opt->base + opt->next[i];
+        uint32_t fill = opt->fill[set];
+        uint32_t way;
+
+        for (way = 0; way < fill; way++) {
+            if (opt->blocks[first + way] == block) {
+                break;
+            }
+        }
+
+        if (way == fill) {
+            uint32_t *seen = block_map_find(&opt->seen, block);
+
+            if (seen == NULL) {
+                return -1;
+            }
+            opt->compulsory += *seen == 0;
+            *seen = 1;
+            opt->misses++;
+
+            if (fill < ways) {
+                /* Free way, appended as a new leaf */
+                opt->fill[set] = (uint8_t)++fill;
+                opt->heap[first + way] = (uint8_t)way;
+                opt->slot[first + way] = (uint8_t)way;
+            } else {
+                /* Victim with the furthest next use */
+                way = opt->heap[first];
+            }
+            opt->blocks[first + way] = block;
+        }
+
+        opt->next_use[first + way] = next_use;
+        heap_update(opt, first, opt->slot[first + way], fill);
+    }
+    opt->accesses += count;
+
+    for (r = 0; r <= REPLACEMENT_SRRIP; r++) {
+        if (opt->policy[r] != NULL) {
+            opt->policy_misses[r] +=
+                count - cache_access_batch(opt->policy[r], opt->addresses, NULL, 1, count, NULL);
+        }
+    }
+
+    return 0;
+}
+
+/* opt_record
+ *
+ * Feed every block access of a record. Simulates a window once the
+ * buffer is full.
+ *
+ * @param       opt
+ * @param       record
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int opt_record(struct Opt *opt, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t offset = opt->config.offset;
+    uint32_t block = record->address >> offset;
+    uint32_t last = (record->address + record->size - 1) >> offset;
+    uint32_t i;
+
+    while (1) {
+        opt->addresses[opt->count++] = block << offset;
+
+        if (opt->count == 2 * opt->window) {
+            if (scan(opt) != 0 || simulate(opt, opt->window) != 0) {
+                return -1;
+            }
+
+            /* The second window moves to the front */
+            memmove(opt->addresses, &opt->addresses[opt->window],
+                    opt->window * sizeof(*opt->addresses));
+            for (i = 0; i < opt->window; i++) {
+                uint32_t next = opt->next[opt->window + i];
+
+                opt->next[i] = next == OPT_NEVER ? OPT_NEVER : next - opt->window;
+            }
+            opt->count = opt->window;
+            opt->scanned = opt->window;
+            opt->base += opt->window;
+        }
+
+        if (block == last) {
+            break;
+        }
+        block++;
+    }
+
+    return 0;
+}
+
+/* opt_finish
+ *
+ * Simulate the accesses left in the buffer
+ *
+ * @param       opt
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int opt_finish(struct Opt *opt)
+{
+    /* Local Variables */
+    uint32_t count = opt->count;
+
+    if (scan(opt) != 0 || simulate(opt, count) != 0) {
+        return -1;
+    }
+    opt->base += count;
+    opt->count = 0;
+    opt->scanned = 0;
+
+    return 0;
+}
+
+/* print_row
+ *
+ * Print the misses of one policy and its gap to OPT
+ *
+ * @param       opt
+ * @param       name
+ * @param       misses
+ * @param       file
+ *
+ * @return      void
+ */
+static void print_row(const struct Opt *opt, const char *name, uint64_t misses, FILE *file)
+{
+    /* Local Variables */
+    double accesses = opt->accesses != 0 ? (double)opt->accesses : 1.0;
+    double optimal = opt->misses != 0 ? (double)opt->misses : 1.0;
+
+    fprintf(file, "%-8s %12llu %9.4f %12llu %9.2f\n", name, (unsigned long long)misses,
+            100.0 * misses / accesses, (unsigned long long)(misses - opt->misses),
+            100.0 * (misses - opt->misses) / optimal);
+}
+
+/* opt_print
+ *
+ * Print the misses of OPT and of every online policy with their gap
+ * to OPT
+ *
+ * @param       opt
+ * @param       file
+ *
+ * @return      void
+ */
+void opt_print(const struct Opt *opt, FILE *file)
+{
+    /* Local Variables */
+    uint32_t r;
+
+    fprintf(file, "ACCESSES: %llu  COMPULSORY: %llu\n", (unsigned long long)opt->accesses,
+            (unsigned long long)opt->compulsory);
+    fprintf(file, "%-8s %12s %9s %12s %9s\n", "POLICY", "MISSES", "MISS %", "OVER OPT",
+            "OVER %");
+    print_row(opt, "OPT", opt->misses, file);
+    for (r = 0; r <= REPLACEMENT_SRRIP; r++) {
+        if (opt->policy[r] != NULL) {
+            print_row(opt, policy_names[r], opt->policy_misses[r], file);
+        }
+    }
+}
@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Belady OPT replacement oracle
+ *
+ * OPT evicts the line whose next use lies furthest in the future and
+ * gives the lowest miss count any demand-fill replacement policy can
+ * reach for a geometry. The online policies of cache.c run on the same
+ * block accesses, so their gap to OPT can be read off directly.
+ *
+ * Block accesses are buffered in two windows. A backward scan over each
+ * new window stores the next use of every access in a compact array,
+ * then the first window is simulated and the second one moves to the
+ * front.
+ * A trace of up to one window is simulated exactly. For longer traces
+ * next uses beyond the buffer count as "never", i.e. OPT looks ahead at
+ * least one window, which does not change the victim as long as a
+ * window is much larger than a set.
+ *
+ * Every set keeps its lines in a binary max-heap on the next use, so
+ * the victim is at the root.
+ */
+
+#ifndef OPT_H_
+#define OPT_H_
+
+#include <stdio.h>
+
+/* User includes */
+#include "cache.h"
+#include "trace.h"
+#include "block_map.h"
+
+/* Default block accesses per window */
+#define OPT_WINDOW (1u << 22)
+
+/* Next use of a block that is not accessed again inside the buffer */
+#define OPT_NEVER UINT32_MAX
+
+/* Opt
+ *
+ * OPT simulator plus one cache instance per online policy
+ */
+struct Opt {
+    struct CacheConfig config;
+    uint32_t set_count;
+    uint32_t window;
+
+    /* Buffered block addresses and their next use inside the buffer */
+    uint32_t *addresses;
+    uint32_t *next;
+    uint32_t count;
+    uint32_t scanned;           /* Leading entries whose next use is known */
+    uint64_t base;              /* Position of addresses[0] in the trace */
+    struct BlockMap map;        /* Block -> first position + 1, scan only */
+    struct BlockMap seen;       /* Blocks missed before, for compulsory misses */
+
+    /* OPT state, ways entries per set */
+    uint32_t *blocks;
+    uint64_t *next_use;
+    uint8_t *heap;              /* Ways ordered as a max-heap on next_use */
+    uint8_t *slot;              /* Heap position of every way */
+    uint8_t *fill;              /* Valid ways per set */
+
+    uint64_t accesses;
+    uint64_t misses;
+    uint64_t compulsory;
+
+    /* Online policies for comparison, NULL if not applicable */
+    cache_t *policy[REPLACEMENT_SRRIP + 1];
+    uint64_t policy_misses[REPLACEMENT_SRRIP + 1];
+};
+
+/* opt_init
+ *
+ * Initialize an OPT simulator
+ *
+ * @param       opt
+ * @param       config      Geometry, the replacement is ignored
+ * @param       window      Block accesses per window, 0 for the default
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int opt_init(struct Opt *opt, const struct CacheConfig *config, uint32_t window);
+
+/* opt_free
+ *
+ * Release an OPT simulator
+ *
+ * @param       opt
+ *
+ * @return      void
+ */
+void opt_free(struct Opt *opt);
+
+/* opt_record
+ *
+ * Feed every block access of a record. Simulates a window once the
+ * buffer is full.
+ *
+ * @param       opt
+ * @param       record
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int opt_record(struct Opt *opt, const struct TraceRecord *record);
+
+/* opt_finish
+ *
+ * Simulate the accesses left in the buffer
+ *
+ * @param       opt
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int opt_finish(struct Opt *opt);
+
+/* opt_print
+ *
+ * Print the misses of OPT and of every online policy with their gap
+ * to OPT
+ *
+ * @param       opt
+ * @param       file
+ *
+ * @return      void
+ */
+void opt_print(const struct Opt *opt, FILE *file);
+
+#endif
+/* OPT_H_ */
@@ -0,0 +1,119 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, Belady OPT bound
+ * --
+ * -- Usage       : optsim [-o offset] [-s index] [-w ways]
+ * --                      [-W window] trace
+ * --               Streams the trace once and prints the misses of
+ * --               OPT and of every replacement policy of cache.c on
+ * --               the same geometry. offset, index and ways default
+ * --               to config.h, window is the number of block
+ * --               accesses per window (default 4M). Traces up to one
+ * --               window are exact, longer ones look ahead at least
+ * --               one window.
+ * --------------------------------------------------------------- */
+
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace_bin.h"
+#include "opt.h"
+
+/* Context of the trace callback */
+struct Profile {
+    struct Opt opt;
+    int failed;
+};
+
+/* opt_visit
+ *
+ * Feed a record to the OPT simulator
+ *
+ * @param       context     struct Profile
+ * @param       record
+ *
+ * @return      void
+ */
+static void opt_visit(void *context, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct Profile *profile = context;
+
+    if (!profile->failed && opt_record(&profile->opt, record) != 0) {
+        profile->failed = 1;
+    }
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static struct Profile profile;
+    struct CacheConfig config;
+    uint32_t window = 0;
+    int64_t records;
+    double start;
+    double seconds;
+    int option;
+
+    memset(&config, 0, sizeof(config));
+    config.offset = OFFSET;
+    config.index = INDEX;
+    config.ways = WAYS;
+
+    while ((option = getopt(argc, argv, "o:s:w:W:")) != -1) {
+        switch (option) {
+            case 'o':
+                config.offset = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                config.index = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                config.ways = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'W':
+                window = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "usage: %s [-o offset] [-s index] [-w ways] [-W window] trace\n", argv[0]);
+        return 2;
+    }
+
+    if (opt_init(&profile.opt, &config, window) != 0) {
+        fprintf(stderr, "invalid geometry or out of memory\n");
+        return 1;
+    }
+    printf("CACHE: offset %u index %u ways %u  WINDOW: %u\n", config.offset, config.index,
+           config.ways, profile.opt.window);
+
+    start = host_time();
+    records = trace_stream(argv[optind], opt_visit, &profile);
+    if (records < 0 || profile.failed || opt_finish(&profile.opt) != 0) {
+        fprintf(stderr, "%s\n", records < 0 ? "trace error" : "out of memory");
+        opt_free(&profile.opt);
+        return 1;
+    }
+    seconds = host_time() - start;
+
+    opt_print(&profile.opt, stdout);
+    fprintf(stderr, "RECORDS: %lld  TIME: %.3f s\n", (long long)records, seconds);
+    print_throughput(profile.opt.accesses, seconds);
+    opt_free(&profile.opt);
+
+    return 0;
+}
@@ -0,0 +1,511 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "parallel.h"
+
+/* Ring index mask */
+#define QUEUE_MASK (PARALLEL_QUEUE_SIZE - 1)
+
+/* ParallelForWorker
+ *
+ * Thread of parallel_for(). The items it still owns are the range
+ * begin .. end - 1, packed into one word as begin | end << 32, so the
+ * owner and thieves can claim items with one compare and swap.
+ */
+struct ParallelForWorker {
+    _Alignas(HOST_CACHE_LINE) atomic_uint_fast64_t range;
+    struct ParallelFor *shared;
+    uint32_t worker;
+    pthread_t thread;
+};
+
+/* ParallelFor
+ *
+ * Shared state of parallel_for()
+ */
+struct ParallelFor {
+    uint32_t workers;
+    void (*run)(void *context, uint32_t item, uint32_t worker);
+    void *context;
+    struct ParallelForWorker worker[PARALLEL_MAX_WORKERS];
+};
+
+/* worker_main
+ *
+ * Drain the queue of a worker until the producer is done
+ *
+ * @param       arg         struct ParallelWorker
+ *
+ * @return      NULL
+ */
+static void *worker_main(void *arg)
+{
+    /* Local Variables */
+    struct ParallelWorker *worker = arg;
+    struct ParallelQueue *queue = worker->queue;
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    while (1) {
+        size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+        if (head == tail) {
+            /* The producer publishes everything before it sets done */
+            if (atomic_load_explicit(worker->done, memory_order_acquire)
+                && head == atomic_load_explicit(&queue->tail, memory_order_acquire)) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+
+        for (; head != tail; head++) {
+            const struct TraceRecord *record = &queue->records[head & QUEUE_MASK];
+
+            access_cache_shard(record->address, (access_t)record->access, record->size,
+                               &worker->hit_miss, &worker->traffic);
+        }
+        atomic_store_explicit(&queue->head, head, memory_order_release);
+    }
+
+    return NULL;
+}
+
+/* queue_publish
+ *
+ * Make the written records visible to the worker
+ *
+ * @param       queue
+ *
+ * @return      void
+ */
+static void queue_publish(struct ParallelQueue *queue)
+{
+    atomic_store_explicit(&queue->tail, queue->write, memory_order_release);
+}
+
+/* queue_push
+ *
+ * Write one block access into a queue, waits while the queue is full
+ *
+ * @param       queue
+ * @param       record
+ * @param       address     Block address
+ *
+ * @return      void
+ */
+static void queue_push(struct ParallelQueue *queue, const struct TraceRecord *record, uint32_t address)
+{
+    /* Local Variables */
+    struct TraceRecord *slot;
+
+    while (queue->write - queue->cached_head == PARALLEL_QUEUE_SIZE) {
+        queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);
+        if (queue->write - queue->cached_head == PARALLEL_QUEUE_SIZE) {
+            queue_publish(queue);
+            sched_yield();
+        }
+    }
+
+    slot = &queue->records[queue->write & QUEUE_MASK];
+    slot->address = address;
+    slot->access = record->access;
+    slot->size = trace_block_bytes(record, address, OFFSET);
+
+    if (++queue->write % PARALLEL_BATCH == 0) {
+        queue_publish(queue);
+    }
+}
+
+/* parallel_workers
+ *
+ * Limit a requested number of workers to the available sets. The
+ * queues are picked by the bit-slice index, with a hashed
+ * INDEX_FUNCTION a single worker owns all sets. A victim cache and
+ * the telemetry cells and windows are shared by all sets, so they need
+ * a single worker as well.
+ *
+ * @param       workers
+ *
+ * @return      usable number of workers
+ */
+uint32_t parallel_workers(uint32_t workers)
+{
+    if (workers > PARALLEL_MAX_WORKERS) {
+        workers = PARALLEL_MAX_WORKERS;
+    }
+    if (workers > SET_COUNT) {
+        workers = SET_COUNT;
+    }
+    if (INDEX_FUNCTION != INDEX_FUNCTION_BITS || VICTIM_ENTRIES > 0 || TELEMETRY) {
+        workers = 1;
+    }
+
+    return workers ? workers : 1;
+}
+
+/* parallel_start
+ *
+ * Start the worker threads. The cache must be initialized with
+ * init_cache() before.
+ *
+ * @param       parallel
+ * @param       workers     Number of threads, see parallel_workers()
+ *
+ * @return      0 on success, -1 on error
+ */
+int parallel_start(struct Parallel *parallel, uint32_t workers)
+{
+    /* Local Variables */
+    struct HitMiss unused;
+    struct MemoryTraffic unused_traffic;
+    uint32_t i;
+
+    parallel->workers = parallel_workers(workers);
+    atomic_init(&parallel->done, 0);
+
+    parallel->queues = aligned_alloc(HOST_CACHE_LINE, parallel->workers * sizeof(*parallel->queues));
+    if (parallel->queues == NULL) {
+        return -1;
+    }
+
+    for (i = 0; i < parallel->workers; i++) {
+        struct ParallelQueue *queue = &parallel->queues[i];
+        struct ParallelWorker *worker = &parallel->worker[i];
+
+        atomic_init(&queue->head, 0);
+        atomic_init(&queue->tail, 0);
+        queue->write = 0;
+        queue->cached_head = 0;
+
+        memset(&worker->hit_miss, 0, sizeof(worker->hit_miss));
+        memset(&worker->traffic, 0, sizeof(worker->traffic));
+        worker->queue = queue;
+        worker->done = &parallel->done;
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            /* Stop the workers started so far */
+            parallel->workers = i;
+            parallel_finish(parallel, &unused, &unused_traffic);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* parallel_feed
+ *
+ * Hand one record to the workers owning its blocks
+ *
+ * @param       parallel
+ * @param       record
+ *
+ * @return      number of cache accesses
+ */
+uint32_t parallel_feed(struct Parallel *parallel, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t address = record->address;
+    uint32_t last = (record->address + record->size - 1) >> OFFSET;
+    uint32_t accesses = 1;
+
+    /* Sets are split into contiguous ranges, one per worker */
+    while (1) {
+        uint32_t owner = (uint32_t)(((uint64_t)INDEX_GET(address) * parallel->workers) >> INDEX);
+
+        queue_push(&parallel->queues[owner], record, address);
+        if ((address >> OFFSET) == last) {
+            break;
+        }
+        address = ((address >> OFFSET) + 1) << OFFSET;
+        accesses++;
+    }
+
+    return accesses;
+}
+
+/* parallel_finish
+ *
+ * Wait until all records are simulated, stop the workers and merge
+ * their counters
+ *
+ * @param       parallel
+ * @param       result      Merged counters
+ * @param       traffic     Merged memory traffic
+ *
+ * @return      void
+ */
+void parallel_finish(struct Parallel *parallel, struct HitMiss *result, struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    struct HitMiss merged = { 0 };
+    struct MemoryTraffic merged_traffic = { 0, 0, 0 };
+    uint32_t i;
+
+    for (i = 0; i < parallel->workers; i++) {
+        queue_publish(&parallel->queues[i]);
+    }
+    atomic_store_explicit(&parallel->done, 1, memory_order_release);
+
+    for (i = 0; i < parallel->workers; i++) {
+        pthread_join(parallel->worker[i].thread, NULL);
+        hit_miss_add(&merged, &parallel->worker[i].hit_miss);
+        merged_traffic.fill_bytes += parallel->worker[i].traffic.fill_bytes;
+        merged_traffic.writeback_bytes += parallel->worker[i].traffic.writeback_bytes;
+        merged_traffic.write_through_bytes += parallel->worker[i].traffic.write_through_bytes;
+    }
+
+    free(parallel->queues);
+    parallel->queues = NULL;
+    *result = merged;
+    *traffic = merged_traffic;
+}
+
+/* parallel_replay
+ *
+ * Replay an in-memory trace with the given number of workers
+ *
+ * @param       trace
+ * @param       workers
+ * @param       result      Merged counters
+ * @param       traffic     Merged memory traffic
+ *
+ * @return      number of cache accesses, -1 if the workers cannot start
+ */
+int64_t parallel_replay(const struct Trace *trace, uint32_t workers, struct HitMiss *result,
+                        struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    struct Parallel parallel;
+    uint64_t accesses = 0;
+    size_t i;
+
+    if (parallel_start(&parallel, workers) != 0) {
+        return -1;
+    }
+    for (i = 0; i < trace->count; i++) {
+        accesses += parallel_feed(&parallel, &trace->records[i]);
+    }
+    parallel_finish(&parallel, result, traffic);
+
+    return (int64_t)accesses;
+}
+
+/* parallel_replay_bin
+ *
+ * Replay a binary trace with the given number of workers
+ *
+ * @param       reader
+ * @param       workers
+ * @param       result      Merged counters
+ * @param       traffic     Merged memory traffic
+ *
+ * @return      number of cache accesses, -1 if the workers cannot start,
+ *              -2 if a chunk is corrupt
+ */
+int64_t parallel_replay_bin(const struct TraceBinReader *reader, uint32_t workers,
+                            struct HitMiss *result, struct MemoryTraffic *traffic)
+{
+    /* Local Variables */
+    struct Parallel parallel;
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    uint64_t accesses = 0;
+    uint32_t chunk;
+    int decoded = 0;
+
+    if (parallel_start(&parallel, workers) != 0) {
+        return -1;
+    }
+    for (chunk = 0; chunk < reader->chunk_count && decoded >= 0; chunk++) {
+        trace_bin_cursor(reader, chunk, &cursor);
+        while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+            accesses += parallel_feed(&parallel, &record);
+        }
+    }
+    parallel_finish(&parallel, result, traffic);
+
+    return decoded < 0 ? -2 : (int64_t)accesses;
+}
+
+/* range_pack
+ *
+ * Pack an item range into one word
+ *
+ * @param       begin
+ * @param       end
+ *
+ * @return      begin | end << 32
+ */
+static inline uint64_t range_pack(uint32_t begin, uint32_t end)
+{
+    return begin | (uint64_t)end << 32;
+}
+
+/* for_pop
+ *
+ * Take the first item of the own range
+ *
+ * @param       worker
+ * @param       item        Taken item
+ *
+ * @return      1 if an item was taken, 0 if the range is empty
+ */
+static int for_pop(struct ParallelForWorker *worker, uint32_t *item)
+{
+    /* Local Variables */
+    uint64_t range = atomic_load_explicit(&worker->range, memory_order_relaxed);
+
+    while ((uint32_t)range < (uint32_t)(range >> 32)) {
+        if (atomic_compare_exchange_weak_explicit(&worker->range, &range, range + 1,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            *item = (uint32_t)range;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* for_steal
+ *
+ * Move the back half of the range of another worker to the own, empty
+ * range. Every item is handed out once, so a range value never comes
+ * back and the compare and swap cannot suffer from ABA.
+ *
+ * @param       worker
+ *
+ * @return      1 if items were stolen, 0 if all ranges are empty
+ */
+static int for_steal(struct ParallelForWorker *worker)
+{
+    /* Local Variables */
+    struct ParallelFor *shared = worker->shared;
+    uint32_t k;
+
+    for (k = 1; k < shared->workers; k++) {
+        struct ParallelForWorker *victim = &shared->worker[(worker->worker + k) % shared->workers];
+        uint64_t range = atomic_load_explicit(&victim->range, memory_order_relaxed);
+
+        while ((uint32_t)range < (uint32_t)(range >> 32)) {
+            uint32_t begin = (uint32_t)range;
+            uint32_t end = (uint32_t)(range >> 32);
+            uint32_t split = end - (end - begin + 1) / 2;
+
+            if (atomic_compare_exchange_weak_explicit(&victim->range, &range, range_pack(begin, split),
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                atomic_store_explicit(&worker->range, range_pack(split, end), memory_order_relaxed);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* for_main
+ *
+ * Run the own items, then steal from the other workers until no items
+ * are left
+ *
+ * @param       arg         struct ParallelForWorker
+ *
+ * @return      NULL
+ */
+static void *for_main(void *arg)
+{
+    /* Local Variables */
+    struct ParallelForWorker *worker = arg;
+    struct ParallelFor *shared = worker->shared;
+    uint32_t item;
+
+    do {
+        while (for_pop(worker, &item)) {
+            shared->run(shared->context, item, worker->worker);
+        }
+    } while (for_steal(worker));
+
+    return NULL;
+}
+
+/* parallel_cpus
+ *
+ * Number of online CPUs
+ *
+ * @return      CPUs, at least 1
+ */
+uint32_t parallel_cpus(void)
+{
+    /* Local Variables */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return cpus > 0 ? (uint32_t)cpus : 1;
+}
+
+/* parallel_for
+ *
+ * Run items 0 .. count - 1 on worker threads. Every worker starts on a
+ * contiguous share of the items and steals half of the remaining items
+ * of another worker when it runs out, so items of different cost
+ * balance out. The calling thread is worker 0.
+ *
+ * @param       count       Number of items
+ * @param       workers     Number of threads, 0 for one per CPU
+ * @param       run         Called with the context, item and worker
+ * @param       context
+ *
+ * @return      number of workers used
+ */
+uint32_t parallel_for(uint32_t count, uint32_t workers,
+                      void (*run)(void *context, uint32_t item, uint32_t worker), void *context)
+{
+    /* Local Variables */
+    struct ParallelFor shared;
+    uint32_t started;
+    uint32_t i;
+
+    if (workers == 0) {
+        workers = parallel_cpus();
+    }
+    if (workers > PARALLEL_MAX_WORKERS) {
+        workers = PARALLEL_MAX_WORKERS;
+    }
+    if (workers > count) {
+        workers = count ? count : 1;
+    }
+
+    shared.workers = workers;
+    shared.run = run;
+    shared.context = context;
+    for (i = 0; i < workers; i++) {
+        shared.worker[i].shared = &shared;
+        shared.worker[i].worker = i;
+        atomic_init(&shared.worker[i].range,
+                    range_pack((uint32_t)((uint64_t)count * i / workers),
+                               (uint32_t)((uint64_t)count * (i + 1) / workers)));
+    }
+
+    /* A thread that fails to start leaves its items to be stolen */
+    for (started = 1; started < workers; started++) {
+        if (pthread_create(&shared.worker[started].thread, NULL, for_main, &shared.worker[started]) != 0) {
+            break;
+        }
+    }
+    for_main(&shared.worker[0]);
+
+    for (i = 1; i < started; i++) {
+        pthread_join(shared.worker[i].thread, NULL);
+    }
+
+    return started;
+}
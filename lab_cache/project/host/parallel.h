@@ -0,0 +1,182 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Set-sharded parallel replay
+ *
+ * Every set evolves independently, so the sets are split into one
+ * contiguous range per worker thread. The calling thread decodes the
+ * trace and pushes every block access into the lock-free single
+ * producer / single consumer queue of the worker owning its set. Each
+ * set sees its accesses in trace order, so the merged counters equal
+ * the ones of the sequential replay. Only the bit-slice index function
+ * splits the sets like that, the XOR and prime hash map a block to
+ * another set and the skewed one to a set per way, so with these a
+ * single worker replays everything.
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* User includes */
+#include "trace_bin.h"
+
+/* Upper limit of worker threads */
+#define PARALLEL_MAX_WORKERS 64
+
+/* Records per worker queue, power of two */
+#define PARALLEL_QUEUE_SIZE (1u << 14)
+
+/* Records the producer collects before publishing them */
+#define PARALLEL_BATCH 256
+
+/* Size of a host cache line, keeps thread owned data apart */
+#define HOST_CACHE_LINE 64
+
+/* ParallelQueue
+ *
+ * Single producer / single consumer ring. head is written by the
+ * worker, tail by the producer, each on its own cache line.
+ */
+struct ParallelQueue {
+    _Alignas(HOST_CACHE_LINE) atomic_size_t head;
+    _Alignas(HOST_CACHE_LINE) atomic_size_t tail;
+    _Alignas(HOST_CACHE_LINE) size_t write;
+    size_t cached_head;
+    struct TraceRecord records[PARALLEL_QUEUE_SIZE];
+};
+
+/* ParallelWorker
+ *
+ * Thread state including its private counters
+ */
+struct ParallelWorker {
+    _Alignas(HOST_CACHE_LINE) struct HitMiss hit_miss;
+    struct MemoryTraffic traffic;
+    struct ParallelQueue *queue;
+    atomic_int *done;
+    pthread_t thread;
+};
+
+/* Parallel
+ *
+ * Parallel replay engine
+ */
+struct Parallel {
+    uint32_t workers;
+    struct ParallelQueue *queues;
+    struct ParallelWorker worker[PARALLEL_MAX_WORKERS];
+    atomic_int done;
+};
+
+/* parallel_workers
+ *
+ * Limit a requested number of workers to the available sets, 1 with
+ * a hashed INDEX_FUNCTION, a victim cache or TELEMETRY
+ *
+ * @param       workers
+ *
+ * @return      usable number of workers
+ */
+uint32_t parallel_workers(uint32_t workers);
+
+/* parallel_start
+ *
+ * Start the worker threads. The cache must be initialized with
+ * init_cache() before.
+ *
+ * @param       parallel
+ * @param       workers     Number of threads, see parallel_workers()
+ *
+ * @return      0 on success, -1 on error
+ */
+int parallel_start(struct Parallel *parallel, uint32_t workers);
+
+/* parallel_feed
+ *
+ * Hand one record to the workers owning its blocks
+ *
+ * @param       parallel
+ * @param       record
+ *
+ * @return      number of cache accesses
+ */
+uint32_t parallel_feed(struct Parallel *parallel, const struct TraceRecord *record);
+
+/* parallel_finish
+ *
+ * Wait until all records are simulated, stop the workers and merge
+ * their counters
+ *
+ * @param       parallel
+ * @param       result      Merged counters
+ * @param       traffic     Merged memory traffic
+ *
+ * @return      void
+ */
+void parallel_finish(struct Parallel *parallel, struct HitMiss *result, struct MemoryTraffic *traffic);
+
+/* parallel_replay
+ *
+ * Replay an in-memory trace with the given number of workers
+ *
+ * @param       trace
+ * @param       workers
+ * @param       result      Merged counters
+ * @param       traffic     Merged memory traffic
+ *
+ * @return      number of cache accesses, -1 if the workers cannot start
+ */
+int64_t parallel_replay(const struct Trace *trace, uint32_t workers, struct HitMiss *result,
+                        struct MemoryTraffic *traffic);
+
+/* parallel_replay_bin
+ *
+ * Replay a binary trace with the given number of workers
+ *
+ * @param       reader
+ * @param       workers
+ * @param       result      Merged counters
+ * @param       traffic     Merged memory traffic
+ *
+ * @return      number of cache accesses, -1 if the workers cannot start,
+ *              -2 if a chunk is corrupt
+ */
+int64_t parallel_replay_bin(const struct TraceBinReader *reader, uint32_t workers,
+                            struct HitMiss *result, struct MemoryTraffic *traffic);
+
+/* parallel_cpus
+ *
+ * Number of online CPUs
+ *
+ * @return      CPUs, at least 1
+ */
+uint32_t parallel_cpus(void);
+
+/* parallel_for
+ *
+ * Run items 0 .. count - 1 on worker threads. Every worker starts on a
+ * contiguous share of the items and steals half of the remaining items
+ * of another worker when it runs out, so items of different cost
+ * balance out. The calling thread is worker 0.
+ *
+ * @param       count       Number of items
+ * @param       workers     Number of threads, 0 for one per CPU
+ * @param       run         Called with the context, item and worker
+ * @param       context
+ *
+ * @return      number of workers used
+ */
+uint32_t parallel_for(uint32_t count, uint32_t workers,
+                      void (*run)(void *context, uint32_t item, uint32_t worker), void *context);
+
+#endif
+/* PARALLEL_H_ */
@@ -0,0 +1,569 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "prefetch.h"
+
+/* Initial slots of the block map */
+#define PREFETCH_MAP_CAPACITY   1024
+
+/* Names of the models */
+static const char *prefetch_names[] = { "none", "next-line", "stride", "stream" };
+
+/* block_entry
+ *
+ * Tracking state of a block
+ *
+ * @param       prefetcher
+ * @param       block       Block number
+ * @param       create      Add an entry if the block has none
+ *
+ * @return      entry, NULL if absent and not created or out of memory
+ */
+static struct PrefetchBlock *block_entry(struct Prefetcher *prefetcher, uint32_t block,
+                                         uint8_t create)
+{
+    /* Local Variables */
+    uint32_t *value;
+
+    if (!create) {
+        uint32_t index = block_map_get(&prefetcher->map, block);
+
+        return index ? &prefetcher->blocks[index - 1] : NULL;
+    }
+
+    value = block_map_find(&prefetcher->map, block);
+    if (value == NULL) {
+        return NULL;
+    }
+    if (*value == 0) {
+        if (prefetcher->block_count == prefetcher->block_capacity) {
+            uint32_t capacity = prefetcher->block_capacity ? 2 * prefetcher->block_capacity
+                                                           : PREFETCH_MAP_CAPACITY;
+            struct PrefetchBlock *blocks = realloc(prefetcher->blocks,
+                                                   capacity * sizeof(*blocks));
+
+            if (blocks == NULL) {
+                return NULL;
+            }
+            prefetcher->blocks = blocks;
+            prefetcher->block_capacity = capacity;
+        }
+        memset(&prefetcher->blocks[prefetcher->block_count], 0, sizeof(*prefetcher->blocks));
+        *value = ++prefetcher->block_count;
+    }
+
+    return &prefetcher->blocks[*value - 1];
+}
+
+/* issue
+ *
+ * Prefetch a block into the cache unless it is present. The block is
+ * usable latency accesses later, the line it replaces is marked as
+ * polluted.
+ *
+ * @param       prefetcher
+ * @param       block       Block number
+ *
+ * @return      void
+ */
+static void issue(struct Prefetcher *prefetcher, uint32_t block)
+{
+    /* Local Variables */
+    uint32_t offset = prefetcher->cache->config.offset;
+    struct PrefetchBlock *entry;
+    uint32_t victim;
+
+    if (cache_probe(prefetcher->cache, block << offset)) {
+        return;
+    }
+    if (cache_fill(prefetcher->cache, block << offset, &victim, &prefetcher->traffic)) {
+        entry = block_entry(prefetcher, victim >> offset, 1);
+        if (entry != NULL) {
+            entry->polluted = 1;
+        }
+    }
+    prefetcher->stats.issued++;
+    prefetcher->stats.prefetch_bytes += 1u << offset;
+
+    entry = block_entry(prefetcher, block, 1);
+    if (entry != NULL) {
+        entry->pending = 1;
+        entry->ready = prefetcher->now + prefetcher->config.latency;
+    }
+}
+
+/* stride_train
+ *
+ * Update the table entry of the region of an address and prefetch the
+ * next strides once the stride is steady
+ *
+ * @param       prefetcher
+ * @param       address
+ *
+ * @return      void
+ */
+static void stride_train(struct Prefetcher *prefetcher, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t region = address / prefetcher->config.region_size;
+    uint32_t offset = prefetcher->cache->config.offset;
+    int32_t block_size = 1 << offset;
+    struct StrideEntry *entry = NULL;
+    struct StrideEntry *lru = &prefetcher->stride[0];
+    int32_t stride;
+    uint32_t k;
+
+    for (k = 0; k < PREFETCH_STRIDE_ENTRIES; k++) {
+        struct StrideEntry *candidate = &prefetcher->stride[k];
+
+        if (candidate->valid && candidate->region == region) {
+            entry = candidate;
+            break;
+        }
+        if (!candidate->valid || (lru->valid && candidate->used < lru->used)) {
+            lru = candidate;
+        }
+    }
+
+    if (entry == NULL) {
+        /* New region, nothing to predict yet */
+        lru->valid = 1;
+        lru->region = region;
+        lru->last = address;
+        lru->stride = 0;
+        lru->state = STRIDE_INITIAL;
+        lru->used = prefetcher->now;
+        return;
+    }
+
+    stride = (int32_t)(address - entry->last);
+    if (stride == entry->stride) {
+        entry->state = entry->state == STRIDE_NO_PREDICTION ? STRIDE_TRANSIENT : STRIDE_STEADY;
+    } else {
+        switch (entry->state) {
+            case STRIDE_STEADY:
+                entry->state = STRIDE_INITIAL;
+                break;
+            case STRIDE_INITIAL:
+                entry->stride = stride;
+                entry->state = STRIDE_TRANSIENT;
+                break;
+            default:
+                entry->stride = stride;
+                entry->state = STRIDE_NO_PREDICTION;
+                break;
+        }
+    }
+    entry->last = address;
+    entry->used = prefetcher->now;
+
+    if (entry->state != STRIDE_STEADY || entry->stride == 0) {
+        return;
+    }
+
+    /* Strides inside a block advance by whole blocks */
+    stride = entry->stride;
+    if (stride > -block_size && stride < block_size) {
+        stride = stride < 0 ? -block_size : block_size;
+    }
+    for (k = 1; k <= prefetcher->config.degree; k++) {
+        issue(prefetcher, (address + (uint32_t)stride * k) >> offset);
+    }
+}
+
+/* stream_take
+ *
+ * Look for a block in the stream buffers. A match moves the block into
+ * the cache, drops the entries before it and tops the buffer up.
+ *
+ * @param       prefetcher
+ * @param       block       Block number
+ *
+ * @return      1 if a buffer held the block, 0 otherwise
+ */
+static uint8_t stream_take(struct Prefetcher *prefetcher, uint32_t block)
+{
+    /* Local Variables */
+    uint32_t offset = prefetcher->cache->config.offset;
+    uint32_t depth = prefetcher->config.depth;
+    uint32_t victim;
+    uint32_t s;
+
+    for (s = 0; s < prefetcher->config.streams; s++) {
+        struct StreamBuffer *buffer = &prefetcher->stream[s];
+        uint32_t k;
+
+        for (k = 0; k < buffer->count; k++) {
+            uint32_t slot = (buffer->head + k) % depth;
+
+            if (buffer->block[slot] != block) {
+                continue;
+            }
+
+            prefetcher->stats.useful++;
+            if (prefetcher->now < buffer->ready[slot]) {
+                prefetcher->stats.late++;
+            }
+            /* Filled on demand, so the victim does not count as pollution */
+            cache_fill(prefetcher->cache, block << offset, &victim, &prefetcher->traffic);
+
+            /* Drop the skipped entries and the taken one */
+            buffer->head = (slot + 1) % depth;
+            buffer->count -= k + 1;
+            buffer->used = prefetcher->now;
+
+            /* Keep the buffer full */
+            while (buffer->count < depth) {
+                slot = (buffer->head + buffer->count) % depth;
+                buffer->block[slot] = buffer->next++;
+                buffer->ready[slot] = prefetcher->now + prefetcher->config.latency;
+                buffer->count++;
+                prefetcher->stats.issued++;
+                prefetcher->stats.prefetch_bytes += 1u << offset;
+            }
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* stream_allocate
+ *
+ * Start a stream behind a missing block in the least recently used
+ * buffer
+ *
+ * @param       prefetcher
+ * @param       block       Block number of the miss
+ *
+ * @return      void
+ */
+static void stream_allocate(struct Prefetcher *prefetcher, uint32_t block)
+{
+    /* Local Variables */
+    struct StreamBuffer *buffer = &prefetcher->stream[0];
+    uint32_t offset = prefetcher->cache->config.offset;
+    uint32_t k;
+
+    for (k = 1; k < prefetcher->config.streams; k++) {
+        if (prefetcher->stream[k].used < buffer->used) {
+            buffer = &prefetcher->stream[k];
+        }
+    }
+
+    buffer->head = 0;
+    buffer->count = prefetcher->config.depth;
+    buffer->next = block + 1 + prefetcher->config.depth;
+    buffer->used = prefetcher->now;
+    for (k = 0; k < prefetcher->config.depth; k++) {
+        buffer->block[k] = block + 1 + k;
+        buffer->ready[k] = prefetcher->now + prefetcher->config.latency;
+    }
+    prefetcher->stats.issued += prefetcher->config.depth;
+    prefetcher->stats.prefetch_bytes += (uint64_t)prefetcher->config.depth << offset;
+}
+
+/* prefetch_init
+ *
+ * Initialize a prefetcher in front of a cache
+ *
+ * @param       prefetcher
+ * @param       cache
+ * @param       config
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int prefetch_init(struct Prefetcher *prefetcher, struct Cache *cache,
+                  const struct PrefetchConfig *config)
+{
+    memset(prefetcher, 0, sizeof(*prefetcher));
+    if (config->type >= PREFETCH_TYPES || config->region_size == 0 ||
+        config->streams < 1 || config->streams > PREFETCH_MAX_STREAMS ||
+        config->depth < 1 || config->depth > PREFETCH_MAX_DEPTH) {
+        return -1;
+    }
+    if (block_map_init(&prefetcher->map, PREFETCH_MAP_CAPACITY) != 0) {
+        return -1;
+    }
+    prefetcher->config = *config;
+    prefetcher->cache = cache;
+    prefetch_select(prefetcher, config->type);
+
+    return 0;
+}
+
+/* prefetch_free
+ *
+ * Release a prefetcher
+ *
+ * @param       prefetcher
+ *
+ * @return      void
+ */
+void prefetch_free(struct Prefetcher *prefetcher)
+{
+    block_map_free(&prefetcher->map);
+    free(prefetcher->blocks);
+    prefetcher->blocks = NULL;
+    prefetcher->block_count = 0;
+    prefetcher->block_capacity = 0;
+}
+
+/* prefetch_select
+ *
+ * Switch to another model. Resets the cache, the model state and the
+ * statistics, so every model starts from the same point.
+ *
+ * @param       prefetcher
+ * @param       type
+ *
+ * @return      void
+ */
+void prefetch_select(struct Prefetcher *prefetcher, prefetch_t type)
+{
+    /* Local Variables */
+    uint32_t i;
+
+    prefetcher->config.type = type;
+    cache_reset(prefetcher->cache);
+    prefetcher->now = 0;
+    memset(prefetcher->stride, 0, sizeof(prefetcher->stride));
+    memset(prefetcher->stream, 0, sizeof(prefetcher->stream));
+    memset(&prefetcher->traffic, 0, sizeof(prefetcher->traffic));
+    memset(&prefetcher->stats, 0, sizeof(prefetcher->stats));
+
+    /* Forget all tracked blocks but keep the storage */
+    for (i = 0; i < prefetcher->map.capacity; i++) {
+        prefetcher->map.values[i] = 0;
+    }
+    prefetcher->map.count = 0;
+    prefetcher->block_count = 0;
+}
+
+/* prefetch_access
+ *
+ * Run one demand access to a block through the prefetcher and the
+ * cache
+ *
+ * @param       prefetcher
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes inside the block
+ *
+ * @return      result of the demand access
+ */
+result_t prefetch_access(struct Prefetcher *prefetcher, uint32_t address, access_t access,
+                         uint8_t size)
+{
+    /* Local Variables */
+    uint32_t block = address >> prefetcher->cache->config.offset;
+    prefetch_t type = prefetcher->config.type;
+    struct HitMiss counter = { 0 };
+    struct PrefetchBlock *entry;
+    uint8_t first_use = 0;
+    result_t result;
+
+    prefetcher->now++;
+    prefetcher->stats.accesses++;
+
+    /* A stream buffer hit supplies the block before the cache sees it */
+    if (type == PREFETCH_STREAM && !cache_probe(prefetcher->cache, address)) {
+        stream_take(prefetcher, block);
+    }
+
+    result = cache_access_counted(prefetcher->cache, address, access, size, &counter,
+                                  &prefetcher->traffic);
+    if (result == RESULT_HIT) {
+        prefetcher->stats.hits++;
+    } else {
+        prefetcher->stats.misses++;
+    }
+
+    entry = block_entry(prefetcher, block, 0);
+    if (entry != NULL) {
+        if (entry->polluted && result == RESULT_MISS) {
+            prefetcher->stats.pollution++;
+        }
+        entry->polluted = 0;
+        if (entry->pending && result == RESULT_HIT) {
+            prefetcher->stats.useful++;
+            if (prefetcher->now < entry->ready) {
+                prefetcher->stats.late++;
+            }
+            first_use = 1;
+        }
+        entry->pending = 0;
+    }
+
+    switch (type) {
+        case PREFETCH_NEXT_LINE:
+            /* Tagged: a miss or the first use of a prefetched block */
+            if (result == RESULT_MISS || first_use) {
+                uint32_t k;
+
+                for (k = 1; k <= prefetcher->config.degree; k++) {
+                    issue(prefetcher, block + k);
+                }
+            }
+            break;
+        case PREFETCH_STRIDE:
+            stride_train(prefetcher, address);
+            break;
+        case PREFETCH_STREAM:
+            if (result == RESULT_MISS) {
+                stream_allocate(prefetcher, block);
+            }
+            break;
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/* prefetch_record
+ *
+ * Run every block access of a record through the prefetcher
+ *
+ * @param       prefetcher
+ * @param       record
+ *
+ * @return      number of demand accesses
+ */
+uint32_t prefetch_record(struct Prefetcher *prefetcher, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t offset = prefetcher->cache->config.offset;
+    uint32_t block = record->address >> offset;
+    uint32_t last = (record->address + record->size - 1) >> offset;
+    uint32_t accesses = 1;
+
+    prefetch_access(prefetcher, record->address, (access_t)record->access,
+                    trace_block_bytes(record, record->address, offset));
+
+    /* Remaining blocks of an access crossing a block boundary */
+    while (block != last) {
+        block++;
+        prefetch_access(prefetcher, block << offset, (access_t)record->access,
+                        trace_block_bytes(record, block << offset, offset));
+        accesses++;
+    }
+
+    return accesses;
+}
+
+/* prefetch_replay
+ *
+ * Run all records of an in-memory trace through the prefetcher
+ *
+ * @param       prefetcher
+ * @param       trace
+ *
+ * @return      number of demand accesses
+ */
+uint64_t prefetch_replay(struct Prefetcher *prefetcher, const struct Trace *trace)
+{
+    /* Local Variables */
+    uint64_t accesses = 0;
+    size_t i;
+
+    for (i = 0; i < trace->count; i++) {
+        accesses += prefetch_record(prefetcher, &trace->records[i]);
+    }
+
+    return accesses;
+}
+
+/* prefetch_replay_bin
+ *
+ * Run all records of a binary trace through the prefetcher
+ *
+ * @param       prefetcher
+ * @param       reader
+ *
+ * @return      number of demand accesses, -1 if a chunk is corrupt
+ */
+int64_t prefetch_replay_bin(struct Prefetcher *prefetcher, const struct TraceBinReader *reader)
+{
+    /* Local Variables */
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    uint64_t accesses = 0;
+    uint32_t chunk;
+    int decoded = 0;
+
+    for (chunk = 0; chunk < reader->chunk_count && decoded >= 0; chunk++) {
+        trace_bin_cursor(reader, chunk, &cursor);
+        while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+            accesses += prefetch_record(prefetcher, &record);
+        }
+    }
+
+    return decoded < 0 ? -1 : (int64_t)accesses;
+}
+
+/* prefetch_name
+ *
+ * Name of a model
+ *
+ * @param       type
+ *
+ * @return      name
+ */
+const char *prefetch_name(prefetch_t type)
+{
+    return type < PREFETCH_TYPES ? prefetch_names[type] : "?";
+}
+
+/* prefetch_print_header
+ *
+ * Print the column names of prefetch_print()
+ *
+ * @param       file
+ *
+ * @return      void
+ */
+void prefetch_print_header(FILE *file)
+{
+    fprintf(file, "%-10s %10s %10s %10s %10s %8s %8s %8s %10s %12s\n", "PREFETCH", "HITS",
+            "MISSES", "ISSUED", "USEFUL", "COVER %", "ACCUR %", "TIMELY %", "POLLUTION",
+            "TRAFFIC");
+}
+
+/* prefetch_print
+ *
+ * Print the statistics of the current model as one row
+ *
+ * @param       prefetcher
+ * @param       file
+ *
+ * @return      void
+ */
+void prefetch_print(const struct Prefetcher *prefetcher, FILE *file)
+{
+    /* Local Variables */
+    const struct PrefetchStats *stats = &prefetcher->stats;
+    const struct MemoryTraffic *traffic = &prefetcher->traffic;
+    uint64_t covered = stats->useful + stats->misses;
+    uint64_t bytes = traffic->fill_bytes + traffic->writeback_bytes +
+                     traffic->write_through_bytes + stats->prefetch_bytes;
+
+    fprintf(file, "%-10s %10llu %10llu %10llu %10llu %8.2f %8.2f %8.2f %10llu %12llu\n",
+            prefetch_name(prefetcher->config.type), (unsigned long long)stats->hits,
+            (unsigned long long)stats->misses, (unsigned long long)stats->issued,
+            (unsigned long long)stats->useful,
+            covered ? 100.0 * stats->useful / covered : 0.0,
+            stats->issued ? 100.0 * stats->useful / stats->issued : 0.0,
+            stats->useful ? 100.0 * (stats->useful - stats->late) / stats->useful : 0.0,
+            (unsigned long long)stats->pollution, (unsigned long long)bytes);
+}
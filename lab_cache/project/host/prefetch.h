@@ -0,0 +1,266 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Hardware prefetcher models
+ *
+ * A prefetcher sits in front of a cache instance and observes its
+ * demand stream. The model can be switched at runtime:
+ *
+ *   next-line   on a miss or the first use of a prefetched block, the
+ *               next N blocks are fetched (tagged prefetching)
+ *   stride      reference prediction table without PCs: one entry per
+ *               address region (by default one array), trained with
+ *               the distance between consecutive accesses to the
+ *               region. A steady stride fetches the next N strides.
+ *   stream      stream buffers: a miss allocates a buffer holding the
+ *               next blocks. A miss that finds its block in a buffer
+ *               takes it from there, and the buffer fetches one more.
+ *               Buffered blocks stay out of the cache until used.
+ *
+ * Next-line and stride prefetch into the cache itself. Time is counted
+ * in demand accesses, a prefetch is ready latency accesses after it
+ * was issued.
+ *
+ *   coverage     useful / (useful + remaining demand misses)
+ *   accuracy     useful / issued
+ *   timeliness   share of the useful prefetches that were ready in
+ *                time (late ones still save part of the miss)
+ *   pollution    demand misses on blocks a prefetch had evicted
+ */
+
+#ifndef PREFETCH_H_
+#define PREFETCH_H_
+
+#include <stdio.h>
+
+/* User includes */
+#include "trace_bin.h"
+#include "block_map.h"
+
+/* Table and buffer limits */
+#define PREFETCH_STRIDE_ENTRIES     16
+#define PREFETCH_MAX_STREAMS        16
+#define PREFETCH_MAX_DEPTH          16
+
+/* Typedefs */
+typedef enum {
+    PREFETCH_NONE,
+    PREFETCH_NEXT_LINE,
+    PREFETCH_STRIDE,
+    PREFETCH_STREAM,
+    PREFETCH_TYPES
+} prefetch_t;
+
+/* States of a stride table entry (Chen and Baer) */
+typedef enum {
+    STRIDE_INITIAL,
+    STRIDE_TRANSIENT,
+    STRIDE_STEADY,
+    STRIDE_NO_PREDICTION
+} stride_state_t;
+
+/* PrefetchConfig
+ *
+ * Model and its parameters
+ */
+struct PrefetchConfig {
+    prefetch_t type;
+    uint32_t degree;        /* Blocks or strides ahead, next-line and stride */
+    uint32_t streams;       /* Stream buffers */
+    uint32_t depth;         /* Blocks per stream buffer */
+    uint32_t region_size;   /* Bytes per stride table region */
+    uint32_t latency;       /* Demand accesses until a prefetch arrives */
+};
+
+/* PrefetchStats
+ *
+ * Demand results and prefetch effectiveness
+ */
+struct PrefetchStats {
+    uint64_t accesses;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t issued;
+    uint64_t useful;
+    uint64_t late;
+    uint64_t pollution;
+    uint64_t prefetch_bytes;
+};
+
+/* StrideEntry
+ *
+ * Reference prediction table entry of one region
+ */
+struct StrideEntry {
+    uint32_t region;
+    uint32_t last;
+    int32_t stride;
+    uint8_t state;
+    uint8_t valid;
+    uint64_t used;
+};
+
+/* StreamBuffer
+ *
+ * FIFO of prefetched blocks following a miss
+ */
+struct StreamBuffer {
+    uint32_t block[PREFETCH_MAX_DEPTH];
+    uint64_t ready[PREFETCH_MAX_DEPTH];
+    uint32_t head;
+    uint32_t count;
+    uint32_t next;
+    uint64_t used;
+};
+
+/* PrefetchBlock
+ *
+ * Tracking state of a block that was prefetched or evicted by a
+ * prefetch
+ */
+struct PrefetchBlock {
+    uint64_t ready;
+    uint8_t pending;        /* Prefetched into the cache, not used yet */
+    uint8_t polluted;       /* Evicted by a prefetch, not accessed since */
+};
+
+/* Prefetcher
+ *
+ * Prefetcher state in front of one cache
+ */
+struct Prefetcher {
+    struct PrefetchConfig config;
+    struct Cache *cache;
+    uint64_t now;
+    struct StrideEntry stride[PREFETCH_STRIDE_ENTRIES];
+    struct StreamBuffer stream[PREFETCH_MAX_STREAMS];
+    struct BlockMap map;
+    struct PrefetchBlock *blocks;
+    uint32_t block_count;
+    uint32_t block_capacity;
+    struct MemoryTraffic traffic;
+    struct PrefetchStats stats;
+};
+
+/* prefetch_init
+ *
+ * Initialize a prefetcher in front of a cache
+ *
+ * @param       prefetcher
+ * @param       cache
+ * @param       config
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+int prefetch_init(struct Prefetcher *prefetcher, struct Cache *cache,
+                  const struct PrefetchConfig *config);
+
+/* prefetch_free
+ *
+ * Release a prefetcher
+ *
+ * @param       prefetcher
+ *
+ * @return      void
+ */
+void prefetch_free(struct Prefetcher *prefetcher);
+
+/* prefetch_select
+ *
+ * Switch to another model. Resets the cache, the model state and the
+ * statistics, so every model starts from the same point.
+ *
+ * @param       prefetcher
+ * @param       type
+ *
+ * @return      void
+ */
+void prefetch_select(struct Prefetcher *prefetcher, prefetch_t type);
+
+/* prefetch_access
+ *
+ * Run one demand access to a block through the prefetcher and the
+ * cache
+ *
+ * @param       prefetcher
+ * @param       address
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       size        Bytes inside the block
+ *
+ * @return      result of the demand access
+ */
+result_t prefetch_access(struct Prefetcher *prefetcher, uint32_t address, access_t access,
+                         uint8_t size);
+
+/* prefetch_record
+ *
+ * Run every block access of a record through the prefetcher
+ *
+ * @param       prefetcher
+ * @param       record
+ *
+ * @return      number of demand accesses
+ */
+uint32_t prefetch_record(struct Prefetcher *prefetcher, const struct TraceRecord *record);
+
+/* prefetch_replay
+ *
+ * Run all records of an in-memory trace through the prefetcher
+ *
+ * @param       prefetcher
+ * @param       trace
+ *
+ * @return      number of demand accesses
+ */
+uint64_t prefetch_replay(struct Prefetcher *prefetcher, const struct Trace *trace);
+
+/* prefetch_replay_bin
+ *
+ * Run all records of a binary trace through the prefetcher
+ *
+ * @param       prefetcher
+ * @param       reader
+ *
+ * @return      number of demand accesses, -1 if a chunk is corrupt
+ */
+int64_t prefetch_replay_bin(struct Prefetcher *prefetcher, const struct TraceBinReader *reader);
+
+/* prefetch_name
+ *
+ * Name of a model
+ *
+ * @param       type
+ *
+ * @return      name
+ */
+const char *prefetch_name(prefetch_t type);
+
+/* prefetch_print_header
+ *
+ * Print the column names of prefetch_print()
+ *
+ * @param       file
+ *
+ * @return      void
+ */
+void prefetch_print_header(FILE *file);
+
+/* prefetch_print
+ *
+ * Print the statistics of the current model as one row
+ *
+ * @param       prefetcher
+ * @param       file
+ *
+ * @return      void
+ */
+void prefetch_print(const struct Prefetcher *prefetcher, FILE *file);
+
+#endif
+/* PREFETCH_H_ */
@@ -0,0 +1,189 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, prefetcher simulator
+ * --
+ * -- Usage       : prefsim [-p model] [-d degree] [-s streams]
+ * --                       [-b depth] [-r bytes] [-l accesses] [trace]
+ * --               -p  none, next, stride, stream or all (default),
+ * --                   every model runs on an empty config.h cache
+ * --               -d  blocks or strides ahead (default 1)
+ * --               -s  stream buffers (default 4)
+ * --               -b  blocks per stream buffer (default 4)
+ * --               -r  stride table region in bytes (default one
+ * --                   array)
+ * --               -l  prefetch latency in accesses (default 2)
+ * --               Without a trace the a = b + c kernel of main.c is
+ * --               simulated.
+ * --------------------------------------------------------------- */
+
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "prefetch.h"
+#include "config.h"
+
+/* usage
+ *
+ * Print the command line help
+ *
+ * @param       name        Program name
+ *
+ * @return      exit code
+ */
+static int usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-p none|next|stride|stream|all] [-d degree] [-s streams] "
+            "[-b depth] [-r bytes] [-l accesses] [trace]\n", name);
+
+    return 2;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static const char *models[] = { "none", "next", "stride", "stream" };
+    struct PrefetchConfig config;
+    struct CacheConfig cache_config;
+    struct Cache cache;
+    struct Prefetcher prefetcher;
+    struct Trace trace;
+    struct TraceBinReader reader;
+    const char *path = NULL;
+    int all = 1;
+    int binary;
+    uint64_t accesses = 0;
+    double start;
+    double seconds = 0.0;
+    int64_t replayed;
+    uint32_t type;
+    int option;
+
+    memset(&config, 0, sizeof(config));
+    config.degree = 1;
+    config.streams = 4;
+    config.depth = 4;
+    config.region_size = ITEM_SIZE * ARRAY_ROWS * ARRAY_COLUMNS;
+    config.latency = 2;
+
+    while ((option = getopt(argc, argv, "p:d:s:b:r:l:")) != -1) {
+        switch (option) {
+            case 'p':
+                all = strcmp(optarg, "all") == 0;
+                for (type = 0; !all && type < PREFETCH_TYPES; type++) {
+                    if (strcmp(optarg, models[type]) == 0) {
+                        break;
+                    }
+                }
+                if (!all && type == PREFETCH_TYPES) {
+                    return usage(argv[0]);
+                }
+                config.type = all ? PREFETCH_NONE : (prefetch_t)type;
+                break;
+            case 'd':
+                config.degree = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                config.streams = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                config.depth = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                config.region_size = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                config.latency = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind++];
+    }
+    if (optind < argc) {
+        return usage(argv[0]);
+    }
+
+    /* The prefetchers observe a cache of the config.h geometry */
+    cache_config.offset = OFFSET;
+    cache_config.index = INDEX;
+    cache_config.ways = WAYS;
+    cache_config.replacement = REPLACEMENT;
+    cache_config.write_policy = WRITE_POLICY;
+    cache_config.write_miss = WRITE_MISS;
+    cache_config.index_function = INDEX_FUNCTION;
+    if (cache_alloc(&cache, &cache_config) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    if (prefetch_init(&prefetcher, &cache, &config) != 0) {
+        fprintf(stderr, "invalid prefetcher\n");
+        cache_release(&cache);
+        return 1;
+    }
+    printf("CACHE: offset %d index %d ways %d\n", OFFSET, INDEX, WAYS);
+    printf("PREFETCH: degree %u streams %u depth %u region %u latency %u\n", config.degree,
+           config.streams, config.depth, config.region_size, config.latency);
+
+    /* Load before timing, the replay does no I/O */
+    trace_init(&trace);
+    binary = path != NULL && trace_bin_is_binary(path);
+    if (binary) {
+        if (trace_bin_open(&reader, path) != 0) {
+            prefetch_free(&prefetcher);
+            cache_release(&cache);
+            return 1;
+        }
+    } else if ((path != NULL ? trace_load_text(path, &trace) : trace_kernel(&trace)) != 0) {
+        trace_free(&trace);
+        prefetch_free(&prefetcher);
+        cache_release(&cache);
+        return 1;
+    }
+
+    prefetch_print_header(stdout);
+    for (type = 0; type < PREFETCH_TYPES; type++) {
+        if (!all && type != config.type) {
+            continue;
+        }
+        prefetch_select(&prefetcher, (prefetch_t)type);
+
+        start = host_time();
+        replayed = binary ? prefetch_replay_bin(&prefetcher, &reader)
+                          : (int64_t)prefetch_replay(&prefetcher, &trace);
+        seconds += host_time() - start;
+        if (replayed < 0) {
+            fprintf(stderr, "%s: corrupt chunk\n", path);
+            trace_bin_close(&reader);
+            prefetch_free(&prefetcher);
+            cache_release(&cache);
+            return 1;
+        }
+        accesses += (uint64_t)replayed;
+
+        /* Dirty lines left at the end still cost a write-back */
+        cache_flush(&cache, &prefetcher.traffic);
+        prefetch_print(&prefetcher, stdout);
+    }
+    print_throughput(accesses, seconds);
+
+    if (binary) {
+        trace_bin_close(&reader);
+    }
+    trace_free(&trace);
+    prefetch_free(&prefetcher);
+    cache_release(&cache);
+
+    return 0;
+}
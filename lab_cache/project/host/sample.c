@@ -0,0 +1,340 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <string.h>
+
+/* User includes */
+#include "sample.h"
+
+/* Sampler
+ *
+ * State of one sampled run
+ */
+struct Sampler {
+    cache_t *cache;
+    struct SampleResult *result;
+    uint64_t period;
+    uint64_t detail_start;      /* Position of the window in a period */
+    uint64_t warm_start;        /* Position of the warm-up in a period */
+
+    /* Open window */
+    uint64_t accesses;
+    uint64_t misses;
+    struct MemoryTraffic traffic;
+
+    /* Uncounted accesses of the warm-up */
+    struct HitMiss scratch;
+    struct MemoryTraffic scratch_traffic;
+
+    /* Sums over the closed windows for the ratio estimator */
+    double sum_a;
+    double sum_m;
+    double sum_a2;
+    double sum_m2;
+    double sum_am;
+};
+
+/* sampler_init
+ *
+ * Reset a sampler and its result
+ *
+ * @param       sampler
+ * @param       config
+ * @param       cache
+ * @param       result
+ *
+ * @return      void
+ */
+static void sampler_init(struct Sampler *sampler, const struct SampleConfig *config,
+                         cache_t *cache, struct SampleResult *result)
+{
+    memset(sampler, 0, sizeof(*sampler));
+    memset(result, 0, sizeof(*result));
+    sampler->cache = cache;
+    sampler->result = result;
+    sampler->period = config->period;
+    sampler->detail_start = config->period - config->unit;
+    sampler->warm_start = sampler->detail_start > config->warmup
+                          ? sampler->detail_start - config->warmup : 0;
+}
+
+/* sampler_next
+ *
+ * First record at or after n that is warmed or measured
+ *
+ * @param       sampler
+ * @param       n           Record number
+ *
+ * @return      record number
+ */
+static uint64_t sampler_next(const struct Sampler *sampler, uint64_t n)
+{
+    /* Local Variables */
+    uint64_t position = n % sampler->period;
+
+    return position < sampler->warm_start ? n - position + sampler->warm_start : n;
+}
+
+/* sampler_access
+ *
+ * Run one record through the cache, one access per block
+ *
+ * @param       sampler
+ * @param       record
+ * @param       counter
+ * @param       traffic
+ * @param       misses      Incremented per missed block
+ *
+ * @return      number of block accesses
+ */
+static uint32_t sampler_access(struct Sampler *sampler, const struct TraceRecord *record,
+                               struct HitMiss *counter, struct MemoryTraffic *traffic,
+                               uint64_t *misses)
+{
+    /* Local Variables */
+    cache_t *cache = sampler->cache;
+    uint32_t offset = cache->config.offset;
+    uint32_t address = record->address;
+    uint32_t last = (record->address + record->size - 1) >> offset;
+    uint32_t accesses = 1;
+
+    while (1) {
+        *misses += cache_access_counted(cache, address, (access_t)record->access,
+                                        trace_block_bytes(record, address, offset), counter,
+                                        traffic) != RESULT_HIT;
+        if ((address >> offset) == last) {
+            break;
+        }
+        address = ((address >> offset) + 1) << offset;
+        accesses++;
+    }
+
+    return accesses;
+}
+
+/* sampler_visit
+ *
+ * Warm or measure record n, close the window after its last record
+ *
+ * @param       sampler
+ * @param       n           Record number, not before sampler_next(n)
+ * @param       record
+ *
+ * @return      void
+ */
+static void sampler_visit(struct Sampler *sampler, uint64_t n, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct SampleResult *result = sampler->result;
+    uint64_t position = n % sampler->period;
+    uint64_t ignored = 0;
+    double a;
+    double m;
+
+    if (position < sampler->detail_start) {
+        sampler_access(sampler, record, &sampler->scratch, &sampler->scratch_traffic, &ignored);
+        result->warmed++;
+        return;
+    }
+    sampler->accesses += sampler_access(sampler, record, &sampler->scratch, &sampler->traffic,
+                                        &sampler->misses);
+    if (position != sampler->period - 1) {
+        return;
+    }
+
+    /* Window complete */
+    a = (double)sampler->accesses;
+    m = (double)sampler->misses;
+    sampler->sum_a += a;
+    sampler->sum_m += m;
+    sampler->sum_a2 += a * a;
+    sampler->sum_m2 += m * m;
+    sampler->sum_am += a * m;
+    result->windows++;
+    result->detailed += sampler->period - sampler->detail_start;
+    result->accesses += sampler->accesses;
+    result->misses += sampler->misses;
+    result->traffic.fill_bytes += sampler->traffic.fill_bytes;
+    result->traffic.write_through_bytes += sampler->traffic.write_through_bytes;
+    result->traffic.writeback_bytes += sampler->traffic.writeback_bytes;
+    sampler->accesses = 0;
+    sampler->misses = 0;
+    memset(&sampler->traffic, 0, sizeof(sampler->traffic));
+}
+
+/* sampler_finish
+ *
+ * Compute the estimates of the closed windows
+ *
+ * @param       sampler
+ * @param       records     Records of the trace
+ *
+ * @return      void
+ */
+static void sampler_finish(struct Sampler *sampler, uint64_t records)
+{
+    /* Local Variables */
+    struct SampleResult *result = sampler->result;
+    double n = (double)result->windows;
+    double fraction = (double)(sampler->period - sampler->detail_start) / sampler->period;
+    double rate;
+    double residual;
+    double variance;
+    double relative;
+
+    result->records = records;
+    result->hits = result->accesses - result->misses;
+    if (result->accesses == 0) {
+        return;
+    }
+
+    rate = sampler->sum_m / sampler->sum_a;
+    result->miss_rate = rate;
+    result->est_accesses = (double)records * sampler->sum_a / result->detailed;
+    result->est_misses = rate * result->est_accesses;
+    if (result->windows < 2) {
+        result->half_width = HUGE_VAL;
+        return;
+    }
+
+    /* Variance of the ratio estimator: sum (m - R a)^2 / (n (n - 1) mean(a)^2) */
+    residual = sampler->sum_m2 - 2 * rate * sampler->sum_am + rate * rate * sampler->sum_a2;
+    residual = residual > 0 ? residual : 0;
+    variance = (1 - fraction) * residual * n / ((n - 1) * sampler->sum_a * sampler->sum_a);
+    result->half_width = SAMPLE_Z * sqrt(variance);
+
+    /* The half width shrinks with the square root of the windows */
+    relative = rate > 0 ? result->half_width / rate : 0;
+    result->windows_needed = (uint64_t)ceil(n * (relative / SAMPLE_TARGET) *
+                                            (relative / SAMPLE_TARGET));
+}
+
+/* sample_config_valid
+ *
+ * Check a window layout
+ *
+ * @param       config
+ *
+ * @return      1 if 0 < unit <= period, 0 otherwise
+ */
+int sample_config_valid(const struct SampleConfig *config)
+{
+    return config->unit > 0 && config->unit <= config->period;
+}
+
+/* sample_trace
+ *
+ * Sample an in-memory trace
+ *
+ * @param       config
+ * @param       cache       Warm or cold cache, its own counters stay as they are
+ * @param       trace
+ * @param       result
+ *
+ * @return      void
+ */
+void sample_trace(const struct SampleConfig *config, cache_t *cache, const struct Trace *trace,
+                  struct SampleResult *result)
+{
+    /* Local Variables */
+    struct Sampler sampler;
+    uint64_t n;
+
+    sampler_init(&sampler, config, cache, result);
+    for (n = sampler_next(&sampler, 0); n < trace->count; n = sampler_next(&sampler, n + 1)) {
+        sampler_visit(&sampler, n, &trace->records[n]);
+    }
+    sampler_finish(&sampler, trace->count);
+}
+
+/* sample_bin
+ *
+ * Sample a binary trace, skipping the chunks no window or warm-up
+ * touches
+ *
+ * @param       config
+ * @param       cache       Warm or cold cache, its own counters stay as they are
+ * @param       reader
+ * @param       result
+ *
+ * @return      0 on success, -1 if a chunk is corrupt
+ */
+int sample_bin(const struct SampleConfig *config, cache_t *cache,
+               const struct TraceBinReader *reader, struct SampleResult *result)
+{
+    /* Local Variables */
+    struct Sampler sampler;
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    uint64_t want;
+    uint32_t chunk;
+    int status = 0;
+
+    sampler_init(&sampler, config, cache, result);
+    want = sampler_next(&sampler, 0);
+    for (chunk = 0; chunk < reader->chunk_count && status == 0; chunk++) {
+        const struct TraceBinChunk *entry = &reader->index[chunk];
+        uint64_t n = entry->first_record;
+        int decoded;
+
+        /* Records are delta coded from the chunk start, a chunk is
+         * decoded from its first record up to the last one needed */
+        if (want >= entry->first_record + entry->records) {
+            continue;
+        }
+        trace_bin_cursor(reader, chunk, &cursor);
+        while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+            if (n == want) {
+                sampler_visit(&sampler, n, &record);
+                want = sampler_next(&sampler, n + 1);
+            }
+            n++;
+            if (want >= entry->first_record + entry->records) {
+                break;
+            }
+        }
+        if (decoded < 0) {
+            status = -1;
+        }
+    }
+    sampler_finish(&sampler, reader->record_count);
+
+    return status;
+}
+
+/* sample_print
+ *
+ * Print the estimates of a sampled run
+ *
+ * @param       result
+ * @param       out
+ *
+ * @return      void
+ */
+void sample_print(const struct SampleResult *result, FILE *out)
+{
+    fprintf(out, "SAMPLE: %llu windows, %llu of %llu records measured (%.2f %%), %llu warmed\n",
+            (unsigned long long)result->windows, (unsigned long long)result->detailed,
+            (unsigned long long)result->records,
+            result->records ? 100.0 * result->detailed / result->records : 0.0,
+            (unsigned long long)result->warmed);
+    fprintf(out, "WINDOWS: HITS: %llu  MISSES: %llu  ACCESSES: %llu\n",
+            (unsigned long long)result->hits, (unsigned long long)result->misses,
+            (unsigned long long)result->accesses);
+    fprintf(out, "MISS RATE: %.4f %% +- %.4f %% (95 %% confidence, %.2f %% relative)\n",
+            100.0 * result->miss_rate, 100.0 * result->half_width,
+            result->miss_rate > 0 ? 100.0 * result->half_width / result->miss_rate : 0.0);
+    fprintf(out, "ESTIMATE: HITS: %.0f  MISSES: %.0f  ACCESSES: %.0f\n",
+            result->est_accesses - result->est_misses, result->est_misses, result->est_accesses);
+    if (result->windows_needed > result->windows) {
+        fprintf(out, "WINDOWS NEEDED: %llu for %.0f %% relative error\n",
+                (unsigned long long)result->windows_needed, 100.0 * SAMPLE_TARGET);
+    }
+}
@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Sampled simulation
+ *
+ * SMARTS style systematic sampling. The trace is cut into periods of
+ * `period` records, the last `unit` records of every period are a
+ * detailed window whose hits, misses and traffic are counted:
+ *
+ *   | skip ........ | warm-up ...... | window |  skip ...
+ *   |<------------------ period ------------->|
+ *
+ * The `warmup` records before a window run through the cache as well,
+ * so its tags, replacement state and dirty bits are current, but are
+ * not counted (functional warming). With a warm-up of period - unit or
+ * more every record updates the cache and only the counting is saved.
+ * Shorter warm-ups skip the records in between: in memory they are
+ * passed over, in a binary trace whole chunks are never decoded. A
+ * warm-up of a few times the cache size keeps the stale state bias
+ * well below the sampling error.
+ *
+ * The miss rate is the ratio of the window misses to the window block
+ * accesses. Its confidence interval uses the variance of that ratio
+ * estimator over the windows, with the finite population correction
+ * 1 - unit / period, so sampling every record gives the exact result
+ * with a zero interval. Incomplete windows at the end of the trace are
+ * dropped.
+ */
+
+#ifndef SAMPLE_H_
+#define SAMPLE_H_
+
+#include <stdio.h>
+
+/* User includes */
+#include "cache.h"
+#include "trace.h"
+#include "trace_bin.h"
+
+/* Default detailed window, records */
+#define SAMPLE_UNIT     1000
+
+/* Default period, records */
+#define SAMPLE_PERIOD   100000
+
+/* Default warm-up, records */
+#define SAMPLE_WARMUP   20000
+
+/* Normal quantile of the 95 % confidence interval */
+#define SAMPLE_Z        1.96
+
+/* Relative error the needed number of windows is given for */
+#define SAMPLE_TARGET   0.01
+
+/* SampleConfig
+ *
+ * Window layout, all in trace records
+ */
+struct SampleConfig {
+    uint64_t unit;              /* Detailed records per window */
+    uint64_t period;            /* Records from one window to the next */
+    uint64_t warmup;            /* Warmed records before a window */
+};
+
+/* SampleResult
+ *
+ * Counters of the windows and the estimates for the whole trace
+ */
+struct SampleResult {
+    uint64_t records;           /* Records of the trace */
+    uint64_t warmed;            /* Records run through the cache, uncounted */
+    uint64_t detailed;          /* Records of the windows */
+    uint64_t windows;
+    uint64_t accesses;          /* Block accesses of the windows */
+    uint64_t hits;
+    uint64_t misses;
+    struct MemoryTraffic traffic;
+
+    double miss_rate;           /* Estimate */
+    double half_width;          /* Of the confidence interval, absolute */
+    double est_accesses;        /* Block accesses of the trace */
+    double est_misses;
+    uint64_t windows_needed;    /* For SAMPLE_TARGET relative error */
+};
+
+/* sample_config_valid
+ *
+ * Check a window layout
+ *
+ * @param       config
+ *
+ * @return      1 if 0 < unit <= period, 0 otherwise
+ */
+int sample_config_valid(const struct SampleConfig *config);
+
+/* sample_trace
+ *
+ * Sample an in-memory trace
+ *
+ * @param       config
+ * @param       cache       Warm or cold cache, its own counters stay as they are
+ * @param       trace
+ * @param       result
+ *
+ * @return      void
+ */
+void sample_trace(const struct SampleConfig *config, cache_t *cache, const struct Trace *trace,
+                  struct SampleResult *result);
+
+/* sample_bin
+ *
+ * Sample a binary trace, skipping the chunks no window or warm-up
+ * touches
+ *
+ * @param       config
+ * @param       cache       Warm or cold cache, its own counters stay as they are
+ * @param       reader
+ * @param       result
+ *
+ * @return      0 on success, -1 if a chunk is corrupt
+ */
+int sample_bin(const struct SampleConfig *config, cache_t *cache,
+               const struct TraceBinReader *reader, struct SampleResult *result);
+
+/* sample_print
+ *
+ * Print the estimates of a sampled run
+ *
+ * @param       result
+ * @param       out
+ *
+ * @return      void
+ */
+void sample_print(const struct SampleResult *result, FILE *out);
+
+#endif
+/* SAMPLE_H_ */
@@ -0,0 +1,209 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Host replacement of simulation.c: writes to stdout instead of the LCD */
+
+#include <stdlib.h>
+#include <time.h>
+
+/* User includes */
+#include "sim_host.h"
+
+/* print_results
+ *
+ * Print the hits and misses, split into reads and writes, and per
+ * array if any access counted its array.
+ *
+ * @return      void
+ */
+void print_results(struct HitMiss *hit_miss)
+{
+    /* Local Variables */
+    static const char *const names[COUNTER_ARRAYS] = { "A", "B", "C", "OTHER" };
+    uint64_t arrays = 0;
+    uint32_t i;
+
+    printf("HITS: %6llu        MISSES: %4llu\n", (unsigned long long)hit_miss->hits,
+           (unsigned long long)hit_miss->misses);
+    printf("READ HITS: %llu  READ MISSES: %llu  WRITE HITS: %llu  WRITE MISSES: %llu\n",
+           (unsigned long long)(hit_miss->hits - hit_miss->write_hits),
+           (unsigned long long)(hit_miss->misses - hit_miss->write_misses),
+           (unsigned long long)hit_miss->write_hits, (unsigned long long)hit_miss->write_misses);
+    for (i = 0; i < COUNTER_ARRAYS; i++) {
+        arrays += hit_miss->array[i].hits + hit_miss->array[i].misses;
+    }
+    for (i = 0; i < COUNTER_ARRAYS && arrays > 0; i++) {
+        printf("ARRAY %-5s HITS: %llu  MISSES: %llu\n", names[i],
+               (unsigned long long)hit_miss->array[i].hits,
+               (unsigned long long)hit_miss->array[i].misses);
+    }
+}
+
+/* print_victim_results
+ *
+ * Print the hits and misses of the victim cache, labeled
+ *
+ * @param       hit_miss    Hits and misses
+ *
+ * @return      void
+ */
+void print_victim_results(struct HitMiss *hit_miss)
+{
+    printf("VICTIM HITS: %6llu  VICTIM MISSES: %4llu\n", (unsigned long long)hit_miss->hits,
+           (unsigned long long)hit_miss->misses);
+    printf("VICTIM READ HITS: %llu  VICTIM READ MISSES: %llu  "
+           "VICTIM WRITE HITS: %llu  VICTIM WRITE MISSES: %llu\n",
+           (unsigned long long)(hit_miss->hits - hit_miss->write_hits),
+           (unsigned long long)(hit_miss->misses - hit_miss->write_misses),
+           (unsigned long long)hit_miss->write_hits, (unsigned long long)hit_miss->write_misses);
+}
+
+/* debug_line_out
+ *
+ * Prints out to stderr
+ *
+ * @param       level       Debug level
+ * @param       text        Line to write
+ *
+ * @return      void
+ */
+void debug_line_out(debug_level_t level, char text[])
+{
+    (void)level;
+    fprintf(stderr, "%s\n", text);
+}
+
+/* host_time
+ *
+ * Monotonic wall clock time
+ *
+ * @return      time in seconds
+ */
+double host_time(void)
+{
+    /* Local Variables */
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* print_throughput
+ *
+ * Print the number of accesses and the accesses per second of a run.
+ *
+ * @param       accesses    Number of simulated accesses
+ * @param       seconds     Duration of the run
+ *
+ * @return      void
+ */
+void print_throughput(uint64_t accesses, double seconds)
+{
+    printf("ACCESSES: %llu  TIME: %.3f s  RATE: %.1f M/s\n",
+           (unsigned long long)accesses, seconds,
+           seconds > 0 ? accesses / seconds / 1e6 : 0.0);
+}
+
+/* print_traffic
+ *
+ * Print the bytes moved between the cache and memory
+ *
+ * @param       traffic
+ *
+ * @return      void
+ */
+void print_traffic(const struct MemoryTraffic *traffic)
+{
+    printf("FILL: %llu B  WRITEBACK: %llu B  WRITE-THROUGH: %llu B  TOTAL: %llu B\n",
+           (unsigned long long)traffic->fill_bytes, (unsigned long long)traffic->writeback_bytes,
+           (unsigned long long)traffic->write_through_bytes,
+           (unsigned long long)(traffic->fill_bytes + traffic->writeback_bytes
+                                + traffic->write_through_bytes));
+}
+
+/* checkpoint_save
+ *
+ * Write the state of a cache instance to a file
+ *
+ * @param       path
+ * @param       cache
+ *
+ * @return      0 on success, -1 on error
+ */
+int checkpoint_save(const char *path, const cache_t *cache)
+{
+    /* Local Variables */
+    size_t size = cache_serialized_size(cache);
+    uint8_t *buffer = malloc(size);
+    FILE *file;
+    int status = -1;
+
+    if (buffer == NULL) {
+        return -1;
+    }
+    cache_serialize(cache, buffer, size);
+
+    file = fopen(path, "wb");
+    if (file != NULL) {
+        if (fwrite(buffer, 1, size, file) == size) {
+            status = 0;
+        }
+        if (fclose(file) != 0) {
+            status = -1;
+        }
+    }
+    if (status != 0) {
+        perror(path);
+    }
+    free(buffer);
+
+    return status;
+}
+
+/* checkpoint_load
+ *
+ * Restore the state of a cache instance from a file written by
+ * checkpoint_save()
+ *
+ * @param       path
+ * @param       cache       Cache of the same config
+ *
+ * @return      0 on success, -1 on error
+ */
+int checkpoint_load(const char *path, cache_t *cache)
+{
+    /* Local Variables */
+    size_t size = cache_serialized_size(cache);
+    uint8_t *buffer = malloc(size + 1);
+    FILE *file;
+    size_t length;
+    int status;
+
+    if (buffer == NULL) {
+        return -1;
+    }
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        free(buffer);
+        return -1;
+    }
+
+    /* One byte more than expected detects a longer file */
+    length = fread(buffer, 1, size + 1, file);
+    fclose(file);
+    status = cache_restore(cache, buffer, length);
+    if (status != 0) {
+        fprintf(stderr, "%s: not a checkpoint of this cache\n", path);
+    }
+    free(buffer);
+
+    return status;
+}
@@ -0,0 +1,69 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#ifndef SIM_HOST_H_
+#define SIM_HOST_H_
+
+/* User includes */
+#include "simulation.h"
+
+/* host_time
+ *
+ * Monotonic wall clock time
+ *
+ * @return      time in seconds
+ */
+double host_time(void);
+
+/* print_throughput
+ *
+ * Print the number of accesses and the accesses per second of a run.
+ *
+ * @param       accesses    Number of simulated accesses
+ * @param       seconds     Duration of the run
+ *
+ * @return      void
+ */
+void print_throughput(uint64_t accesses, double seconds);
+
+/* print_traffic
+ *
+ * Print the bytes moved between the cache and memory
+ *
+ * @param       traffic
+ *
+ * @return      void
+ */
+void print_traffic(const struct MemoryTraffic *traffic);
+
+/* checkpoint_save
+ *
+ * Write the state of a cache instance to a file
+ *
+ * @param       path
+ * @param       cache
+ *
+ * @return      0 on success, -1 on error
+ */
+int checkpoint_save(const char *path, const cache_t *cache);
+
+/* checkpoint_load
+ *
+ * Restore the state of a cache instance from a file written by
+ * checkpoint_save()
+ *
+ * @param       path
+ * @param       cache       Cache of the same config
+ *
+ * @return      0 on success, -1 on error
+ */
+int checkpoint_load(const char *path, cache_t *cache);
+
+#endif
+/* SIM_HOST_H_ */
@@ -0,0 +1,389 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "stack_distance.h"
+
+/* Initial capacity of the block map, power of two */
+#define MAP_INITIAL_CAPACITY (1u << 12)
+
+/* update
+ *
+ * Recompute the subtree size of a node
+ *
+ * @param       n           Nodes
+ * @param       x
+ *
+ * @return      void
+ */
+static void update(struct StackNode *n, uint32_t x)
+{
+    n[x].size = n[n[x].left].size + n[n[x].right].size + 1;
+}
+
+/* rotate
+ *
+ * Rotate a node above its parent
+ *
+ * @param       n           Nodes
+ * @param       x
+ *
+ * @return      void
+ */
+static void rotate(struct StackNode *n, uint32_t x)
+{
+    /* Local Variables */
+    uint32_t p = n[x].parent;
+    uint32_t g = n[p].parent;
+
+    if (n[p].left == x) {
+        n[p].left = n[x].right;
+        if (n[x].right) {
+            n[n[x].right].parent = p;
+        }
+        n[x].right = p;
+    } else {
+        n[p].right = n[x].left;
+        if (n[x].left) {
+            n[n[x].left].parent = p;
+        }
+        n[x].left = p;
+    }
+    n[p].parent = x;
+    n[x].parent = g;
+    if (g) {
+        if (n[g].left == p) {
+            n[g].left = x;
+        } else {
+            n[g].right = x;
+        }
+    }
+
+    update(n, p);
+    update(n, x);
+}
+
+/* splay
+ *
+ * Move a node to the root of its tree
+ *
+ * @param       n           Nodes
+ * @param       x
+ *
+ * @return      void
+ */
+static void splay(struct StackNode *n, uint32_t x)
+{
+    while (n[x].parent) {
+        uint32_t p = n[x].parent;
+        uint32_t g = n[p].parent;
+
+        if (g) {
+            /* Zig-zig rotates the parent first, zig-zag the node twice */
+            if ((n[g].left == p) == (n[p].left == x)) {
+                rotate(n, p);
+            } else {
+                rotate(n, x);
+            }
+        }
+        rotate(n, x);
+    }
+}
+
+/* join
+ *
+ * Join two detached trees where all nodes of left are older
+ *
+ * @param       n           Nodes
+ * @param       left
+ * @param       right
+ *
+ * @return      root of the joined tree
+ */
+static uint32_t join(struct StackNode *n, uint32_t left, uint32_t right)
+{
+    /* Local Variables */
+    uint32_t max = left;
+
+    if (left == 0) {
+        return right;
+    }
+
+    /* The newest node of left becomes the root, right hangs below it */
+    while (n[max].right) {
+        max = n[max].right;
+    }
+    splay(n, max);
+    n[max].right = right;
+    if (right) {
+        n[right].parent = max;
+    }
+    update(n, max);
+
+    return max;
+}
+
+/* record_distance
+ *
+ * Count a stack distance in the histogram of a level
+ *
+ * @param       level
+ * @param       distance
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int record_distance(struct StackLevel *level, uint32_t distance)
+{
+    if (distance >= level->histogram_size) {
+        uint32_t size = level->histogram_size ? level->histogram_size : 16;
+        uint64_t *histogram;
+
+        while (size <= distance) {
+            size *= 2;
+        }
+        histogram = realloc(level->histogram, size * sizeof(*histogram));
+        if (histogram == NULL) {
+            return -1;
+        }
+        memset(histogram + level->histogram_size, 0,
+               (size - level->histogram_size) * sizeof(*histogram));
+        level->histogram = histogram;
+        level->histogram_size = size;
+    }
+    level->histogram[distance]++;
+
+    return 0;
+}
+
+/* stack_distance_init
+ *
+ * Initialize a profiler
+ *
+ * @param       sd
+ * @param       offset      Offset size in bits (block size)
+ * @param       max_index   Largest index size in bits to profile
+ *
+ * @return      0 on success, -1 on error
+ */
+int stack_distance_init(struct StackDistance *sd, uint32_t offset, uint32_t max_index)
+{
+    /* Local Variables */
+    uint32_t k;
+
+    memset(sd, 0, sizeof(*sd));
+    if (max_index > STACK_DISTANCE_MAX_INDEX || offset > 31) {
+        return -1;
+    }
+    sd->offset = offset;
+    sd->levels = max_index + 1;
+
+    for (k = 0; k < sd->levels; k++) {
+        sd->level[k].roots = calloc((size_t)1 << k, sizeof(uint32_t));
+        if (sd->level[k].roots == NULL) {
+            stack_distance_free(sd);
+            return -1;
+        }
+    }
+
+    sd->node_capacity = 1 + 1024 * sd->levels;
+    sd->nodes = calloc(sd->node_capacity, sizeof(*sd->nodes));
+    if (block_map_init(&sd->map, MAP_INITIAL_CAPACITY) != 0 || sd->nodes == NULL) {
+        stack_distance_free(sd);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* stack_distance_free
+ *
+ * Release a profiler
+ *
+ * @param       sd
+ *
+ * @return      void
+ */
+void stack_distance_free(struct StackDistance *sd)
+{
+    /* Local Variables */
+    uint32_t k;
+
+    for (k = 0; k <= STACK_DISTANCE_MAX_INDEX; k++) {
+        free(sd->level[k].roots);
+        free(sd->level[k].histogram);
+    }
+    free(sd->nodes);
+    block_map_free(&sd->map);
+    memset(sd, 0, sizeof(*sd));
+}
+
+/* stack_distance_access
+ *
+ * Record the access to one block. Its fully associative distance, the
+ * number of other blocks used since the previous access, is left in
+ * sd->distance.
+ *
+ * @param       sd
+ * @param       address
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int stack_distance_access(struct StackDistance *sd, uint32_t address)
+{
+    /* Local Variables */
+    uint32_t block = address >> sd->offset;
+    uint32_t *ordinal = block_map_find(&sd->map, block);
+    struct StackNode *n;
+    uint32_t first;
+    uint32_t k;
+    int cold = 0;
+
+    if (ordinal == NULL) {
+        return -1;
+    }
+
+    if (*ordinal == 0) {
+        /* First access, allocate the nodes of all levels */
+        if ((uint64_t)(sd->blocks + 1) * sd->levels + 1 > UINT32_MAX) {
+            return -1;
+        }
+        if ((sd->blocks + 1) * sd->levels + 1 > sd->node_capacity) {
+            uint32_t capacity = sd->node_capacity * 2;
+            struct StackNode *nodes = realloc(sd->nodes, capacity * sizeof(*nodes));
+
+            if (nodes == NULL) {
+                return -1;
+            }
+            sd->nodes = nodes;
+            sd->node_capacity = capacity;
+        }
+        *ordinal = ++sd->blocks;
+        cold = 1;
+        sd->cold++;
+        sd->distance = STACK_DISTANCE_COLD;
+    }
+
+    n = sd->nodes;
+    first = 1 + (*ordinal - 1) * sd->levels;
+    sd->accesses++;
+
+    for (k = 0; k < sd->levels; k++) {
+        struct StackLevel *level = &sd->level[k];
+        uint32_t *root = &level->roots[block & ((1u << k) - 1)];
+        uint32_t x = first + k;
+        uint32_t joined;
+
+        if (cold) {
+            /* Newest block, becomes the root with the old tree to the left */
+            n[x].left = *root;
+            n[x].right = 0;
+            n[x].parent = 0;
+            if (*root) {
+                n[*root].parent = x;
+            }
+            update(n, x);
+            *root = x;
+            continue;
+        }
+
+        /* Blocks used after x are to its right */
+        splay(n, x);
+        if (record_distance(level, n[n[x].right].size) != 0) {
+            return -1;
+        }
+        if (k == 0) {
+            sd->distance = n[n[x].right].size;
+        }
+
+        /* Move x to the newest position */
+        if (n[x].left) {
+            n[n[x].left].parent = 0;
+        }
+        if (n[x].right) {
+            n[n[x].right].parent = 0;
+        }
+        joined = join(n, n[x].left, n[x].right);
+        n[x].left = joined;
+        n[x].right = 0;
+        if (joined) {
+            n[joined].parent = x;
+        }
+        update(n, x);
+        *root = x;
+    }
+
+    return 0;
+}
+
+/* stack_distance_misses
+ *
+ * Misses of an LRU cache with the given geometry
+ *
+ * @param       sd
+ * @param       index       Index size in bits
+ * @param       ways
+ *
+ * @return      misses
+ */
+uint64_t stack_distance_misses(const struct StackDistance *sd, uint32_t index, uint32_t ways)
+{
+    /* Local Variables */
+    const struct StackLevel *level;
+    uint64_t hits = 0;
+    uint32_t d;
+
+    if (index >= sd->levels) {
+        return 0;
+    }
+    level = &sd->level[index];
+    for (d = 0; d < ways && d < level->histogram_size; d++) {
+        hits += level->histogram[d];
+    }
+
+    return sd->accesses - hits;
+}
+
+/* stack_distance_write_csv
+ *
+ * Write the miss ratio curve of every set count for power of two ways
+ * up to the number of distinct blocks as CSV
+ *
+ * @param       sd
+ * @param       file
+ *
+ * @return      void
+ */
+void stack_distance_write_csv(const struct StackDistance *sd, FILE *file)
+{
+    /* Local Variables */
+    uint32_t k;
+    uint32_t ways;
+
+    fprintf(file, "sets,ways,block_bytes,capacity_bytes,accesses,misses,compulsory,miss_ratio\n");
+    for (k = 0; k < sd->levels; k++) {
+        for (ways = 1; ; ways *= 2) {
+            uint64_t misses = stack_distance_misses(sd, k, ways);
+
+            fprintf(file, "%u,%u,%u,%llu,%llu,%llu,%llu,%.6f\n",
+                    1u << k, ways, 1u << sd->offset,
+                    (unsigned long long)ways << (k + sd->offset),
+                    (unsigned long long)sd->accesses, (unsigned long long)misses,
+                    (unsigned long long)sd->cold,
+                    sd->accesses ? (double)misses / sd->accesses : 0.0);
+
+            /* Larger caches only take compulsory misses */
+            if (ways >= sd->level[k].histogram_size || ways >= (1u << 31)) {
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Stack distance (Mattson) profiler
+ *
+ * An LRU cache with W ways hits an access exactly if fewer than W other
+ * blocks of the same set were used since the previous access to the
+ * block. One pass records this per-set stack distance for every set
+ * count 2^0 .. 2^max_index at once. The miss ratio of every
+ * sets x ways geometry then follows from the distance histograms.
+ *
+ * Per set count and set, the blocks are kept in a splay tree ordered by
+ * their last access, so the distance is the size of the right subtree
+ * of the splayed block: O(log n) amortized per access and level.
+ */
+
+#ifndef STACK_DISTANCE_H_
+#define STACK_DISTANCE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* User includes */
+#include "block_map.h"
+
+/* Largest supported index size in bits */
+#define STACK_DISTANCE_MAX_INDEX 20
+
+/* Distance of the first access to a block */
+#define STACK_DISTANCE_COLD UINT32_MAX
+
+/* StackNode
+ *
+ * Splay tree node of one block in one level, 0 is the nil node
+ */
+struct StackNode {
+    uint32_t left;
+    uint32_t right;
+    uint32_t parent;
+    uint32_t size;
+};
+
+/* StackLevel
+ *
+ * Trees and distance histogram of one set count
+ */
+struct StackLevel {
+    uint32_t *roots;
+    uint64_t *histogram;
+    uint32_t histogram_size;
+};
+
+/* StackDistance
+ *
+ * Profiler state. Nodes of one block for all levels are stored next to
+ * each other, the block map points to the first of them.
+ */
+struct StackDistance {
+    uint32_t offset;
+    uint32_t levels;
+    uint64_t accesses;
+    uint64_t cold;
+    uint32_t blocks;
+    uint32_t distance;          /* Fully associative distance of the last access */
+    struct StackLevel level[STACK_DISTANCE_MAX_INDEX + 1];
+    struct StackNode *nodes;
+    uint32_t node_capacity;
+    struct BlockMap map;
+};
+
+/* stack_distance_init
+ *
+ * Initialize a profiler
+ *
+ * @param       sd
+ * @param       offset      Offset size in bits (block size)
+ * @param       max_index   Largest index size in bits to profile
+ *
+ * @return      0 on success, -1 on error
+ */
+int stack_distance_init(struct StackDistance *sd, uint32_t offset, uint32_t max_index);
+
+/* stack_distance_free
+ *
+ * Release a profiler
+ *
+ * @param       sd
+ *
+ * @return      void
+ */
+void stack_distance_free(struct StackDistance *sd);
+
+/* stack_distance_access
+ *
+ * Record the access to one block. Its fully associative distance, the
+ * number of other blocks used since the previous access, is left in
+ * sd->distance.
+ *
+ * @param       sd
+ * @param       address
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int stack_distance_access(struct StackDistance *sd, uint32_t address);
+
+/* stack_distance_misses
+ *
+ * Misses of an LRU cache with the given geometry
+ *
+ * @param       sd
+ * @param       index       Index size in bits
+ * @param       ways
+ *
+ * @return      misses
+ */
+uint64_t stack_distance_misses(const struct StackDistance *sd, uint32_t index, uint32_t ways);
+
+/* stack_distance_write_csv
+ *
+ * Write the miss ratio curve of every set count for power of two ways
+ * up to the number of distinct blocks as CSV
+ *
+ * @param       sd
+ * @param       file
+ *
+ * @return      void
+ */
+void stack_distance_write_csv(const struct StackDistance *sd, FILE *file);
+
+#endif
+/* STACK_DISTANCE_H_ */
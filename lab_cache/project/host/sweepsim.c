@@ -0,0 +1,599 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, design space sweep
+ * --
+ * -- Usage       : sweepsim [-A bits] [-o offsets] [-s indexes]
+ * --                        [-w ways] [-r replacements]
+ * --                        [-b write policies] [-a write miss]
+ * --                        [-j workers] [-C] [trace]
+ * --               Simulates every combination of the given params
+ * --               on an empty cache and prints hits, misses and
+ * --               their 3C breakdown per config. Every param takes
+ * --               a list of values and ranges, e.g. -w 1,2,4-8, and
+ * --               defaults to config.h (-A to 32 address bits).
+ * --               -b and -a take 0/1 as WRITE_POLICY and WRITE_MISS.
+ * --               -C prints CSV. Without a trace the a = b + c kernel
+ * --               of main.c is simulated.
+ * --
+ * --               The trace is loaded once, binary traces are mapped
+ * --               read-only. Configs with the same address bits,
+ * --               offset and index form a group that decodes the
+ * --               trace and runs the fully associative shadow of the
+ * --               3C split once for all its configs. The groups run
+ * --               on a work stealing thread pool.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "parallel.h"
+#include "classify.h"
+#include "stack_distance.h"
+#include "config.h"
+
+/* Block accesses decoded before they are simulated */
+#define SWEEP_CHUNK 4096
+
+/* Swept params: address bits, offset, index, ways, replacement, write
+ * policy, write miss policy. The first three decide the decoding. */
+#define SWEEP_PARAMS        7
+#define SWEEP_GROUP_PARAMS  3
+
+static const char *replacement_names[] = { "LRU", "PLRU", "FIFO", "RANDOM", "SRRIP" };
+
+/* SweepConfig
+ *
+ * One point of the design space and its result
+ */
+struct SweepConfig {
+    struct CacheConfig config;
+    uint8_t address_size;
+    uint64_t accesses;
+    struct MissClass result;
+    struct MemoryTraffic traffic;
+};
+
+/* SweepGroup
+ *
+ * Consecutive configs that decode the trace the same way
+ */
+struct SweepGroup {
+    uint32_t first;
+    uint32_t count;
+    int failed;     /* 1 out of memory, 2 corrupt chunk */
+};
+
+/* Sweep
+ *
+ * Shared read-only trace plus all configs and groups
+ */
+struct Sweep {
+    const struct Trace *trace;              /* Text trace or kernel, or NULL */
+    const struct TraceBinReader *reader;    /* Mapped binary trace, or NULL */
+    struct SweepConfig *configs;
+    uint32_t config_count;
+    struct SweepGroup *groups;
+    uint32_t group_count;
+};
+
+/* GroupRun
+ *
+ * State of one group while it runs
+ */
+struct GroupRun {
+    struct SweepConfig *configs;
+    uint32_t count;
+    cache_t **caches;
+    struct StackDistance sd;
+    uint32_t mask;              /* Address bits */
+    uint32_t offset;
+    uint8_t size;               /* Bytes of every access in the chunk */
+    uint32_t used;
+    uint32_t addresses[SWEEP_CHUNK];
+    uint8_t types[SWEEP_CHUNK];
+    uint32_t distances[SWEEP_CHUNK];
+    uint8_t results[SWEEP_CHUNK];
+};
+
+/* parse_values
+ *
+ * Parse a list of values and ranges like "1,2,4-8"
+ *
+ * @param       text
+ * @param       max         Largest allowed value, at most 63
+ * @param       values      Bit n set for every value n
+ *
+ * @return      0 on success, -1 on a syntax error or a value above max
+ */
+static int parse_values(const char *text, uint32_t max, uint64_t *values)
+{
+    /* Local Variables */
+    char *end;
+
+    *values = 0;
+    while (1) {
+        unsigned long low = strtoul(text, &end, 0);
+        unsigned long high = low;
+
+        if (end == text) {
+            return -1;
+        }
+        if (*end == '-') {
+            text = end + 1;
+            high = strtoul(text, &end, 0);
+            if (end == text || high < low) {
+                return -1;
+            }
+        }
+        if (high > max) {
+            return -1;
+        }
+        for (; low <= high; low++) {
+            *values |= 1ull << low;
+        }
+        if (*end == '\0') {
+            return 0;
+        }
+        if (*end != ',') {
+            return -1;
+        }
+        text = end + 1;
+    }
+}
+
+/* group_chunk
+ *
+ * Run the decoded chunk through every cache of the group and classify
+ * the misses with the fully associative distance
+ *
+ * @param       run
+ *
+ * @return      void
+ */
+static void group_chunk(struct GroupRun *run)
+{
+    /* Local Variables */
+    uint32_t c;
+    uint32_t i;
+
+    for (c = 0; c < run->count; c++) {
+        struct MissClass *result = &run->configs[c].result;
+        uint32_t lines = (1u << run->configs[c].config.index) * run->configs[c].config.ways;
+
+        result->hits += cache_access_batch(run->caches[c], run->addresses, run->types, run->size,
+                                           run->used, run->results);
+        for (i = 0; i < run->used; i++) {
+            if (run->results[i] != RESULT_HIT) {
+                uint32_t distance = run->distances[i];
+
+                result->compulsory += distance == STACK_DISTANCE_COLD;
+                result->capacity += distance != STACK_DISTANCE_COLD && distance >= lines;
+                result->conflict += distance < lines;
+            }
+        }
+        run->configs[c].accesses += run->used;
+    }
+    run->used = 0;
+}
+
+/* group_record
+ *
+ * Decode a record into block accesses of the group
+ *
+ * @param       run
+ * @param       record
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int group_record(struct GroupRun *run, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct TraceRecord masked = *record;
+    uint32_t address;
+    uint32_t last;
+
+    masked.address &= run->mask;
+    address = masked.address;
+    last = (masked.address + masked.size - 1) >> run->offset;
+
+    while (1) {
+        uint8_t size = trace_block_bytes(&masked, address, run->offset);
+
+        /* A batch simulates accesses of one size */
+        if (run->used == SWEEP_CHUNK || (run->used != 0 && size != run->size)) {
+            group_chunk(run);
+        }
+        if (stack_distance_access(&run->sd, address) != 0) {
+            return -1;
+        }
+        run->size = size;
+        run->addresses[run->used] = address;
+        run->types[run->used] = masked.access;
+        run->distances[run->used++] = run->sd.distance;
+
+        if ((address >> run->offset) == last) {
+            break;
+        }
+        address = ((address >> run->offset) + 1) << run->offset;
+    }
+
+    return 0;
+}
+
+/* group_replay
+ *
+ * Decode the trace once for all configs of the group
+ *
+ * @param       sweep
+ * @param       run
+ *
+ * @return      0 on success, -1 if out of memory, -2 if a chunk is corrupt
+ */
+static int group_replay(const struct Sweep *sweep, struct GroupRun *run)
+{
+    /* Local Variables */
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    uint32_t chunk;
+    int decoded;
+    size_t i;
+
+    if (sweep->trace != NULL) {
+        for (i = 0; i < sweep->trace->count; i++) {
+            if (group_record(run, &sweep->trace->records[i]) != 0) {
+                return -1;
+            }
+        }
+    } else {
+        for (chunk = 0; chunk < sweep->reader->chunk_count; chunk++) {
+            trace_bin_cursor(sweep->reader, chunk, &cursor);
+            while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+                if (group_record(run, &record) != 0) {
+                    return -1;
+                }
+            }
+            if (decoded < 0) {
+                return -2;
+            }
+        }
+    }
+    group_chunk(run);
+
+    return 0;
+}
+
+/* group_main
+ *
+ * Simulate all configs of a group, parallel_for() callback
+ *
+ * @param       context     struct Sweep
+ * @param       item        Group
+ * @param       worker
+ *
+ * @return      void
+ */
+static void group_main(void *context, uint32_t item, uint32_t worker)
+{
+    /* Local Variables */
+    struct Sweep *sweep = context;
+    struct SweepGroup *group = &sweep->groups[item];
+    struct GroupRun *run = malloc(sizeof(*run));
+    uint32_t c;
+
+    (void)worker;
+    if (run == NULL) {
+        group->failed = 1;
+        return;
+    }
+    run->configs = &sweep->configs[group->first];
+    run->count = group->count;
+    run->offset = run->configs[0].config.offset;
+    run->mask = run->configs[0].address_size >= 32 ? UINT32_MAX
+                                                   : (1u << run->configs[0].address_size) - 1;
+    run->size = 0;
+    run->used = 0;
+    run->caches = calloc(group->count, sizeof(*run->caches));
+    if (run->caches == NULL || stack_distance_init(&run->sd, run->offset, 0) != 0) {
+        free(run->caches);
+        free(run);
+        group->failed = 1;
+        return;
+    }
+
+    for (c = 0; c < group->count; c++) {
+        run->caches[c] = cache_create(&run->configs[c].config);
+        if (run->caches[c] == NULL) {
+            group->failed = 1;
+        }
+    }
+    if (!group->failed) {
+        int replayed = group_replay(sweep, run);
+
+        if (replayed != 0) {
+            group->failed = replayed == -2 ? 2 : 1;
+        }
+    }
+
+    for (c = 0; c < group->count; c++) {
+        if (run->caches[c] != NULL) {
+            /* Dirty lines left at the end still cost a write-back */
+            cache_flush(run->caches[c], &run->caches[c]->traffic);
+            run->configs[c].traffic = run->caches[c]->traffic;
+            cache_destroy(run->caches[c]);
+        }
+    }
+    stack_distance_free(&run->sd);
+    free(run->caches);
+    free(run);
+}
+
+/* sweep_build
+ *
+ * Enumerate the valid configs, grouped by address bits, offset and
+ * index
+ *
+ * @param       sweep
+ * @param       values      Allowed values of every param, see main()
+ *
+ * @return      number of skipped invalid configs, -1 if out of memory
+ */
+static int sweep_build(struct Sweep *sweep, const uint64_t values[SWEEP_PARAMS])
+{
+    /* Local Variables */
+    uint8_t list[SWEEP_PARAMS][64];
+    uint32_t counts[SWEEP_PARAMS];
+    uint32_t digit[SWEEP_PARAMS];
+    uint32_t capacity = 0;
+    uint32_t first = 0;
+    uint32_t v;
+    int skipped = 0;
+    int k;
+
+    for (k = 0; k < SWEEP_PARAMS; k++) {
+        counts[k] = 0;
+        digit[k] = 0;
+        for (v = 0; v < 64; v++) {
+            if (values[k] >> v & 1) {
+                list[k][counts[k]++] = (uint8_t)v;
+            }
+        }
+        if (counts[k] == 0) {
+            return 0;
+        }
+    }
+
+    /* Count through all combinations, the last param fastest */
+    do {
+        struct SweepConfig *config;
+
+        if (sweep->config_count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            config = realloc(sweep->configs, capacity * sizeof(*config));
+            if (config == NULL) {
+                return -1;
+            }
+            sweep->configs = config;
+        }
+        config = &sweep->configs[sweep->config_count];
+        memset(config, 0, sizeof(*config));
+        config->address_size = list[0][digit[0]];
+        config->config.offset = list[1][digit[1]];
+        config->config.index = list[2][digit[2]];
+        config->config.ways = list[3][digit[3]];
+        config->config.replacement = list[4][digit[4]];
+        config->config.write_policy = list[5][digit[5]];
+        config->config.write_miss = list[6][digit[6]];
+        if (cache_config_valid(&config->config)) {
+            sweep->config_count++;
+        } else {
+            skipped++;
+        }
+
+        for (k = SWEEP_PARAMS - 1; k >= 0 && ++digit[k] == counts[k]; k--) {
+            digit[k] = 0;
+        }
+
+        /* Address bits, offset or index change: the group is complete */
+        if (k < SWEEP_GROUP_PARAMS && sweep->config_count > first) {
+            struct SweepGroup *group = realloc(sweep->groups,
+                                               (sweep->group_count + 1) * sizeof(*group));
+
+            if (group == NULL) {
+                return -1;
+            }
+            sweep->groups = group;
+            group = &sweep->groups[sweep->group_count++];
+            group->first = first;
+            group->count = sweep->config_count - first;
+            group->failed = 0;
+            first = sweep->config_count;
+        }
+    } while (k >= 0);
+
+    return skipped;
+}
+
+/* print_config
+ *
+ * Print the result of one config as a table row or as CSV
+ *
+ * @param       config
+ * @param       csv
+ *
+ * @return      void
+ */
+static void print_config(const struct SweepConfig *config, int csv)
+{
+    /* Local Variables */
+    const struct MissClass *result = &config->result;
+    uint64_t misses = result->compulsory + result->capacity + result->conflict;
+    uint64_t traffic = config->traffic.fill_bytes + config->traffic.write_through_bytes
+                       + config->traffic.writeback_bytes;
+    const char *format = csv ? "%u,%u,%u,%u,%s,%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%.4f,%llu\n"
+                             : "%4u %6u %5u %4u %-6s %2u %2u %12llu %12llu %12llu %12llu %12llu "
+                               "%12llu %8.4f %14llu\n";
+
+    printf(format, config->address_size, config->config.offset, config->config.index,
+           config->config.ways, replacement_names[config->config.replacement],
+           config->config.write_policy, config->config.write_miss,
+           (unsigned long long)config->accesses, (unsigned long long)result->hits,
+           (unsigned long long)misses, (unsigned long long)result->compulsory,
+           (unsigned long long)result->capacity, (unsigned long long)result->conflict,
+           config->accesses ? 100.0 * misses / config->accesses : 0.0, (unsigned long long)traffic);
+}
+
+/* usage
+ *
+ * Print the command line help
+ *
+ * @param       name        Program name
+ *
+ * @return      exit code
+ */
+static int usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-A bits] [-o offsets] [-s indexes] [-w ways] [-r replacements] "
+            "[-b write policies] [-a write miss] [-j workers] [-C] [trace]\n", name);
+
+    return 2;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static const char options[] = "Aoswrba";
+    static const uint32_t limits[] = { 32, 31, 31, MAX_WAYS, REPLACEMENT_SRRIP, 1, 1 };
+    static struct Sweep sweep;
+    struct Trace trace;
+    struct TraceBinReader reader;
+    uint64_t values[SWEEP_PARAMS];
+    uint64_t total = 0;
+    const char *path = NULL;
+    const char *which;
+    uint32_t workers = 0;
+    uint32_t used;
+    uint32_t i;
+    int binary;
+    int csv = 0;
+    int skipped;
+    int status = 0;
+    double start;
+    double seconds;
+    int option;
+
+    values[0] = 1ull << 32;
+    values[1] = 1ull << OFFSET;
+    values[2] = 1ull << INDEX;
+    values[3] = 1ull << WAYS;
+    values[4] = 1ull << REPLACEMENT;
+    values[5] = 1ull << WRITE_POLICY;
+    values[6] = 1ull << WRITE_MISS;
+
+    while ((option = getopt(argc, argv, "A:o:s:w:r:b:a:j:C")) != -1) {
+        which = strchr(options, option);
+        if (which != NULL) {
+            if (parse_values(optarg, limits[which - options], &values[which - options]) != 0) {
+                return usage(argv[0]);
+            }
+            continue;
+        }
+        switch (option) {
+            case 'j':
+                workers = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'C':
+                csv = 1;
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind++];
+    }
+    if (optind < argc) {
+        return usage(argv[0]);
+    }
+
+    skipped = sweep_build(&sweep, values);
+    if (skipped < 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    if (sweep.config_count == 0) {
+        fprintf(stderr, "no valid config\n");
+        return 1;
+    }
+
+    /* Loaded once and only read by the workers */
+    trace_init(&trace);
+    binary = path != NULL && trace_bin_is_binary(path);
+    if (binary) {
+        if (trace_bin_open(&reader, path) != 0) {
+            return 1;
+        }
+        sweep.reader = &reader;
+    } else {
+        if ((path != NULL ? trace_load_text(path, &trace) : trace_kernel(&trace)) != 0) {
+            trace_free(&trace);
+            return 1;
+        }
+        sweep.trace = &trace;
+    }
+
+    start = host_time();
+    used = parallel_for(sweep.group_count, workers, group_main, &sweep);
+    seconds = host_time() - start;
+
+    if (csv) {
+        printf("address_bits,offset,index,ways,replacement,write_policy,write_miss,accesses,hits,"
+               "misses,compulsory,capacity,conflict,miss_percent,traffic_bytes\n");
+    } else {
+        printf("%4s %6s %5s %4s %-6s %2s %2s %12s %12s %12s %12s %12s %12s %8s %14s\n", "ADDR",
+               "OFFSET", "INDEX", "WAYS", "REPL", "WP", "WM", "ACCESSES", "HITS", "MISSES",
+               "COMPULSORY", "CAPACITY", "CONFLICT", "MISS %", "TRAFFIC B");
+    }
+    for (i = 0; i < sweep.group_count; i++) {
+        uint32_t c;
+
+        if (sweep.groups[i].failed) {
+            status |= sweep.groups[i].failed;
+            continue;
+        }
+        for (c = 0; c < sweep.groups[i].count; c++) {
+            print_config(&sweep.configs[sweep.groups[i].first + c], csv);
+            total += sweep.configs[sweep.groups[i].first + c].accesses;
+        }
+    }
+    if (status & 2) {
+        fprintf(stderr, "%s: corrupt chunk, some configs are missing\n", path);
+    }
+    if (status & 1) {
+        fprintf(stderr, "out of memory, some configs are missing\n");
+    }
+    /* Kept off stdout, so the CSV stays clean */
+    fprintf(stderr, "CONFIGS: %u  SKIPPED: %d  GROUPS: %u  WORKERS: %u\n", sweep.config_count,
+            skipped, sweep.group_count, used);
+    fprintf(stderr, "ACCESSES: %llu  TIME: %.3f s  RATE: %.1f M/s\n", (unsigned long long)total,
+            seconds, seconds > 0.0 ? total / seconds / 1e6 : 0.0);
+
+    if (binary) {
+        trace_bin_close(&reader);
+    }
+    trace_free(&trace);
+    free(sweep.configs);
+    free(sweep.groups);
+
+    return status != 0;
+}
@@ -0,0 +1,305 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "telemetry.h"
+
+/* Header bytes of the binary format */
+#define HEADER_BYTES 24
+
+/* SetTotal
+ *
+ * Counts of one set over all windows
+ */
+struct SetTotal {
+    uint32_t set;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+/* put_u32
+ *
+ * Store a little endian 32 bit value
+ *
+ * @param       p
+ * @param       value
+ *
+ * @return      void
+ */
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/* put_u64
+ *
+ * Store a little endian 64 bit value
+ *
+ * @param       p
+ * @param       value
+ *
+ * @return      void
+ */
+static void put_u64(uint8_t *p, uint64_t value)
+{
+    put_u32(p, (uint32_t)value);
+    put_u32(p + 4, (uint32_t)(value >> 32));
+}
+
+/* compare_misses
+ *
+ * qsort() order of set totals, most misses first
+ *
+ * @param       a
+ * @param       b
+ *
+ * @return      order
+ */
+static int compare_misses(const void *a, const void *b)
+{
+    /* Local Variables */
+    const struct SetTotal *x = a;
+    const struct SetTotal *y = b;
+
+    if (x->misses != y->misses) {
+        return x->misses < y->misses ? 1 : -1;
+    }
+    return x->set < y->set ? -1 : x->set > y->set;
+}
+
+/* telemetry_create
+ *
+ * Allocate telemetry and its cells and attach it to a cache instance
+ *
+ * @param       cache
+ * @param       capacity    Windows, even and at least 2
+ * @param       window      Accesses per window
+ *
+ * @return      telemetry, NULL on invalid params, no memory or without
+ *              TELEMETRY
+ */
+struct Telemetry *telemetry_create(cache_t *cache, uint32_t capacity, uint32_t window)
+{
+    /* Local Variables */
+    size_t cells = (size_t)capacity * cache->set_count;
+    struct Telemetry *telemetry;
+
+    /* Cells right behind the header, the occupancy behind them, one block */
+    telemetry = malloc(sizeof(*telemetry) + cells * sizeof(struct TelemetryCell) +
+                       cache->set_count);
+    if (telemetry == NULL) {
+        return NULL;
+    }
+    if (cache_attach_telemetry(cache, telemetry, (struct TelemetryCell *)(telemetry + 1),
+                               (uint8_t *)((struct TelemetryCell *)(telemetry + 1) + cells),
+                               capacity, window) != 0) {
+        free(telemetry);
+        return NULL;
+    }
+
+    return telemetry;
+}
+
+/* telemetry_destroy
+ *
+ * Detach telemetry from telemetry_create() and free it
+ *
+ * @param       cache
+ * @param       telemetry   May be NULL
+ *
+ * @return      void
+ */
+void telemetry_destroy(cache_t *cache, struct Telemetry *telemetry)
+{
+    if (telemetry != NULL) {
+        cache_attach_telemetry(cache, NULL, NULL, NULL, 0, 0);
+        free(telemetry);
+    }
+}
+
+/* telemetry_windows
+ *
+ * Windows holding counts
+ *
+ * @param       telemetry
+ *
+ * @return      windows
+ */
+uint32_t telemetry_windows(const struct Telemetry *telemetry)
+{
+    return telemetry->current + (telemetry->remaining < telemetry->window);
+}
+
+/* telemetry_write_csv
+ *
+ * Write the cells as CSV
+ *
+ * @param       telemetry
+ * @param       out
+ *
+ * @return      0 on success, -1 on a write error
+ */
+int telemetry_write_csv(const struct Telemetry *telemetry, FILE *out)
+{
+    /* Local Variables */
+    uint32_t windows = telemetry_windows(telemetry);
+    uint32_t w;
+    uint32_t s;
+
+    fprintf(out, "window,first_access,set,hits,misses,evictions\n");
+    for (w = 0; w < windows; w++) {
+        for (s = 0; s < telemetry->set_count; s++) {
+            const struct TelemetryCell *cell = &telemetry->cells[w * telemetry->set_count + s];
+
+            fprintf(out, "%u,%llu,%u,%llu,%llu,%llu\n", w,
+                    (unsigned long long)w * telemetry->window, s, (unsigned long long)cell->hits,
+                    (unsigned long long)cell->misses, (unsigned long long)cell->evictions);
+        }
+    }
+
+    return ferror(out) ? -1 : 0;
+}
+
+/* telemetry_write_bin
+ *
+ * Write the cells in the binary format
+ *
+ * @param       telemetry
+ * @param       out
+ *
+ * @return      0 on success, -1 on a write error
+ */
+int telemetry_write_bin(const struct Telemetry *telemetry, FILE *out)
+{
+    /* Local Variables */
+    uint32_t windows = telemetry_windows(telemetry);
+    uint8_t header[HEADER_BYTES];
+    uint8_t cell_bytes[24];
+    size_t cells = (size_t)windows * telemetry->set_count;
+    size_t i;
+
+    put_u32(header, TELEMETRY_MAGIC);
+    put_u32(header + 4, TELEMETRY_VERSION);
+    put_u32(header + 8, telemetry->set_count);
+    put_u32(header + 12, windows);
+    put_u64(header + 16, telemetry->window);
+    if (fwrite(header, sizeof(header), 1, out) != 1) {
+        return -1;
+    }
+    for (i = 0; i < cells; i++) {
+        put_u64(cell_bytes, telemetry->cells[i].hits);
+        put_u64(cell_bytes + 8, telemetry->cells[i].misses);
+        put_u64(cell_bytes + 16, telemetry->cells[i].evictions);
+        if (fwrite(cell_bytes, sizeof(cell_bytes), 1, out) != 1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* telemetry_save
+ *
+ * Write the cells to a file, as CSV if the name ends in ".csv", else
+ * binary
+ *
+ * @param       telemetry
+ * @param       path
+ *
+ * @return      0 on success, -1 on error
+ */
+int telemetry_save(const struct Telemetry *telemetry, const char *path)
+{
+    /* Local Variables */
+    size_t length = strlen(path);
+    int csv = length >= 4 && strcmp(path + length - 4, ".csv") == 0;
+    FILE *out = fopen(path, csv ? "w" : "wb");
+    int status;
+
+    if (out == NULL) {
+        perror(path);
+        return -1;
+    }
+    status = csv ? telemetry_write_csv(telemetry, out) : telemetry_write_bin(telemetry, out);
+    if (fclose(out) != 0 || status != 0) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* telemetry_print
+ *
+ * Print the window layout, the sets with the most misses and the
+ * window with the highest miss rate
+ *
+ * @param       telemetry
+ * @param       out
+ * @param       top         Sets to list
+ *
+ * @return      void
+ */
+void telemetry_print(const struct Telemetry *telemetry, FILE *out, uint32_t top)
+{
+    /* Local Variables */
+    uint32_t windows = telemetry_windows(telemetry);
+    uint32_t sets = telemetry->set_count;
+    struct SetTotal *totals = calloc(sets, sizeof(*totals));
+    double peak_rate = 0;
+    uint32_t peak = 0;
+    uint32_t w;
+    uint32_t s;
+
+    if (totals == NULL) {
+        return;
+    }
+    for (s = 0; s < sets; s++) {
+        totals[s].set = s;
+    }
+    for (w = 0; w < windows; w++) {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+        for (s = 0; s < sets; s++) {
+            const struct TelemetryCell *cell = &telemetry->cells[w * sets + s];
+
+            totals[s].hits += cell->hits;
+            totals[s].misses += cell->misses;
+            totals[s].evictions += cell->evictions;
+            hits += cell->hits;
+            misses += cell->misses;
+        }
+        if (hits + misses > 0 && (double)misses / (hits + misses) > peak_rate) {
+            peak_rate = (double)misses / (hits + misses);
+            peak = w;
+        }
+    }
+
+    fprintf(out, "TELEMETRY: %u sets x %u windows of %llu accesses\n", sets, windows,
+            (unsigned long long)telemetry->window);
+    if (windows > 0) {
+        fprintf(out, "PEAK WINDOW: %u (accesses %llu ..), miss rate %.2f %%\n", peak,
+                (unsigned long long)peak * telemetry->window, 100.0 * peak_rate);
+    }
+    qsort(totals, sets, sizeof(*totals), compare_misses);
+    for (s = 0; s < sets && s < top && totals[s].misses > 0; s++) {
+        fprintf(out, "SET %5u: HITS: %llu  MISSES: %llu  EVICTIONS: %llu\n", totals[s].set,
+                (unsigned long long)totals[s].hits, (unsigned long long)totals[s].misses,
+                (unsigned long long)totals[s].evictions);
+    }
+    free(totals);
+}
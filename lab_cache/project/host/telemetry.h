@@ -0,0 +1,123 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Telemetry export
+ *
+ * Writes the per set and per window counts of cache_attach_telemetry()
+ * for heatmaps (x = window, y = set).
+ *
+ * CSV: one row per window and set, window major:
+ *
+ *   window,first_access,set,hits,misses,evictions
+ *
+ * Binary, all integers little endian:
+ *
+ *   header   magic "CTEL", version, set count, window count (32 bit),
+ *            accesses per window (64 bit)
+ *   cells    hits, misses, evictions (64 bit) of every set of window 0,
+ *            then window 1, ...
+ *
+ * The last window may be partly filled.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdio.h>
+
+/* User includes */
+#include "cache.h"
+
+/* File identification */
+#define TELEMETRY_MAGIC     0x4C455443u     /* "CTEL" */
+#define TELEMETRY_VERSION   2
+
+/* telemetry_create
+ *
+ * Allocate telemetry and its cells and attach it to a cache instance
+ *
+ * @param       cache
+ * @param       capacity    Windows, even and at least 2
+ * @param       window      Accesses per window
+ *
+ * @return      telemetry, NULL on invalid params, no memory or without
+ *              TELEMETRY
+ */
+struct Telemetry *telemetry_create(cache_t *cache, uint32_t capacity, uint32_t window);
+
+/* telemetry_destroy
+ *
+ * Detach telemetry from telemetry_create() and free it
+ *
+ * @param       cache
+ * @param       telemetry   May be NULL
+ *
+ * @return      void
+ */
+void telemetry_destroy(cache_t *cache, struct Telemetry *telemetry);
+
+/* telemetry_windows
+ *
+ * Windows holding counts
+ *
+ * @param       telemetry
+ *
+ * @return      windows
+ */
+uint32_t telemetry_windows(const struct Telemetry *telemetry);
+
+/* telemetry_write_csv
+ *
+ * Write the cells as CSV
+ *
+ * @param       telemetry
+ * @param       out
+ *
+ * @return      0 on success, -1 on a write error
+ */
+int telemetry_write_csv(const struct Telemetry *telemetry, FILE *out);
+
+/* telemetry_write_bin
+ *
+ * Write the cells in the binary format
+ *
+ * @param       telemetry
+ * @param       out
+ *
+ * @return      0 on success, -1 on a write error
+ */
+int telemetry_write_bin(const struct Telemetry *telemetry, FILE *out);
+
+/* telemetry_save
+ *
+ * Write the cells to a file, as CSV if the name ends in ".csv", else
+ * binary
+ *
+ * @param       telemetry
+ * @param       path
+ *
+ * @return      0 on success, -1 on error
+ */
+int telemetry_save(const struct Telemetry *telemetry, const char *path);
+
+/* telemetry_print
+ *
+ * Print the window layout, the sets with the most misses and the
+ * window with the highest miss rate
+ *
+ * @param       telemetry
+ * @param       out
+ * @param       top         Sets to list
+ *
+ * @return      void
+ */
+void telemetry_print(const struct Telemetry *telemetry, FILE *out, uint32_t top);
+
+#endif
+/* TELEMETRY_H_ */
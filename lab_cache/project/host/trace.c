@@ -0,0 +1,361 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <ctype.h>
+
+/* User includes */
+#include "trace.h"
+
+/* Initial record capacity of a trace */
+#define TRACE_INITIAL_CAPACITY 4096
+
+/* trace_init
+ *
+ * Initialize an empty trace
+ *
+ * @param       trace
+ *
+ * @return      void
+ */
+void trace_init(struct Trace *trace)
+{
+    trace->records = NULL;
+    trace->count = 0;
+    trace->capacity = 0;
+}
+
+/* trace_free
+ *
+ * Release the records of a trace
+ *
+ * @param       trace
+ *
+ * @return      void
+ */
+void trace_free(struct Trace *trace)
+{
+    free(trace->records);
+    trace_init(trace);
+}
+
+/* trace_append
+ *
+ * Append one access to a trace
+ *
+ * @param       trace
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       address
+ * @param       size        Size in bytes
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int trace_append(struct Trace *trace, access_t access, uint32_t address, uint8_t size)
+{
+    /* Local Variables */
+    struct TraceRecord *record;
+
+    /* Grow geometrically */
+    if (trace->count == trace->capacity) {
+        size_t capacity = trace->capacity ? trace->capacity * 2 : TRACE_INITIAL_CAPACITY;
+        struct TraceRecord *records = realloc(trace->records, capacity * sizeof(*records));
+
+        if (records == NULL) {
+            return -1;
+        }
+        trace->records = records;
+        trace->capacity = capacity;
+    }
+
+    record = &trace->records[trace->count++];
+    record->address = address;
+    record->access = (uint8_t)access;
+    record->size = size ? size : 1;
+
+    return 0;
+}
+
+/* record_item
+ *
+ * Append the accesses of the kernel on one item, for_each_item()
+ * callback
+ *
+ * @param       row index
+ * @param       column index
+ * @param       context     Trace the records are appended to
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+static int record_item(uint16_t row, uint16_t col, void *context)
+{
+    /* Local Variables */
+    struct Trace *trace = context;
+
+    // Same order as a_equals_b_plus_c()
+    if (trace_append(trace, READ_ACCESS, get_item_address(ARRAY_INDEX_B, row, col), ITEM_SIZE) != 0
+        || trace_append(trace, READ_ACCESS, get_item_address(ARRAY_INDEX_C, row, col), ITEM_SIZE) != 0
+        || trace_append(trace, WRITE_ACCESS, get_item_address(ARRAY_INDEX_A, row, col), ITEM_SIZE) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* trace_kernel
+ *
+ * Record the a = b + c kernel of main.c (columns outer, rows inner)
+ *
+ * @param       trace       Trace the records are appended to
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int trace_kernel(struct Trace *trace)
+{
+    return for_each_item(record_item, trace);
+}
+
+/* trace_parse_line
+ *
+ * Parse one line of a text trace, "R|W address [size]". The address is
+ * hex (0x...) or decimal, the size defaults to 1.
+ *
+ * @param       line
+ * @param       record      Parsed access
+ *
+ * @return      1 if a record was parsed, 0 for an empty or comment line,
+ *              -1 on a syntax error
+ */
+int trace_parse_line(const char *line, struct TraceRecord *record)
+{
+    /* Local Variables */
+    const char *p = line;
+    char *end;
+    unsigned long address;
+    unsigned long size;
+
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p == '\0' || *p == '#') {
+        return 0;
+    }
+
+    /* Access type */
+    if (*p == 'R' || *p == 'r') {
+        record->access = READ_ACCESS;
+    } else if (*p == 'W' || *p == 'w') {
+        record->access = WRITE_ACCESS;
+    } else {
+        return -1;
+    }
+    p++;
+
+    /* Address */
+    address = strtoul(p, &end, 0);
+    if (end == p) {
+        return -1;
+    }
+    p = end;
+
+    /* Optional size */
+    size = strtoul(p, &end, 0);
+    if (end == p || size == 0) {
+        size = 1;
+    }
+    if (size > UINT8_MAX) {
+        return -1;
+    }
+
+    record->address = (uint32_t)address;
+    record->size = (uint8_t)size;
+
+    return 1;
+}
+
+/* trace_load_text
+ *
+ * Load a text trace. Every line holds "R|W address [size]", the address
+ * in hex (0x...) or decimal. Empty lines and lines starting with '#'
+ * are skipped.
+ *
+ * @param       path
+ * @param       trace       Trace the records are appended to
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_load_text(const char *path, struct Trace *trace)
+{
+    /* Local Variables */
+    FILE *file;
+    char line[128];
+    unsigned long line_number = 0;
+    int result = 0;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        struct TraceRecord record;
+        int parsed = trace_parse_line(line, &record);
+
+        line_number++;
+
+        if (parsed < 0) {
+            fprintf(stderr, "%s:%lu: syntax error\n", path, line_number);
+            result = -1;
+            break;
+        }
+        if (parsed == 0) {
+            continue;
+        }
+        if (trace_append(trace, (access_t)record.access, record.address, record.size) != 0) {
+            fprintf(stderr, "%s: out of memory\n", path);
+            result = -1;
+            break;
+        }
+    }
+
+    fclose(file);
+
+    return result;
+}
+
+/* trace_block_bytes
+ *
+ * Bytes of a record that fall into the block starting at or holding
+ * an address
+ *
+ * @param       record
+ * @param       address     record->address or a later block address
+ * @param       offset      Offset size in bits (block size)
+ *
+ * @return      bytes
+ */
+uint8_t trace_block_bytes(const struct TraceRecord *record, uint32_t address, uint32_t offset)
+{
+    /* Local Variables */
+    uint32_t before = address - record->address;
+    uint32_t room = (1u << offset) - (address & ((1u << offset) - 1));
+    uint32_t left = record->size - before;
+
+    return (uint8_t)(left < room ? left : room);
+}
+
+/* access_crossing
+ *
+ * Access every block of a record that crosses a block boundary. Kept
+ * out of line, so the common single block path needs no stack frame.
+ *
+ * @param       record
+ *
+ * @return      number of cache accesses
+ */
+__attribute__((noinline)) static uint32_t access_crossing(const struct TraceRecord *record)
+{
+    /* Local Variables */
+    uint32_t address = record->address;
+    uint32_t last = (record->address + record->size - 1) >> OFFSET;
+    uint32_t accesses = 1;
+
+    while (1) {
+        access_cache_sized(address, (access_t)record->access, trace_block_bytes(record, address, OFFSET));
+        if ((address >> OFFSET) == last) {
+            break;
+        }
+        address = ((address >> OFFSET) + 1) << OFFSET;
+        accesses++;
+    }
+
+    return accesses;
+}
+
+/* trace_access_record
+ *
+ * Run one record through the cache of config.h. An access that spans
+ * several blocks accesses each of them.
+ *
+ * @param       record
+ *
+ * @return      number of cache accesses
+ */
+uint32_t trace_access_record(const struct TraceRecord *record)
+{
+    if ((record->address >> OFFSET) != ((record->address + record->size - 1) >> OFFSET)) {
+        return access_crossing(record);
+    }
+
+    /* Common case, the whole access falls into one block */
+    access_cache_sized(record->address, (access_t)record->access, record->size);
+
+    return 1;
+}
+
+/* trace_replay
+ *
+ * Run all records of a trace through the cache of config.h. An access that
+ * spans several blocks accesses each of them.
+ *
+ * @param       trace
+ *
+ * @return      number of cache accesses
+ */
+uint64_t trace_replay(const struct Trace *trace)
+{
+    /* Local Variables */
+    const struct TraceRecord *record = trace->records;
+    const struct TraceRecord *end = record + trace->count;
+    uint64_t accesses = 0;
+
+    for (; record < end; record++) {
+        accesses += trace_access_record(record);
+    }
+
+    return accesses;
+}
+
+/* trace_replay_arrays
+ *
+ * Run all records of a trace through the cache of config.h and count
+ * the results per array as well
+ *
+ * @param       trace
+ *
+ * @return      number of cache accesses
+ */
+uint64_t trace_replay_arrays(const struct Trace *trace)
+{
+    /* Local Variables */
+    struct HitMiss *hit_miss = get_cache_result();
+    uint64_t accesses = 0;
+    size_t i;
+
+    for (i = 0; i < trace->count; i++) {
+        const struct TraceRecord *record = &trace->records[i];
+        uint32_t address = record->address;
+        uint32_t last = (record->address + record->size - 1) >> OFFSET;
+
+        while (1) {
+            struct AccessCount *count = &hit_miss->array[get_array_index(address)];
+            result_t result = access_cache_sized(address, (access_t)record->access,
+                                                 trace_block_bytes(record, address, OFFSET));
+
+            count->hits += result == RESULT_HIT;
+            count->misses += result != RESULT_HIT;
+            accesses++;
+            if ((address >> OFFSET) == last) {
+                break;
+            }
+            address = ((address >> OFFSET) + 1) << OFFSET;
+        }
+    }
+
+    return accesses;
+}
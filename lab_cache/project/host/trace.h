@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* User includes */
+#include "arrays.h"
+#include "cache.h"
+
+/* TraceRecord
+ *
+ * One memory access: access type, start address and size in bytes.
+ */
+struct TraceRecord {
+    uint32_t address;
+    uint8_t access;
+    uint8_t size;
+};
+
+/* Trace
+ *
+ * Address trace held in memory, so replaying it does no I/O.
+ */
+struct Trace {
+    struct TraceRecord *records;
+    size_t count;
+    size_t capacity;
+};
+
+/* trace_init
+ *
+ * Initialize an empty trace
+ *
+ * @param       trace
+ *
+ * @return      void
+ */
+void trace_init(struct Trace *trace);
+
+/* trace_free
+ *
+ * Release the records of a trace
+ *
+ * @param       trace
+ *
+ * @return      void
+ */
+void trace_free(struct Trace *trace);
+
+/* trace_append
+ *
+ * Append one access to a trace
+ *
+ * @param       trace
+ * @param       access      READ_ACCESS or WRITE_ACCESS
+ * @param       address
+ * @param       size        Size in bytes
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int trace_append(struct Trace *trace, access_t access, uint32_t address, uint8_t size);
+
+/* trace_kernel
+ *
+ * Record the a = b + c kernel of main.c (columns outer, rows inner)
+ *
+ * @param       trace       Trace the records are appended to
+ *
+ * @return      0 on success, -1 if out of memory
+ */
+int trace_kernel(struct Trace *trace);
+
+/* trace_parse_line
+ *
+ * Parse one line of a text trace, "R|W address [size]". The address is
+ * hex (0x...) or decimal, the size defaults to 1.
+ *
+ * @param       line
+ * @param       record      Parsed access
+ *
+ * @return      1 if a record was parsed, 0 for an empty or comment line,
+ *              -1 on a syntax error
+ */
+int trace_parse_line(const char *line, struct TraceRecord *record);
+
+/* trace_load_text
+ *
+ * Load a text trace. Every line holds "R|W address [size]", the address
+ * in hex (0x...) or decimal. Empty lines and lines starting with '#'
+ * are skipped.
+ *
+ * @param       path
+ * @param       trace       Trace the records are appended to
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_load_text(const char *path, struct Trace *trace);
+
+/* trace_block_bytes
+ *
+ * Bytes of a record that fall into the block starting at or holding
+ * an address
+ *
+ * @param       record
+ * @param       address     record->address or a later block address
+ * @param       offset      Offset size in bits (block size)
+ *
+ * @return      bytes
+ */
+uint8_t trace_block_bytes(const struct TraceRecord *record, uint32_t address, uint32_t offset);
+
+/* trace_access_record
+ *
+ * Run one record through access_cache(). An access that spans several
+ * blocks accesses each of them.
+ *
+ * @param       record
+ *
+ * @return      number of cache accesses
+ */
+uint32_t trace_access_record(const struct TraceRecord *record);
+
+/* trace_replay
+ *
+ * Run all records of a trace through access_cache(). An access that
+ * spans several blocks accesses each of them.
+ *
+ * @param       trace
+ *
+ * @return      number of cache accesses
+ */
+uint64_t trace_replay(const struct Trace *trace);
+
+/* trace_replay_arrays
+ *
+ * Same as trace_replay(), but also counts every result for the array
+ * of its address, as access_array() does on the board. Meant for the
+ * trace of trace_kernel(), get_array_index() costs too much for long
+ * traces.
+ *
+ * @param       trace
+ *
+ * @return      number of cache accesses
+ */
+uint64_t trace_replay_arrays(const struct Trace *trace);
+
+#endif
+/* TRACE_H_ */
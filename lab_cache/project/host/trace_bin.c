@@ -0,0 +1,588 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* User includes */
+#include "trace_bin.h"
+
+/* Worst case encoded size of a record: 5 varint bytes plus size byte */
+#define TRACE_BIN_MAX_RECORD 6
+
+/* put_u32
+ *
+ * Store a little endian 32 bit value
+ *
+ * @param       p
+ * @param       value
+ *
+ * @return      void
+ */
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/* put_u64
+ *
+ * Store a little endian 64 bit value
+ *
+ * @param       p
+ * @param       value
+ *
+ * @return      void
+ */
+static void put_u64(uint8_t *p, uint64_t value)
+{
+    put_u32(p, (uint32_t)value);
+    put_u32(p + 4, (uint32_t)(value >> 32));
+}
+
+/* get_u32
+ *
+ * Load a little endian 32 bit value
+ *
+ * @param       p
+ *
+ * @return      value
+ */
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* get_u64
+ *
+ * Load a little endian 64 bit value
+ *
+ * @param       p
+ *
+ * @return      value
+ */
+static uint64_t get_u64(const uint8_t *p)
+{
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+/* write_header
+ *
+ * Write the file header at the start of the file
+ *
+ * @param       writer
+ * @param       index_offset
+ *
+ * @return      0 on success, -1 on error
+ */
+static int write_header(struct TraceBinWriter *writer, uint64_t index_offset)
+{
+    /* Local Variables */
+    uint8_t header[TRACE_BIN_HEADER] = { 0 };
+
+    put_u32(header, TRACE_BIN_MAGIC);
+    header[4] = TRACE_BIN_VERSION;
+    header[6] = TRACE_BIN_HEADER;
+    put_u32(header + 8, writer->chunk_records);
+    put_u32(header + 12, writer->chunk_count);
+    put_u64(header + 16, writer->record_count);
+    put_u64(header + 24, index_offset);
+
+    if (fseek(writer->file, 0, SEEK_SET) != 0
+        || fwrite(header, sizeof(header), 1, writer->file) != 1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* flush_chunk
+ *
+ * Write the buffered chunk and add it to the index
+ *
+ * @param       writer
+ *
+ * @return      0 on success, -1 on error
+ */
+static int flush_chunk(struct TraceBinWriter *writer)
+{
+    /* Local Variables */
+    struct TraceBinChunk *chunk;
+
+    if (writer->records == 0) {
+        return 0;
+    }
+
+    if (writer->chunk_count == writer->index_capacity) {
+        uint32_t capacity = writer->index_capacity ? writer->index_capacity * 2 : 64;
+        struct TraceBinChunk *index = realloc(writer->index, capacity * sizeof(*index));
+
+        if (index == NULL) {
+            return -1;
+        }
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+
+    if (fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) {
+        return -1;
+    }
+
+    chunk = &writer->index[writer->chunk_count++];
+    chunk->offset = writer->offset;
+    chunk->first_record = writer->record_count - writer->records;
+    chunk->bytes = writer->used;
+    chunk->records = writer->records;
+
+    /* Next chunk decodes on its own */
+    writer->offset += writer->used;
+    writer->used = 0;
+    writer->records = 0;
+    writer->previous_address = 0;
+    writer->previous_size = 1;
+
+    return 0;
+}
+
+/* trace_bin_create
+ *
+ * Create a binary trace file
+ *
+ * @param       writer
+ * @param       path
+ * @param       chunk_records   Records per chunk, 0 for the default
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_bin_create(struct TraceBinWriter *writer, const char *path, uint32_t chunk_records)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->chunk_records = chunk_records ? chunk_records : TRACE_BIN_CHUNK_RECORDS;
+    writer->previous_size = 1;
+    writer->offset = TRACE_BIN_HEADER;
+
+    writer->buffer = malloc((size_t)writer->chunk_records * TRACE_BIN_MAX_RECORD);
+    if (writer->buffer == NULL) {
+        return -1;
+    }
+
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        perror(path);
+        free(writer->buffer);
+        return -1;
+    }
+
+    /* Placeholder, rewritten by trace_bin_finish() */
+    if (write_header(writer, 0) != 0) {
+        fclose(writer->file);
+        free(writer->buffer);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* trace_bin_write
+ *
+ * Append one record
+ *
+ * @param       writer
+ * @param       record
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_bin_write(struct TraceBinWriter *writer, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    int64_t delta = (int64_t)record->address - (int64_t)writer->previous_address;
+    uint64_t value = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    uint8_t *p = writer->buffer + writer->used;
+
+    /* Pack the access type and the size flag into the tag bits */
+    value <<= TRACE_BIN_TAG_BITS;
+    if (record->access == WRITE_ACCESS) {
+        value |= TRACE_BIN_TAG_WRITE;
+    }
+    if (record->size != writer->previous_size) {
+        value |= TRACE_BIN_TAG_SIZE;
+    }
+
+    /* LEB128 varint */
+    while (value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+
+    if (record->size != writer->previous_size) {
+        *p++ = record->size;
+        writer->previous_size = record->size;
+    }
+
+    writer->previous_address = record->address;
+    writer->used = (uint32_t)(p - writer->buffer);
+    writer->records++;
+    writer->record_count++;
+
+    if (writer->records == writer->chunk_records) {
+        return flush_chunk(writer);
+    }
+
+    return 0;
+}
+
+/* trace_bin_finish
+ *
+ * Flush the last chunk, write the index and the header and close the
+ * file
+ *
+ * @param       writer
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_bin_finish(struct TraceBinWriter *writer)
+{
+    /* Local Variables */
+    uint64_t index_offset;
+    uint32_t i;
+    int result = 0;
+
+    if (flush_chunk(writer) != 0) {
+        result = -1;
+    }
+
+    /* Index */
+    index_offset = writer->offset;
+    for (i = 0; i < writer->chunk_count && result == 0; i++) {
+        uint8_t entry[TRACE_BIN_ENTRY];
+
+        put_u64(entry, writer->index[i].offset);
+        put_u64(entry + 8, writer->index[i].first_record);
+        put_u32(entry + 16, writer->index[i].bytes);
+        put_u32(entry + 20, writer->index[i].records);
+        if (fwrite(entry, sizeof(entry), 1, writer->file) != 1) {
+            result = -1;
+        }
+    }
+
+    if (result == 0) {
+        result = write_header(writer, index_offset);
+    }
+    if (fclose(writer->file) != 0) {
+        result = -1;
+    }
+
+    free(writer->buffer);
+    free(writer->index);
+    writer->file = NULL;
+    writer->buffer = NULL;
+    writer->index = NULL;
+
+    return result;
+}
+
+/* trace_bin_open
+ *
+ * Map a binary trace and read its index
+ *
+ * @param       reader
+ * @param       path
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_bin_open(struct TraceBinReader *reader, const char *path)
+{
+    /* Local Variables */
+    struct stat st;
+    const uint8_t *map;
+    uint64_t index_offset;
+    uint64_t record_count = 0;
+    uint32_t i;
+    int fd;
+
+    memset(reader, 0, sizeof(*reader));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < TRACE_BIN_HEADER) {
+        fprintf(stderr, "%s: not a binary trace\n", path);
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    reader->map = map;
+    reader->map_size = (size_t)st.st_size;
+
+    /* Header */
+    index_offset = get_u64(map + 24);
+    reader->chunk_count = get_u32(map + 12);
+    reader->record_count = get_u64(map + 16);
+    if (get_u32(map) != TRACE_BIN_MAGIC || map[4] != TRACE_BIN_VERSION
+        || index_offset > reader->map_size
+        || (reader->map_size - index_offset) / TRACE_BIN_ENTRY < reader->chunk_count) {
+        fprintf(stderr, "%s: corrupt binary trace header\n", path);
+        trace_bin_close(reader);
+        return -1;
+    }
+
+    /* Index */
+    reader->index = malloc((reader->chunk_count + 1) * sizeof(*reader->index));
+    if (reader->index == NULL) {
+        trace_bin_close(reader);
+        return -1;
+    }
+    for (i = 0; i < reader->chunk_count; i++) {
+        const uint8_t *entry = map + index_offset + (uint64_t)i * TRACE_BIN_ENTRY;
+        struct TraceBinChunk *chunk = &reader->index[i];
+
+        chunk->offset = get_u64(entry);
+        chunk->first_record = get_u64(entry + 8);
+        chunk->bytes = get_u32(entry + 16);
+        chunk->records = get_u32(entry + 20);
+        if (chunk->offset > index_offset || chunk->bytes > index_offset - chunk->offset
+            || chunk->first_record != record_count) {
+            fprintf(stderr, "%s: corrupt binary trace index\n", path);
+            trace_bin_close(reader);
+            return -1;
+        }
+        record_count += chunk->records;
+    }
+    if (record_count != reader->record_count) {
+        fprintf(stderr, "%s: corrupt binary trace index\n", path);
+        trace_bin_close(reader);
+        return -1;
+    }
+
+    /* Chunks are read front to back */
+    posix_madvise((void *)map, reader->map_size, POSIX_MADV_SEQUENTIAL);
+
+    return 0;
+}
+
+/* trace_bin_close
+ *
+ * Unmap a binary trace
+ *
+ * @param       reader
+ *
+ * @return      void
+ */
+void trace_bin_close(struct TraceBinReader *reader)
+{
+    if (reader->map != NULL) {
+        munmap((void *)reader->map, reader->map_size);
+    }
+    free(reader->index);
+    memset(reader, 0, sizeof(*reader));
+}
+
+/* trace_bin_is_binary
+ *
+ * Check whether a file starts with the binary trace magic
+ *
+ * @param       path
+ *
+ * @return      1 if binary, 0 otherwise
+ */
+int trace_bin_is_binary(const char *path)
+{
+    /* Local Variables */
+    uint8_t magic[4];
+    FILE *file = fopen(path, "rb");
+    int binary = 0;
+
+    if (file != NULL) {
+        binary = fread(magic, sizeof(magic), 1, file) == 1 && get_u32(magic) == TRACE_BIN_MAGIC;
+        fclose(file);
+    }
+
+    return binary;
+}
+
+/* trace_bin_cursor
+ *
+ * Position a cursor at the first record of a chunk. Cursors of
+ * different chunks are independent and can be used in parallel.
+ *
+ * @param       reader
+ * @param       chunk       Chunk number
+ * @param       cursor
+ *
+ * @return      void
+ */
+void trace_bin_cursor(const struct TraceBinReader *reader, uint32_t chunk,
+                      struct TraceBinCursor *cursor)
+{
+    const struct TraceBinChunk *entry = &reader->index[chunk];
+
+    cursor->pos = reader->map + entry->offset;
+    cursor->end = cursor->pos + entry->bytes;
+    cursor->remaining = entry->records;
+    cursor->address = 0;
+    cursor->size = 1;
+}
+
+/* trace_bin_next
+ *
+ * Decode the next record of a chunk
+ *
+ * @param       cursor
+ * @param       record
+ *
+ * @return      1 if a record was decoded, 0 at the end of the chunk,
+ *              -1 if the chunk is corrupt
+ */
+int trace_bin_next(struct TraceBinCursor *cursor, struct TraceRecord *record)
+{
+    /* Local Variables */
+    const uint8_t *p = cursor->pos;
+    uint64_t value = 0;
+    unsigned shift = 0;
+    uint64_t zigzag;
+
+    if (cursor->remaining == 0) {
+        return 0;
+    }
+
+    /* LEB128 varint */
+    do {
+        if (p == cursor->end || shift > 28) {
+            return -1;
+        }
+        value |= (uint64_t)(*p & 0x7f) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+
+    if (value & TRACE_BIN_TAG_SIZE) {
+        if (p == cursor->end) {
+            return -1;
+        }
+        cursor->size = *p++;
+    }
+
+    zigzag = value >> TRACE_BIN_TAG_BITS;
+    cursor->address += (uint32_t)((zigzag >> 1) ^ (0 - (zigzag & 1)));
+    cursor->pos = p;
+    cursor->remaining--;
+
+    record->address = cursor->address;
+    record->size = cursor->size;
+    record->access = (value & TRACE_BIN_TAG_WRITE) ? WRITE_ACCESS : READ_ACCESS;
+
+    return 1;
+}
+
+/* trace_bin_replay
+ *
+ * Run all records of a binary trace through the cache of config.h
+ *
+ * @param       reader
+ *
+ * @return      number of cache accesses, -1 if a chunk is corrupt
+ */
+int64_t trace_bin_replay(const struct TraceBinReader *reader)
+{
+    /* Local Variables */
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    uint64_t accesses = 0;
+    uint32_t chunk;
+    int decoded = 0;
+
+    for (chunk = 0; chunk < reader->chunk_count && decoded >= 0; chunk++) {
+        trace_bin_cursor(reader, chunk, &cursor);
+        while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+            accesses += trace_access_record(&record);
+        }
+    }
+
+    return decoded < 0 ? -1 : (int64_t)accesses;
+}
+
+/* trace_stream
+ *
+ * Stream the records of a text or binary trace file through a callback
+ * without loading the whole trace
+ *
+ * @param       path
+ * @param       visit       Called for every record
+ * @param       context     Passed to visit
+ *
+ * @return      number of records, -1 on error
+ */
+int64_t trace_stream(const char *path, void (*visit)(void *context, const struct TraceRecord *record),
+                     void *context)
+{
+    /* Local Variables */
+    struct TraceRecord record;
+    int64_t records = 0;
+
+    if (trace_bin_is_binary(path)) {
+        struct TraceBinReader reader;
+        struct TraceBinCursor cursor;
+        uint32_t chunk;
+        int decoded = 0;
+
+        if (trace_bin_open(&reader, path) != 0) {
+            return -1;
+        }
+        for (chunk = 0; chunk < reader.chunk_count && decoded >= 0; chunk++) {
+            trace_bin_cursor(&reader, chunk, &cursor);
+            while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+                visit(context, &record);
+                records++;
+            }
+        }
+        trace_bin_close(&reader);
+        if (decoded < 0) {
+            fprintf(stderr, "%s: corrupt chunk\n", path);
+            return -1;
+        }
+    } else {
+        char line[128];
+        unsigned long line_number = 0;
+        FILE *file = fopen(path, "r");
+
+        if (file == NULL) {
+            perror(path);
+            return -1;
+        }
+        while (fgets(line, sizeof(line), file) != NULL) {
+            int parsed = trace_parse_line(line, &record);
+
+            line_number++;
+            if (parsed < 0) {
+                fprintf(stderr, "%s:%lu: syntax error\n", path, line_number);
+                fclose(file);
+                return -1;
+            }
+            if (parsed > 0) {
+                visit(context, &record);
+                records++;
+            }
+        }
+        fclose(file);
+    }
+
+    return records;
+}
@@ -0,0 +1,223 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Binary trace format
+ *
+ * All integers are little endian.
+ *
+ *   header   magic "CTTB", version, header size, records per chunk,
+ *            chunk count, record count, index offset
+ *   chunks   encoded records, every chunk decodes on its own
+ *   index    per chunk: file offset, first record, bytes, records
+ *
+ * A record is one varint (LEB128) holding
+ *
+ *   zigzag(address - previous address) << 2 | size flag << 1 | write
+ *
+ * followed by one size byte if the size flag is set, i.e. the size
+ * differs from the previous record. The previous address and size start
+ * at 0 and 1 at the beginning of every chunk.
+ */
+
+#ifndef TRACE_BIN_H_
+#define TRACE_BIN_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* User includes */
+#include "trace.h"
+
+/* File identification */
+#define TRACE_BIN_MAGIC     0x42545443u     /* "CTTB" */
+#define TRACE_BIN_VERSION   1
+#define TRACE_BIN_HEADER    40
+#define TRACE_BIN_ENTRY     24
+
+/* Default records per chunk */
+#define TRACE_BIN_CHUNK_RECORDS (1u << 16)
+
+/* Tag bits of an encoded record */
+#define TRACE_BIN_TAG_WRITE 0x1u
+#define TRACE_BIN_TAG_SIZE  0x2u
+#define TRACE_BIN_TAG_BITS  2
+
+/* TraceBinChunk
+ *
+ * Index entry of one chunk
+ */
+struct TraceBinChunk {
+    uint64_t offset;
+    uint64_t first_record;
+    uint32_t bytes;
+    uint32_t records;
+};
+
+/* TraceBinWriter
+ *
+ * Encodes records into a chunk buffer and writes full chunks to a file.
+ * The index is kept in memory and appended by trace_bin_finish().
+ */
+struct TraceBinWriter {
+    FILE *file;
+    uint8_t *buffer;
+    uint32_t used;
+    uint32_t chunk_records;
+    uint32_t records;
+    uint32_t previous_address;
+    uint8_t previous_size;
+    uint64_t offset;
+    uint64_t record_count;
+    struct TraceBinChunk *index;
+    uint32_t chunk_count;
+    uint32_t index_capacity;
+};
+
+/* TraceBinReader
+ *
+ * Read only mapping of a binary trace plus its decoded index
+ */
+struct TraceBinReader {
+    const uint8_t *map;
+    size_t map_size;
+    uint64_t record_count;
+    uint32_t chunk_count;
+    struct TraceBinChunk *index;
+};
+
+/* TraceBinCursor
+ *
+ * Iterator over the records of one chunk. Decodes straight from the
+ * mapping, nothing is copied.
+ */
+struct TraceBinCursor {
+    const uint8_t *pos;
+    const uint8_t *end;
+    uint32_t remaining;
+    uint32_t address;
+    uint8_t size;
+};
+
+/* trace_bin_create
+ *
+ * Create a binary trace file
+ *
+ * @param       writer
+ * @param       path
+ * @param       chunk_records   Records per chunk, 0 for the default
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_bin_create(struct TraceBinWriter *writer, const char *path, uint32_t chunk_records);
+
+/* trace_bin_write
+ *
+ * Append one record
+ *
+ * @param       writer
+ * @param       record
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_bin_write(struct TraceBinWriter *writer, const struct TraceRecord *record);
+
+/* trace_bin_finish
+ *
+ * Flush the last chunk, write the index and the header and close the
+ * file
+ *
+ * @param       writer
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_bin_finish(struct TraceBinWriter *writer);
+
+/* trace_bin_open
+ *
+ * Map a binary trace and read its index
+ *
+ * @param       reader
+ * @param       path
+ *
+ * @return      0 on success, -1 on error
+ */
+int trace_bin_open(struct TraceBinReader *reader, const char *path);
+
+/* trace_bin_close
+ *
+ * Unmap a binary trace
+ *
+ * @param       reader
+ *
+ * @return      void
+ */
+void trace_bin_close(struct TraceBinReader *reader);
+
+/* trace_bin_is_binary
+ *
+ * Check whether a file starts with the binary trace magic
+ *
+ * @param       path
+ *
+ * @return      1 if binary, 0 otherwise
+ */
+int trace_bin_is_binary(const char *path);
+
+/* trace_bin_cursor
+ *
+ * Position a cursor at the first record of a chunk. Cursors of
+ * different chunks are independent and can be used in parallel.
+ *
+ * @param       reader
+ * @param       chunk       Chunk number
+ * @param       cursor
+ *
+ * @return      void
+ */
+void trace_bin_cursor(const struct TraceBinReader *reader, uint32_t chunk,
+                      struct TraceBinCursor *cursor);
+
+/* trace_bin_next
+ *
+ * Decode the next record of a chunk
+ *
+ * @param       cursor
+ * @param       record
+ *
+ * @return      1 if a record was decoded, 0 at the end of the chunk,
+ *              -1 if the chunk is corrupt
+ */
+int trace_bin_next(struct TraceBinCursor *cursor, struct TraceRecord *record);
+
+/* trace_bin_replay
+ *
+ * Run all records of a binary trace through the cache of config.h
+ *
+ * @param       reader
+ *
+ * @return      number of cache accesses, -1 if a chunk is corrupt
+ */
+int64_t trace_bin_replay(const struct TraceBinReader *reader);
+
+/* trace_stream
+ *
+ * Stream the records of a text or binary trace file through a callback
+ * without loading the whole trace
+ *
+ * @param       path
+ * @param       visit       Called for every record
+ * @param       context     Passed to visit
+ *
+ * @return      number of records, -1 on error
+ */
+int64_t trace_stream(const char *path, void (*visit)(void *context, const struct TraceRecord *record),
+                     void *context);
+
+#endif
+/* TRACE_BIN_H_ */
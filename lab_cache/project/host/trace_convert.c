@@ -0,0 +1,224 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, trace converter
+ * --
+ * -- Usage       : trace_convert [-f format] in out [records per chunk]
+ * --               Text input is converted to a binary trace, binary
+ * --               input back to text. With -f a din, lackey or pin
+ * --               trace (see trace_import.h) is converted to a binary
+ * --               trace.
+ * --------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+/* User includes */
+#include "trace_bin.h"
+#include "trace_import.h"
+
+/* ImportTarget
+ *
+ * Context of import_visit()
+ */
+struct ImportTarget {
+    struct TraceBinWriter writer;
+    int failed;
+};
+
+/* text_to_binary
+ *
+ * Stream a text trace into a binary trace
+ *
+ * @param       in
+ * @param       out
+ * @param       chunk_records
+ *
+ * @return      0 on success, -1 on error
+ */
+static int text_to_binary(const char *in, const char *out, uint32_t chunk_records)
+{
+    /* Local Variables */
+    struct TraceBinWriter writer;
+    struct TraceRecord record;
+    char line[128];
+    unsigned long line_number = 0;
+    FILE *file;
+    int result = 0;
+
+    file = fopen(in, "r");
+    if (file == NULL) {
+        perror(in);
+        return -1;
+    }
+    if (trace_bin_create(&writer, out, chunk_records) != 0) {
+        fclose(file);
+        return -1;
+    }
+
+    while (result == 0 && fgets(line, sizeof(line), file) != NULL) {
+        int parsed = trace_parse_line(line, &record);
+
+        line_number++;
+        if (parsed < 0) {
+            fprintf(stderr, "%s:%lu: syntax error\n", in, line_number);
+            result = -1;
+        } else if (parsed > 0) {
+            result = trace_bin_write(&writer, &record);
+        }
+    }
+    fclose(file);
+
+    if (trace_bin_finish(&writer) != 0) {
+        result = -1;
+    }
+    if (result == 0) {
+        printf("%llu records\n", (unsigned long long)writer.record_count);
+    }
+
+    return result;
+}
+
+/* import_visit
+ *
+ * Write an imported record to the binary trace
+ *
+ * @param       context     struct ImportTarget
+ * @param       record
+ *
+ * @return      void
+ */
+static void import_visit(void *context, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct ImportTarget *target = context;
+
+    if (!target->failed && trace_bin_write(&target->writer, record) != 0) {
+        target->failed = 1;
+    }
+}
+
+/* import_to_binary
+ *
+ * Stream a foreign trace into a binary trace
+ *
+ * @param       in
+ * @param       format      TRACE_FORMAT_*
+ * @param       out
+ * @param       chunk_records
+ *
+ * @return      0 on success, -1 on error
+ */
+static int import_to_binary(const char *in, int format, const char *out, uint32_t chunk_records)
+{
+    /* Local Variables */
+    struct ImportTarget target;
+    struct TraceImport import;
+    int result = 0;
+
+    target.failed = 0;
+    if (trace_bin_create(&target.writer, out, chunk_records) != 0) {
+        return -1;
+    }
+    if (trace_import(in, format, import_visit, &target, &import) < 0 || target.failed) {
+        result = -1;
+    }
+    if (trace_bin_finish(&target.writer) != 0) {
+        result = -1;
+    }
+    if (result == 0) {
+        printf("%llu lines, %llu records, %llu skipped\n", (unsigned long long)import.lines,
+               (unsigned long long)import.records, (unsigned long long)import.skipped);
+    }
+
+    return result;
+}
+
+/* binary_to_text
+ *
+ * Decode a binary trace into a text trace
+ *
+ * @param       in
+ * @param       out
+ *
+ * @return      0 on success, -1 on error
+ */
+static int binary_to_text(const char *in, const char *out)
+{
+    /* Local Variables */
+    struct TraceBinReader reader;
+    struct TraceBinCursor cursor;
+    struct TraceRecord record;
+    uint32_t chunk;
+    FILE *file;
+    int result = 0;
+
+    if (trace_bin_open(&reader, in) != 0) {
+        return -1;
+    }
+    file = fopen(out, "w");
+    if (file == NULL) {
+        perror(out);
+        trace_bin_close(&reader);
+        return -1;
+    }
+
+    for (chunk = 0; chunk < reader.chunk_count && result == 0; chunk++) {
+        int decoded;
+
+        trace_bin_cursor(&reader, chunk, &cursor);
+        while ((decoded = trace_bin_next(&cursor, &record)) > 0) {
+            fprintf(file, "%c 0x%08x %u\n", record.access == WRITE_ACCESS ? 'W' : 'R',
+                    record.address, record.size);
+        }
+        if (decoded < 0) {
+            fprintf(stderr, "%s: corrupt chunk %u\n", in, chunk);
+            result = -1;
+        }
+    }
+
+    if (fclose(file) != 0) {
+        result = -1;
+    }
+    trace_bin_close(&reader);
+
+    return result;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    uint32_t chunk_records = 0;
+    int format = -1;
+    int option;
+
+    while ((option = getopt(argc, argv, "f:")) != -1) {
+        if (option != 'f' || (format = trace_format_parse(optarg)) < 0) {
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind > argc || argc - optind < 2 || argc - optind > 3) {
+        fprintf(stderr, "usage: %s [-f din|lackey|pin] in out [records per chunk]\n", argv[0]);
+        return 2;
+    }
+    if (argc - optind == 3) {
+        chunk_records = (uint32_t)strtoul(argv[optind + 2], NULL, 0);
+    }
+
+    if (format >= 0) {
+        return import_to_binary(argv[optind], format, argv[optind + 1], chunk_records) == 0 ? 0 : 1;
+    }
+    if (trace_bin_is_binary(argv[optind])) {
+        return binary_to_text(argv[optind], argv[optind + 1]) == 0 ? 0 : 1;
+    }
+
+    return text_to_binary(argv[optind], argv[optind + 1], chunk_records) == 0 ? 0 : 1;
+}
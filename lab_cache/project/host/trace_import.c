@@ -0,0 +1,436 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* User includes */
+#include "trace_import.h"
+
+/* Kinds of a parsed line */
+#define LINE_READ   0
+#define LINE_WRITE  1
+#define LINE_MODIFY 2               /* Read then write */
+#define LINE_SKIP   3
+
+/* Names of the formats, by TRACE_FORMAT_* */
+static const char *format_names[] = { "din", "lackey", "pin" };
+
+/* ImportLine
+ *
+ * One parsed line
+ */
+struct ImportLine {
+    uint64_t address;
+    uint32_t size;
+    uint8_t kind;
+};
+
+/* trace_format_parse
+ *
+ * Look up a format by name
+ *
+ * @param       name        "din", "lackey" or "pin"
+ *
+ * @return      TRACE_FORMAT_*, -1 if unknown
+ */
+int trace_format_parse(const char *name)
+{
+    /* Local Variables */
+    int format;
+
+    for (format = 0; format < (int)(sizeof(format_names) / sizeof(format_names[0])); format++) {
+        if (strcmp(name, format_names[format]) == 0) {
+            return format;
+        }
+    }
+
+    return -1;
+}
+
+/* trace_format_name
+ *
+ * Name of a format
+ *
+ * @param       format      TRACE_FORMAT_*
+ *
+ * @return      name
+ */
+const char *trace_format_name(int format)
+{
+    return format_names[format];
+}
+
+/* skip_blanks
+ *
+ * Skip spaces, tabs and a carriage return
+ *
+ * @param       p
+ * @param       end
+ *
+ * @return      first other character
+ */
+static inline const char *skip_blanks(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+
+    return p;
+}
+
+/* parse_hex
+ *
+ * Parse a hex number with or without 0x
+ *
+ * @param       p
+ * @param       end
+ * @param       value
+ *
+ * @return      character after the number, NULL if there is none
+ */
+static inline const char *parse_hex(const char *p, const char *end, uint64_t *value)
+{
+    /* Local Variables */
+    const char *start;
+    uint64_t v = 0;
+
+    if (end - p > 2 && p[0] == '0' && (p[1] | 0x20) == 'x') {
+        p += 2;
+    }
+    for (start = p; p < end; p++) {
+        uint32_t digit = (uint32_t)(uint8_t)*p - '0';
+
+        if (digit > 9) {
+            /* Lower case by bit 5, then a .. f */
+            digit = (uint32_t)((uint8_t)*p | 0x20) - 'a';
+            if (digit > 5) {
+                break;
+            }
+            digit += 10;
+        }
+        v = v << 4 | digit;
+    }
+    *value = v;
+
+    return p > start ? p : NULL;
+}
+
+/* parse_decimal
+ *
+ * Parse a decimal number
+ *
+ * @param       p
+ * @param       end
+ * @param       value
+ *
+ * @return      character after the number, NULL if there is none
+ */
+static inline const char *parse_decimal(const char *p, const char *end, uint32_t *value)
+{
+    /* Local Variables */
+    const char *start = p;
+    uint32_t v = 0;
+
+    for (; p < end && (uint32_t)(uint8_t)*p - '0' <= 9; p++) {
+        v = v * 10 + ((uint32_t)(uint8_t)*p - '0');
+    }
+    *value = v;
+
+    return p > start ? p : NULL;
+}
+
+/* parse_din
+ *
+ * Parse a Dinero IV line "label address [size]"
+ *
+ * @param       p           First non-blank character
+ * @param       end
+ * @param       line
+ *
+ * @return      0 on success, -1 on a syntax error
+ */
+static inline int parse_din(const char *p, const char *end, struct ImportLine *line)
+{
+    /* Local Variables */
+    uint32_t label;
+
+    p = parse_decimal(p, end, &label);
+    if (p == NULL || label > 4) {
+        return -1;
+    }
+    line->kind = label == 0 ? LINE_READ : label == 1 ? LINE_WRITE : LINE_SKIP;
+
+    p = parse_hex(skip_blanks(p, end), end, &line->address);
+    if (p == NULL) {
+        return -1;
+    }
+    p = skip_blanks(p, end);
+    line->size = TRACE_IMPORT_SIZE;
+    if (p < end && (p = parse_decimal(p, end, &line->size)) == NULL) {
+        return -1;
+    }
+
+    return skip_blanks(p, end) == end ? 0 : -1;
+}
+
+/* parse_lackey
+ *
+ * Parse a Lackey line "K address,size", K one of I L S M
+ *
+ * @param       p           First non-blank character
+ * @param       end
+ * @param       line
+ *
+ * @return      0 on success, -1 on a syntax error
+ */
+static inline int parse_lackey(const char *p, const char *end, struct ImportLine *line)
+{
+    switch (*p) {
+    case 'L':
+        line->kind = LINE_READ;
+        break;
+    case 'S':
+        line->kind = LINE_WRITE;
+        break;
+    case 'M':
+        line->kind = LINE_MODIFY;
+        break;
+    case 'I':
+        line->kind = LINE_SKIP;
+        break;
+    case '=':
+        /* Valgrind messages, "==pid== ..." */
+        line->kind = LINE_SKIP;
+        return 0;
+    default:
+        return -1;
+    }
+
+    p = parse_hex(skip_blanks(p + 1, end), end, &line->address);
+    if (p == NULL || p == end || *p != ',') {
+        return -1;
+    }
+    p = parse_decimal(p + 1, end, &line->size);
+    if (p == NULL) {
+        return -1;
+    }
+
+    return skip_blanks(p, end) == end ? 0 : -1;
+}
+
+/* parse_pin
+ *
+ * Parse a pin-style line "[ip:] R|W address [size]"
+ *
+ * @param       p           First non-blank character
+ * @param       end
+ * @param       line
+ *
+ * @return      0 on success, -1 on a syntax error
+ */
+static inline int parse_pin(const char *p, const char *end, struct ImportLine *line)
+{
+    /* Local Variables */
+    const char *after;
+    uint64_t ip;
+
+    /* Instruction pointer, dropped */
+    after = parse_hex(p, end, &ip);
+    if (after != NULL && after < end && *after == ':') {
+        p = skip_blanks(after + 1, end);
+    }
+
+    if (p < end && (*p == 'R' || *p == 'r')) {
+        line->kind = LINE_READ;
+    } else if (p < end && (*p == 'W' || *p == 'w')) {
+        line->kind = LINE_WRITE;
+    } else {
+        return -1;
+    }
+
+    p = parse_hex(skip_blanks(p + 1, end), end, &line->address);
+    if (p == NULL) {
+        return -1;
+    }
+    p = skip_blanks(p, end);
+    line->size = TRACE_IMPORT_SIZE;
+    if (p < end && (p = parse_decimal(p, end, &line->size)) == NULL) {
+        return -1;
+    }
+
+    return skip_blanks(p, end) == end ? 0 : -1;
+}
+
+/* import_line
+ *
+ * Parse one line and pass its records on
+ *
+ * @param       format
+ * @param       p           Start of the line
+ * @param       end         Its newline or the end of the file
+ * @param       visit
+ * @param       context
+ * @param       import
+ *
+ * @return      0 on success, -1 on a syntax error
+ */
+static inline int import_line(int format, const char *p, const char *end,
+                              void (*visit)(void *context, const struct TraceRecord *record),
+                              void *context, struct TraceImport *import)
+{
+    /* Local Variables */
+    struct ImportLine line;
+    struct TraceRecord record;
+    uint32_t first;
+    uint32_t last;
+    uint32_t pass;
+    int parsed;
+
+    p = skip_blanks(p, end);
+    if (p == end || *p == '#') {
+        import->skipped++;
+        return 0;
+    }
+
+    switch (format) {
+    case TRACE_FORMAT_DIN:
+        parsed = parse_din(p, end, &line);
+        break;
+    case TRACE_FORMAT_LACKEY:
+        parsed = parse_lackey(p, end, &line);
+        break;
+    default:
+        parsed = parse_pin(p, end, &line);
+        break;
+    }
+    if (parsed != 0) {
+        return -1;
+    }
+    if (line.kind == LINE_SKIP) {
+        import->skipped++;
+        return 0;
+    }
+
+    /* A modify is a read and a write, a long access several records */
+    first = line.kind == LINE_WRITE;
+    last = line.kind != LINE_READ;
+    for (pass = first; pass <= last; pass++) {
+        uint32_t address = (uint32_t)line.address;
+        uint32_t size = line.size ? line.size : 1;
+
+        record.access = pass == 0 ? READ_ACCESS : WRITE_ACCESS;
+        do {
+            record.address = address;
+            record.size = (uint8_t)(size > UINT8_MAX ? UINT8_MAX : size);
+            visit(context, &record);
+            import->records++;
+            address += record.size;
+            size -= record.size;
+        } while (size > 0);
+    }
+
+    return 0;
+}
+
+/* trace_import
+ *
+ * Stream the records of a foreign trace through a callback
+ *
+ * @param       path
+ * @param       format      TRACE_FORMAT_*
+ * @param       visit       Called for every record
+ * @param       context     Passed to visit
+ * @param       import      Gets the counters, may be NULL
+ *
+ * @return      number of records, -1 on error
+ */
+int64_t trace_import(const char *path, int format,
+                     void (*visit)(void *context, const struct TraceRecord *record), void *context,
+                     struct TraceImport *import)
+{
+    /* Local Variables */
+    struct TraceImport counters;
+    char *buffer;
+    size_t fill = 0;
+    int eof = 0;
+    int status = 0;
+    FILE *file;
+
+    memset(&counters, 0, sizeof(counters));
+    if (format < TRACE_FORMAT_DIN || format > TRACE_FORMAT_PIN) {
+        return -1;
+    }
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    buffer = malloc(TRACE_IMPORT_BUFFER);
+    if (buffer == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    while (status == 0 && !eof) {
+        size_t got = fread(buffer + fill, 1, TRACE_IMPORT_BUFFER - fill, file);
+        const char *p = buffer;
+        const char *end;
+
+        if (got == 0) {
+            if (ferror(file)) {
+                perror(path);
+                status = -1;
+                break;
+            }
+            eof = 1;
+        }
+        counters.bytes += got;
+        fill += got;
+        end = buffer + fill;
+
+        while (p < end) {
+            const char *newline = memchr(p, '\n', (size_t)(end - p));
+
+            if (newline == NULL) {
+                /* Partial line, completed by the next read */
+                if (!eof) {
+                    break;
+                }
+                newline = end;
+            }
+            counters.lines++;
+            if (import_line(format, p, newline, visit, context, &counters) != 0) {
+                fprintf(stderr, "%s:%llu: syntax error\n", path,
+                        (unsigned long long)counters.lines);
+                status = -1;
+                break;
+            }
+            p = newline < end ? newline + 1 : end;
+        }
+
+        /* Move the partial line to the front */
+        fill = (size_t)(end - p);
+        if (status == 0 && fill == TRACE_IMPORT_BUFFER) {
+            fprintf(stderr, "%s:%llu: line too long\n", path,
+                    (unsigned long long)counters.lines + 1);
+            status = -1;
+        }
+        memmove(buffer, p, fill);
+    }
+
+    free(buffer);
+    fclose(file);
+    if (import != NULL) {
+        *import = counters;
+    }
+
+    return status == 0 ? (int64_t)counters.records : -1;
+}
@@ -0,0 +1,100 @@
+/* ----------------------------------------------------------------------------
+ * --  _____       ______  _____                                              -
+ * -- |_   _|     |  ____|/ ____|                                             -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems              -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of                       -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                           -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland               -
+ * ------------------------------------------------------------------------- */
+
+/* Trace importers
+ *
+ * Streaming parsers for the traces of other tools:
+ *
+ *   din     Dinero IV "label address [size]", label 0 read, 1 write,
+ *           2 instruction fetch, 3 and 4 escapes; the address is hex
+ *           without 0x, the size decimal
+ *   lackey  valgrind --tool=lackey --trace-mem=yes, lines " L addr,size",
+ *           " S addr,size", " M addr,size" (a read then a write of the
+ *           same bytes) and "I  addr,size"; "==pid==" lines are skipped
+ *   pin     "[ip:] R|W address [size]" as written by a pinatrace style
+ *           tool, hex addresses with or without 0x, the size decimal
+ *
+ * Instruction fetches and escapes are skipped, the model is a data
+ * cache. A missing size is TRACE_IMPORT_SIZE bytes, 64 bit addresses
+ * keep their low 32 bits and accesses over 255 bytes are split into
+ * several records. A record may still cross a line, the replay splits
+ * it into one access per block.
+ *
+ * The file is read in TRACE_IMPORT_BUFFER blocks and parsed in place,
+ * nothing is allocated per line.
+ */
+
+#ifndef TRACE_IMPORT_H_
+#define TRACE_IMPORT_H_
+
+#include <stdint.h>
+
+/* User includes */
+#include "trace.h"
+
+/* Formats */
+#define TRACE_FORMAT_DIN    0
+#define TRACE_FORMAT_LACKEY 1
+#define TRACE_FORMAT_PIN    2
+
+/* Bytes of the read buffer, also the longest line */
+#define TRACE_IMPORT_BUFFER (1u << 20)
+
+/* Size of an access whose line has none */
+#define TRACE_IMPORT_SIZE   4
+
+/* TraceImport
+ *
+ * Counters of an import
+ */
+struct TraceImport {
+    uint64_t lines;
+    uint64_t records;
+    uint64_t skipped;                   /* Instruction fetches, escapes, comments */
+    uint64_t bytes;
+};
+
+/* trace_format_parse
+ *
+ * Look up a format by name
+ *
+ * @param       name        "din", "lackey" or "pin"
+ *
+ * @return      TRACE_FORMAT_*, -1 if unknown
+ */
+int trace_format_parse(const char *name);
+
+/* trace_format_name
+ *
+ * Name of a format
+ *
+ * @param       format      TRACE_FORMAT_*
+ *
+ * @return      name
+ */
+const char *trace_format_name(int format);
+
+/* trace_import
+ *
+ * Stream the records of a foreign trace through a callback
+ *
+ * @param       path
+ * @param       format      TRACE_FORMAT_*
+ * @param       visit       Called for every record
+ * @param       context     Passed to visit
+ * @param       import      Gets the counters, may be NULL
+ *
+ * @return      number of records, -1 on error
+ */
+int64_t trace_import(const char *path, int format,
+                     void (*visit)(void *context, const struct TraceRecord *record), void *context,
+                     struct TraceImport *import);
+
+#endif
+/* TRACE_IMPORT_H_ */
@@ -0,0 +1,234 @@
+/* ------------------------------------------------------------------
+ * --  _____       ______  _____                                    -
+ * -- |_   _|     |  ____|/ ____|                                   -
+ * --   | |  _ __ | |__  | (___    Institute of Embedded Systems    -
+ * --   | | | '_ \|  __|  \___ \   Zurich University of             -
+ * --  _| |_| | | | |____ ____) |  Applied Sciences                 -
+ * -- |_____|_| |_|______|_____/   8401 Winterthur, Switzerland     -
+ * ------------------------------------------------------------------
+ * --
+ * -- Project     : MC1 Cache, victim cache comparison
+ * --
+ * -- Usage       : victimsim [-o offset] [-s index] [-w ways]
+ * --                         [-r replacement] [trace]
+ * --               Streams the trace once through the base cache,
+ * --               the base cache with 1 to 16 victim entries and
+ * --               caches with 2 and 4 times the ways, once with
+ * --               the same sets and once with the same lines. The
+ * --               geometry defaults to config.h, without a trace
+ * --               the a = b + c kernel of main.c is simulated.
+ * --------------------------------------------------------------- */
+
+#include <string.h>
+#include <unistd.h>
+
+/* User includes */
+#include "sim_host.h"
+#include "trace_bin.h"
+#include "config.h"
+
+/* Victim entries and way factors of the candidates */
+static const uint8_t victim_entries[] = { 1, 2, 4, 8, 16 };
+static const uint8_t way_factors[] = { 2, 4 };
+
+/* Most candidates: base, victim caches, two per way factor */
+#define CANDIDATES_MAX (1 + sizeof(victim_entries) + 2 * sizeof(way_factors))
+
+/* Candidate
+ *
+ * One simulated cache
+ */
+struct Candidate {
+    cache_t *cache;
+    struct VictimCache victim;
+    uint8_t entries;            /* Victim entries, 0 for none */
+};
+
+/* Context of the trace callback */
+struct Comparison {
+    struct Candidate candidate[CANDIDATES_MAX];
+    uint32_t count;
+    uint64_t accesses;
+};
+
+/* compare_visit
+ *
+ * Run a record through every candidate, block by block
+ *
+ * @param       context     struct Comparison
+ * @param       record
+ *
+ * @return      void
+ */
+static void compare_visit(void *context, const struct TraceRecord *record)
+{
+    /* Local Variables */
+    struct Comparison *comparison = context;
+    uint32_t c;
+
+    for (c = 0; c < comparison->count; c++) {
+        cache_t *cache = comparison->candidate[c].cache;
+        uint32_t offset = cache->config.offset;
+        uint32_t address = record->address;
+        uint32_t last = (record->address + (record->size ? record->size : 1) - 1) >> offset;
+
+        while (1) {
+            cache_access(cache, address, (access_t)record->access,
+                         trace_block_bytes(record, address, offset));
+            comparison->accesses += c == 0;
+            if ((address >> offset) == last) {
+                break;
+            }
+            address = ((address >> offset) + 1) << offset;
+        }
+    }
+}
+
+/* add_candidate
+ *
+ * Create a candidate cache
+ *
+ * @param       comparison
+ * @param       config
+ * @param       entries     Victim entries, 0 for none
+ *
+ * @return      0 on success, -1 on an invalid config or no memory
+ */
+static int add_candidate(struct Comparison *comparison, const struct CacheConfig *config,
+                         uint8_t entries)
+{
+    /* Local Variables */
+    struct Candidate *candidate = &comparison->candidate[comparison->count];
+
+    candidate->cache = cache_create(config);
+    if (candidate->cache == NULL) {
+        return -1;
+    }
+    candidate->entries = entries;
+    if (entries && cache_attach_victim(candidate->cache, &candidate->victim, entries) != 0) {
+        cache_destroy(candidate->cache);
+        return -1;
+    }
+    comparison->count++;
+
+    return 0;
+}
+
+/* Main */
+int main(int argc, char *argv[])
+{
+    /* Local Variables */
+    static struct Comparison comparison;
+    struct CacheConfig base;
+    struct Trace trace;
+    const char *path = NULL;
+    int64_t records = 0;
+    uint32_t c;
+    size_t i;
+    int option;
+
+    memset(&base, 0, sizeof(base));
+    base.offset = OFFSET;
+    base.index = INDEX;
+    base.ways = WAYS;
+    base.replacement = REPLACEMENT;
+    base.write_policy = WRITE_POLICY;
+    base.write_miss = WRITE_MISS;
+
+    while ((option = getopt(argc, argv, "o:s:w:r:")) != -1) {
+        switch (option) {
+            case 'o':
+                base.offset = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                base.index = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                base.ways = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                base.replacement = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind++];
+    }
+    if (optind < argc) {
+        fprintf(stderr, "usage: %s [-o offset] [-s index] [-w ways] [-r replacement] [trace]\n",
+                argv[0]);
+        return 2;
+    }
+
+    /* Base cache and victim caches behind it */
+    if (add_candidate(&comparison, &base, 0) != 0) {
+        fprintf(stderr, "invalid cache config or out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < sizeof(victim_entries); i++) {
+        if (add_candidate(&comparison, &base, victim_entries[i]) != 0) {
+            fprintf(stderr, "victim cache needs an offset of at least 2\n");
+            return 1;
+        }
+    }
+
+    /* More ways, skipped where the geometry does not allow them */
+    for (i = 0; i < sizeof(way_factors); i++) {
+        struct CacheConfig config = base;
+        uint32_t shift = __builtin_ctz(way_factors[i]);
+
+        config.ways = (uint8_t)(base.ways * way_factors[i]);
+        if (base.ways * way_factors[i] <= MAX_WAYS) {
+            add_candidate(&comparison, &config, 0);
+            config.index = (uint8_t)(base.index - shift);
+            if (base.index >= shift) {
+                add_candidate(&comparison, &config, 0);
+            }
+        }
+    }
+
+    if (path != NULL) {
+        records = trace_stream(path, compare_visit, &comparison);
+    } else {
+        trace_init(&trace);
+        if (trace_kernel(&trace) != 0) {
+            records = -1;
+        }
+        for (i = 0; records >= 0 && i < trace.count; i++) {
+            compare_visit(&comparison, &trace.records[i]);
+        }
+        records = records < 0 ? records : (int64_t)trace.count;
+        trace_free(&trace);
+    }
+    if (records < 0) {
+        fprintf(stderr, "trace error\n");
+        return 1;
+    }
+
+    printf("ACCESSES: %llu\n", (unsigned long long)comparison.accesses);
+    printf("%-7s %-5s %-5s %-7s %6s %10s %10s %9s %12s\n", "OFFSET", "INDEX", "WAYS", "VICTIM",
+           "LINES", "MISSES", "VICTIM HIT", "MEMORY %", "TRAFFIC B");
+    for (c = 0; c < comparison.count; c++) {
+        struct Candidate *candidate = &comparison.candidate[c];
+        cache_t *cache = candidate->cache;
+        struct MemoryTraffic traffic = cache->traffic;
+        uint64_t misses = cache->hit_miss.misses;
+        uint64_t recovered = candidate->entries ? candidate->victim.hit_miss.hits : 0;
+
+        /* Dirty lines left at the end still cost a write-back */
+        cache_flush(cache, &traffic);
+        printf("%-7u %-5u %-5u %-7u %6u %10llu %10llu %9.4f %12llu\n", cache->config.offset,
+               cache->config.index, cache->config.ways, candidate->entries,
+               cache->set_count * cache->config.ways + candidate->entries,
+               (unsigned long long)misses, (unsigned long long)recovered,
+               comparison.accesses ? 100.0 * (misses - recovered) / comparison.accesses : 0.0,
+               (unsigned long long)(traffic.fill_bytes + traffic.write_through_bytes +
+                                    traffic.writeback_bytes));
+        cache_destroy(cache);
+    }
+
+    return 0;
+}